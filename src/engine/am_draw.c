@@ -33,6 +33,10 @@
 #include "r_clipper.h"
 #include "r_drawlist.h"
 #include "dgl.h"
+#include "doomstat.h"
+#include "m_misc.h"
+#include "z_zone.h"
+#include "con_console.h"
 
 extern fixed_t automappanx;
 extern fixed_t automappany;
@@ -40,8 +44,11 @@ extern byte amModeCycle;
 
 static angle_t am_viewangle;
 
+static void AM_CullCells(float scale);
+
 CVAR_EXTERNAL(am_fulldraw);
 CVAR_EXTERNAL(am_ssect);
+CVAR_EXTERNAL(am_showkeycolors);
 CVAR_EXTERNAL(r_texturecombiner);
 
 //
@@ -50,6 +57,8 @@ CVAR_EXTERNAL(r_texturecombiner);
 
 void AM_BeginDraw(angle_t view, fixed_t x, fixed_t y) {
 	float fov;
+	rfloat proj[16];
+	rfloat modelview[16];
 	extern float scale;
 
 	I_ShaderUnBind();
@@ -62,23 +71,27 @@ void AM_BeginDraw(angle_t view, fixed_t x, fixed_t y) {
 	}
 
 	dglDepthRange(0.0f, 0.0f);
-	dglMatrixMode(GL_PROJECTION);
-	dglLoadIdentity();
-
 	fov = 45.0f * (scale / 200.0f);
 	if (fov > 170.0f) {
 		fov = 170.0f;
 	}
 
-	dglViewFrustum(video_width, video_height, fov, 0.1f);
+	dglMakeViewFrustum(video_width, video_height, fov, 0.1f, proj);
+	dglMatrixMode(GL_PROJECTION);
+	dglLoadMatrixf(proj);
+
+	dglMatrixIdentity(modelview);
+	dglMatrixTranslate(modelview, -F2D3D(automappanx), -F2D3D(automappany), 0);
+	dglMatrixRotate(modelview, -(float)TRUEANGLES(am_viewangle), 0.0f, 0.0f, 1.0f);
+	dglMatrixTranslate(modelview, -F2D3D(x), -F2D3D(y), 0);
+
 	dglMatrixMode(GL_MODELVIEW);
 	dglLoadIdentity();
 	dglPushMatrix();
-	dglTranslatef(-F2D3D(automappanx), -F2D3D(automappany), 0);
-	dglRotatef(-(float)TRUEANGLES(am_viewangle), 0.0f, 0.0f, 1.0f);
-	dglTranslatef(-F2D3D(x), -F2D3D(y), 0);
+	dglLoadMatrixf(modelview);
 	drawlist[DLT_AMAP].index = 0;
-	R_FrustrumSetup();
+	R_FrustrumSetup(proj, modelview);
+	AM_CullCells(scale);
 	GL_ResetTextures();
 }
 
@@ -99,6 +112,515 @@ void AM_EndDraw(void) {
     GL_SetDefaultCombiner();
 	}
 
+//
+// RETAINED LINE BUFFERS
+//
+// Lines, subsector outlines and leafs are bucketed into coarse cells
+// when the level loads. A cell keeps the vertices of its shown lines
+// and only rebuilds them when one of its lines gets mapped or the
+// reveal rules change. Cells in view are gathered into one array per
+// line type and drawn with a single call.
+//
+
+#define AMCELLSHIFT     (FRACBITS + 10)     // 1024 map units
+
+#define AMD_WALLS       1
+#define AMD_OUTLINES    2
+
+typedef struct {
+	fixed_t     bbox[4];
+	int         firstline;      // into amcelllines, two vertices each in amwallvtx
+	int         numlines;
+	int         firstseg;       // seg slots of its subsectors, two vertices each in amoutlinevtx
+	int         numsegs;
+	int         firstsub;       // into amcellsubs
+	int         numsubs;
+	int         numwallvtx;
+	int         numoutlinevtx;
+	byte        dirty;
+} amcell_t;
+
+typedef struct {
+	int         walls;
+	int         outlines;
+	int         cells;
+	int         drawcalls;
+	int         rebuilds;
+} amlinestats_t;
+
+static amcell_t*        amcells = NULL;
+static int              amnumcells;
+static int              amcellsx;
+static int              amcellsy;
+static fixed_t          amorgx;
+static fixed_t          amorgy;
+static int*             amcelllines;
+static int*             amcellsubs;
+static int*             amlinecell;         // cell holding each line's wall
+static int*             amlinefirst;        // line -> cells holding its outlines
+static int*             amlinecells;
+static vtx_t*           amwallvtx;
+static vtx_t*           amoutlinevtx;
+static vtx_t*           amframevtx;
+static int*             amvisiblecells;
+static int              amnumvisible;
+static int              amlinekey = -1;
+static amlinestats_t    amlinestats;
+
+//
+// AM_CellForPoint
+//
+
+static int AM_CellForPoint(fixed_t x, fixed_t y) {
+	int cx = (x - amorgx) >> AMCELLSHIFT;
+	int cy = (y - amorgy) >> AMCELLSHIFT;
+
+	cx = MAX(0, MIN(cx, amcellsx - 1));
+	cy = MAX(0, MIN(cy, amcellsy - 1));
+
+	return cy * amcellsx + cx;
+}
+
+//
+// AM_CellForSubsector
+//
+
+static int AM_CellForSubsector(subsector_t* sub) {
+	int64_t x = 0;
+	int64_t y = 0;
+	int j;
+
+	if (!sub->numleafs) {
+		return AM_CellForPoint(segs[sub->firstline].v1->x, segs[sub->firstline].v1->y);
+	}
+
+	for (j = 0; j < sub->numleafs; j++) {
+		x += leafs[sub->leaf + j].vertex->x;
+		y += leafs[sub->leaf + j].vertex->y;
+	}
+
+	return AM_CellForPoint((fixed_t)(x / sub->numleafs), (fixed_t)(y / sub->numleafs));
+}
+
+//
+// AM_IsOutlineSeg
+// Only one-sided and secret lines get a white outline. Checked at
+// rebuild time since specials can change line flags
+//
+
+static boolean AM_IsOutlineSeg(seg_t* seg) {
+	return seg->linedef && ((seg->linedef->flags & ML_SECRET) || !seg->linedef->backsector);
+}
+
+//
+// AM_SetupLevelLines
+//
+
+void AM_SetupLevelLines(void) {
+	fixed_t maxx;
+	fixed_t maxy;
+	int* subcell;
+	int* fill;
+	int numoutlines;
+	int i;
+	int j;
+
+	if (!numvertexes) {
+		amcells = NULL;
+		return;
+	}
+
+	amorgx = maxx = vertexes[0].x;
+	amorgy = maxy = vertexes[0].y;
+
+	for (i = 1; i < numvertexes; i++) {
+		amorgx = MIN(amorgx, vertexes[i].x);
+		amorgy = MIN(amorgy, vertexes[i].y);
+		maxx = MAX(maxx, vertexes[i].x);
+		maxy = MAX(maxy, vertexes[i].y);
+	}
+
+	amcellsx = ((maxx - amorgx) >> AMCELLSHIFT) + 1;
+	amcellsy = ((maxy - amorgy) >> AMCELLSHIFT) + 1;
+	amnumcells = amcellsx * amcellsy;
+
+	amcells = (amcell_t*)Z_Calloc(sizeof(amcell_t) * amnumcells, PU_LEVEL, 0);
+	amvisiblecells = (int*)Z_Malloc(sizeof(int) * amnumcells, PU_LEVEL, 0);
+	amlinecell = (int*)Z_Malloc(sizeof(int) * numlines, PU_LEVEL, 0);
+	subcell = (int*)Z_Malloc(sizeof(int) * numsubsectors, PU_STATIC, 0);
+	fill = (int*)Z_Malloc(sizeof(int) * MAX(amnumcells, numlines + 1), PU_STATIC, 0);
+
+	for (i = 0; i < amnumcells; i++) {
+		M_ClearBox(amcells[i].bbox);
+	}
+
+	//
+	// count lines, subsectors and segs per cell
+	//
+	for (i = 0; i < numlines; i++) {
+		line_t* l = &lines[i];
+		amcell_t* cell;
+
+		amlinecell[i] = AM_CellForPoint((l->v1->x >> 1) + (l->v2->x >> 1),
+			(l->v1->y >> 1) + (l->v2->y >> 1));
+
+		cell = &amcells[amlinecell[i]];
+		cell->numlines++;
+		M_AddToBox(cell->bbox, l->v1->x, l->v1->y);
+		M_AddToBox(cell->bbox, l->v2->x, l->v2->y);
+	}
+
+	numoutlines = 0;
+
+	for (i = 0; i < numsubsectors; i++) {
+		subsector_t* sub = &subsectors[i];
+		amcell_t* cell;
+
+		subcell[i] = AM_CellForSubsector(sub);
+		cell = &amcells[subcell[i]];
+		cell->numsubs++;
+
+		for (j = 0; j < sub->numleafs; j++) {
+			vertex_t* vertex = leafs[sub->leaf + j].vertex;
+			M_AddToBox(cell->bbox, vertex->x, vertex->y);
+		}
+
+		for (j = 0; j < sub->numlines; j++) {
+			seg_t* seg = &segs[sub->firstline + j];
+
+			if (seg->linedef) {
+				M_AddToBox(cell->bbox, seg->linedef->v1->x, seg->linedef->v1->y);
+				M_AddToBox(cell->bbox, seg->linedef->v2->x, seg->linedef->v2->y);
+			}
+		}
+
+		cell->numsegs += sub->numlines;
+		numoutlines += sub->numlines;
+	}
+
+	//
+	// lay the cells out back to back
+	//
+	for (i = 0, j = 0; i < amnumcells; i++) {
+		amcells[i].firstline = j;
+		j += amcells[i].numlines;
+	}
+	for (i = 0, j = 0; i < amnumcells; i++) {
+		amcells[i].firstsub = j;
+		j += amcells[i].numsubs;
+	}
+	for (i = 0, j = 0; i < amnumcells; i++) {
+		amcells[i].firstseg = j;
+		j += amcells[i].numsegs;
+		amcells[i].dirty = AMD_WALLS | AMD_OUTLINES;
+	}
+
+	amcelllines = (int*)Z_Malloc(sizeof(int) * MAX(numlines, 1), PU_LEVEL, 0);
+	amcellsubs = (int*)Z_Malloc(sizeof(int) * MAX(numsubsectors, 1), PU_LEVEL, 0);
+
+	for (i = 0; i < amnumcells; i++) {
+		fill[i] = 0;
+	}
+	for (i = 0; i < numlines; i++) {
+		amcell_t* cell = &amcells[amlinecell[i]];
+		amcelllines[cell->firstline + fill[amlinecell[i]]++] = i;
+	}
+
+	for (i = 0; i < amnumcells; i++) {
+		fill[i] = 0;
+	}
+	for (i = 0; i < numsubsectors; i++) {
+		amcell_t* cell = &amcells[subcell[i]];
+		amcellsubs[cell->firstsub + fill[subcell[i]]++] = i;
+	}
+
+	//
+	// mapping a line can reveal the outline of every subsector
+	// it has a seg in
+	//
+	amlinefirst = (int*)Z_Calloc(sizeof(int) * (numlines + 1), PU_LEVEL, 0);
+	amlinecells = (int*)Z_Malloc(sizeof(int) * MAX(numsegs, 1), PU_LEVEL, 0);
+
+	for (i = 0; i < numsubsectors; i++) {
+		for (j = 0; j < subsectors[i].numlines; j++) {
+			seg_t* seg = &segs[subsectors[i].firstline + j];
+
+			if (seg->linedef) {
+				amlinefirst[(seg->linedef - lines) + 1]++;
+			}
+		}
+	}
+	for (i = 0; i < numlines; i++) {
+		amlinefirst[i + 1] += amlinefirst[i];
+		fill[i] = 0;
+	}
+	for (i = 0; i < numsubsectors; i++) {
+		for (j = 0; j < subsectors[i].numlines; j++) {
+			seg_t* seg = &segs[subsectors[i].firstline + j];
+			int line;
+
+			if (!seg->linedef) {
+				continue;
+			}
+
+			line = seg->linedef - lines;
+			amlinecells[amlinefirst[line] + fill[line]++] = subcell[i];
+		}
+	}
+
+	amwallvtx = (vtx_t*)Z_Calloc(sizeof(vtx_t) * 2 * MAX(numlines, 1), PU_LEVEL, 0);
+	amoutlinevtx = (vtx_t*)Z_Calloc(sizeof(vtx_t) * 2 * MAX(numoutlines, 1), PU_LEVEL, 0);
+	amframevtx = (vtx_t*)Z_Calloc(sizeof(vtx_t) * 2 * MAX(MAX(numlines, numoutlines), 1), PU_LEVEL, 0);
+
+	Z_Free(subcell);
+	Z_Free(fill);
+
+	amlinekey = -1;
+	amnumvisible = 0;
+}
+
+//
+// AM_MarkLineDirty
+// Called when a line's flags change, usually as it gets ML_MAPPED
+//
+
+void AM_MarkLineDirty(line_t* line) {
+	int num;
+	int i;
+
+	if (!amcells) {
+		return;
+	}
+
+	num = line - lines;
+	amcells[amlinecell[num]].dirty |= AMD_WALLS;
+
+	for (i = amlinefirst[num]; i < amlinefirst[num + 1]; i++) {
+		amcells[amlinecells[i]].dirty |= AMD_OUTLINES;
+	}
+}
+
+//
+// AM_InvalidateLines
+// Line or sector flags changed wholesale (savegames, specials)
+//
+
+void AM_InvalidateLines(void) {
+	int i;
+
+	if (!amcells) {
+		return;
+	}
+
+	for (i = 0; i < amnumcells; i++) {
+		amcells[i].dirty = AMD_WALLS | AMD_OUTLINES;
+	}
+}
+
+//
+// AM_SetLineVertex
+//
+
+static void AM_SetLineVertex(vtx_t* v, line_t* l, rcolor c) {
+	v[0].x = F2D3D(l->v1->x);
+	v[0].y = F2D3D(l->v1->y);
+	v[0].z = 0;
+	v[1].x = F2D3D(l->v2->x);
+	v[1].y = F2D3D(l->v2->y);
+	v[1].z = 0;
+	dglSetVertexColor(v, c, 2);
+}
+
+//
+// AM_RebuildCell
+//
+
+static void AM_RebuildCell(amcell_t* cell, byte dirty) {
+	int i;
+	int j;
+	int n;
+	rcolor color;
+
+	if (dirty & AMD_WALLS) {
+		vtx_t* v = &amwallvtx[cell->firstline * 2];
+
+		for (i = 0, n = 0; i < cell->numlines; i++) {
+			line_t* l = &lines[amcelllines[cell->firstline + i]];
+
+			if (AM_GetLineColor(l, &color)) {
+				AM_SetLineVertex(&v[n], l, color);
+				n += 2;
+			}
+		}
+
+		cell->numwallvtx = n;
+	}
+
+	if (dirty & AMD_OUTLINES) {
+		vtx_t* v = &amoutlinevtx[cell->firstseg * 2];
+
+		for (i = 0, n = 0; i < cell->numsubs; i++) {
+			subsector_t* sub = &subsectors[amcellsubs[cell->firstsub + i]];
+
+			if (!AM_SubsectorRevealed(sub)) {
+				continue;
+			}
+
+			for (j = 0; j < sub->numlines; j++) {
+				seg_t* seg = &segs[sub->firstline + j];
+
+				if (AM_IsOutlineSeg(seg)) {
+					AM_SetLineVertex(&v[n], seg->linedef, WHITE);
+					n += 2;
+				}
+			}
+		}
+
+		cell->numoutlinevtx = n;
+	}
+
+	cell->dirty &= ~dirty;
+	amlinestats.rebuilds++;
+}
+
+//
+// AM_CullCells
+//
+
+static void AM_CullCells(float scale) {
+	fixed_t z;
+	int i;
+
+	amnumvisible = 0;
+
+	if (!amcells) {
+		return;
+	}
+
+	z = (fixed_t)(-(scale * 2) * FRACUNIT);
+	R_FrustrumSetHeights(z, z);
+
+	for (i = 0; i < amnumcells; i++) {
+		if (amcells[i].numlines + amcells[i].numsubs == 0) {
+			continue;
+		}
+
+		if (R_FrustrumTestBox(amcells[i].bbox)) {
+			amvisiblecells[amnumvisible++] = i;
+		}
+	}
+
+	amlinestats.walls = 0;
+	amlinestats.outlines = 0;
+	amlinestats.drawcalls = 0;
+	amlinestats.cells = amnumvisible;
+}
+
+//
+// AM_LineWidth
+//
+
+static float AM_LineWidth(void) {
+	if (video_width >= 3840) {
+		return 3.0f;
+	}
+	else if (video_width >= 2560) {
+		return 2.0f;
+	}
+	else if (video_width >= 1920) {
+		return 1.5f;
+	}
+
+	return 1.0f;
+}
+
+//
+// AM_DrawLineBatch
+//
+
+void AM_DrawLineBatch(amlinetype_t type, float scale) {
+	byte dirty = (type == AML_WALLS) ? AMD_WALLS : AMD_OUTLINES;
+	int key;
+	int count;
+	int i;
+
+	if (!amcells) {
+		return;
+	}
+
+	key = (am_fulldraw.value != 0) | (AM_RevealAll() << 1) | ((am_showkeycolors.value != 0) << 2);
+	if (key != amlinekey) {
+		AM_InvalidateLines();
+		amlinekey = key;
+	}
+
+	count = 0;
+
+	for (i = 0; i < amnumvisible; i++) {
+		amcell_t* cell = &amcells[amvisiblecells[i]];
+
+		if (cell->dirty & dirty) {
+			AM_RebuildCell(cell, cell->dirty & dirty);
+		}
+
+		if (type == AML_WALLS) {
+			dmemcpy(&amframevtx[count], &amwallvtx[cell->firstline * 2], sizeof(vtx_t) * cell->numwallvtx);
+			count += cell->numwallvtx;
+		}
+		else {
+			dmemcpy(&amframevtx[count], &amoutlinevtx[cell->firstseg * 2], sizeof(vtx_t) * cell->numoutlinevtx);
+			count += cell->numoutlinevtx;
+		}
+	}
+
+	if (type == AML_WALLS) {
+		amlinestats.walls = count / 2;
+	}
+	else {
+		amlinestats.outlines = count / 2;
+	}
+
+	if (!count) {
+		return;
+	}
+
+	dglDisable(GL_TEXTURE_2D);
+	dglLineWidth(AM_LineWidth());
+	dglPushMatrix();
+	dglTranslatef(0, 0, -(scale * 2));
+
+	dglSetVertex(amframevtx);
+	dglDrawArrays(GL_LINES, 0, count);
+	statdrawcalls++;
+	amlinestats.drawcalls++;
+
+	dglPopMatrix();
+	dglLineWidth(1.0f);
+	dglEnable(GL_TEXTURE_2D);
+
+	if (devparm) {
+		vertCount += count;
+	}
+}
+
+//
+// AM_PrintLineStats
+//
+
+void AM_PrintLineStats(void) {
+	if (!amcells) {
+		CON_Printf(WHITE, "No level has been loaded\n");
+		return;
+	}
+
+	CON_Printf(GREEN, "Automap lines (last frame):\n");
+	CON_Printf(AQUA, "walls:       %i / %i\n", amlinestats.walls, numlines);
+	CON_Printf(AQUA, "outlines:    %i\n", amlinestats.outlines);
+	CON_Printf(AQUA, "cells:       %i / %i\n", amlinestats.cells, amnumcells);
+	CON_Printf(AQUA, "draw calls:  %i\n", amlinestats.drawcalls);
+	CON_Printf(AQUA, "rebuilds:    %i total\n", amlinestats.rebuilds);
+}
+
 //
 // DL_ProcessAutomap
 //
@@ -196,50 +718,56 @@ static boolean DL_ProcessAutomap(vtxlist_t* vl, int* drawcount) {
 void AM_DrawLeafs(float scale) {
 	subsector_t* sub;
 	drawlist_t* am_drawlist;
+	amcell_t* cell;
+	int c;
 	int i;
 	int j;
 
 	am_drawlist = &drawlist[DLT_AMAP];
 
-	for (i = 0; i < numsubsectors; i++) {
-		sub = &subsectors[i];
+	for (c = 0; c < amnumvisible; c++) {
+		cell = &amcells[amvisiblecells[c]];
 
-		//
-		// don't add sky flats
-		//
-		if (sub->sector->floorpic == skyflatnum) {
-			continue;
-		}
+		for (i = 0; i < cell->numsubs; i++) {
+			sub = &subsectors[amcellsubs[cell->firstsub + i]];
 
-		//
-		// must be mapped
-		//
-		if (segs[sub->firstline].linedef->flags & ML_MAPPED || amCheating) {
 			//
-			// add to draw list if visible
+			// don't add sky flats
 			//
-			if (!(sub->sector->flags & MS_HIDESSECTOR) || am_fulldraw.value) {
-				vtxlist_t* list;
-				vtx_t* v = &drawVertex[0];
-
-				for (j = 0; j < sub->numleafs; j++) {
-					vertex_t* vertex;
-
-					vertex = leafs[sub->leaf + j].vertex;
-
-					v[j].x = F2D3D(vertex->x);
-					v[j].y = F2D3D(vertex->y);
-					v[j].z = -(scale * 2);
-				}
+			if (sub->sector->floorpic == skyflatnum) {
+				continue;
+			}
 
-				if (!R_FrustrumTestVertex(v, sub->numleafs)) {
-					continue;
+			//
+			// must be mapped
+			//
+			if (segs[sub->firstline].linedef->flags & ML_MAPPED || amCheating) {
+				//
+				// add to draw list if visible
+				//
+				if (!(sub->sector->flags & MS_HIDESSECTOR) || am_fulldraw.value) {
+					vtxlist_t* list;
+					vtx_t* v = &drawVertex[0];
+
+					for (j = 0; j < sub->numleafs; j++) {
+						vertex_t* vertex;
+
+						vertex = leafs[sub->leaf + j].vertex;
+
+						v[j].x = F2D3D(vertex->x);
+						v[j].y = F2D3D(vertex->y);
+						v[j].z = -(scale * 2);
+					}
+
+					if (!R_FrustrumTestVertex(v, sub->numleafs)) {
+						continue;
+					}
+
+					list = DL_AddVertexList(am_drawlist);
+					list->data = (subsector_t*)sub;
+					list->callback = NULL;
+					list->texid = sub->sector->floorpic;
 				}
-
-				list = DL_AddVertexList(am_drawlist);
-				list->data = (subsector_t*)sub;
-				list->callback = NULL;
-				list->texid = sub->sector->floorpic;
 			}
 		}
 	}
@@ -278,18 +806,6 @@ void AM_DrawLeafs(float scale) {
 
 void AM_DrawLine(int x1, int x2, int y1, int y2, float scale, rcolor c) {
 	vtx_t v[2];
-	float linewidth;
-
-	linewidth = 1.0f;
-	if (video_width >= 3840) {
-		linewidth = 3.0f;
-	}
-	else if (video_width >= 2560) {
-		linewidth = 2.0f;
-	}
-	else if (video_width >= 1920) {
-		linewidth = 1.5f;
-	}
 
 	v[0].x = F2D3D(x1);
 	v[0].z = F2D3D(y1);
@@ -298,7 +814,7 @@ void AM_DrawLine(int x1, int x2, int y1, int y2, float scale, rcolor c) {
 	v[0].y = v[1].y = (scale * 2);
 	dglSetVertexColor(v, c, 2);
 	dglDisable(GL_TEXTURE_2D);
-	dglLineWidth(linewidth);  // Add this line
+	dglLineWidth(AM_LineWidth());
 	dglBegin(GL_LINES);
 	dglColor4ub(v[0].r, v[0].g, v[0].b, v[0].a);
 	dglVertex3f(v[0].x, v[0].z, -v[0].y);
@@ -29,6 +29,7 @@
 #include "p_mobj.h"
 #include "doomtype.h"
 #include "gl_main.h"
+#include "t_bsp.h"
 
 void AM_BeginDraw(angle_t view, fixed_t x, fixed_t y);
 void AM_EndDraw(void);
@@ -37,4 +38,23 @@ void AM_DrawLine(int x1, int x2, int y1, int y2, float scale, rcolor c);
 void AM_DrawTriangle(mobj_t* mobj, float scale, boolean solid, byte r, byte g, byte b);
 void AM_DrawSprite(mobj_t* thing, float scale);
 
+//
+// Retained line buffers, built once per level
+//
+typedef enum {
+	AML_WALLS,      // linedefs, colored by type
+	AML_OUTLINES    // white subsector outlines for overlay mode
+} amlinetype_t;
+
+void AM_SetupLevelLines(void);
+void AM_MarkLineDirty(line_t* line);
+void AM_InvalidateLines(void);
+void AM_DrawLineBatch(amlinetype_t type, float scale);
+void AM_PrintLineStats(void);
+
+// Visibility and color rules, in am_map.c
+boolean AM_RevealAll(void);
+boolean AM_SubsectorRevealed(subsector_t* sub);
+boolean AM_GetLineColor(line_t* l, rcolor* out);
+
 #endif
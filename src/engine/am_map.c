@@ -175,6 +175,14 @@ static CMD(AutomapFollow) {
 	}
 }
 
+//
+// CMD_AutomapStats
+//
+
+static CMD(AutomapStats) {
+	AM_PrintLineStats();
+}
+
 //
 // AM_Reset
 //
@@ -525,13 +533,43 @@ void AM_Ticker(void) {
 	}
 }
 
+//
+// AM_RevealAll
+// True when the computer map or the map cheat shows lines that
+// haven't been seen yet
+//
+
+boolean AM_RevealAll(void) {
+	return (plr && plr->powers[pw_allmap]) || amCheating;
+}
+
+//
+// AM_SubsectorRevealed
+// If the subsector has at least one seg that is mapped, then the
+// white outline is drawn for the entire subsector in overlay mode
+//
+
+boolean AM_SubsectorRevealed(subsector_t* sub) {
+	int p;
+
+	if (sub->sector->flags & MS_HIDESSECTOR) {
+		return false;
+	}
+
+	for (p = 0; p < sub->numlines; p++) {
+		if (segs[sub->firstline + p].linedef->flags & ML_MAPPED || AM_RevealAll()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 //
 // AM_DrawMapped
 //
 
 static void AM_DrawMapped(void) {
-	int i;
-
 	//
 	// draw textured subsectors for automap
 	//
@@ -541,50 +579,7 @@ static void AM_DrawMapped(void) {
 	// draw white outlines around the subsectors for overlay mode
 	//
 	if (am_overlay.value) {
-		fixed_t x1;
-		fixed_t x2;
-		fixed_t y1;
-		fixed_t y2;
-		seg_t* seg;
-		int j;
-		int p;
-
-		for (j = 0; j < numsubsectors; j++) {
-			if (subsectors[j].sector->flags & MS_HIDESSECTOR) {
-				continue;
-			}
-
-			for (p = 0; p < subsectors[j].numlines; p++) {
-				seg = &segs[subsectors[j].firstline + p];
-
-				//
-				// if the subsector has at least one seg that is mapped, then
-				// draw the white outline for the entire subsector
-				//
-				if (seg->linedef->flags & ML_MAPPED ||
-					(plr->powers[pw_allmap] || amCheating)) {
-					for (i = 0; i < subsectors[j].numlines; i++) {
-						seg = &segs[subsectors[j].firstline + i];
-
-						if (!(seg->linedef->flags & ML_SECRET) && seg->linedef->backsector) {
-							continue;
-						}
-
-						x1 = seg->linedef->v1->x;
-						y1 = seg->linedef->v1->y;
-						x2 = seg->linedef->v2->x;
-						y2 = seg->linedef->v2->y;
-
-						AM_DrawLine(x1, x2, y1, y2, scale, WHITE);
-					}
-
-					//
-					// continue to next subsector
-					//
-					break;
-				}
-			}
-		}
+		AM_DrawLineBatch(AML_OUTLINES, scale);
 	}
 }
 
@@ -688,89 +683,102 @@ static void AM_DrawNodes(void) {
 }
 
 //
-// AM_DrawWalls
-// Determines visible lines, draws them.
+// AM_GetLineColor
+// Returns false if the line isn't shown on the automap.
 // This is LineDef based, not LineSeg based.
 //
 
-static void AM_DrawWalls(void) {
-	int i;
-	int x1, x2, y1, y2;
+boolean AM_GetLineColor(line_t* l, rcolor* out) {
+	rcolor color;
 
-	for (i = 0; i < numlines; i++) {
-		line_t* l;
+	//
+	// 20120208 villsa - re-ordered flag checks to match original game
+	//
 
-		l = &lines[i];
+	if (l->flags & ML_DONTDRAW) {
+		return false;
+	}
 
-		x1 = l->v1->x;
-		y1 = l->v1->y;
-		x2 = l->v2->x;
-		y2 = l->v2->y;
+	if (!((l->flags & ML_MAPPED) || am_fulldraw.value || AM_RevealAll())) {
+		return false;
+	}
+
+	color = D_RGBA(0x8A, 0x5C, 0x30, 0xFF);  // default color
 
+	//
+	// check for cheats
+	//
+	if (AM_RevealAll() && !(l->flags & ML_MAPPED)) {
+		color = D_RGBA(0x80, 0x80, 0x80, 0xFF);
+	}
+	//
+	// check for secret line
+	//
+	else if (l->flags & ML_SECRET) {
+		color = D_RGBA(0xA4, 0x00, 0x00, 0xFF);
+	}
+	//
+	// handle special line
+	//
+	else if (l->special && !(l->flags & ML_HIDEAUTOMAPTRIGGER)) {
 		//
-		// 20120208 villsa - re-ordered flag checks to match original game
+		// draw colored doors based on key requirement
 		//
-
-		if (l->flags & ML_DONTDRAW) {
-			continue;
-		}
-
-		if ((l->flags & ML_MAPPED) || am_fulldraw.value || plr->powers[pw_allmap] || amCheating) {
-			rcolor color = D_RGBA(0x8A, 0x5C, 0x30, 0xFF);  // default color
-
-			//
-			// check for cheats
-			//
-			if ((plr->powers[pw_allmap] || amCheating) && !(l->flags & ML_MAPPED)) {
-				color = D_RGBA(0x80, 0x80, 0x80, 0xFF);
+		if (am_showkeycolors.value) {
+			if (l->special & MLU_RED) {
+				color = D_RGBA(0xFF, 0x00, 0x00, 0xFF);
 			}
-			//
-			// check for secret line
-			//
-			else if (l->flags & ML_SECRET) {
-				color = D_RGBA(0xA4, 0x00, 0x00, 0xFF);
+			else if (l->special & MLU_BLUE) {
+				color = D_RGBA(0x00, 0x00, 0xFF, 0xFF);
 			}
-			//
-			// handle special line
-			//
-			else if (l->special && !(l->flags & ML_HIDEAUTOMAPTRIGGER)) {
+			else if (l->special & MLU_YELLOW) {
+				color = D_RGBA(0xFF, 0xFF, 0x00, 0xFF);
+			}
+			else {
 				//
-				// draw colored doors based on key requirement
+				// change color to green to avoid confusion with yellow key doors
 				//
-				if (am_showkeycolors.value) {
-					if (l->special & MLU_RED) {
-						color = D_RGBA(0xFF, 0x00, 0x00, 0xFF);
-					}
-					else if (l->special & MLU_BLUE) {
-						color = D_RGBA(0x00, 0x00, 0xFF, 0xFF);
-					}
-					else if (l->special & MLU_YELLOW) {
-						color = D_RGBA(0xFF, 0xFF, 0x00, 0xFF);
-					}
-					else {
-						//
-						// change color to green to avoid confusion with yellow key doors
-						//
-						color = D_RGBA(0x00, 0xCC, 0x00, 0xFF);
-					}
-				}
-				else {
-					//
-					// default color for special lines
-					//
-					color = D_RGBA(0xCC, 0xCC, 0x00, 0xFF);
-				}
+				color = D_RGBA(0x00, 0xCC, 0x00, 0xFF);
 			}
+		}
+		else {
 			//
-			// solid wall?
+			// default color for special lines
 			//
-			else if (!(l->flags & ML_TWOSIDED)) {
-				color = D_RGBA(0xA4, 0x00, 0x00, 0xFF);
-			}
-
-			AM_DrawLine(x1, x2, y1, y2, scale, color);
+			color = D_RGBA(0xCC, 0xCC, 0x00, 0xFF);
 		}
 	}
+	//
+	// solid wall?
+	//
+	else if (!(l->flags & ML_TWOSIDED)) {
+		color = D_RGBA(0xA4, 0x00, 0x00, 0xFF);
+	}
+
+	*out = color;
+	return true;
+}
+
+//
+// AM_GetThingPosition
+// Interpolated from the render snapshot when there is one
+//
+
+static void AM_GetThingPosition(mobj_t* mobj, fixed_t* x, fixed_t* y) {
+	const snapmobj_t* sm = NULL;
+
+	if (i_interpolateframes.value) {
+		sm = P_GetSnapshotMobj(P_GetSnapshot(), mobj);
+	}
+
+	if (sm) {
+		*x = R_Interpolate(sm->x[SNAP_CUR], sm->x[SNAP_PREV], true);
+		*y = R_Interpolate(sm->y[SNAP_CUR], sm->y[SNAP_PREV], true);
+	}
+	else {
+		*x = mobj->x;
+		*y = mobj->y;
+	}
 }
 
 //
@@ -793,16 +801,8 @@ static void AM_drawPlayers(void) {
 		if (!p_loop_player || !p_loop_player->mo) return;
 		player_mobj = p_loop_player->mo;
 
-		if (i_interpolateframes.value) {
-			render_x = R_Interpolate(player_mobj->x, player_mobj->frame_x, true);
-			render_y = R_Interpolate(player_mobj->y, player_mobj->frame_y, true);
-			render_angle = R_Interpolate(player_mobj->angle, player_mobj->angle, true);
-		}
-		else {
-			render_x = player_mobj->x;
-			render_y = player_mobj->y;
-			render_angle = player_mobj->angle;
-		}
+		AM_GetThingPosition(player_mobj, &render_x, &render_y);
+		render_angle = player_mobj->angle;
 
 		original_x = player_mobj->x;
 		original_y = player_mobj->y;
@@ -832,16 +832,8 @@ static void AM_drawPlayers(void) {
 
 		player_mobj = p_loop_player->mo;
 
-		if (i_interpolateframes.value) {
-			render_x = R_Interpolate(player_mobj->x, player_mobj->frame_x, true);
-			render_y = R_Interpolate(player_mobj->y, player_mobj->frame_y, true);
-			render_angle = R_Interpolate(player_mobj->angle, player_mobj->angle, true);
-		}
-		else {
-			render_x = player_mobj->x;
-			render_y = player_mobj->y;
-			render_angle = player_mobj->angle;
-		}
+		AM_GetThingPosition(player_mobj, &render_x, &render_y);
+		render_angle = player_mobj->angle;
 
 		original_x = player_mobj->x;
 		original_y = player_mobj->y;
@@ -891,16 +883,8 @@ static void AM_drawThings(void) {
 			fixed_t render_t_x, render_t_y;
 			angle_t render_t_angle;
 
-			if (i_interpolateframes.value) {
-				render_t_x = R_Interpolate(t->x, t->frame_x, true);
-				render_t_y = R_Interpolate(t->y, t->frame_y, true);
-				render_t_angle = R_Interpolate(t->angle, t->angle, true);
-			}
-			else {
-				render_t_x = t->x;
-				render_t_y = t->y;
-				render_t_angle = t->angle;
-			}
+			AM_GetThingPosition(t, &render_t_x, &render_t_y);
+			render_t_angle = t->angle;
 
 			original_t_x = t->x;
 			original_t_y = t->y;
@@ -1047,7 +1031,7 @@ void AM_Drawer(void) {
 	}
 	else {
 		if (am_lines.value) {
-			AM_DrawWalls();
+			AM_DrawLineBatch(AML_WALLS, scale);
 		}
 	}
 
@@ -1113,4 +1097,5 @@ void AM_RegisterCvars(void) {
 	G_AddCommand("+automap_freepan", CMD_AutomapSetFlag, AF_PANMODE);
 	G_AddCommand("-automap_freepan", CMD_AutomapSetFlag, AF_PANMODE | PCKF_UP);
 	G_AddCommand("automap_follow", CMD_AutomapFollow, 0);
+	G_AddCommand("amstats", CMD_AutomapStats, 0);
 }
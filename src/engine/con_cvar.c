@@ -33,6 +33,7 @@
 #include "st_stuff.h"
 #include "g_game.h"
 #include "g_actions.h"
+#include "net_loop.h"
 
 cvar_t* cvarcap;
 
@@ -176,6 +177,7 @@ void CON_CvarInit(void) {
 	P_RegisterCvars();
 	G_RegisterCvars();
 	LOC_RegisterCvars();
+	NET_LoopRegisterCvars();
 
 	G_AddCommand("listcvars", CMD_ListCvars, 0);
 }
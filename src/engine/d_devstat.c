@@ -132,8 +132,26 @@ void D_DeveloperDisplay(void) {
 	y += 16;
 
 	if (gamestate == GS_LEVEL) {
+		frametimestats_t frames;
+		float synccpu;
+		float syncgpu;
+
 		ST_DrawFPS(y);
 		y += 16;
+
+		if (I_GetFrameTimeStats(&frames)) {
+			sevclr = frames.max >= 2 * frames.avg ? YELLOW : WHITE;
+			Draw_Text(0, y, sevclr, 0.35f, false, "Frame Time: avg %.2fms, 99%% %.2fms, max %.2fms",
+				frames.avg, frames.p99, frames.max);
+			y += 16;
+		}
+
+		if (GL_GetFrameSyncStats(&synccpu, &syncgpu)) {
+			sevclr = syncgpu >= synccpu ? YELLOW : WHITE;
+			Draw_Text(0, y, sevclr, 0.35f, false, "Frame Sync: cpu %.2fms, gpu wait %.2fms",
+				synccpu, syncgpu);
+			y += 16;
+		}
 	}
 
 	/*MOBJ INFORMATION*/
@@ -166,6 +184,10 @@ void D_DeveloperDisplay(void) {
 	Draw_Text(0, y, WHITE, 0.35f, false, "Draw Indices: %i", statindice);
 	y += 16;
 
+	sevclr = drawcallsframe >= 1000 ? YELLOW : WHITE;
+	Draw_Text(0, y, sevclr, 0.35f, false, "Draw Calls: %i (2D batches: %i)", drawcallsframe, drawbatchesframe);
+	y += 16;
+
 	if (gamestate == GS_LEVEL && !automapactive) {
 		Draw_Text(0, y, WHITE, 0.35f, false, "PlayerView Render Time: %ims", renderTic);
 		y += 16;
@@ -48,9 +48,11 @@
 #include "r_wipe.h"
 #include "r_main.h"
 #include "g_demo.h"
+#include "d_net.h"
 #include "p_saveg.h"
 #include "gl_draw.h"
 #include "net_client.h"
+#include "net_loop.h"
 #include "i_shaders.h"
 
 void D_DoomLoop(void);
@@ -188,8 +190,12 @@ static void D_FinishDraw(void) {
 	// send out any new accumulation
 	NetUpdate();
 
+	Draw_EndFrame();
 	I_ShaderUnBind();
 
+	// hold the frame until the fps cap allows it
+	I_PaceFrame();
+
 	// normal update
 	I_FinishUpdate();
 
@@ -197,6 +203,32 @@ static void D_FinishDraw(void) {
 
 }
 
+//
+// D_RunTic
+//
+
+static int D_RunTic(int (*tick)(void)) {
+	int action = 0;
+
+	G_Ticker();
+
+	// the screen behind a wipe is held until it has finished
+	if (WIPE_InProgress()) {
+		WIPE_Ticker();
+	}
+	else if (tick) {
+		action = tick();
+	}
+
+	if (gameaction != ga_nothing) {
+		action = gameaction;
+	}
+
+	gametic++;
+
+	return action;
+}
+
 int D_MiniLoop(void (*start)(void), void (*stop)(void),
 	void (*draw)(void), int(*tick)(void)) {
 	int action = gameaction = ga_nothing;
@@ -213,6 +245,7 @@ int D_MiniLoop(void (*start)(void), void (*stop)(void),
 		int realtics = 0;
 		int availabletics = 0;
 		int counts = 0;
+		int stallstart = -1;
 
 		windowpause = (menuactive ? true : false);
 
@@ -231,6 +264,7 @@ int D_MiniLoop(void (*start)(void), void (*stop)(void),
 				if (draw && !action) {
 					draw();
 				}
+				WIPE_Drawer();
 				D_DrawInterface();
 				I_ShaderUnBind();
 				D_FinishDraw();
@@ -311,6 +345,11 @@ int D_MiniLoop(void (*start)(void), void (*stop)(void),
 
 		// wait for new tics if needed
 
+		if (netgame && lowtic < gametic / ticdup + counts) {
+			net_simstats.stalls++;
+			stallstart = I_GetTimeMS();
+		}
+
 		while (!PlayersInGame() || lowtic < gametic / ticdup + counts) {
 			NetUpdate();
 			lowtic = GetLowTic();
@@ -327,6 +366,7 @@ int D_MiniLoop(void (*start)(void), void (*stop)(void),
 					if (draw && !action) {
 						draw();
 					}
+					WIPE_Drawer();
 					D_DrawInterface();
 					I_ShaderUnBind();
 					D_FinishDraw();
@@ -341,6 +381,10 @@ int D_MiniLoop(void (*start)(void), void (*stop)(void),
 			I_Sleep(1);
 		}
 
+		if (stallstart >= 0) {
+			net_simstats.stall_ms += I_GetTimeMS() - stallstart;
+		}
+
 		// run the count * ticdup tics
 		while (counts--) {
 			for (i = 0; i < ticdup; i++) {
@@ -359,17 +403,7 @@ int D_MiniLoop(void (*start)(void), void (*stop)(void),
 					I_GetTime_SaveMS();
 				}
 
-				G_Ticker();
-
-				if (tick) {
-					action = tick();
-				}
-
-				if (gameaction != ga_nothing) {
-					action = gameaction;
-				}
-
-				gametic++;
+				action = D_RunTic(tick);
 
 				// modify command for duplicated tics
 				if (i != ticdup - 1) {
@@ -391,6 +425,12 @@ int D_MiniLoop(void (*start)(void), void (*stop)(void),
 			NetUpdate();   // check for new console commands
 		}
 
+		// demo seeking and fast-forward run more tics without drawing them
+		for (i = 0; !action && G_DemoFastTic(i); i++) {
+			action = D_RunTic(tick);
+			D_ResetDemoTics();
+		}
+
 	drawframe:
 		S_UpdateSounds();
 
@@ -405,6 +445,7 @@ int D_MiniLoop(void (*start)(void), void (*stop)(void),
 		if (draw && !action) {
 			draw();
 		}
+		WIPE_Drawer();
 		D_DrawInterface();
 		I_ShaderUnBind();
 		D_FinishDraw();
@@ -837,10 +878,6 @@ static void D_Init(void) {
 //
 
 static int D_CheckDemo(void) {
-
-	// Demo recording / playback is broken (crashes) so disable it for now
-
-	/*
 	int p;
 
 	// start the apropriate game based on parms
@@ -857,7 +894,6 @@ static int D_CheckDemo(void) {
 		G_PlayDemo(myargv[p + 1]);
 		return 1;
 	}
-	*/
 
 	return 0;
 }
@@ -446,3 +446,16 @@ int GetLowTic(void) {
 
 	return lowtic;
 }
+
+//
+// D_ResetDemoTics
+// Demo seeking and fast-forward move gametic without the clock;
+// restart tic building from where gametic is now
+//
+
+void D_ResetDemoTics(void) {
+	maketic = gametic / ticdup;
+	nettics[consoleplayer] = maketic;
+	gametime = GetAdjustedTime() / ticdup;
+	skiptics = 0;
+}
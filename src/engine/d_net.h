@@ -33,6 +33,9 @@
 // Create any new ticcmds and broadcast to other players.
 void NetUpdate(void);
 
+// Restarts tic building at gametic after a demo seek
+void D_ResetDemoTics(void);
+
 // Broadcasts special packets to other players
 //  to notify of game exit
 void D_QuitNetGame(void);
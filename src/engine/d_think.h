@@ -39,11 +39,44 @@ typedef union {
 //  an actor.
 typedef actionf_t  think_t;
 
+// What kind of special a thinker is, set once by P_AddThinker.
+// The values up to tc_endthinkers are written to savegames.
+typedef enum {
+	tc_ceiling,
+	tc_door,
+	tc_floor,
+	tc_plat,
+	tc_flash,
+	tc_strobe,
+	tc_glow,
+	tc_flicker,
+	tc_delay,
+	tc_aimcam,
+	tc_movecam,
+	tc_fade,
+	tc_sequence,
+	tc_quake,
+	tc_combine,
+	tc_laser,
+	tc_split,
+	tc_morph,
+	tc_exp,
+	tc_endthinkers,     // savegame terminator; classes after it are not archived
+	tc_fadebright,
+	NUMTHINKERCLASSES
+} thinkerclass_t;
+
 // Doubly linked list of actors.
 typedef struct thinker_s {
 	struct thinker_s* prev;
 	struct thinker_s* next;
 	think_t             function;
+
+	// second list of only this class; unlinked (NULL) as soon as
+	// the thinker is removed, before it is actually freed
+	thinkerclass_t      tclass;
+	struct thinker_s* cprev;
+	struct thinker_s* cnext;
 } thinker_t;
 
 #endif
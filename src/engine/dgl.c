@@ -26,12 +26,14 @@
 #include "dgl.h"
 #include "doomstat.h"
 #include "gl_main.h"
+#include "gl_draw.h"
 #include "gl_texture.h"
 #include "i_system.h"
 
 #define MAXINDICES  0x10000
 
 word statindice = 0;
+unsigned int statdrawcalls = 0;
 
 static word indicecnt = 0;
 static word drawIndices[MAXINDICES];
@@ -89,6 +91,8 @@ void dglSetVertex(vtx_t* vtx) {
 
 	// 20120623 villsa - avoid redundant calls by checking for
 	// the previous pointer that was set
+	Draw_CheckBatch();
+
 	if (dgl_prevptr == vtx) {
 		return;
 	}
@@ -127,6 +131,7 @@ void dglDrawGeometry(int count, vtx_t* vtx) {
 #endif
 
 	dglDrawElements(GL_TRIANGLES, indicecnt, GL_UNSIGNED_SHORT, drawIndices);
+	statdrawcalls++;
 
 	if (devparm) {
 		statindice += indicecnt;
@@ -136,20 +141,17 @@ void dglDrawGeometry(int count, vtx_t* vtx) {
 }
 
 //
-// dglViewFrustum
+// dglMakeViewFrustum
+// Builds the perspective matrix dglViewFrustum applies, with the
+// far plane at infinity
 //
 
-void dglViewFrustum(int width, int height, rfloat fovy, rfloat znear) {
+void dglMakeViewFrustum(int width, int height, rfloat fovy, rfloat znear, rfloat* m) {
 	rfloat left;
 	rfloat right;
 	rfloat bottom;
 	rfloat top;
 	rfloat aspect;
-	rfloat m[16];
-
-#ifdef LOG_GLFUNC_CALLS
-	I_Printf("dglViewFrustum(width=%i, height=%i, fovy=%f, znear=%f)\n", width, height, fovy, znear);
-#endif
 
 	aspect = (rfloat)width / (rfloat)height;
 	top = znear * (rfloat)tan((double)fovy * M_PI / 360.0f);
@@ -176,10 +178,102 @@ void dglViewFrustum(int width, int height, rfloat fovy, rfloat znear) {
 	m[7] = 0;
 	m[11] = -1;
 	m[15] = 0;
+}
 
+//
+// dglViewFrustum
+//
+
+void dglViewFrustum(int width, int height, rfloat fovy, rfloat znear) {
+	rfloat m[16];
+
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("dglViewFrustum(width=%i, height=%i, fovy=%f, znear=%f)\n", width, height, fovy, znear);
+#endif
+
+	dglMakeViewFrustum(width, height, fovy, znear, m);
 	dglMultMatrixf(m);
 }
 
+//
+// CPU side matrices
+//
+// Column major like OpenGL's, and each operation multiplies on the
+// right the way glRotatef and glTranslatef do, so the same sequence
+// of calls builds the same matrix without reading it back.
+//
+
+void dglMatrixIdentity(rfloat* m) {
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		m[i] = (i % 5) == 0 ? 1.0f : 0.0f;
+	}
+}
+
+void dglMatrixMultiply(rfloat* m, const rfloat* n) {
+	rfloat r[16];
+	int i;
+	int j;
+
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 4; j++) {
+			r[j * 4 + i] =
+				m[0 * 4 + i] * n[j * 4 + 0] +
+				m[1 * 4 + i] * n[j * 4 + 1] +
+				m[2 * 4 + i] * n[j * 4 + 2] +
+				m[3 * 4 + i] * n[j * 4 + 3];
+		}
+	}
+
+	dmemcpy(m, r, sizeof(r));
+}
+
+void dglMatrixRotate(rfloat* m, rfloat angle, rfloat x, rfloat y, rfloat z) {
+	rfloat r[16];
+	double rad = (double)angle * M_PI / 180.0;
+	rfloat c = (rfloat)cos(rad);
+	rfloat s = (rfloat)sin(rad);
+	rfloat len = (rfloat)sqrt(x * x + y * y + z * z);
+
+	if (len <= 0) {
+		return;
+	}
+
+	x /= len;
+	y /= len;
+	z /= len;
+
+	r[0] = x * x * (1 - c) + c;
+	r[1] = y * x * (1 - c) + z * s;
+	r[2] = x * z * (1 - c) - y * s;
+	r[3] = 0;
+
+	r[4] = x * y * (1 - c) - z * s;
+	r[5] = y * y * (1 - c) + c;
+	r[6] = y * z * (1 - c) + x * s;
+	r[7] = 0;
+
+	r[8] = x * z * (1 - c) + y * s;
+	r[9] = y * z * (1 - c) - x * s;
+	r[10] = z * z * (1 - c) + c;
+	r[11] = 0;
+
+	r[12] = 0;
+	r[13] = 0;
+	r[14] = 0;
+	r[15] = 1;
+
+	dglMatrixMultiply(m, r);
+}
+
+void dglMatrixTranslate(rfloat* m, rfloat x, rfloat y, rfloat z) {
+	m[12] += m[0] * x + m[4] * y + m[8] * z;
+	m[13] += m[1] * x + m[5] * y + m[9] * z;
+	m[14] += m[2] * x + m[6] * y + m[10] * z;
+	m[15] += m[3] * x + m[7] * y + m[11] * z;
+}
+
 //
 // dglSetVertexColor
 //
@@ -36,10 +36,18 @@ void dglLogError(const char* message, const char* file, int line);
 // CUSTOM ROUTINES
 //
 
+extern word statindice;
+extern unsigned int statdrawcalls;
+
 void dglSetVertex(vtx_t* vtx);
 void dglTriangle(int v0, int v1, int v2);
 void dglDrawGeometry(int count, vtx_t* vtx);
+void dglMakeViewFrustum(int width, int height, rfloat fovy, rfloat znear, rfloat* m);
 void dglViewFrustum(int width, int height, rfloat fovy, rfloat znear);
+void dglMatrixIdentity(rfloat* m);
+void dglMatrixMultiply(rfloat* m, const rfloat* n);
+void dglMatrixRotate(rfloat* m, rfloat angle, rfloat x, rfloat y, rfloat z);
+void dglMatrixTranslate(rfloat* m, rfloat x, rfloat y, rfloat z);
 void dglSetVertexColor(vtx_t* v, rcolor c, word count);
 void dglGetColorf(rcolor color, float* argb);
 void dglTexCombReplace(void);
@@ -4204,6 +4212,70 @@ SDL_INLINE static void glGetBufferPointervARB_DEBUG(GLenum target, GLenum pname,
 
 #endif // USE_DEBUG_GLFUNCS
 
+//
+// GL_ARB_sync
+//
+extern boolean has_GL_ARB_sync;
+
+extern PFNGLFENCESYNCPROC _glFenceSync;
+extern PFNGLCLIENTWAITSYNCPROC _glClientWaitSync;
+extern PFNGLDELETESYNCPROC _glDeleteSync;
+
+#define GL_ARB_sync_Define() \
+boolean has_GL_ARB_sync = false; \
+PFNGLFENCESYNCPROC _glFenceSync = NULL; \
+PFNGLCLIENTWAITSYNCPROC _glClientWaitSync = NULL; \
+PFNGLDELETESYNCPROC _glDeleteSync = NULL
+
+#define GL_ARB_sync_Init() \
+has_GL_ARB_sync = GL_CheckExtension("GL_ARB_sync"); \
+_glFenceSync = GL_RegisterProc("glFenceSync"); \
+_glClientWaitSync = GL_RegisterProc("glClientWaitSync"); \
+_glDeleteSync = GL_RegisterProc("glDeleteSync"); \
+has_GL_ARB_sync = has_GL_ARB_sync && _glFenceSync && _glClientWaitSync && _glDeleteSync
+
+#ifndef USE_DEBUG_GLFUNCS
+
+#define dglFenceSync(condition, flags) _glFenceSync(condition, flags)
+#define dglClientWaitSync(sync, flags, timeout) _glClientWaitSync(sync, flags, timeout)
+#define dglDeleteSync(sync) _glDeleteSync(sync)
+
+#else
+
+SDL_INLINE static GLsync glFenceSync_DEBUG(GLenum condition, GLbitfield flags, const char* file, int line) {
+	GLsync sync;
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glFenceSync(condition=0x%x, flags=0x%x)\n", file, line, condition, flags);
+#endif
+	sync = _glFenceSync(condition, flags);
+	dglLogError("glFenceSync", file, line);
+	return sync;
+}
+
+SDL_INLINE static GLenum glClientWaitSync_DEBUG(GLsync sync, GLbitfield flags, GLuint64 timeout, const char* file, int line) {
+	GLenum result;
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glClientWaitSync(sync=%p, flags=0x%x, timeout=%llu)\n", file, line, sync, flags, (unsigned long long)timeout);
+#endif
+	result = _glClientWaitSync(sync, flags, timeout);
+	dglLogError("glClientWaitSync", file, line);
+	return result;
+}
+
+SDL_INLINE static void glDeleteSync_DEBUG(GLsync sync, const char* file, int line) {
+#ifdef LOG_GLFUNC_CALLS
+	I_Printf("file = %s, line = %i, glDeleteSync(sync=%p)\n", file, line, sync);
+#endif
+	_glDeleteSync(sync);
+	dglLogError("glDeleteSync", file, line);
+}
+
+#define dglFenceSync(condition, flags) glFenceSync_DEBUG(condition, flags, __FILE__, __LINE__)
+#define dglClientWaitSync(sync, flags, timeout) glClientWaitSync_DEBUG(sync, flags, timeout, __FILE__, __LINE__)
+#define dglDeleteSync(sync) glDeleteSync_DEBUG(sync, __FILE__, __LINE__)
+
+#endif // USE_DEBUG_GLFUNCS
+
 //
 // GL_ARB_texture_env_combine
 //
@@ -170,6 +170,7 @@ typedef struct {
 	boolean    contmusexit;
 	int         allowfreelook;
 	int		 compat_collision;	
+	int         nameref;    // localised title, -1 if none
 } mapdef_t;
 
 typedef struct {
@@ -182,6 +183,8 @@ typedef struct {
 	boolean    scrolltextend;
 	char        text[512];
 	char        pic[9];
+	int         textref;    // localised text lines
+	int         numtextrefs;
 } clusterdef_t;
 
 typedef struct
@@ -27,6 +27,11 @@
 #include "doomstat.h"
 #include "z_zone.h"
 #include "p_tick.h"
+#include "p_statehash.h"
+#include "p_saveg.h"
+#include "d_net.h"
+#include "r_wipe.h"
+#include "con_cvar.h"
 #include "g_game.h"
 #include "m_misc.h"
 #include "con_console.h"
@@ -51,9 +56,12 @@ byte* demoend;
 boolean        singledemo = false;    // quit after playing a demo from cmdline
 boolean        endDemo;
 boolean        iwadDemo = false;
+int            demotic = 0;           // ticcmds read so far
 
 extern int      starttime;
 
+CVAR_EXTERNAL(p_demokeyframes);
+
 //
 // DEMO RECORDING
 //
@@ -75,6 +83,8 @@ void G_ReadDemoTiccmd(ticcmd_t* cmd) {
 	cmd->pitch = (int16_t)(demo_p[0] | (demo_p[1] << 8)); demo_p += 2;
 	cmd->buttons = *demo_p++;
 	cmd->buttons2 = *demo_p++;
+
+	demotic++;
 }
 
 //
@@ -85,14 +95,14 @@ void G_WriteDemoTiccmd(ticcmd_t* cmd) {
 	char buf[8];
 	char* p = buf;
 
-	*demo_p++ = (byte)cmd->forwardmove;        // int8
-	*demo_p++ = (byte)cmd->sidemove;           // int8
-	*demo_p++ = (byte)(cmd->angleturn & 0xff); // lo
-	*demo_p++ = (byte)(cmd->angleturn >> 8);   // hi
-	*demo_p++ = (byte)(cmd->pitch & 0xff);     // lo
-	*demo_p++ = (byte)(cmd->pitch >> 8);       // hi
-	*demo_p++ = (byte)cmd->buttons;
-	*demo_p++ = (byte)cmd->buttons2;
+	*p++ = (byte)cmd->forwardmove;        // int8
+	*p++ = (byte)cmd->sidemove;           // int8
+	*p++ = (byte)(cmd->angleturn & 0xff); // lo
+	*p++ = (byte)(cmd->angleturn >> 8);   // hi
+	*p++ = (byte)(cmd->pitch & 0xff);     // lo
+	*p++ = (byte)(cmd->pitch >> 8);       // hi
+	*p++ = (byte)cmd->buttons;
+	*p++ = (byte)cmd->buttons2;
 
 	if (fwrite(buf, p - buf, 1, demofp) != 1) {
 		I_Error("G_WriteDemoTiccmd: error writing demo");
@@ -178,6 +188,8 @@ void G_RecordDemo(const char* name) {
 	demorecording = true;
 	usergame = false;
 
+	P_StateHashOpenDemo(demoname, true);
+
 	G_RunGame();
 	G_CheckDemoStatus();
 }
@@ -211,6 +223,8 @@ void G_PlayDemo(const char* name) {
 		}
 
 		demo_p = demobuffer;
+
+		P_StateHashOpenDemo(filename, M_CheckParm("-hashwrite"));
 	}
 	else {
 		if (W_CheckNumForName(name) == -1) {
@@ -253,6 +267,9 @@ void G_PlayDemo(const char* name) {
 		playeringame[i] = *demo_p++;
 	}
 
+	G_ClearDemoKeyframes();
+	demotic = 0;
+
 	G_InitNew(startskill, startmap);
 
 	if (playeringame[1]) {
@@ -278,6 +295,7 @@ boolean G_CheckDemoStatus(void) {
 	if (endDemo) {
 		demorecording = false;
 		fputc(DEMOMARKER, demofp);
+		P_StateHashCloseDemo();
 		CON_Printf(WHITE, "G_CheckDemoStatus: Demo recorded\n");
 		fclose(demofp);
 		endDemo = false;
@@ -285,6 +303,9 @@ boolean G_CheckDemoStatus(void) {
 	}
 
 	if (demoplayback) {
+		P_StateHashCloseDemo();
+		G_ClearDemoKeyframes();
+
 		if (singledemo) {
 			I_Quit();
 		}
@@ -308,6 +329,376 @@ boolean G_CheckDemoStatus(void) {
 	return false;
 }
 
+//
+// DEMO KEYFRAMES
+//
+// While a demo plays, the world is snapshotted every p_demokeyframes
+// demo tics. A seek restores the nearest keyframe at or before the
+// target and runs the rest of the way without drawing, so it never
+// simulates more than one interval unless the target is past the
+// furthest point played so far.
+//
+
+#define SEEKFRAMENS     50000000    // ns of seeking per drawn frame
+
+typedef struct {
+	int     demotic;
+	int     offset;     // demo_p - demobuffer
+	int     gametic;    // A_Tracer keys off gametic
+	int     hashtic;
+	int     size;
+	byte*   data;
+} demokeyframe_t;
+
+static demokeyframe_t*  keyframes = NULL;
+static int              numkeyframes = 0;
+static int              maxkeyframes = 0;
+static uint64_t         keyframetime = 0;
+
+static int              seektarget = -1;
+static demokeyframe_t*  seekfrom = NULL;    // restored before running forward
+static uint64_t         seekstart;
+static uint64_t         fastframestart;
+static int              fastspeed = 1;
+
+// state from linear playback, compared once a seek reaches it again
+static byte*            checkdata = NULL;
+static int              checksize = 0;
+static boolean          seekchecked = false;
+
+//
+// G_ClearDemoKeyframes
+//
+
+void G_ClearDemoKeyframes(void) {
+	int i;
+
+	for (i = 0; i < numkeyframes; i++) {
+		Z_Free(keyframes[i].data);
+	}
+
+	if (keyframes) {
+		Z_Free(keyframes);
+	}
+
+	if (checkdata) {
+		Z_Free(checkdata);
+	}
+
+	keyframes = NULL;
+	numkeyframes = maxkeyframes = 0;
+	keyframetime = 0;
+	seektarget = -1;
+	seekfrom = NULL;
+	fastspeed = 1;
+	checkdata = NULL;
+	seekchecked = false;
+}
+
+//
+// G_CanSeekDemo
+//
+
+static boolean G_CanSeekDemo(void) {
+	if (!demoplayback || iwadDemo || netdemo || !demobuffer) {
+		CON_Printf(WHITE, "Not playing a demo\n");
+		return false;
+	}
+
+	return true;
+}
+
+//
+// G_FindKeyframe
+// Latest keyframe at or before tic
+//
+
+static demokeyframe_t* G_FindKeyframe(int tic) {
+	int i;
+
+	for (i = numkeyframes - 1; i >= 0; i--) {
+		if (keyframes[i].demotic <= tic) {
+			return &keyframes[i];
+		}
+	}
+
+	return NULL;
+}
+
+//
+// G_RestoreKeyframe
+//
+
+static void G_RestoreKeyframe(demokeyframe_t* kf) {
+	P_LoadSnapshot(kf->data);
+
+	demo_p = demobuffer + kf->offset;
+	demotic = kf->demotic;
+	gametic = kf->gametic;
+
+	D_ResetDemoTics();
+	P_SetStateHashTic(kf->hashtic);
+}
+
+//
+// G_FinishSeekCheck
+//
+
+static void G_FinishSeekCheck(void) {
+	byte* data = NULL;
+	int size;
+	int diff;
+	int i;
+
+	size = P_SaveSnapshot(&data);
+
+	diff = -1;
+	for (i = 0; i < MIN(size, checksize); i++) {
+		if (data[i] != checkdata[i]) {
+			diff = i;
+			break;
+		}
+	}
+
+	if (diff == -1 && size != checksize) {
+		diff = MIN(size, checksize);
+	}
+
+	Z_Free(data);
+	Z_Free(checkdata);
+	checkdata = NULL;
+
+	if (diff == -1) {
+		CON_Printf(GREEN, "demoseekcheck: state at tic %i matches linear playback\n", demotic);
+	}
+	else {
+		CON_Warnf("demoseekcheck: state at tic %i differs from linear playback at byte %i\n",
+			demotic, diff);
+	}
+
+	if (M_CheckParm("-demoseekcheck")) {
+		if (diff != -1) {
+			I_Error("demoseekcheck: seek to tic %i diverged", demotic);
+		}
+
+		I_Quit();
+	}
+}
+
+//
+// G_DemoTicker
+// Called by G_Ticker before the demo is read for a tic
+//
+
+void G_DemoTicker(void) {
+	demokeyframe_t* kf;
+	uint64_t start;
+	int interval;
+	int p;
+
+	if (gamestate != GS_LEVEL || iwadDemo || netdemo || !demobuffer) {
+		return;
+	}
+
+	interval = (int)p_demokeyframes.value;
+
+	// already captured on an earlier pass
+	if (interval > 0 && !(demotic % interval)
+		&& (!numkeyframes || keyframes[numkeyframes - 1].demotic < demotic)) {
+		if (numkeyframes == maxkeyframes) {
+			maxkeyframes = maxkeyframes ? maxkeyframes * 2 : 64;
+			keyframes = Z_Realloc(keyframes, maxkeyframes * sizeof(*keyframes), PU_STATIC, NULL);
+		}
+
+		start = I_GetTimeNS();
+
+		kf = &keyframes[numkeyframes++];
+		kf->data = NULL;
+		kf->size = P_SaveSnapshot(&kf->data);
+		kf->demotic = demotic;
+		kf->offset = (int)(demo_p - demobuffer);
+		kf->gametic = gametic;
+		kf->hashtic = P_StateHashTic();
+
+		keyframetime += I_GetTimeNS() - start;
+	}
+
+	// -demoseekcheck <tic>: seek back onto that tic once and compare
+	p = M_CheckParm("-demoseekcheck");
+	if (p && p < myargc - 1 && !seekchecked && demotic == datoi(myargv[p + 1])) {
+		seekchecked = true;
+		G_DemoSeekCheck();
+	}
+}
+
+//
+// G_DemoFastTic
+// Asked by D_MiniLoop after the frame's tics; true runs one more
+//
+
+boolean G_DemoFastTic(int count) {
+	if (!demoplayback) {
+		return false;
+	}
+
+	if (!count) {
+		fastframestart = I_GetTimeNS();
+	}
+
+	if (seekfrom) {
+		if (gamestate != GS_LEVEL || WIPE_InProgress()) {
+			CON_Printf(WHITE, "Can only seek back from inside a level\n");
+			seekfrom = NULL;
+			seektarget = -1;
+			return false;
+		}
+
+		G_RestoreKeyframe(seekfrom);
+		seekfrom = NULL;
+	}
+
+	if (seektarget >= 0) {
+		if (demotic >= seektarget) {
+			CON_Printf(WHITE, "Seeked to tic %i (%i:%02i) in %.1f ms\n", demotic,
+				demotic / (TICRATE * 60), (demotic / TICRATE) % 60,
+				(double)(I_GetTimeNS() - seekstart) / 1000000.0);
+
+			seektarget = -1;
+
+			if (checkdata) {
+				G_FinishSeekCheck();
+			}
+
+			return false;
+		}
+
+		// long seeks still draw now and then
+		return I_GetTimeNS() - fastframestart < SEEKFRAMENS;
+	}
+
+	return count < fastspeed - 1;
+}
+
+//
+// G_DemoSeek
+//
+
+void G_DemoSeek(int tic) {
+	demokeyframe_t* kf;
+
+	if (!G_CanSeekDemo()) {
+		return;
+	}
+
+	tic = MAX(tic, 0);
+	kf = G_FindKeyframe(tic);
+
+	// running on from here is no longer than restoring
+	if (tic >= demotic && (!kf || kf->demotic <= demotic)) {
+		kf = NULL;
+	}
+	else if (!kf) {
+		CON_Printf(WHITE, "No keyframe at or before tic %i\n", tic);
+		return;
+	}
+
+	seekfrom = kf;
+	seektarget = tic;
+	seekstart = I_GetTimeNS();
+}
+
+//
+// G_DemoSeekCommand
+// "demoseek <tic>" or "demoseek <minutes>:<seconds>"
+//
+
+void G_DemoSeekCommand(const char* arg) {
+	const char* colon;
+
+	if (!arg) {
+		CON_Printf(WHITE, "demoseek <tic | m:ss>, now at tic %i\n", demotic);
+		return;
+	}
+
+	colon = dstrrchr((char*)arg, ':');
+
+	if (colon) {
+		G_DemoSeek((datoi(arg) * 60 + datoi(colon + 1)) * TICRATE);
+	}
+	else {
+		G_DemoSeek(datoi(arg));
+	}
+}
+
+//
+// G_DemoSeekCheck
+// Saves the state here, then seeks back onto this tic
+// from an earlier keyframe and compares
+//
+
+void G_DemoSeekCheck(void) {
+	demokeyframe_t* kf;
+
+	if (!G_CanSeekDemo()) {
+		return;
+	}
+
+	kf = G_FindKeyframe(demotic - 1);
+
+	if (gamestate != GS_LEVEL || !kf) {
+		CON_Printf(WHITE, "No keyframe before tic %i\n", demotic);
+		return;
+	}
+
+	checksize = P_SaveSnapshot(&checkdata);
+
+	seekfrom = kf;
+	seektarget = demotic;
+	seekstart = I_GetTimeNS();
+}
+
+//
+// G_DemoFastForward
+//
+
+void G_DemoFastForward(int speed) {
+	if (!G_CanSeekDemo()) {
+		return;
+	}
+
+	fastspeed = MAX(speed, 1);
+	CON_Printf(WHITE, "Demo speed x%i\n", fastspeed);
+}
+
+//
+// G_PrintDemoKeyframes
+//
+
+void G_PrintDemoKeyframes(void) {
+	int total = 0;
+	int i;
+
+	if (!G_CanSeekDemo()) {
+		return;
+	}
+
+	for (i = 0; i < numkeyframes; i++) {
+		total += keyframes[i].size;
+	}
+
+	CON_Printf(GREEN, "Demo at tic %i (%i:%02i), speed x%i\n", demotic,
+		demotic / (TICRATE * 60), (demotic / TICRATE) % 60, fastspeed);
+
+	if (!numkeyframes) {
+		CON_Printf(WHITE, "No keyframes (p_demokeyframes is the interval in tics)\n");
+		return;
+	}
+
+	CON_Printf(AQUA, "%i keyframes every %i tics up to tic %i, %i kb, %.2f ms each\n",
+		numkeyframes, (int)p_demokeyframes.value, keyframes[numkeyframes - 1].demotic,
+		total >> 10, (double)keyframetime / numkeyframes / 1000000.0);
+}
+
 /* VANILLA */
 
 int G_PlayDemoPtr(int skill, int map) // 800049D0
@@ -31,6 +31,16 @@ void G_PlayDemo(const char* name);
 void G_ReadDemoTiccmd(ticcmd_t* cmd);
 void G_WriteDemoTiccmd(ticcmd_t* cmd);
 
+// Keyframes, seeking and fast-forward during playback
+void G_ClearDemoKeyframes(void);
+void G_DemoTicker(void);
+boolean G_DemoFastTic(int count);
+void G_DemoSeek(int tic);
+void G_DemoSeekCommand(const char* arg);
+void G_DemoSeekCheck(void);
+void G_DemoFastForward(int speed);
+void G_PrintDemoKeyframes(void);
+
 extern char             demoname[256];  // name of demo lump
 extern boolean         demorecording;  // currently recording a demo
 extern boolean         demoplayback;   // currently playing a demo
@@ -41,6 +51,7 @@ extern byte* demoend;
 extern boolean         singledemo;
 extern boolean         endDemo;        // signal recorder to stop on next tick
 extern boolean         iwadDemo;       // hide hud, end playback after one level
+extern int             demotic;        // ticcmds read so far
 
 /* VANILLA */
 int G_PlayDemoPtr(int skill, int map); // 800049D0
@@ -32,7 +32,11 @@
 #include "i_system.h"
 #include "p_setup.h"
 #include "p_saveg.h"
+#include "p_statehash.h"
 #include "p_tick.h"
+#include "p_reject.h"
+#include "r_clipbench.h"
+#include "r_cullbench.h"
 #include "d_main.h"
 #include "wi_stuff.h"
 #include "st_stuff.h"
@@ -45,13 +49,16 @@
 #include "info.h"
 #include "r_lights.h"
 #include "r_main.h"
+#include "r_wipe.h"
 #include "con_console.h"
+#include "gl_draw.h"
 #include "i_sdlinput.h"
 #include "g_demo.h"
 #include "g_controls.h"
 #include "g_settings.h"
 #include "g_actions.h"
 #include "net_server.h"
+#include "net_loop.h"
 
 
 #define DCLICK_TIME     20
@@ -641,6 +648,157 @@ static CMD(ListMaps) {
 	P_ListMaps();
 }
 
+//
+// CMD_FrameTimes
+//
+
+static CMD(FrameTimes) {
+	I_PrintFrameTimes();
+	GL_PrintFrameSync();
+}
+
+//
+// CMD_LoadTimes
+//
+
+static CMD(LoadTimes) {
+	P_PrintLoadTimes();
+}
+
+//
+// CMD_FlatStats
+//
+
+static CMD(FlatStats) {
+	R_PrintFlatStats();
+}
+
+//
+// CMD_DrawStats
+//
+
+static CMD(DrawStats) {
+	Draw_PrintStats();
+}
+
+//
+// CMD_SightStats
+//
+
+static CMD(SightStats) {
+	P_PrintSightStats();
+}
+
+//
+// CMD_ThinkerCensus
+//
+
+static CMD(ThinkerCensus) {
+	if (gamestate != GS_LEVEL) {
+		CON_Printf(WHITE, "Not in a level\n");
+		return;
+	}
+
+	P_PrintThinkerCensus();
+}
+
+//
+// CMD_Rewind
+//
+
+static CMD(Rewind) {
+	if (!param[0]) {
+		P_PrintRewind();
+		return;
+	}
+
+	P_Rewind(datoi(param[0]));
+}
+
+//
+// CMD_RewindCheck
+//
+
+static CMD(RewindCheck) {
+	P_RewindCheck(param[0] ? datoi(param[0]) : 0);
+}
+
+//
+// CMD_StateHash
+//
+
+static CMD(StateHash) {
+	P_PrintStateHash();
+}
+
+//
+// CMD_DemoSeek
+//
+
+static CMD(DemoSeek) {
+	G_DemoSeekCommand(param[0]);
+}
+
+//
+// CMD_DemoFastForward
+//
+
+static CMD(DemoFastForward) {
+	G_DemoFastForward(param[0] ? datoi(param[0]) : 1);
+}
+
+//
+// CMD_DemoKeyframes
+//
+
+static CMD(DemoKeyframes) {
+	G_PrintDemoKeyframes();
+}
+
+//
+// CMD_DemoSeekCheck
+//
+
+static CMD(DemoSeekCheck) {
+	G_DemoSeekCheck();
+}
+
+//
+// CMD_NetSim
+//
+
+static CMD(NetSim) {
+	if (param[0] && !dstricmp(param[0], "reset")) {
+		NET_LoopResetStats();
+	}
+
+	NET_LoopPrintStats();
+}
+
+//
+// CMD_LocBench
+//
+
+static CMD(LocBench) {
+	LOC_Benchmark(param[0] ? datoi(param[0]) : 0);
+}
+
+//
+// CMD_ClipBench
+//
+
+static CMD(ClipBench) {
+	R_ClipBenchCommand(param[0]);
+}
+
+//
+// CMD_CullCheck
+//
+
+static CMD(CullCheck) {
+	R_CullBenchCommand(param[0]);
+}
+
 //
 // G_SaveDefaults
 //
@@ -1139,7 +1297,7 @@ void G_Ticker(void) {
 		gameaction = ga_nothing;
 	}
 
-	if (paused || (menuactive && !netgame)) {
+	if (paused || (menuactive && !netgame) || WIPE_InProgress()) {
 		basetic++;    // For tracers and RNG -- we must maintain sync
 	}
 	else {
@@ -1147,6 +1305,10 @@ void G_Ticker(void) {
 		// and build new consistancy check
 		buf = (gametic / ticdup) % BACKUPTICS;
 
+		if (demoplayback) {
+			G_DemoTicker();
+		}
+
 		for (i = 0; i < MAXPLAYERS; i++) {
 			ticcmd_t * cmd = &players[i].cmd;
 			if (demoplayback) {
@@ -1165,15 +1327,9 @@ void G_Ticker(void) {
 				
 			}
 
-				//
-				// 20120404 villsa - make sure gameaction isn't set to anything before
-				// reading a demo lump
-				//
-				if (demoplayback && gameaction == ga_nothing) {
-					G_ReadDemoTiccmd(cmd);
-				}
-
-				if (demorecording) {
+				// only the console player's commands are in a demo,
+				// the same ones playback reads above
+				if (demorecording && i == consoleplayer && gameaction == ga_nothing) {
 					G_WriteDemoTiccmd(cmd);
 
 					if (endDemo == true) {
@@ -1184,15 +1340,13 @@ void G_Ticker(void) {
 				if (netgame && !netdemo && !(gametic % ticdup)) {
 					if (gametic > BACKUPTICS
 						&& consistency[i][buf] != cmd->consistency) {
-						I_Error("consistency failure (%i should be %i)",
-							cmd->consistency, consistency[i][buf], consoleplayer);
-					}
-					if (players[i].mo) {
-						consistency[i][buf] = players[i].mo->x;
-					}
-					else {
-						consistency[i][buf] = 0;
+						P_PrintStateHash();
+						I_Error("consistency failure at tic %i (%i should be %i)",
+							gametic, cmd->consistency, consistency[i][buf]);
 					}
+
+					// folded hash of the whole playsim, not just one position
+					consistency[i][buf] = P_StateHashConsistency();
 				}
 			}
 		}
@@ -1722,6 +1876,23 @@ void G_Init(void) {
 	G_AddCommand("setcamerachase", CMD_PlayerCamera, 1);
 	G_AddCommand("enddemo", CMD_EndDemo, 0);
 	G_AddCommand("listmaps", CMD_ListMaps, 0);
+	G_AddCommand("loadtimes", CMD_LoadTimes, 0);
+	G_AddCommand("flatstats", CMD_FlatStats, 0);
+	G_AddCommand("drawstats", CMD_DrawStats, 0);
+	G_AddCommand("frametimes", CMD_FrameTimes, 0);
+	G_AddCommand("sightstats", CMD_SightStats, 0);
+	G_AddCommand("clipbench", CMD_ClipBench, 0);
+	G_AddCommand("cullcheck", CMD_CullCheck, 0);
+	G_AddCommand("locbench", CMD_LocBench, 0);
+	G_AddCommand("thinkers", CMD_ThinkerCensus, 0);
+	G_AddCommand("rewind", CMD_Rewind, 0);
+	G_AddCommand("rewindcheck", CMD_RewindCheck, 0);
+	G_AddCommand("statehash", CMD_StateHash, 0);
+	G_AddCommand("demoseek", CMD_DemoSeek, 0);
+	G_AddCommand("demoff", CMD_DemoFastForward, 0);
+	G_AddCommand("demokeyframes", CMD_DemoKeyframes, 0);
+	G_AddCommand("demoseekcheck", CMD_DemoSeekCheck, 0);
+	G_AddCommand("netsim", CMD_NetSim, 0);
 	
 }
 
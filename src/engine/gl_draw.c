@@ -38,9 +38,49 @@ extern void I_ShaderSetTextureSize(int,int);
 #include "r_things.h"
 #include "gl_texture.h"
 #include "r_main.h"
+#include "con_console.h"
 
 CVAR_EXTERNAL(r_hudFilter);
 
+static int sfonthandle = GFX_UNRESOLVED;
+static int symbolshandle = GFX_UNRESOLVED;
+static int confonthandle = GFX_UNRESOLVED;
+
+//
+// Draw_GfxHandleForName
+// Image names passed to Draw_GfxImage* are almost always string
+// literals or fixed fields, so the resolved handle is cached against
+// the name pointer and only re-resolved when the text behind it changes
+//
+
+#define GFXNAMECACHE    32
+
+typedef struct {
+	const char* name;
+	char        lump[8];
+	int         handle;
+} gfxnamecache_t;
+
+static gfxnamecache_t gfxnamecache[GFXNAMECACHE];
+
+static int Draw_GfxHandleForName(const char* name) {
+	gfxnamecache_t* c = &gfxnamecache[((uintptr_t)name >> 2) & (GFXNAMECACHE - 1)];
+	int i;
+
+	if (c->name == name && !dstrncmp(c->lump, name, 8)) {
+		return c->handle;
+	}
+
+	c->name = name;
+	dmemset(c->lump, 0, 8);
+	for (i = 0; i < 8 && name[i]; ++i) {
+		c->lump[i] = name[i];
+	}
+	c->handle = GL_GetGfxHandle(name);
+
+	return c->handle;
+}
+
 //
 // Draw_GfxImage
 //
@@ -50,7 +90,7 @@ static void Draw_GfxImageInternal(int x, int y, const char* name,
 	float max_w, float offset_width, float offset_height, 
 	rcolor color, boolean alpha) {
 	
-	int gfxIdx = GL_BindGfxTexture(name, alpha);
+	int gfxIdx = GL_BindGfxHandle(Draw_GfxHandleForName(name), alpha);
 	if (gfxIdx < 0) { 
 		return; 
 	}
@@ -79,7 +119,7 @@ static void Draw_GfxImageInternalInter(int x, int y, const char* name,
 	float max_w, float offset_width, float offset_height,
 	rcolor color, boolean alpha) {
 
-	int gfxIdx = GL_BindGfxTexture(name, alpha);
+	int gfxIdx = GL_BindGfxHandle(Draw_GfxHandleForName(name), alpha);
 	if (gfxIdx < 0) {
 		return;
 	}
@@ -167,172 +207,225 @@ void Draw_Sprite2D(int type, int rot, int frame, int x, int y,
 }
 
 //
+// 2D BATCH
 //
-// STRING DRAWING ROUTINES
-//
+// Glyph quads from the string routines are queued here instead of
+// being drawn per string. Consecutive strings that share a font and
+// filter end up in one draw call; anything that changes GL state or
+// submits its own geometry flushes the queue first (Draw_CheckBatch)
 //
 
-static vtx_t vtxstring[MAX_MESSAGE_SIZE];
+#define MAXBATCHQUADS   2048
+
+typedef struct {
+	int     gfx;
+	int     filter;
+	boolean fill;
+} drawbatchkey_t;
+
+int                     drawbatchquads = 0;
+unsigned int            drawbatchflushes = 0;
+
+static drawbatchkey_t   drawbatchkey;
+static vtx_t            drawbatchvtx[MAXBATCHQUADS * 4];
+static word             drawbatchindices[MAXBATCHQUADS * 6];
+static boolean          drawbatchready = false;
 
 //
-// Draw_Text
+// Draw_FlushBatch
 //
 
-int Draw_Text(int x, int y, rcolor color, float scale,
-	boolean wrap, const char* string, ...) {
-	int c;
-	int i;
-	int vi = 0;
-	int    col;
-	const float size = 0.03125f;
-	float fcol, frow;
-	int start = 0;
-	char msg[MAX_MESSAGE_SIZE];
-	va_list    va;
-	const int ix = x;
+void Draw_FlushBatch(void) {
+	int count = drawbatchquads;
+	float scale;
 	boolean fill = false;
 
-	va_start(va, string);
-	vsprintf(msg, string, va);
-	va_end(va);
+	if (!count) {
+		return;
+	}
 
-	GL_SetState(GLSTATE_BLEND, 1);
+	// the state calls below check the batch again
+	drawbatchquads = 0;
 
-	if(!r_fillmode.value) {
-        dglEnable(GL_TEXTURE_2D);
-        dglPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        r_fillmode.value = 1.0f;
-        fill = true;
-    }
+	if (drawbatchkey.fill && !r_fillmode.value) {
+		dglEnable(GL_TEXTURE_2D);
+		dglPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		r_fillmode.value = 1.0f;
+		fill = true;
+	}
 
-	GL_BindGfxTexture("SFONT", true);
+	GL_BindGfxHandle(drawbatchkey.gfx, true);
 
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (int)r_hudFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (int)r_hudFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
+	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, drawbatchkey.filter);
+	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, drawbatchkey.filter);
+
+	GL_SetState(GLSTATE_BLEND, 1);
+
+	// quads were scaled when queued
+	scale = GL_GetOrthoScale();
+	if (scale != 1.0f) {
+		GL_SetOrthoScale(1.0f);
+	}
 
-	GL_SetOrthoScale(scale);
 	GL_SetOrtho(0);
 
-	dglSetVertex(vtxstring);
+	dglSetVertex(drawbatchvtx);
+	dglDrawElements(GL_TRIANGLES, count * 6, GL_UNSIGNED_SHORT, drawbatchindices);
 
-	for (i = 0, vi = 0; i < dstrlen(msg); i++, vi += 4) {
-		c = SDL_toupper(msg[i]);
-		if (c == '\t') {
-			while (x % 64) {
-				x++;
-			}
-			continue;
-		}
-		if (c == '\n') {
-			y += ST_FONTWHSIZE;
-			x = ix;
-			continue;
-		}
-		if (c == 0x20) {
-			if (wrap) {
-				if (x > 192) {
-					y += ST_FONTWHSIZE;
-					x = ix;
-					continue;
-				}
-			}
-		}
-		else {
-			start = (c - ST_FONTSTART);
-			col = start & (ST_FONTNUMSET - 1);
+	statdrawcalls++;
+	drawbatchflushes++;
 
-			fcol = (col * size);
-			frow = (start >= ST_FONTNUMSET) ? 0.5f : 0.0f;
+	if (devparm) {
+		statindice += count * 6;
+		vertCount += count * 4;
+	}
 
-			vtxstring[vi + 0].x = (float)x;
-			vtxstring[vi + 0].y = (float)y;
-			vtxstring[vi + 0].tu = fcol + 0.0015f;
-			vtxstring[vi + 0].tv = frow + size;
-			vtxstring[vi + 1].x = (float)x + ST_FONTWHSIZE;
-			vtxstring[vi + 1].y = (float)y;
-			vtxstring[vi + 1].tu = (fcol + size) - 0.0015f;
-			vtxstring[vi + 1].tv = frow + size;
-			vtxstring[vi + 2].x = (float)x + ST_FONTWHSIZE;
-			vtxstring[vi + 2].y = (float)y + ST_FONTWHSIZE;
-			vtxstring[vi + 2].tu = (fcol + size) - 0.0015f;
-			vtxstring[vi + 2].tv = frow + 0.5f;
-			vtxstring[vi + 3].x = (float)x;
-			vtxstring[vi + 3].y = (float)y + ST_FONTWHSIZE;
-			vtxstring[vi + 3].tu = fcol + 0.0015f;
-			vtxstring[vi + 3].tv = frow + 0.5f;
-
-			dglSetVertexColor(vtxstring + vi, color, 4);
-
-			dglTriangle(vi + 0, vi + 1, vi + 2);
-			dglTriangle(vi + 0, vi + 2, vi + 3);
-
-			if (devparm) {
-				vertCount += 4;
-			}
+	GL_ResetViewport();
+
+	if (scale != 1.0f) {
+		GL_SetOrthoScale(scale);
+	}
+
+	if (fill) {
+		dglDisable(GL_TEXTURE_2D);
+		dglPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		r_fillmode.value = 0.0f;
+	}
+
+	GL_SetState(GLSTATE_BLEND, 0);
+}
+
+//
+// Draw_EndFrame
+// Flushes the batch before swap and keeps the frame's draw call
+// counts for drawstats and the developer display
+//
+
+unsigned int drawcallsframe = 0;
+unsigned int drawbatchesframe = 0;
+
+void Draw_EndFrame(void) {
+	Draw_FlushBatch();
+
+	drawcallsframe = statdrawcalls;
+	drawbatchesframe = drawbatchflushes;
+	statdrawcalls = 0;
+	drawbatchflushes = 0;
+}
+
+//
+// Draw_PrintStats
+//
+
+void Draw_PrintStats(void) {
+	CON_Printf(GREEN, "Last frame:\n");
+	CON_Printf(AQUA, "draw calls:  %i\n", drawcallsframe);
+	CON_Printf(AQUA, "2d batches:  %i\n", drawbatchesframe);
+}
+
+//
+// Draw_BatchBegin
+// Returns false if the font is missing
+//
+
+static boolean Draw_BatchBegin(int gfx, int filter, boolean fill) {
+	int i;
+
+	if (gfx < 0) {
+		return false;
+	}
+
+	if (!drawbatchready) {
+		for (i = 0; i < MAXBATCHQUADS; i++) {
+			drawbatchindices[i * 6 + 0] = i * 4 + 0;
+			drawbatchindices[i * 6 + 1] = i * 4 + 1;
+			drawbatchindices[i * 6 + 2] = i * 4 + 2;
+			drawbatchindices[i * 6 + 3] = i * 4 + 0;
+			drawbatchindices[i * 6 + 4] = i * 4 + 2;
+			drawbatchindices[i * 6 + 5] = i * 4 + 3;
 		}
-		x += ST_FONTWHSIZE;
+		drawbatchready = true;
 	}
 
-	if (vi) {
-		dglDrawGeometry(vi, vtxstring);
+	if (drawbatchkey.gfx != gfx || drawbatchkey.filter != filter || drawbatchkey.fill != fill) {
+		Draw_FlushBatch();
+		drawbatchkey.gfx = gfx;
+		drawbatchkey.filter = filter;
+		drawbatchkey.fill = fill;
 	}
 
-	GL_ResetViewport();
+	// first use uploads the texture, which may pad gfxwidth/gfxheight
+	if (!gfxptr[gfx]) {
+		Draw_FlushBatch();
+		GL_BindGfxHandle(gfx, true);
+	}
 
-	if(fill) {
-        dglDisable(GL_TEXTURE_2D);
-        dglPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        r_fillmode.value = 0.0f;
-    }
+	return true;
+}
 
-	GL_SetState(GLSTATE_BLEND, 0);
-	GL_SetOrthoScale(1.0f);
+//
+// Draw_BatchQuad
+//
 
-	return x;
+static void Draw_BatchQuad(float x1, float y1, float x2, float y2,
+	float u1, float v1, float u2, float v2, rcolor color) {
+	vtx_t* v;
+	float t;
+
+	if (drawbatchquads == MAXBATCHQUADS) {
+		Draw_FlushBatch();
+	}
+
+	// keep every quad wound top-left, top-right, bottom-right
+	if (y2 < y1) {
+		t = y1; y1 = y2; y2 = t;
+		t = v1; v1 = v2; v2 = t;
+	}
+
+	v = &drawbatchvtx[drawbatchquads * 4];
+
+	v[0].x = x1; v[0].y = y1; v[0].z = 0; v[0].tu = u1; v[0].tv = v1;
+	v[1].x = x2; v[1].y = y1; v[1].z = 0; v[1].tu = u2; v[1].tv = v1;
+	v[2].x = x2; v[2].y = y2; v[2].z = 0; v[2].tu = u2; v[2].tv = v2;
+	v[3].x = x1; v[3].y = y2; v[3].z = 0; v[3].tu = u1; v[3].tv = v2;
+
+	dglSetVertexColor(v, color, 4);
+
+	drawbatchquads++;
 }
 
-int Draw_TextSecret(int x, int y, rcolor color, float scale,
-	boolean wrap, const char* string, ...) {
+//
+//
+// STRING DRAWING ROUTINES
+//
+//
+
+//
+// Draw_TextString
+//
+
+static int Draw_TextString(int x, int y, rcolor color, float scale,
+	boolean wrap, const char* msg) {
 	int c;
 	int i;
-	int vi = 0;
-	int    col;
+	int len;
+	int col;
 	const float size = 0.03125f;
 	float fcol, frow;
 	int start = 0;
-	char msg[MAX_MESSAGE_SIZE];
-	va_list    va;
 	const int ix = x;
-	boolean fill = false;
-
-	va_start(va, string);
-	vsprintf(msg, string, va);
-	va_end(va);
+	const int filter = (int)r_hudFilter.value == 0 ? GL_LINEAR : GL_NEAREST;
 
-	GL_SetState(GLSTATE_BLEND, 1);
-
-	if (!r_fillmode.value) {
-		dglEnable(GL_TEXTURE_2D);
-		dglPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-		r_fillmode.value = 1.0f;
-		fill = true;
+	if (!Draw_BatchBegin(GL_CacheGfxHandle(&sfonthandle, "SFONT"), filter, true)) {
+		GL_SetOrthoScale(1.0f);
+		return x;
 	}
 
-	GL_BindGfxTexture("SFONT", true);
-
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (int)r_hudFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (int)r_hudFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
-
-	GL_SetOrthoScale(scale);
-	GL_SetOrtho(0);
-
-	dglSetVertex(vtxstring);
+	len = dstrlen(msg);
 
-	for (i = 0, vi = 0; i < dstrlen(msg); i++, vi += 4) {
+	for (i = 0; i < len; i++) {
 		c = SDL_toupper(msg[i]);
 		if (c == '\t') {
 			while (x % 64) {
@@ -361,51 +454,44 @@ int Draw_TextSecret(int x, int y, rcolor color, float scale,
 			fcol = (col * size);
 			frow = (start >= ST_FONTNUMSET) ? 0.5f : 0.0f;
 
-			vtxstring[vi + 0].x = (float)x;
-			vtxstring[vi + 0].y = (float)y;
-			vtxstring[vi + 0].tu = fcol + 0.0015f;
-			vtxstring[vi + 0].tv = frow + size;
-			vtxstring[vi + 1].x = (float)x + ST_FONTWHSIZE;
-			vtxstring[vi + 1].y = (float)y;
-			vtxstring[vi + 1].tu = (fcol + size) - 0.0015f;
-			vtxstring[vi + 1].tv = frow + size;
-			vtxstring[vi + 2].x = (float)x + ST_FONTWHSIZE;
-			vtxstring[vi + 2].y = (float)y + ST_FONTWHSIZE;
-			vtxstring[vi + 2].tu = (fcol + size) - 0.0015f;
-			vtxstring[vi + 2].tv = frow + 0.5f;
-			vtxstring[vi + 3].x = (float)x;
-			vtxstring[vi + 3].y = (float)y + ST_FONTWHSIZE;
-			vtxstring[vi + 3].tu = fcol + 0.0015f;
-			vtxstring[vi + 3].tv = frow + 0.5f;
-
-			dglSetVertexColor(vtxstring + vi, color, 4);
-
-			dglTriangle(vi + 0, vi + 1, vi + 2);
-			dglTriangle(vi + 0, vi + 2, vi + 3);
-
-			if (devparm) {
-				vertCount += 4;
-			}
+			Draw_BatchQuad((float)x * scale, (float)y * scale,
+				(float)(x + ST_FONTWHSIZE) * scale, (float)(y + ST_FONTWHSIZE) * scale,
+				fcol + 0.0015f, frow + size, (fcol + size) - 0.0015f, frow + 0.5f, color);
 		}
 		x += ST_FONTWHSIZE;
 	}
 
-	if (vi) {
-		dglDrawGeometry(vi, vtxstring);
-	}
+	GL_SetOrthoScale(1.0f);
 
-	GL_ResetViewport();
+	return x;
+}
 
-	if (fill) {
-		dglDisable(GL_TEXTURE_2D);
-		dglPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		r_fillmode.value = 0.0f;
-	}
+//
+// Draw_Text
+//
 
-	GL_SetState(GLSTATE_BLEND, 0);
-	GL_SetOrthoScale(1.0f);
+int Draw_Text(int x, int y, rcolor color, float scale,
+	boolean wrap, const char* string, ...) {
+	char msg[MAX_MESSAGE_SIZE];
+	va_list    va;
 
-	return x;
+	va_start(va, string);
+	vsprintf(msg, string, va);
+	va_end(va);
+
+	return Draw_TextString(x, y, color, scale, wrap, msg);
+}
+
+int Draw_TextSecret(int x, int y, rcolor color, float scale,
+	boolean wrap, const char* string, ...) {
+	char msg[MAX_MESSAGE_SIZE];
+	va_list    va;
+
+	va_start(va, string);
+	vsprintf(msg, string, va);
+	va_end(va);
+
+	return Draw_TextString(x, y, color, scale, wrap, msg);
 }
 
 const symboldata_t symboldata[] = {  //0x5B9BC
@@ -576,24 +662,26 @@ int Center_Text(const char* string) {
 
 
 //
-// Draw_BigText
+// Draw_SymbolString
 //
 
-int Draw_BigText(int x, int y, rcolor color, const char* string) {
+static int Draw_SymbolString(int x, int y, rcolor color, const char* string,
+	float size, int xoffset, int spacewidth) {
 	int c = 0;
 	int i = 0;
-	int vi = 0;
+	int len;
 	int index = 0;
 	float vx1 = 0.0f;
 	float vy1 = 0.0f;
-	float vx2 = 0.0f;
-	float vy2 = 0.0f;
 	float tx1 = 0.0f;
 	float tx2 = 0.0f;
 	float ty1 = 0.0f;
 	float ty2 = 0.0f;
 	float smbwidth;
 	float smbheight;
+	float ueps;
+	float veps;
+	float scale;
 	int pic;
 
 	if (x <= -1) {
@@ -602,26 +690,22 @@ int Draw_BigText(int x, int y, rcolor color, const char* string) {
 
 	y += 14;
 
-	pic = GL_BindGfxTexture("SYMBOLS", true);
+	pic = GL_CacheGfxHandle(&symbolshandle, "SYMBOLS");
+	if (!Draw_BatchBegin(pic, (int)r_hudFilter.value == 0 ? GL_LINEAR : GL_NEAREST, false)) {
+		return x;
+	}
 
 	smbwidth = (float)gfxwidth[pic];
 	smbheight = (float)gfxheight[pic];
 
-	const float ueps = 0.5f / smbwidth;
-	const float veps = 0.5f / smbheight;
-
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (int)r_hudFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (int)r_hudFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
-
-	dglSetVertex(vtxstring);
+	ueps = 0.5f / smbwidth;
+	veps = 0.5f / smbheight;
 
-	GL_SetState(GLSTATE_BLEND, 1);
-	GL_SetOrtho(0);
+	scale = GL_GetOrthoScale();
+	len = dstrlen(string);
 
-	for (i = 0, vi = 0; i < dstrlen(string); i++, vi += 4) {
-		vx1 = (float)x;
+	for (i = 0; i < len; i++) {
+		vx1 = (float)(x + xoffset);
 		vy1 = (float)y;
 
 		c = string[i];
@@ -629,7 +713,7 @@ int Draw_BigText(int x, int y, rcolor color, const char* string) {
 			continue;
 		}
 		else if (c == 0x20) {
-			x += 8;
+			x += spacewidth;
 			continue;
 		}
 		else {
@@ -657,38 +741,29 @@ int Draw_BigText(int x, int y, rcolor color, const char* string) {
 				}
 			}
 
-			vx2 = vx1 + symboldata[index].w;
-			vy2 = vy1 - symboldata[index].h;
-
 			tx1 = ((float)symboldata[index].x / smbwidth) + ueps;
 			tx2 = ((float)(symboldata[index].x + symboldata[index].w) / smbwidth) - ueps;
 			ty1 = ((float)symboldata[index].y / smbheight) + veps;
 			ty2 = ((float)(symboldata[index].y + symboldata[index].h) / smbheight) - veps;
 
-			vtxstring[vi + 0].x = vx1; vtxstring[vi + 0].y = vy1; vtxstring[vi + 0].tu = tx1; vtxstring[vi + 0].tv = ty2;
-			vtxstring[vi + 1].x = vx2; vtxstring[vi + 1].y = vy1; vtxstring[vi + 1].tu = tx2; vtxstring[vi + 1].tv = ty2;
-			vtxstring[vi + 2].x = vx2; vtxstring[vi + 2].y = vy2; vtxstring[vi + 2].tu = tx2; vtxstring[vi + 2].tv = ty1;
-			vtxstring[vi + 3].x = vx1; vtxstring[vi + 3].y = vy2; vtxstring[vi + 3].tu = tx1; vtxstring[vi + 3].tv = ty1;
-
-			dglSetVertexColor(vtxstring + vi, color, 4);
-
-			dglTriangle(vi + 2, vi + 1, vi + 0);
-			dglTriangle(vi + 3, vi + 2, vi + 0);
-
-			if (devparm) { vertCount += 4; }
+			Draw_BatchQuad(vx1 * scale, vy1 * scale,
+				(vx1 + symboldata[index].w * size) * scale,
+				(vy1 - symboldata[index].h * size) * scale,
+				tx1, ty2, tx2, ty1, color);
 
-			x += symboldata[index].w;
+			x += (int)(symboldata[index].w * size);
 		}
 	}
 
-	if (vi) {
-		dglDrawGeometry(vi, vtxstring);
-	}
+	return x;
+}
 
-	GL_ResetViewport();
-	GL_SetState(GLSTATE_BLEND, 0);
+//
+// Draw_BigText
+//
 
-	return x;
+int Draw_BigText(int x, int y, rcolor color, const char* string) {
+	return Draw_SymbolString(x, y, color, string, 1.0f, 0, 8);
 }
 
 //
@@ -696,117 +771,7 @@ int Draw_BigText(int x, int y, rcolor color, const char* string) {
 //
 
 int Draw_SmallText(int x, int y, rcolor color, const char* string) {
-	int c = 0;
-	int i = 0;
-	int vi = 0;
-	int index = 0;
-	float vx1 = 0.0f;
-	float vy1 = 0.0f;
-	float vx2 = 0.0f;
-	float vy2 = 0.0f;
-	float tx1 = 0.0f;
-	float tx2 = 0.0f;
-	float ty1 = 0.0f;
-	float ty2 = 0.0f;
-	float smbwidth;
-	float smbheight;
-	int pic;
-
-	const float scale_factor = 0.7f;
-
-	if (x <= -1) {
-		x = Center_Text(string);
-	}
-
-	y += 14;
-
-	pic = GL_BindGfxTexture("SYMBOLS", true);
-
-	smbwidth = (float)gfxwidth[pic];
-	smbheight = (float)gfxheight[pic];
-
-	const float ueps = 0.5f / smbwidth;
-	const float veps = 0.5f / smbheight;
-
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (int)r_hudFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (int)r_hudFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
-
-	dglSetVertex(vtxstring);
-
-	GL_SetState(GLSTATE_BLEND, 1);
-	GL_SetOrtho(0);
-
-	for (i = 0, vi = 0; i < dstrlen(string); i++, vi += 4) {
-		vx1 = (float)x + 30;
-		vy1 = (float)y;
-
-		c = string[i];
-		if (c == '\n' || c == '\t') {
-			continue;
-		}
-		else if (c == 0x20) {
-			x += 4;
-			continue;
-		}
-		else {
-			if (c >= '0' && c <= '9') index = (c - '0') + SM_NUMBERS;
-			if (c >= 'A' && c <= 'Z') index = (c - 'A') + SM_FONT1;
-			if (c >= 'a' && c <= 'z') index = (c - 'a') + SM_FONT2;
-			if (c == '-') index = SM_MISCFONT;
-			if (c == '%') index = SM_MISCFONT + 1;
-			if (c == '!') index = SM_MISCFONT + 2;
-			if (c == '.') index = SM_MISCFONT + 3;
-			if (c == '?') index = SM_MISCFONT + 4;
-			if (c == ':') index = SM_MISCFONT + 5;
-
-			if (c == '/') {
-				c = string[++i];
-				switch (c) {
-				case 'u': index = SM_MICONS + 17; break;
-				case 'd': index = SM_MICONS + 16; break;
-				case 'r': index = SM_MICONS + 18; break;
-				case 'l': index = SM_MICONS + 0;  break;
-				case 'b': index = SM_MICONS + 1;  break;
-				case 't': index = SM_THERMO + 0;  break;
-				case 's': index = SM_THERMO + 1;  break;
-				default: return 0;
-				}
-			}
-
-			vx2 = vx1 + symboldata[index].w * scale_factor;
-			vy2 = vy1 - symboldata[index].h * scale_factor;
-
-			tx1 = ((float)symboldata[index].x / smbwidth) + ueps;
-			tx2 = ((float)(symboldata[index].x + symboldata[index].w) / smbwidth) - ueps;
-			ty1 = ((float)symboldata[index].y / smbheight) + veps;
-			ty2 = ((float)(symboldata[index].y + symboldata[index].h) / smbheight) - veps;
-
-			vtxstring[vi + 0].x = vx1; vtxstring[vi + 0].y = vy1; vtxstring[vi + 0].tu = tx1; vtxstring[vi + 0].tv = ty2;
-			vtxstring[vi + 1].x = vx2; vtxstring[vi + 1].y = vy1; vtxstring[vi + 1].tu = tx2; vtxstring[vi + 1].tv = ty2;
-			vtxstring[vi + 2].x = vx2; vtxstring[vi + 2].y = vy2; vtxstring[vi + 2].tu = tx2; vtxstring[vi + 2].tv = ty1;
-			vtxstring[vi + 3].x = vx1; vtxstring[vi + 3].y = vy2; vtxstring[vi + 3].tu = tx1; vtxstring[vi + 3].tv = ty1;
-
-			dglSetVertexColor(vtxstring + vi, color, 4);
-
-			dglTriangle(vi + 2, vi + 1, vi + 0);
-			dglTriangle(vi + 3, vi + 2, vi + 0);
-
-			if (devparm) { vertCount += 4; }
-
-			x += (int)(symboldata[index].w * scale_factor);
-		}
-	}
-
-	if (vi) {
-		dglDrawGeometry(vi, vtxstring);
-	}
-
-	GL_ResetViewport();
-	GL_SetState(GLSTATE_BLEND, 0);
-
-	return x;
+	return Draw_SymbolString(x, y, color, string, 0.7f, 30, 4);
 }
 
 //
@@ -1137,11 +1102,9 @@ float Draw_ConsoleText(float x, float y, rcolor color,
 	float scale, const char* string, ...) {
 	int c = 0;
 	int i = 0;
-	int vi = 0;
+	int len;
 	float vx1 = 0.0f;
 	float vy1 = 0.0f;
-	float vx2 = 0.0f;
-	float vy2 = 0.0f;
 	float tx1 = 0.0f;
 	float tx2 = 0.0f;
 	float ty1 = 0.0f;
@@ -1150,81 +1113,47 @@ float Draw_ConsoleText(float x, float y, rcolor color,
 	va_list    va;
 	float width;
 	float height;
+	float orthoscale;
 	int pic;
 
 	va_start(va, string);
 	vsprintf(msg, string, va);
 	va_end(va);
 
-	pic = GL_BindGfxTexture("CONFONT", true);
+	pic = GL_CacheGfxHandle(&confonthandle, "CONFONT");
+	if (!Draw_BatchBegin(pic, GL_NEAREST, false)) {
+		return x;
+	}
 
 	width = (float)gfxwidth[pic];
 	height = (float)gfxheight[pic];
 
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-	dglSetVertex(vtxstring);
+	orthoscale = GL_GetOrthoScale();
+	len = dstrlen(msg);
 
-	GL_SetState(GLSTATE_BLEND, 1);
-	GL_SetOrtho(0);
-
-	for (i = 0, vi = 0; i < dstrlen(msg); i++, vi += 4) {
+	for (i = 0; i < len; i++) {
 		vx1 = x;
 		vy1 = y;
 
-		c = msg[i];
+		c = (byte)msg[i];
 		if (c == '\n' || c == '\t') {
 			continue;    // villsa: safety check
 		}
 		else {
-			vx2 = vx1 + ((float)confontmap[c].w * scale);
-			vy2 = vy1 - ((float)confontmap[c].h * scale);
-
 			tx1 = ((float)confontmap[c].x / width) + 0.001f;
 			tx2 = (tx1 + (float)confontmap[c].w / width) - 0.002f;
 
 			ty1 = ((float)confontmap[c].y / height);
 			ty2 = ty1 + (((float)confontmap[c].h / height));
 
-			vtxstring[vi + 0].x = vx1;
-			vtxstring[vi + 0].y = vy1;
-			vtxstring[vi + 0].tu = tx1;
-			vtxstring[vi + 0].tv = ty2;
-			vtxstring[vi + 1].x = vx2;
-			vtxstring[vi + 1].y = vy1;
-			vtxstring[vi + 1].tu = tx2;
-			vtxstring[vi + 1].tv = ty2;
-			vtxstring[vi + 2].x = vx2;
-			vtxstring[vi + 2].y = vy2;
-			vtxstring[vi + 2].tu = tx2;
-			vtxstring[vi + 2].tv = ty1;
-			vtxstring[vi + 3].x = vx1;
-			vtxstring[vi + 3].y = vy2;
-			vtxstring[vi + 3].tu = tx1;
-			vtxstring[vi + 3].tv = ty1;
-
-			dglSetVertexColor(vtxstring + vi, color, 4);
-
-			dglTriangle(vi + 2, vi + 1, vi + 0);
-			dglTriangle(vi + 3, vi + 2, vi + 0);
-
-			if (devparm) {
-				vertCount += 4;
-			}
+			Draw_BatchQuad(vx1 * orthoscale, vy1 * orthoscale,
+				(vx1 + ((float)confontmap[c].w * scale)) * orthoscale,
+				(vy1 - ((float)confontmap[c].h * scale)) * orthoscale,
+				tx1, ty2, tx2, ty1, color);
 
 			x += ((float)confontmap[c].w * scale);
 		}
 	}
 
-	if (vi) {
-		dglDrawGeometry(vi, vtxstring);
-	}
-
-	GL_ResetViewport();
-	GL_SetState(GLSTATE_BLEND, 0);
-
 	return x;
 }
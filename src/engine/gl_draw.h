@@ -67,4 +67,17 @@ void Draw_Number(int x, int y, int num, int type, rcolor c);
 float Draw_ConsoleText(float x, float y, rcolor color,
 	float scale, const char* string, ...);
 
+extern int drawbatchquads;
+extern unsigned int drawbatchflushes;
+
+extern unsigned int drawcallsframe;
+extern unsigned int drawbatchesframe;
+
+void Draw_FlushBatch(void);
+void Draw_EndFrame(void);
+void Draw_PrintStats(void);
+
+// call before changing GL state or drawing anything outside the batch
+#define Draw_CheckBatch()   do { if (drawbatchquads) Draw_FlushBatch(); } while (0)
+
 #endif
@@ -34,6 +34,7 @@
 #include "z_zone.h"
 #include "r_main.h"
 #include "gl_texture.h"
+#include "gl_draw.h"
 #include "con_console.h"
 #include "m_misc.h"
 #include "g_actions.h"
@@ -66,6 +67,8 @@ CVAR_EXTERNAL(r_multisample);
 CVAR_EXTERNAL(st_flashoverlay);
 CVAR_EXTERNAL(r_colorscale);
 
+CVAR(r_framesinflight, 2);
+
 void GL_OnResize(int w, int h);
 
 //
@@ -97,6 +100,7 @@ GL_EXT_compiled_vertex_array_Define();
 GL_ARB_texture_env_combine_Define();
 GL_EXT_texture_env_combine_Define();
 GL_EXT_texture_filter_anisotropic_Define();
+GL_ARB_sync_Define();
 
 //
 // GL_CheckExtension
@@ -139,6 +143,8 @@ void GL_SetOrtho(boolean stretch) {
     float width;
     float height;
 
+    Draw_CheckBatch();
+
     if(checkortho) {
         if(widescreen) {
             if(stretch && checkortho == 2) {
@@ -208,9 +214,160 @@ float GL_GetOrthoScale(void) {
 //
 
 void GL_SwapBuffers(void) {
+    Draw_CheckBatch();
     I_FinishUpdate();
 }
 
+//
+// FRAME PIPELINING
+//
+// Rather than draining the GPU with glFinish after every swap, a fence
+// is dropped behind each frame and the CPU only blocks once more than
+// r_framesinflight frames are still queued. A limit of 1 waits on the
+// frame just submitted, which is the old behaviour; without GL_ARB_sync
+// glFinish is still used.
+//
+
+#define MAXFRAMESINFLIGHT   3
+
+typedef struct {
+    Uint64  cpu;
+    Uint64  gpuwait;
+} framesync_t;
+
+static GLsync       framefences[MAXFRAMESINFLIGHT];
+static int          framefencehead = 0;
+static int          numframefences = 0;
+static Uint64       framesynclast = 0;
+
+static framesync_t  framesyncs[FRAMETIME_HISTORY];
+static int          framesynchead = 0;
+static int          numframesyncs = 0;
+
+//
+// GL_WaitFrameFence
+// Blocks until the oldest fence is signalled, then frees it
+//
+
+static void GL_WaitFrameFence(void) {
+    int oldest;
+    GLenum result;
+
+    oldest = (framefencehead - numframefences + MAXFRAMESINFLIGHT) % MAXFRAMESINFLIGHT;
+
+    do {
+        result = dglClientWaitSync(framefences[oldest],
+            GL_SYNC_FLUSH_COMMANDS_BIT, SDL_NS_PER_SECOND);
+    } while (result == GL_TIMEOUT_EXPIRED);
+
+    dglDeleteSync(framefences[oldest]);
+    framefences[oldest] = NULL;
+    numframefences--;
+}
+
+//
+// GL_FrameFence
+// Call right after the buffer swap. Records how long the CPU spent
+// on the frame and how long it then waited on the GPU
+//
+
+void GL_FrameFence(void) {
+    Uint64 start;
+    Uint64 end;
+    int limit;
+
+    start = SDL_GetTicksNS();
+
+    if (!has_GL_ARB_sync) {
+        dglFinish();
+    }
+    else {
+        limit = MAX(1, MIN((int)r_framesinflight.value, MAXFRAMESINFLIGHT));
+
+        framefences[framefencehead] = dglFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        framefencehead = (framefencehead + 1) % MAXFRAMESINFLIGHT;
+        numframefences++;
+
+        while (numframefences >= limit) {
+            GL_WaitFrameFence();
+        }
+    }
+
+    end = SDL_GetTicksNS();
+
+    if (framesynclast != 0) {
+        framesyncs[framesynchead].cpu = start - framesynclast;
+        framesyncs[framesynchead].gpuwait = end - start;
+        framesynchead = (framesynchead + 1) % FRAMETIME_HISTORY;
+
+        if (numframesyncs < FRAMETIME_HISTORY) {
+            numframesyncs++;
+        }
+    }
+
+    framesynclast = end;
+}
+
+//
+// GL_ClearFrameFences
+// Waits out and frees any outstanding fences. Must be called before
+// the context they belong to is destroyed
+//
+
+void GL_ClearFrameFences(void) {
+    while (numframefences > 0) {
+        GL_WaitFrameFence();
+    }
+
+    framefencehead = 0;
+    framesynclast = 0;
+}
+
+//
+// GL_GetFrameSyncStats
+// Average CPU time and GPU wait per frame in milliseconds
+//
+
+boolean GL_GetFrameSyncStats(float* cpu, float* gpuwait) {
+    Uint64 cputotal = 0;
+    Uint64 gputotal = 0;
+    int i;
+
+    if (!numframesyncs) {
+        return false;
+    }
+
+    for (i = 0; i < numframesyncs; i++) {
+        cputotal += framesyncs[i].cpu;
+        gputotal += framesyncs[i].gpuwait;
+    }
+
+    *cpu = (float)cputotal / numframesyncs / SDL_NS_PER_MS;
+    *gpuwait = (float)gputotal / numframesyncs / SDL_NS_PER_MS;
+
+    return true;
+}
+
+//
+// GL_PrintFrameSync
+//
+
+void GL_PrintFrameSync(void) {
+    float cpu;
+    float gpuwait;
+
+    CON_Printf(GREEN, "Frame sync: %s, %i frame(s) in flight\n",
+        has_GL_ARB_sync ? "fences" : "glFinish",
+        has_GL_ARB_sync ? MAX(1, MIN((int)r_framesinflight.value, MAXFRAMESINFLIGHT)) : 1);
+
+    if (!GL_GetFrameSyncStats(&cpu, &gpuwait)) {
+        return;
+    }
+
+    CON_Printf(AQUA, "avg cpu %.2fms, avg gpu wait %.2fms (%.0f%% waiting)\n",
+        cpu, gpuwait, 100.0f * gpuwait / MAX(cpu + gpuwait, 0.001f));
+}
+
 //
 // GL_GetScreenBuffer
 //
@@ -225,6 +382,8 @@ byte* GL_GetScreenBuffer(int x, int y, int width, int height) {
     int pack;
     int col;
 
+    Draw_CheckBatch();
+
     col     = (width * 3);
     data    = (byte*)Z_Calloc(height * width * 3, PU_STATIC, 0);
     buffer  = (byte*)Z_Calloc(col, PU_STATIC, 0);
@@ -400,6 +559,8 @@ void GL_SetupAndDraw2DQuad(float x, float y, int width, int height,
 static int glstate_flag = 0;
 
 void GL_SetState(int bit, boolean enable) {
+    Draw_CheckBatch();
+
 #define TOGGLEGLBIT(flag, bit)                          \
     if(enable && !(glstate_flag & (1 << flag)))         \
     {                                                   \
@@ -459,6 +620,8 @@ void GL_CheckFillMode(void) {
 void GL_ClearView(rcolor clearcolor) {
     float f[4];
 
+    Draw_CheckBatch();
+
     dglGetColorf(clearcolor, f);
     dglClearColor(f[0], f[1], f[2], f[3]);
     dglClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -557,6 +720,7 @@ void GL_Init(void) {
     GL_ARB_texture_env_combine_Init();
     GL_EXT_texture_env_combine_Init();
     GL_EXT_texture_filter_anisotropic_Init();
+    GL_ARB_sync_Init();
 
     if(!has_GL_ARB_multitexture) {
         CON_Warnf("GL_ARB_multitexture not supported...\n");
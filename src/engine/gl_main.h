@@ -81,6 +81,10 @@ void GL_ClearView(rcolor clearcolor);
 boolean GL_GetBool(int x);
 void GL_CheckFillMode(void);
 void GL_SwapBuffers(void);
+void GL_FrameFence(void);
+void GL_ClearFrameFences(void);
+boolean GL_GetFrameSyncStats(float* cpu, float* gpuwait);
+void GL_PrintFrameSync(void);
 byte* GL_GetScreenBuffer(int x, int y, int width, int height);
 void GL_SetTextureFilter(void);
 void GL_SetOrtho(boolean stretch);
@@ -28,6 +28,7 @@ extern int g_psprite_scope;
 #include "w_wad.h"
 #include "z_zone.h"
 #include "gl_main.h"
+#include "gl_draw.h"
 #include "p_spec.h"
 #include "con_console.h"
 #include "g_actions.h"
@@ -62,6 +63,7 @@ int         g_start;
 int         g_end;
 int         numgfx;
 int* gfx_lumpnum;
+static int* gfx_lumpmap;    // lump -> gfx id, -1 if the lump isn't a gfx
 dtexture* gfxptr;
 word* gfxwidth;
 word* gfxorigwidth;
@@ -284,6 +286,8 @@ void GL_BindWorldTexture(int texnum, int* width, int* height) {
 	int w;
 	int h;
 
+	Draw_CheckBatch();
+
 	if (r_fillmode.value <= 0) {
 		return;
 	}
@@ -438,6 +442,11 @@ static void InitGfxTextures(void) {
 	int* png_indices = (int*)Z_Calloc(sizeof(int) * numlumps, PU_STATIC, NULL);
 	int  num_found = 0;
 
+	gfx_lumpmap = (int*)Z_Malloc(sizeof(int) * numlumps, PU_STATIC, NULL);
+	for (i = 0; i < numlumps; ++i) {
+		gfx_lumpmap[i] = -1;
+	}
+
 	for (i = numlumps - 1; i >= 0; --i) {
 		int len = W_LumpLength(i);
 		if (len < 8)
@@ -461,6 +470,8 @@ static void InitGfxTextures(void) {
 		}
 		if (!dup)
 			png_indices[num_found++] = i;
+		else
+			gfx_lumpmap[i] = -2 - png_indices[j];   // alias, resolved below
 	}
 
 	for (i = 0, j = num_found - 1; i < j; ++i, --j) {
@@ -489,45 +500,122 @@ static void InitGfxTextures(void) {
 		gfxorigheight[i] = (int16_t)h;
 		gfxheight[i] = (int16_t)h;
 		gfx_lumpnum[i] = lumpnum;
+		gfx_lumpmap[lumpnum] = i;
 
 		if (png)
 			Z_Free(png);
 	}
 
+	// shadowed PNG lumps resolve to the gfx of the lump that won
+	for (i = 0; i < numlumps; ++i) {
+		if (gfx_lumpmap[i] <= -2) {
+			gfx_lumpmap[i] = gfx_lumpmap[-2 - gfx_lumpmap[i]];
+		}
+	}
+
 	Z_Free(png_indices);
 	CON_DPrintf("%i generic PNG textures initialized (full WAD scan)\n", numgfx);
 }
 
+//
+// GL_GetGfxIdForLump
+//
+
 int GL_GetGfxIdForLump(int lump) {
-	for (int i = 0; i < numgfx; ++i) {
-		if (gfx_lumpnum[i] == lump) {
-			return i;
+	if (lump < 0 || lump >= numlumps || !gfx_lumpmap) {
+		return -1;
+	}
+	return gfx_lumpmap[lump];
+}
+
+//
+// GL_WarnGfxOnce
+// Callers that draw every frame would otherwise repeat the
+// same warning each tic, so only the first miss per name is printed
+//
+
+#define MAXGFXWARNINGS  64
+
+static char gfxwarned[MAXGFXWARNINGS][9];
+static int  numgfxwarned = 0;
+
+static void GL_WarnGfxOnce(const char* name, const char* reason) {
+	int i;
+
+	for (i = 0; i < numgfxwarned; ++i) {
+		if (!dstrnicmp(gfxwarned[i], name, 8)) {
+			return;
 		}
 	}
-	return -1;
+
+	if (numgfxwarned == MAXGFXWARNINGS) {
+		return;
+	}
+
+	for (i = 0; i < 8 && name[i]; ++i) {
+		gfxwarned[numgfxwarned][i] = name[i];
+	}
+	gfxwarned[numgfxwarned++][i] = 0;
+	CON_Warnf("GL_GetGfxHandle: '%s' %s\n", name, reason);
 }
 
 //
-// GL_BindGfxTexture
+// GL_GetGfxHandle
+// Resolves a gfx lump name once; the handle can be kept
+// and passed to GL_BindGfxHandle for the lifetime of the wad set
 //
 
-int GL_BindGfxTexture(const char* name, int alpha) {
-	byte* png;
+int GL_GetGfxHandle(const char* name) {
 	int lump;
-	int width, height;
-	int format, type;
 	int gfxid;
 
 	lump = W_CheckNumForName(name);
 	if (lump < 0) {
-		CON_Warnf("GL_BindGfxTexture: '%s' not found\n", name);
+		GL_WarnGfxOnce(name, "not found");
 		return -1;
 	}
 
 	gfxid = GL_GetGfxIdForLump(lump);
-
 	if (gfxid < 0) {
-		CON_Warnf("GL_BindGfxTexture: '%s' is not a PNG gfx lump (skipping)\n", name);
+		GL_WarnGfxOnce(name, "is not a PNG gfx lump (skipping)");
+		return -1;
+	}
+
+	return gfxid;
+}
+
+//
+// GL_CacheGfxHandle
+// Lazily resolves a handle kept by the caller, initialized to GFX_UNRESOLVED
+//
+
+int GL_CacheGfxHandle(int* handle, const char* name) {
+	if (*handle == GFX_UNRESOLVED) {
+		*handle = GL_GetGfxHandle(name);
+	}
+	return *handle;
+}
+
+//
+// GL_BindGfxTexture
+//
+
+int GL_BindGfxTexture(const char* name, int alpha) {
+	return GL_BindGfxHandle(GL_GetGfxHandle(name), alpha);
+}
+
+//
+// GL_BindGfxHandle
+//
+
+int GL_BindGfxHandle(int gfxid, int alpha) {
+	byte* png;
+	int width, height;
+	int format, type;
+
+	Draw_CheckBatch();
+
+	if (gfxid < 0 || gfxid >= numgfx) {
 		return -1;
 	}
 
@@ -593,7 +681,7 @@ int GL_BindGfxTexture(const char* name, int alpha) {
 		return gfxid;
 	}
 
-	png = I_PNGReadData(lump, false, true, alpha, &width, &height, NULL, 0);
+	png = I_PNGReadData(gfx_lumpnum[gfxid], false, true, alpha, &width, &height, NULL, 0);
 
 	dglGenTextures(1, &gfxptr[gfxid]);
 	dglBindTexture(GL_TEXTURE_2D, gfxptr[gfxid]);
@@ -721,6 +809,8 @@ void GL_BindSpriteTexture(int spritenum, int pal) {
 	byte* png;
 	int w, h;
 
+	Draw_CheckBatch();
+
 	if (r_fillmode.value <= 0)
 		return;
 
@@ -816,6 +906,8 @@ dtexture GL_ScreenToTexture(void) {
 	int width;
 	int height;
 
+	Draw_CheckBatch();
+
 	dglEnable(GL_TEXTURE_2D);
 
 	dglGenTextures(1, &id);
@@ -862,6 +954,8 @@ dtexture GL_ScreenToTexture(void) {
 static dtexture dummytexture = 0;
 
 void GL_BindDummyTexture(void) {
+	Draw_CheckBatch();
+
 	if (dummytexture == 0) {
 		//
 		// build dummy texture
@@ -900,6 +994,8 @@ static dtexture envtexture = 0;
 void GL_BindEnvTexture(void) {
 	rcolor rgb[16];
 
+	Draw_CheckBatch();
+
 	if (r_fillmode.value <= 0) {
 		return;
 	}
@@ -1004,6 +1100,8 @@ void GL_UnloadTexture(dtexture* texture) {
 //
 
 void GL_SetTextureUnit(int unit, int enable) {
+	Draw_CheckBatch();
+
 	if (!has_GL_ARB_multitexture || r_fillmode.value <= 0 || unit > 3)
 		return;
 	if (curunit == unit)
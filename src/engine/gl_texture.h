@@ -38,6 +38,9 @@ extern word* palettetranslation;
 extern int                  g_start;
 extern int                  g_end;
 extern int                  numgfx;
+
+#define GFX_UNRESOLVED      -2  // initial value for handles passed to GL_CacheGfxHandle
+
 extern dtexture* gfxptr;
 extern word* gfxwidth;
 extern word* gfxorigwidth;
@@ -67,6 +70,9 @@ void        GL_SetCombineOperandAlpha(int operand, int target);
 void        GL_BindWorldTexture(int texnum, int* width, int* height);
 void        GL_BindSpriteTexture(int spritenum, int pal);
 int         GL_BindGfxTexture(const char* name, int alpha);
+int         GL_BindGfxHandle(int gfxid, int alpha);
+int         GL_GetGfxHandle(const char* name);
+int         GL_CacheGfxHandle(int* handle, const char* name);
 int         GL_PadTextureDims(int size);
 void        GL_SetNewPalette(int id, byte palID);
 void        GL_DumpTextures(void);
@@ -763,7 +763,7 @@ static float GetDisplayRefreshRate(void) {
 void I_FinishUpdate(void) {
 	I_UpdateGrab();
 	SDL_GL_SwapWindow(window);
-	dglFinish();
+	GL_FrameFence();
 	BusyDisk = false;
 }
 
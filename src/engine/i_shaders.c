@@ -24,6 +24,7 @@
 #include "con_cvar.h"
 #include "i_shaders.h"
 #include "dgl.h"
+#include "gl_draw.h"
 
 extern void I_SectorCombiner_Commit(void);
 
@@ -39,6 +40,12 @@ static GLint sLocPassMode[4] = { -1,-1,-1,-1 };
 static GLint sLocPassColor[4] = { -1,-1,-1,-1 };
 static GLint sLocPassFactor[4] = { -1,-1,-1,-1 };
 static GLint sLocFogEnabled = -1, sLocFogColor = -1, sLocFogFactor = -1;
+static GLint sLocLightTable = -1, sLocLightTableSize = -1;
+static GLint sVertexTextureUnits = 0;
+
+// generic attribute for per vertex lights, clear of the slots some
+// drivers alias to the fixed function arrays
+#define LIGHT_ATTRIB 7
 
 typedef struct {
 	int combine_rgb;
@@ -83,6 +90,11 @@ static void (APIENTRY* pglUniform1f)(GLint, float);
 static void (APIENTRY* pglUniform2f)(GLint, float, float);
 static void (APIENTRY* pglUniform3f)(GLint, float, float, float);
 static void (APIENTRY* pglUniform4f)(GLint, float, float, float, float);
+static void (APIENTRY* pglBindAttribLocation)(GLuint, GLuint, const GLchar*);
+static void (APIENTRY* pglVertexAttribPointer)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*);
+static void (APIENTRY* pglEnableVertexAttribArray)(GLuint);
+static void (APIENTRY* pglDisableVertexAttribArray)(GLuint);
+static void (APIENTRY* pglVertexAttrib3f)(GLuint, float, float, float);
 
 static int is_glsl_loaded = 0;
 static GLuint is_current_prog = 0;
@@ -103,6 +115,11 @@ static void I_ShaderLoad(void) {
 	GL_GET(glUniform1f);
 	GL_GET(glUniform3f);
 	GL_GET(glUniform4f);
+	GL_GET(glBindAttribLocation);
+	GL_GET(glVertexAttribPointer);
+	GL_GET(glEnableVertexAttribArray);
+	GL_GET(glDisableVertexAttribArray);
+	GL_GET(glVertexAttrib3f);
 #undef GL_GET
 	is_glsl_loaded = 1;
 }
@@ -122,10 +139,23 @@ static const char* vertex_shader_bilateral =
 "uniform int   uFogEnabled;\n"
 "uniform vec3  uFogColor;\n"
 "uniform float uFogFactor;\n"
+"// world lights: aLight is (upper, lower, blend) indices into the\n"
+"// light table, or negative where the vertex colour is used as is\n"
+"attribute vec3 aLight;\n"
+"uniform sampler2D uLightTable;\n"
+"uniform vec2  uLightTableSize;\n"
+"vec3 _lightColor(float i){\n"
+"  float row = floor(i / uLightTableSize.x);\n"
+"  vec2 uv = (vec2(i - row * uLightTableSize.x, row) + 0.5) / uLightTableSize;\n"
+"  return texture2DLod(uLightTable, uv, 0.0).rgb;\n"
+"}\n"
 "vec3 _applyPass(int mode, vec3 base, vec3 src, float f){\n""  if (mode==8448) return base*src;\n""  if (mode==260)  return base+src;\n""  if (mode==34165) return mix(base,src, clamp(f,0.0,1.0));\n""  if (mode==7681) return src;\n""  return base;\n""}\n""void main(){\n"
 "  vec4 eye = gl_ModelViewMatrix * gl_Vertex;\n  vEyeDist = length(eye.xyz);\n  gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
 "  vUV = gl_MultiTexCoord0.xy;\n"
 "  vColor = gl_Color;\n"
+"  if (aLight.x >= 0.0) {\n"
+"    vColor.rgb = clamp(mix(_lightColor(aLight.y), _lightColor(aLight.x), aLight.z), 0.0, 1.0);\n"
+"  }\n"
 "}\n";
 
 /* N64 3-point filter (atsb) */
@@ -329,6 +359,8 @@ static void I_3PointShaderInit(void) {
 	shader_struct.prog = pglCreateProgram();
 	pglAttachShader(shader_struct.prog, vs);
 	pglAttachShader(shader_struct.prog, fs);
+	if (pglBindAttribLocation)
+		pglBindAttribLocation(shader_struct.prog, LIGHT_ATTRIB, "aLight");
 	pglLinkProgram(shader_struct.prog);
 	GLint ok = 0; pglGetProgramiv(shader_struct.prog, GL_LINK_STATUS, &ok);
 	if (!ok) {
@@ -351,6 +383,13 @@ static void I_3PointShaderInit(void) {
 	sLocFogEnabled = pglGetUniformLocation(shader_struct.prog, "uFogEnabled");
 	sLocFogColor   = pglGetUniformLocation(shader_struct.prog, "uFogColor");
 	sLocFogFactor  = pglGetUniformLocation(shader_struct.prog, "uFogFactor");
+	sLocLightTable = pglGetUniformLocation(shader_struct.prog, "uLightTable");
+	sLocLightTableSize = pglGetUniformLocation(shader_struct.prog, "uLightTableSize");
+	glGetIntegerv(GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS, &sVertexTextureUnits);
+
+	// nothing uses the light table until a world list says so
+	if (pglVertexAttrib3f)
+		pglVertexAttrib3f(LIGHT_ATTRIB, -1.0f, -1.0f, 0.0f);
 
 	shader_struct.initialised = 1;
 
@@ -470,6 +509,7 @@ void I_ShaderFullscreenTint(float r, float g, float b, float a) {
 */
 
 void I_ShaderBind(void) {
+	Draw_CheckBatch();
 	I_3PointShaderInit();
 	I_OverlayTintShaderInit();
 	if (is_current_prog != shader_struct.prog) {
@@ -486,6 +526,7 @@ void I_ShaderBind(void) {
 }
 
 void I_ShaderUnBind(void) {
+	Draw_CheckBatch();
 	if (!shader_struct.initialised)
 		return;
 	if (is_current_prog != 0) {
@@ -508,3 +549,33 @@ void I_ShaderSetUseTexture(int on) {
 		return;
 	pglUniform1i(sLocUseTex, on ? 1 : 0);
 }
+
+/* WORLD LIGHT TABLE
+====================
+*/
+
+int I_ShaderLightTableReady(void) {
+	return shader_struct.initialised && sLocLightTable >= 0 && sLocLightTableSize >= 0 &&
+		sVertexTextureUnits > 0 && pglVertexAttribPointer && pglEnableVertexAttribArray &&
+		pglDisableVertexAttribArray && pglVertexAttrib3f;
+}
+
+void I_ShaderSetLightTable(int unit, int width, int height) {
+	if (!I_ShaderLightTableReady() || is_current_prog != shader_struct.prog)
+		return;
+	pglUniform1i(sLocLightTable, unit);
+	pglUniform2f(sLocLightTableSize, (float)width, (float)height);
+}
+
+void I_ShaderSetLightArray(const float* lights, int stride) {
+	if (!I_ShaderLightTableReady())
+		return;
+	if (lights) {
+		pglVertexAttribPointer(LIGHT_ATTRIB, 3, GL_FLOAT, GL_FALSE, stride, lights);
+		pglEnableVertexAttribArray(LIGHT_ATTRIB);
+	}
+	else {
+		pglDisableVertexAttribArray(LIGHT_ATTRIB);
+		pglVertexAttrib3f(LIGHT_ATTRIB, -1.0f, -1.0f, 0.0f);
+	}
+}
@@ -34,6 +34,9 @@ void I_ShaderSetTextureSize(int w, int h);
 void I_ShaderSetUseTexture(int on);
 void I_OverlayTintShaderInit(void);
 void I_ShaderFullscreenTint(float r, float g, float b, float a);
+int I_ShaderLightTableReady(void);
+void I_ShaderSetLightTable(int unit, int width, int height);
+void I_ShaderSetLightArray(const float* lights, int stride);
 
 typedef char GLchar;
 typedef int GLint;
@@ -49,4 +52,8 @@ typedef unsigned int GLenum;
 #define GL_INFO_LOG_LENGTH  0x8B84
 #endif
 
+#ifndef GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS
+#define GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS 0x8B4C
+#endif
+
 #endif
@@ -46,6 +46,7 @@
 extern void I_ShutdownSound(void);
 
 CVAR(i_interpolateframes, 1);
+CVAR(i_maxfps, 0);
 CVAR(v_accessibility, 0);
 CVAR(v_fadein, 1);
 
@@ -58,24 +59,25 @@ void I_Sleep(unsigned long ms) {
 	SDL_Delay(ms);
 }
 
+// all timing runs off one nanosecond clock so the tic counter,
+// the interpolation fraction and the frame pacer agree
 static Uint64 basetime = 0;
 
-//
-// I_GetTimeNormal: returns time elapsed in number of ticks: 1s -> TICRATE, 2s -> 2*TICRATE, ...
-//
-static int I_GetTimeNormal(void) {
-	Uint64 ticks;
-	Uint64 tic_division = 1000;
-
-	ticks = SDL_GetTicks();
+static Uint64 I_GetClockNS(void) {
+	Uint64 now = SDL_GetTicksNS();
 
 	if (basetime == 0) {
-		basetime = ticks;
+		basetime = now;
 	}
 
-	ticks -= basetime;
+	return now - basetime;
+}
 
-	return (ticks * TICRATE) / tic_division;
+//
+// I_GetTimeNormal: returns time elapsed in number of ticks: 1s -> TICRATE, 2s -> 2*TICRATE, ...
+//
+static int I_GetTimeNormal(void) {
+	return (int)((I_GetClockNS() * TICRATE) / SDL_NS_PER_SECOND);
 }
 
 //
@@ -109,7 +111,6 @@ fixed_t         rendertic_frac = 0;
 Uint64			rendertic_start;
 Uint64			rendertic_step;
 Uint64			rendertic_next;
-const float     rendertic_msec = 100 * TICRATE / 100000.0f;
 
 //
 // I_StartDisplay
@@ -122,7 +123,7 @@ boolean I_StartDisplay(void) {
 		return false;
 	}
 
-	start_displaytime = SDL_GetTicks();
+	start_displaytime = I_GetClockNS();
 	InDisplay = true;
 
 	return true;
@@ -134,34 +135,37 @@ boolean I_StartDisplay(void) {
 
 void I_EndDisplay(void) {
 	if (i_interpolateframes.value) {
-		displaytime = SDL_GetTicks() - start_displaytime;
+		displaytime = I_GetClockNS() - start_displaytime;
 	}
 	InDisplay = false;
 }
 
 //
 // I_GetTimeFrac
+// How far the display is between the last tic run and the next
+// tic boundary, counting the time the previous frame took to draw
 //
 
 fixed_t I_GetTimeFrac(void) {
 	Uint64 now;
-	fixed_t frac;
-
-	now = SDL_GetTicks();
+	Uint64 elapsed;
 
 	if (rendertic_step == 0) {
 		return FRACUNIT;
 	}
-	else {
-		frac = (fixed_t)((now - rendertic_start + displaytime) * FRACUNIT / rendertic_step);
-		if (frac < 0) {
-			frac = 0;
-		}
-		if (frac > FRACUNIT) {
-			frac = FRACUNIT;
-		}
-		return frac;
+
+	now = I_GetClockNS();
+
+	if (now < rendertic_start) {
+		return 0;
 	}
+
+	elapsed = now - rendertic_start + displaytime;
+	if (elapsed >= rendertic_step) {
+		return FRACUNIT;
+	}
+
+	return (fixed_t)((elapsed << FRACBITS) / rendertic_step);
 }
 
 //
@@ -171,27 +175,215 @@ fixed_t I_GetTimeFrac(void) {
 //
 
 int I_GetTimeMS(void) {
-	Uint64 ticks;
-
-	ticks = SDL_GetTicks();
+	return (int)(I_GetClockNS() / SDL_NS_PER_MS);
+}
 
-	if (basetime == 0) {
-		basetime = ticks;
-	}
+//
+// I_GetTimeNS
+//
+// High resolution clock in nanoseconds, for profiling and pacing
+//
 
-	return ticks - basetime;
+uint64_t I_GetTimeNS(void) {
+	return SDL_GetTicksNS();
 }
 
 //
 // I_GetTime_SaveMS
+// Marks the start of a tic and works out where the next tic boundary is
 //
 
 void I_GetTime_SaveMS(void) {
-	rendertic_start = SDL_GetTicks();
-	rendertic_next = (unsigned int)((rendertic_start * rendertic_msec + 1.0f) / rendertic_msec);
+	rendertic_start = I_GetClockNS();
+	rendertic_next = ((rendertic_start * TICRATE) / SDL_NS_PER_SECOND + 1) * SDL_NS_PER_SECOND / TICRATE;
 	rendertic_step = rendertic_next - rendertic_start;
 }
 
+//
+// FRAME PACING
+//
+
+// how long before the deadline to stop sleeping and start spinning;
+// OS sleeps routinely overshoot by a millisecond or so
+#define PACE_SPIN_NS        (2 * SDL_NS_PER_MS)
+
+static Uint64   pace_nextframe = 0;
+static Uint64   pace_lastframe = 0;
+
+static Uint64   frametimes[FRAMETIME_HISTORY];
+static int      frametimehead = 0;
+static int      numframetimes = 0;
+
+//
+// I_PaceFrame
+// Waits until the next frame is due when i_maxfps is set, then
+// records the time since the previous frame. Call once per
+// presented frame, right before the buffer swap.
+//
+
+void I_PaceFrame(void) {
+	Uint64 now;
+	Uint64 framelen;
+
+	now = I_GetClockNS();
+
+	if (i_maxfps.value > 0) {
+		framelen = (Uint64)(SDL_NS_PER_SECOND / i_maxfps.value);
+
+		// fell behind by more than a frame, or the cap changed; start over
+		if (pace_nextframe == 0 || now > pace_nextframe + framelen ||
+			pace_nextframe > now + framelen) {
+			pace_nextframe = now;
+		}
+
+		if (now < pace_nextframe) {
+			if (pace_nextframe - now > PACE_SPIN_NS) {
+				SDL_DelayNS(pace_nextframe - now - PACE_SPIN_NS);
+			}
+
+			while ((now = I_GetClockNS()) < pace_nextframe) {
+				// spin out the remainder
+			}
+		}
+
+		// step from the deadline, not from now, so the rate does not drift
+		pace_nextframe += framelen;
+	}
+	else {
+		pace_nextframe = 0;
+	}
+
+	if (pace_lastframe != 0) {
+		frametimes[frametimehead] = now - pace_lastframe;
+		frametimehead = (frametimehead + 1) % FRAMETIME_HISTORY;
+
+		if (numframetimes < FRAMETIME_HISTORY) {
+			numframetimes++;
+		}
+	}
+
+	pace_lastframe = now;
+}
+
+//
+// I_GetFrameTimes
+// Copies the recorded frame times in nanoseconds, oldest first.
+// Returns the number of entries copied.
+//
+
+int I_GetFrameTimes(uint64_t* out, int max) {
+	int start;
+	int count;
+	int i;
+
+	count = numframetimes < max ? numframetimes : max;
+	start = (frametimehead - count + FRAMETIME_HISTORY) % FRAMETIME_HISTORY;
+
+	for (i = 0; i < count; i++) {
+		out[i] = frametimes[(start + i) % FRAMETIME_HISTORY];
+	}
+
+	return count;
+}
+
+static int I_CompareFrameTimes(const void* a, const void* b) {
+	uint64_t fa = *(const uint64_t*)a;
+	uint64_t fb = *(const uint64_t*)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+//
+// I_GetFrameTimeStats
+// Summary of the frame time history in milliseconds
+//
+
+boolean I_GetFrameTimeStats(frametimestats_t* stats) {
+	uint64_t sorted[FRAMETIME_HISTORY];
+	uint64_t total = 0;
+	int count;
+	int i;
+
+	count = I_GetFrameTimes(sorted, FRAMETIME_HISTORY);
+	if (!count) {
+		return false;
+	}
+
+	for (i = 0; i < count; i++) {
+		total += sorted[i];
+	}
+
+	qsort(sorted, count, sizeof(*sorted), I_CompareFrameTimes);
+
+	stats->count = count;
+	stats->min = (float)sorted[0] / SDL_NS_PER_MS;
+	stats->max = (float)sorted[count - 1] / SDL_NS_PER_MS;
+	stats->avg = (float)total / count / SDL_NS_PER_MS;
+	stats->p99 = (float)sorted[(count * 99) / 100] / SDL_NS_PER_MS;
+
+	return true;
+}
+
+//
+// I_PrintFrameTimes
+// Console dump of the frame time history with a histogram in
+// 1ms buckets, so stutter shows up as a second hump
+//
+
+#define FRAMEHIST_BUCKETS   34
+#define FRAMEHIST_WIDTH     40
+
+void I_PrintFrameTimes(void) {
+	uint64_t times[FRAMETIME_HISTORY];
+	int buckets[FRAMEHIST_BUCKETS];
+	frametimestats_t stats;
+	char bar[FRAMEHIST_WIDTH + 1];
+	int count;
+	int most = 0;
+	int i;
+	int b;
+
+	if (!I_GetFrameTimeStats(&stats)) {
+		CON_Printf(WHITE, "No frames recorded\n");
+		return;
+	}
+
+	count = I_GetFrameTimes(times, FRAMETIME_HISTORY);
+	dmemset(buckets, 0, sizeof(buckets));
+
+	for (i = 0; i < count; i++) {
+		b = (int)(times[i] / SDL_NS_PER_MS);
+		if (b >= FRAMEHIST_BUCKETS) {
+			b = FRAMEHIST_BUCKETS - 1;
+		}
+
+		buckets[b]++;
+	}
+
+	for (i = 0; i < FRAMEHIST_BUCKETS; i++) {
+		if (buckets[i] > most) {
+			most = buckets[i];
+		}
+	}
+
+	CON_Printf(GREEN, "Last %i frames:\n", stats.count);
+	CON_Printf(AQUA, "min %.2fms, avg %.2fms, 99%% %.2fms, max %.2fms\n",
+		stats.min, stats.avg, stats.p99, stats.max);
+
+	for (i = 0; i < FRAMEHIST_BUCKETS; i++) {
+		if (!buckets[i]) {
+			continue;
+		}
+
+		b = (buckets[i] * FRAMEHIST_WIDTH + most - 1) / most;
+		dmemset(bar, '#', b);
+		bar[b] = 0;
+
+		CON_Printf(WHITE, "%s%2ims %4i %s\n", i == FRAMEHIST_BUCKETS - 1 ? ">" : " ",
+			i, buckets[i], bar);
+	}
+}
+
 //
 // I_BaseTiccmd
 //
@@ -454,6 +646,7 @@ void I_RegisterCvars(void) {
 	CON_CvarRegister(&i_brightness);
 	CON_CvarRegister(&i_overbright);
 	CON_CvarRegister(&i_interpolateframes);
+	CON_CvarRegister(&i_maxfps);
 	CON_CvarRegister(&v_accessibility);
 	CON_CvarRegister(&v_fadein);
 }
@@ -19,6 +19,7 @@
 #define __I_SYSTEM__
 
 #include <stdio.h>
+#include <stdint.h>
 #include <SDL3/SDL_platform_defines.h>
 
 #include "d_ticcmd.h"
@@ -35,11 +36,27 @@ extern fixed_t rendertic_frac;
 extern int (*I_GetTime)(void);
 void            I_InitClockRate(void);
 int             I_GetTimeMS(void);
+uint64_t        I_GetTimeNS(void);
 void            I_Sleep(unsigned long usecs);
 boolean        I_StartDisplay(void);
 void            I_EndDisplay(void);
 fixed_t         I_GetTimeFrac(void);
 void            I_GetTime_SaveMS(void);
+
+#define FRAMETIME_HISTORY   256
+
+typedef struct {
+	int     count;
+	float   min;
+	float   avg;
+	float   p99;
+	float   max;
+} frametimestats_t;
+
+void            I_PaceFrame(void);
+int             I_GetFrameTimes(uint64_t* out, int max);
+boolean         I_GetFrameTimeStats(frametimestats_t* stats);
+void            I_PrintFrameTimes(void);
 unsigned long   I_GetRandomTimeSeed(void);
 
 // Asynchronous interrupt functions should maintain private queues
@@ -240,7 +240,7 @@ void I_InitScreen(void) {
     setUseDXGISwapChainNVIDIA(flags & SDL_WINDOW_RESIZABLE);
 #endif
 
-    if (glContext) { SDL_GL_DestroyContext(glContext); glContext = NULL; }
+    if (glContext) { GL_ClearFrameFences(); SDL_GL_DestroyContext(glContext); glContext = NULL; }
     if (window) { SDL_DestroyWindow(window); window = NULL; }
 
     sprintf(title, "Doom64EX-Plus compiled on: %s", version_date);
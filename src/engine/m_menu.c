@@ -4040,6 +4040,9 @@ void M_StartMainMenu(void) {
 	M_SetCursorPos();
 }
 
+static int symbolshandle = GFX_UNRESOLVED;
+static int cursorhandle = GFX_UNRESOLVED;
+
 //
 // M_DrawMenuSkull
 //
@@ -4061,7 +4064,7 @@ static void M_DrawMenuSkull(int x, int y) {
 	vtx_t vtx[4];
 	const rcolor color = MENUCOLORWHITE;
 
-	pic = GL_BindGfxTexture("SYMBOLS", true);
+	pic = GL_BindGfxHandle(GL_CacheGfxHandle(&symbolshandle, "SYMBOLS"), true);
 
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -4121,7 +4124,7 @@ static void M_DrawCursor()
 	float scale;
 
 	scale = ((m_cursorscale.value + 25.0f) / 100.0f);
-	gfxIdx = GL_BindGfxTexture("CURSOR", true);
+	gfxIdx = GL_BindGfxHandle(GL_CacheGfxHandle(&cursorhandle, "CURSOR"), true);
 	if (gfxIdx < 0)
 		return;
 
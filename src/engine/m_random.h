@@ -21,6 +21,7 @@
 #include <stdint.h>
 
 extern unsigned char rndtable[256];
+extern int prndindex;
 int M_Random(void);
 int P_Random(void);
 void M_ClearRandom(void);
@@ -27,6 +27,7 @@
 #include "net_common.h"
 #include "net_defs.h"
 #include "net_io.h"
+#include "net_loop.h"
 #include "net_packet.h"
 #include "net_server.h"
 #include "net_structure.h"
@@ -247,6 +248,14 @@ static void NET_CL_ExpandFullTiccmd(net_full_ticcmd_t* cmd, unsigned int seq)
 
 	if (latency >= 0)
 	{
+		++net_simstats.latency_samples;
+		net_simstats.latency_total += latency;
+
+		if ((unsigned int)latency > net_simstats.latency_max)
+		{
+			net_simstats.latency_max = latency;
+		}
+
 		if (seq <= 20)
 		{
 			average_latency = latency * FRACUNIT;
@@ -713,6 +722,8 @@ static void NET_CL_SendResendRequest(int start, int end)
 
 	//printf("CL: Send resend %i-%i\n", start, end);
 
+	++net_simstats.cl_resends;
+
 	packet = NET_NewPacket(64);
 	NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_RESEND);
 	NET_WriteInt32(packet, start);
@@ -17,19 +17,51 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <SDL3/SDL_stdinc.h>
 
 #include "net_loop.h"
 #include "i_system.h"
 #include "net_defs.h"
 #include "net_packet.h"
+#include "d_net.h"
+#include "con_cvar.h"
+#include "con_console.h"
+#include "doomdef.h"
 
-#define MAX_QUEUE_SIZE 16
+// Network condition simulator.
+// Packets sent down the pipe wait in a delay line and are delivered
+// once their time comes, so latency, jitter, loss, duplication and
+// reordering can be dialled in with net_sim* cvars.  The dice come
+// from a seeded generator, so a given packet sequence is impaired
+// the same way on every run.  With everything at 0 the pipe behaves
+// exactly as before: instant and in order.
+
+CVAR(net_simlatency, 0);    // one-way delay, ms
+CVAR(net_simjitter, 0);     // +/- ms added to each packet
+CVAR(net_simloss, 0);       // percent of packets dropped
+CVAR(net_simdup, 0);        // percent of packets sent twice
+CVAR(net_simreorder, 0);    // percent held back behind later packets
+CVAR(net_simseed, 1);
+
+#define MAX_QUEUE_SIZE 256
+
+// long enough for the next tic's packet to overtake
+
+#define REORDER_HOLD_MS 40
 
 typedef struct
 {
-	net_packet_t* packets[MAX_QUEUE_SIZE];
-	int head, tail;
+	net_packet_t* packet;
+	unsigned int deliver_time;
+	unsigned int order;
+} queued_packet_t;
+
+typedef struct
+{
+	queued_packet_t packets[MAX_QUEUE_SIZE];
+	int count;
+	unsigned int order;
 } packet_queue_t;
 
 static packet_queue_t client_queue;
@@ -37,45 +69,214 @@ static packet_queue_t server_queue;
 static net_addr_t client_addr;
 static net_addr_t server_addr;
 
-static void QueueInit(packet_queue_t* queue)
+static unsigned int sim_rand;
+
+net_simstats_t net_simstats;
+
+static void NET_SimSeed(void)
 {
-	queue->head = queue->tail = 0;
+	sim_rand = (unsigned int)net_simseed.value;
+
+	if (sim_rand == 0)
+	{
+		sim_rand = 1;
+	}
 }
 
-static void QueuePush(packet_queue_t* queue, net_packet_t* packet)
+// xorshift32
+
+static unsigned int NET_SimRandom(void)
 {
-	int new_tail;
+	sim_rand ^= sim_rand << 13;
+	sim_rand ^= sim_rand >> 17;
+	sim_rand ^= sim_rand << 5;
 
-	new_tail = (queue->tail + 1) % MAX_QUEUE_SIZE;
+	return sim_rand;
+}
 
-	if (new_tail == queue->head)
+static boolean NET_SimChance(cvar_t* percent)
+{
+	if (percent->value <= 0)
+	{
+		return false;
+	}
+
+	return (NET_SimRandom() % 10000) < (unsigned int)(percent->value * 100);
+}
+
+static void QueueInit(packet_queue_t* queue)
+{
+	int i;
+
+	for (i = 0; i < queue->count; ++i)
+	{
+		NET_FreePacket(queue->packets[i].packet);
+	}
+
+	queue->count = 0;
+	queue->order = 0;
+}
+
+static void QueueInsert(packet_queue_t* queue, net_packet_t* packet,
+	unsigned int deliver_time)
+{
+	queued_packet_t* entry;
+
+	if (queue->count == MAX_QUEUE_SIZE)
 	{
 		// queue is full
 
+		++net_simstats.overflowed;
+		NET_FreePacket(packet);
 		return;
 	}
 
-	queue->packets[queue->tail] = packet;
-	queue->tail = new_tail;
+	entry = &queue->packets[queue->count++];
+	entry->packet = packet;
+	entry->deliver_time = deliver_time;
+	entry->order = queue->order++;
+
+	if (queue->count > net_simstats.max_in_flight)
+	{
+		net_simstats.max_in_flight = queue->count;
+	}
+}
+
+static unsigned int QueueDelay(void)
+{
+	int delay;
+	int jitter;
+
+	delay = (int)net_simlatency.value;
+	jitter = (int)net_simjitter.value;
+
+	if (jitter > 0)
+	{
+		delay += (int)(NET_SimRandom() % (jitter * 2 + 1)) - jitter;
+	}
+
+	if (NET_SimChance(&net_simreorder))
+	{
+		++net_simstats.reordered;
+		delay += REORDER_HOLD_MS;
+	}
+
+	return delay > 0 ? delay : 0;
+}
+
+static void QueuePush(packet_queue_t* queue, net_packet_t* packet)
+{
+	unsigned int nowtime;
+
+	++net_simstats.sent;
+
+	if (NET_SimChance(&net_simloss))
+	{
+		++net_simstats.dropped;
+		NET_FreePacket(packet);
+		return;
+	}
+
+	nowtime = I_GetTimeMS();
+
+	if (NET_SimChance(&net_simdup))
+	{
+		++net_simstats.duplicated;
+		QueueInsert(queue, NET_PacketDup(packet), nowtime + QueueDelay());
+	}
+
+	QueueInsert(queue, packet, nowtime + QueueDelay());
 }
 
 static net_packet_t* QueuePop(packet_queue_t* queue)
 {
 	net_packet_t* packet;
+	unsigned int nowtime;
+	int best;
+	int i;
+
+	nowtime = I_GetTimeMS();
+	best = -1;
+
+	// earliest due packet, in send order among equals
+
+	for (i = 0; i < queue->count; ++i)
+	{
+		queued_packet_t* entry = &queue->packets[i];
+
+		if ((int)(nowtime - entry->deliver_time) < 0)
+		{
+			continue;
+		}
+
+		if (best < 0
+			|| entry->deliver_time < queue->packets[best].deliver_time
+			|| (entry->deliver_time == queue->packets[best].deliver_time
+				&& entry->order < queue->packets[best].order))
+		{
+			best = i;
+		}
+	}
 
-	if (queue->tail == queue->head)
+	if (best < 0)
 	{
-		// queue empty
+		// nothing due yet
 
 		return NULL;
 	}
 
-	packet = queue->packets[queue->head];
-	queue->head = (queue->head + 1) % MAX_QUEUE_SIZE;
+	packet = queue->packets[best].packet;
+	queue->packets[best] = queue->packets[--queue->count];
 
 	return packet;
 }
 
+void NET_LoopRegisterCvars(void)
+{
+	CON_CvarRegister(&net_simlatency);
+	CON_CvarRegister(&net_simjitter);
+	CON_CvarRegister(&net_simloss);
+	CON_CvarRegister(&net_simdup);
+	CON_CvarRegister(&net_simreorder);
+	CON_CvarRegister(&net_simseed);
+}
+
+void NET_LoopResetStats(void)
+{
+	memset(&net_simstats, 0, sizeof(net_simstats));
+	NET_SimSeed();
+}
+
+void NET_LoopPrintStats(void)
+{
+	net_simstats_t* st = &net_simstats;
+
+	CON_Printf(GREEN, "Loopback: %ims +/- %ims, %.1f%% loss, %.1f%% dup, %.1f%% reorder, seed %i\n",
+		(int)net_simlatency.value, (int)net_simjitter.value, net_simloss.value,
+		net_simdup.value, net_simreorder.value, (int)net_simseed.value);
+
+	CON_Printf(WHITE, "packets: %u sent, %u dropped, %u duplicated, %u reordered, %u overflowed, %u max in flight\n",
+		st->sent, st->dropped, st->duplicated, st->reordered, st->overflowed,
+		st->max_in_flight);
+
+	CON_Printf(WHITE, "resends: %u by client, %u by server, %u deadlock\n",
+		st->cl_resends, st->sv_resends, st->deadlocks);
+
+	CON_Printf(WHITE, "stalls: %u for %u ms\n", st->stalls, st->stall_ms);
+
+	if (st->window_samples)
+	{
+		CON_Printf(AQUA, "server window: %.1f tics average, %u max of %i\n",
+			(double)st->window_total / st->window_samples, st->window_max, BACKUPTICS);
+	}
+
+	if (st->latency_samples)
+	{
+		CON_Printf(AQUA, "tic latency: %u ms average, %u ms max\n",
+			st->latency_total / st->latency_samples, st->latency_max);
+	}
+}
+
 //-----------------------------------------------------------------------------
 //
 // Client end code
@@ -160,6 +361,7 @@ static boolean NET_SV_InitClient(void)
 static boolean NET_SV_InitServer(void)
 {
 	QueueInit(&server_queue);
+	NET_LoopResetStats();
 
 	return true;
 }
@@ -23,4 +23,48 @@
 extern net_module_t net_loop_client_module;
 extern net_module_t net_loop_server_module;
 
+// Counters for the network condition simulator. The protocol
+// counters are kept by the client and server code.
+
+typedef struct
+{
+	// loopback pipe
+
+	unsigned int sent;
+	unsigned int dropped;
+	unsigned int duplicated;
+	unsigned int reordered;
+	unsigned int overflowed;
+	unsigned int max_in_flight;
+
+	// resend requests sent, and those sent to break a deadlock
+
+	unsigned int cl_resends;
+	unsigned int sv_resends;
+	unsigned int deadlocks;
+
+	// frames the game loop spent waiting for tics
+
+	unsigned int stalls;
+	unsigned int stall_ms;
+
+	// tics held in the server receive window, sampled each run
+
+	unsigned int window_samples;
+	unsigned int window_total;
+	unsigned int window_max;
+
+	// ms between building a ticcmd and getting it back from the server
+
+	unsigned int latency_samples;
+	unsigned int latency_total;
+	unsigned int latency_max;
+} net_simstats_t;
+
+extern net_simstats_t net_simstats;
+
+void NET_LoopRegisterCvars(void);
+void NET_LoopResetStats(void);
+void NET_LoopPrintStats(void);
+
 #endif /* #ifndef NET_LOOP_H */
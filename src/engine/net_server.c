@@ -29,6 +29,7 @@
 #include "net_common.h"
 #include "net_defs.h"
 #include "net_io.h"
+#include "net_loop.h"
 #include "net_packet.h"
 #include "net_structure.h"
 
@@ -697,6 +698,41 @@ static void NET_SV_ParseGameStart(net_packet_t* packet, net_client_t* client)
 	recvwindow_start = 0;
 }
 
+// Record how far ahead of the window start tics have been received
+
+static void NET_SV_SampleWindow(void)
+{
+	unsigned int occupancy;
+	int i, j;
+
+	occupancy = 0;
+
+	for (i = 0; i < MAXPLAYERS; ++i)
+	{
+		if (sv_players[i] == NULL || !ClientConnected(sv_players[i]))
+		{
+			continue;
+		}
+
+		for (j = BACKUPTICS - 1; j >= (int)occupancy; --j)
+		{
+			if (recvwindow[j][i].active)
+			{
+				occupancy = j + 1;
+				break;
+			}
+		}
+	}
+
+	++net_simstats.window_samples;
+	net_simstats.window_total += occupancy;
+
+	if (occupancy > net_simstats.window_max)
+	{
+		net_simstats.window_max = occupancy;
+	}
+}
+
 // Send a resend request to a client
 
 static void NET_SV_SendResendRequest(net_client_t* client, int start, int end)
@@ -709,6 +745,8 @@ static void NET_SV_SendResendRequest(net_client_t* client, int start, int end)
 
 	//printf("SV: send resend for %i-%i\n", start, end);
 
+	++net_simstats.sv_resends;
+
 	packet = NET_NewPacket(20);
 
 	NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_RESEND);
@@ -1398,12 +1436,14 @@ void NET_SV_CheckDeadlock(net_client_t* client)
 
 		for (i = 0; i < BACKUPTICS; ++i)
 		{
-			if (!recvwindow[client->player_number][i].active)
+			if (!recvwindow[i][client->player_number].active)
 			{
 				//printf("Possible deadlock: Sending resend request\n");
 
 				// Found a tic we haven't received.  Send a resend request.
 
+				++net_simstats.deadlocks;
+
 				NET_SV_SendResendRequest(client,
 					recvwindow_start + i,
 					recvwindow_start + i + 5);
@@ -1564,6 +1604,7 @@ void NET_SV_Run(void)
 	if (server_state == SERVER_IN_GAME)
 	{
 		NET_SV_AdvanceWindow();
+		NET_SV_SampleWindow();
 
 		for (i = 0; i < MAXPLAYERS; ++i)
 		{
@@ -147,7 +147,7 @@ int EV_DoCeiling(line_t* line, ceiling_e type, fixed_t speed) {
 		// new door thinker
 		rtn = 1;
 		ceiling = Z_Malloc(sizeof(*ceiling), PU_LEVSPEC, 0);
-		P_AddThinker(&ceiling->thinker);
+		P_AddThinker(&ceiling->thinker, tc_ceiling);
 		sec->specialdata = ceiling;
 		ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
 		ceiling->sector = sec;
@@ -26,6 +26,7 @@
 #include "s_sound.h"
 #include "doomstat.h"
 #include "sounds.h"
+#include "am_draw.h"
 
 //
 // VERTICAL DOORS
@@ -168,7 +169,7 @@ int EV_DoDoor(line_t* line, vldoor_e type) {
 		// new door thinker
 		rtn = 1;
 		door = Z_Malloc(sizeof(*door), PU_LEVSPEC, 0);
-		P_AddThinker(&door->thinker);
+		P_AddThinker(&door->thinker, tc_door);
 		sec->specialdata = door;
 
 		door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
@@ -280,7 +281,7 @@ void EV_VerticalDoor(line_t* line, mobj_t* thing) {
 
 	// new door thinker
 	door = Z_Malloc(sizeof(*door), PU_LEVSPEC, 0);
-	P_AddThinker(&door->thinker);
+	P_AddThinker(&door->thinker, tc_door);
 	sec->specialdata = door;
 	door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
 	door->sector = sec;
@@ -296,6 +297,7 @@ void EV_VerticalDoor(line_t* line, mobj_t* thing) {
 	case 31:
 		door->type = dooropen;
 		line->special = 0;
+		AM_MarkLineDirty(line);
 		break;
 
 	case 117:   // blazing door raise
@@ -306,6 +308,7 @@ void EV_VerticalDoor(line_t* line, mobj_t* thing) {
 	case 118:   // blazing door open
 		door->type = blazeOpen;
 		line->special = 0;
+		AM_MarkLineDirty(line);
 		door->speed = VDOORSPEED * 4;
 		break;
 	}
@@ -543,6 +543,19 @@ void P_NewChaseDir(mobj_t* actor) {
 	actor->movedir = DI_NODIR;    // can not move
 }
 
+//
+// PIT_BotTarget
+//
+
+static boolean PIT_BotTarget(mobj_t* mobj, void* data) {
+	if (!(mobj->flags & MF_COUNTKILL) || mobj->type <= MT_PLAYERBOT3 ||
+		mobj->health <= 0 || mobj == (mobj_t*)data) {
+		return false;
+	}
+
+	return true;
+}
+
 //
 // P_LookForPlayers
 // If allaround is false, only look 180 degrees in front.
@@ -585,23 +598,12 @@ boolean P_LookForPlayers(mobj_t* actor, boolean allaround) {
 		}
 
 		else {  // special case for player bots
-			fixed_t dist2 = INT_MAX;
 			mobj_t* mobj;
 
-			for (mobj = mobjhead.next; mobj != &mobjhead; mobj = mobj->next) {
-				if (!(mobj->flags & MF_COUNTKILL) || mobj->type <= MT_PLAYERBOT3 ||
-					mobj->health <= 0 || mobj == actor) {
-					continue;
-				}
-
-				// find a killable target as close as possible
-				dist = P_AproxDistance(mobj->x - actor->x, mobj->y - actor->y);
-				if (!(dist < dist2)) {
-					continue;
-				}
-
+			// find a killable target as close as possible
+			mobj = P_FindNearestThing(actor->x, actor->y, 0, PIT_BotTarget, actor);
+			if (mobj) {
 				P_SetTarget(&actor->target, mobj);
-				dist2 = dist;
 			}
 		}
 
@@ -1190,7 +1192,7 @@ void A_CyberDeathEvent(mobj_t* actor) {
 	mobjexp_t* exp;
 
 	exp = Z_Calloc(sizeof(*exp), PU_LEVSPEC, 0);
-	P_AddThinker(&exp->thinker);
+	P_AddThinker(&exp->thinker, tc_exp);
 
 	exp->thinker.function.acp1 = (actionf_p1)T_MobjExplode;
 	exp->delaymax = 4;
@@ -1458,7 +1460,7 @@ void A_RectDeathEvent(mobj_t* actor) {
 	mobjexp_t* exp;
 
 	exp = Z_Calloc(sizeof(*exp), PU_LEVSPEC, 0);
-	P_AddThinker(&exp->thinker);
+	P_AddThinker(&exp->thinker, tc_exp);
 
 	exp->thinker.function.acp1 = (actionf_p1)T_MobjExplode;
 	exp->delaymax = 3;
@@ -1610,7 +1612,7 @@ void A_SkullSetAlpha(mobj_t* actor) {
 // PIT_PainCheckLine
 //
 
-static boolean PIT_PainCheckLine(intercept_t* in) {
+static boolean PIT_PainCheckLine(pathtrace_t* pt, intercept_t* in) {
 	if (!in->d.line->backsector) {
 		return false;
 	}
@@ -2013,7 +2015,7 @@ void A_SpidDeathEvent(mobj_t* actor)
 	mobjexp_t* exp;
 
 	exp = Z_Calloc(sizeof(*exp), PU_LEVSPEC, 0);
-	P_AddThinker(&exp->thinker);
+	P_AddThinker(&exp->thinker, tc_exp);
 
 	exp->thinker.function.acp1 = (actionf_p1)T_MobjExplode;
 	exp->delaymax = 2;
@@ -208,7 +208,7 @@ int EV_DoFloor(line_t* line, floor_e floortype, fixed_t speed) {
 		// new floor thinker
 		rtn = 1;
 		floor = Z_Malloc(sizeof(*floor), PU_LEVSPEC, 0);
-		P_AddThinker(&floor->thinker);
+		P_AddThinker(&floor->thinker, tc_floor);
 		sec->specialdata = floor;
 		// Midway assumed that ceiling->instant is true only if the
 		// speed is equal to 2048*FRACUNIT, which doesn't seem very sufficient
@@ -398,7 +398,7 @@ int EV_BuildStairs(line_t* line, stair_e type) {
 
 		// new floor thinker
 		floor = Z_Malloc(sizeof(*floor), PU_LEVSPEC, 0);
-		P_AddThinker(&floor->thinker);
+		P_AddThinker(&floor->thinker, tc_floor);
 
 		sec->specialdata = floor;
 
@@ -460,7 +460,7 @@ int EV_BuildStairs(line_t* line, stair_e type) {
 				secnum = newsecnum;
 
 				floor = Z_Malloc(sizeof(*floor), PU_LEVSPEC, 0);
-				P_AddThinker(&floor->thinker);
+				P_AddThinker(&floor->thinker, tc_floor);
 
 				sec->specialdata = floor;
 
@@ -570,7 +570,7 @@ int EV_SplitSector(line_t* line, boolean sync) {
 
 		rtn = 1;
 		split = Z_Malloc(sizeof(*split), PU_LEVSPEC, 0);
-		P_AddThinker(&split->thinker);
+		P_AddThinker(&split->thinker, tc_split);
 		sec->specialdata = split;
 
 		split->thinker.function.acp1 = (actionf_p1)T_MoveSplitPlane;
@@ -0,0 +1,470 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Compiled level cache. Keeps the linked map geometry built by
+//      P_SetupLevel on disk, so the next load of the same map is one
+//      file read plus a pointer fixup pass.
+//
+//      The file is a header followed by the level arrays, each
+//      16 byte aligned. Pointers are stored as index + 1 into the
+//      array they point at (0 for NULL), so the image can be used
+//      from wherever it lands in memory.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL3/SDL_stdinc.h>
+
+#include "p_levelcache.h"
+#include "p_setup.h"
+#include "p_local.h"
+#include "doomstat.h"
+#include "doomdata.h"
+#include "r_sky.h"
+#include "w_wad.h"
+#include "z_zone.h"
+#include "md5.h"
+#include "m_misc.h"
+#include "i_system.h"
+#include "i_system_io.h"
+#include "con_console.h"
+#include "con_cvar.h"
+
+CVAR_EXTERNAL(p_levelcache);
+
+void W_Checksum(md5_digest_t digest);
+
+#define LEVELCACHE_MAGIC    "D64LVLC"
+#define LEVELCACHE_VERSION  1
+#define LEVELCACHE_DIR      "level_cache"
+#define LEVELCACHE_EXT      ".lvc"
+
+enum {
+	LC_VERTEXES,
+	LC_SECTORS,
+	LC_SIDES,
+	LC_LINES,
+	LC_SUBSECTORS,
+	LC_NODES,
+	LC_SEGS,
+	LC_LEAFS,
+	LC_SECTORLINES,
+	LC_BLOCKMAP,
+	LC_BLOCKMAPLUMP,
+	NUMLCSECTIONS
+};
+
+typedef struct {
+	int32_t     offset;
+	int32_t     count;
+	int32_t     size;       // element size, catches struct changes
+} lcsection_t;
+
+typedef struct {
+	char            magic[8];
+	int32_t         version;
+	int32_t         ptrsize;
+	md5_digest_t    key;
+	lcsection_t     sections[NUMLCSECTIONS];
+	fixed_t         bmaporgx;
+	fixed_t         bmaporgy;
+	int32_t         bmapwidth;
+	int32_t         bmapheight;
+	int32_t         lmapwidth;
+	int32_t         lmapheight;
+	int32_t         lmapshift;
+	int32_t         skyflatnum;
+} lcheader_t;
+
+#define LC_ALIGN(x)         (((x) + 15) & ~15)
+
+#define LC_ENCODE(p, base)  ((void*)((p) ? (intptr_t)((p) - (base)) + 1 : 0))
+#define LC_DECODE(p, base)  ((p) ? (base) + ((intptr_t)(p) - 1) : NULL)
+
+// map lumps the cached arrays are built from
+static const int lclumps[] = {
+	ML_LINEDEFS, ML_SIDEDEFS, ML_VERTEXES, ML_SEGS, ML_SSECTORS,
+	ML_NODES, ML_SECTORS, ML_BLOCKMAP, ML_LEAFS, ML_MACROS
+};
+
+//
+// P_LevelCacheKey
+// Map lump contents plus everything else the arrays depend on:
+// the WAD directory (texture numbering, sky flats) and the line
+// cell size the blockmap is built with
+//
+
+void P_LevelCacheKey(md5_digest_t key) {
+	md5_context_t md5;
+	md5_digest_t wads;
+	int i;
+
+	W_Checksum(wads);
+
+	MD5_Init(&md5);
+	MD5_UpdateInt32(&md5, LEVELCACHE_VERSION);
+	MD5_UpdateInt32(&md5, sizeof(void*));
+	MD5_UpdateInt32(&md5, P_LineCellShift());
+	MD5_Update(&md5, wads, sizeof(wads));
+
+	for (i = 0; i < (int)(sizeof(lclumps) / sizeof(*lclumps)); i++) {
+		int length = W_MapLumpLength(lclumps[i]);
+
+		MD5_UpdateInt32(&md5, length);
+		if (length > 0) {
+			MD5_Update(&md5, W_GetMapLump(lclumps[i]), length);
+		}
+	}
+
+	MD5_Final(key, &md5);
+}
+
+//
+// P_LevelCachePath
+// Cache file for the given key; ext picks which kind
+//
+
+char* P_LevelCachePath(md5_digest_t key, const char* ext, boolean create) {
+	filepath_t path;
+	char* dir;
+	int i;
+	int len;
+
+	dir = I_GetUserFile(LEVELCACHE_DIR);
+
+	if (create && !M_DirExists(dir) && !M_CreateDir(dir)) {
+		free(dir);
+		return NULL;
+	}
+
+	len = SDL_snprintf(path, MAX_PATH, "%s/", dir);
+	for (i = 0; i < 16 && len < MAX_PATH - 3; i++) {
+		len += SDL_snprintf(path + len, MAX_PATH - len, "%02x", key[i]);
+	}
+
+	SDL_strlcat(path, ext, MAX_PATH);
+	free(dir);
+
+	return M_StringDuplicate(path);
+}
+
+//
+// P_SetCacheSection
+//
+
+static int P_SetCacheSection(lcheader_t* header, int section, int offset, int count, int size) {
+	header->sections[section].offset = offset;
+	header->sections[section].count = count;
+	header->sections[section].size = size;
+
+	return LC_ALIGN(offset + count * size);
+}
+
+//
+// P_SaveLevelCache
+// Called right after the level arrays are built, before anything
+// has spawned into them
+//
+
+void P_SaveLevelCache(void) {
+	lcheader_t header;
+	byte* buffer;
+	char* path;
+	int numleafs_total;
+	int numsectorlines;
+	int numblockcells;
+	int length;
+	int i;
+
+	if (!p_levelcache.value) {
+		return;
+	}
+
+	numleafs_total = 0;
+	for (i = 0; i < numsubsectors; i++) {
+		numleafs_total = MAX(numleafs_total, subsectors[i].leaf + subsectors[i].numleafs);
+	}
+
+	numsectorlines = 0;
+	for (i = 0; i < numsectors; i++) {
+		numsectorlines += sectors[i].linecount;
+	}
+
+	numblockcells = lmapwidth * lmapheight + 1;
+
+	dmemset(&header, 0, sizeof(header));
+
+	length = LC_ALIGN(sizeof(header));
+	length = P_SetCacheSection(&header, LC_VERTEXES, length, numvertexes, sizeof(vertex_t));
+	length = P_SetCacheSection(&header, LC_SECTORS, length, numsectors, sizeof(sector_t));
+	length = P_SetCacheSection(&header, LC_SIDES, length, numsides, sizeof(side_t));
+	length = P_SetCacheSection(&header, LC_LINES, length, numlines, sizeof(line_t));
+	length = P_SetCacheSection(&header, LC_SUBSECTORS, length, numsubsectors, sizeof(subsector_t));
+	length = P_SetCacheSection(&header, LC_NODES, length, numnodes, sizeof(node_t));
+	length = P_SetCacheSection(&header, LC_SEGS, length, numsegs, sizeof(seg_t));
+	length = P_SetCacheSection(&header, LC_LEAFS, length, numleafs_total, sizeof(leaf_t));
+	length = P_SetCacheSection(&header, LC_SECTORLINES, length, numsectorlines, sizeof(line_t*));
+	length = P_SetCacheSection(&header, LC_BLOCKMAP, length, numblockcells, sizeof(*blockmap));
+	length = P_SetCacheSection(&header, LC_BLOCKMAPLUMP, length,
+		blockmap[numblockcells - 1], sizeof(*blockmaplump));
+
+	dmemcpy(header.magic, LEVELCACHE_MAGIC, sizeof(header.magic));
+	header.version = LEVELCACHE_VERSION;
+	header.ptrsize = sizeof(void*);
+	header.bmaporgx = bmaporgx;
+	header.bmaporgy = bmaporgy;
+	header.bmapwidth = bmapwidth;
+	header.bmapheight = bmapheight;
+	header.lmapwidth = lmapwidth;
+	header.lmapheight = lmapheight;
+	header.lmapshift = lmapshift;
+	header.skyflatnum = skyflatnum;
+	P_LevelCacheKey(header.key);
+
+	buffer = Z_Calloc(length, PU_STATIC, 0);
+	dmemcpy(buffer, &header, sizeof(header));
+
+#define SECTION(s)  (buffer + header.sections[s].offset)
+#define COPY(s, src) dmemcpy(SECTION(s), src, header.sections[s].count * header.sections[s].size)
+
+	COPY(LC_VERTEXES, vertexes);
+	COPY(LC_SECTORS, sectors);
+	COPY(LC_SIDES, sides);
+	COPY(LC_LINES, lines);
+	COPY(LC_SUBSECTORS, subsectors);
+	COPY(LC_NODES, nodes);
+	COPY(LC_SEGS, segs);
+	COPY(LC_LEAFS, leafs);
+	COPY(LC_BLOCKMAP, blockmap);
+	COPY(LC_BLOCKMAPLUMP, blockmaplump);
+
+	//
+	// swap pointers for indexes
+	//
+	{
+		sector_t* sec = (sector_t*)SECTION(LC_SECTORS);
+		side_t* sd = (side_t*)SECTION(LC_SIDES);
+		line_t* ld = (line_t*)SECTION(LC_LINES);
+		subsector_t* ss = (subsector_t*)SECTION(LC_SUBSECTORS);
+		seg_t* sg = (seg_t*)SECTION(LC_SEGS);
+		leaf_t* lf = (leaf_t*)SECTION(LC_LEAFS);
+		line_t** sl = (line_t**)SECTION(LC_SECTORLINES);
+		line_t** sectorlines = numsectors ? sectors[0].lines : NULL;
+
+		for (i = 0; i < numsectors; i++) {
+			// the line lists are slices of one table, in sector order
+			sec[i].lines = (line_t**)(intptr_t)(sectors[i].lines - sectorlines);
+		}
+
+		for (i = 0; i < numsectorlines; i++) {
+			sl[i] = LC_ENCODE(sectorlines[i], lines);
+		}
+
+		for (i = 0; i < numsides; i++) {
+			sd[i].sector = LC_ENCODE(sides[i].sector, sectors);
+		}
+
+		for (i = 0; i < numlines; i++) {
+			ld[i].v1 = LC_ENCODE(lines[i].v1, vertexes);
+			ld[i].v2 = LC_ENCODE(lines[i].v2, vertexes);
+			ld[i].frontsector = LC_ENCODE(lines[i].frontsector, sectors);
+			ld[i].backsector = LC_ENCODE(lines[i].backsector, sectors);
+		}
+
+		for (i = 0; i < numsubsectors; i++) {
+			ss[i].sector = LC_ENCODE(subsectors[i].sector, sectors);
+		}
+
+		for (i = 0; i < numsegs; i++) {
+			sg[i].v1 = LC_ENCODE(segs[i].v1, vertexes);
+			sg[i].v2 = LC_ENCODE(segs[i].v2, vertexes);
+			sg[i].sidedef = LC_ENCODE(segs[i].sidedef, sides);
+			sg[i].linedef = LC_ENCODE(segs[i].linedef, lines);
+			sg[i].frontsector = LC_ENCODE(segs[i].frontsector, sectors);
+			sg[i].backsector = LC_ENCODE(segs[i].backsector, sectors);
+		}
+
+		for (i = 0; i < numleafs_total; i++) {
+			lf[i].vertex = LC_ENCODE(leafs[i].vertex, vertexes);
+			lf[i].seg = LC_ENCODE(leafs[i].seg, segs);
+		}
+	}
+
+#undef COPY
+#undef SECTION
+
+	if ((path = P_LevelCachePath(header.key, LEVELCACHE_EXT, true))) {
+		if (!M_WriteFile(path, buffer, length)) {
+			CON_Warnf("P_SaveLevelCache: couldn't write %s\n", path);
+		}
+
+		free(path);
+	}
+
+	Z_Free(buffer);
+}
+
+//
+// P_LoadLevelCache
+// Returns false, leaving nothing allocated, if there is no usable
+// cache file for the current map
+//
+
+boolean P_LoadLevelCache(void) {
+	md5_digest_t key;
+	lcheader_t* header;
+	byte* buffer;
+	char* path;
+	int length;
+	int i;
+
+	static const int sizes[NUMLCSECTIONS] = {
+		sizeof(vertex_t), sizeof(sector_t), sizeof(side_t), sizeof(line_t),
+		sizeof(subsector_t), sizeof(node_t), sizeof(seg_t), sizeof(leaf_t),
+		sizeof(line_t*), sizeof(*blockmap), sizeof(*blockmaplump)
+	};
+
+	if (!p_levelcache.value) {
+		return false;
+	}
+
+	P_LevelCacheKey(key);
+
+	if (!(path = P_LevelCachePath(key, LEVELCACHE_EXT, false))) {
+		return false;
+	}
+
+	length = M_FileExists(path) ? M_ReadFile(path, &buffer) : -1;
+	free(path);
+
+	if (length < (int)sizeof(lcheader_t)) {
+		if (length >= 0) {
+			Z_Free(buffer);
+		}
+		return false;
+	}
+
+	//
+	// validate
+	//
+	header = (lcheader_t*)buffer;
+
+	if (memcmp(header->magic, LEVELCACHE_MAGIC, sizeof(header->magic)) ||
+		header->version != LEVELCACHE_VERSION ||
+		header->ptrsize != sizeof(void*) ||
+		memcmp(header->key, key, sizeof(key))) {
+		Z_Free(buffer);
+		return false;
+	}
+
+	for (i = 0; i < NUMLCSECTIONS; i++) {
+		lcsection_t* s = &header->sections[i];
+
+		if (s->size != sizes[i] || s->count < 0 || s->offset < (int)sizeof(lcheader_t) ||
+			(int64_t)s->offset + (int64_t)s->count * s->size > length) {
+			Z_Free(buffer);
+			return false;
+		}
+	}
+
+	// the image now backs the level arrays
+	Z_ChangeTag(buffer, PU_LEVEL);
+
+#define SECTION(s)  (buffer + header->sections[s].offset)
+#define COUNT(s)    (header->sections[s].count)
+
+	vertexes = (vertex_t*)SECTION(LC_VERTEXES);
+	numvertexes = COUNT(LC_VERTEXES);
+	sectors = (sector_t*)SECTION(LC_SECTORS);
+	numsectors = COUNT(LC_SECTORS);
+	sides = (side_t*)SECTION(LC_SIDES);
+	numsides = COUNT(LC_SIDES);
+	lines = (line_t*)SECTION(LC_LINES);
+	numlines = COUNT(LC_LINES);
+	subsectors = (subsector_t*)SECTION(LC_SUBSECTORS);
+	numsubsectors = COUNT(LC_SUBSECTORS);
+	nodes = (node_t*)SECTION(LC_NODES);
+	numnodes = COUNT(LC_NODES);
+	segs = (seg_t*)SECTION(LC_SEGS);
+	numsegs = COUNT(LC_SEGS);
+	leafs = (leaf_t*)SECTION(LC_LEAFS);
+	numleafs = numsubsectors;
+	blockmap = (int32_t*)SECTION(LC_BLOCKMAP);
+	blockmaplump = (int32_t*)SECTION(LC_BLOCKMAPLUMP);
+
+	bmaporgx = header->bmaporgx;
+	bmaporgy = header->bmaporgy;
+	bmapwidth = header->bmapwidth;
+	bmapheight = header->bmapheight;
+	lmapwidth = header->lmapwidth;
+	lmapheight = header->lmapheight;
+	lmapshift = header->lmapshift;
+	skyflatnum = header->skyflatnum;
+
+	//
+	// swap indexes back for pointers
+	//
+	{
+		line_t** sectorlines = (line_t**)SECTION(LC_SECTORLINES);
+
+		for (i = 0; i < COUNT(LC_SECTORLINES); i++) {
+			sectorlines[i] = LC_DECODE(sectorlines[i], lines);
+		}
+
+		for (i = 0; i < numsectors; i++) {
+			sectors[i].lines = sectorlines + (intptr_t)sectors[i].lines;
+		}
+	}
+
+	for (i = 0; i < numsides; i++) {
+		sides[i].sector = LC_DECODE(sides[i].sector, sectors);
+	}
+
+	for (i = 0; i < numlines; i++) {
+		lines[i].v1 = LC_DECODE(lines[i].v1, vertexes);
+		lines[i].v2 = LC_DECODE(lines[i].v2, vertexes);
+		lines[i].frontsector = LC_DECODE(lines[i].frontsector, sectors);
+		lines[i].backsector = LC_DECODE(lines[i].backsector, sectors);
+	}
+
+	for (i = 0; i < numsubsectors; i++) {
+		subsectors[i].sector = LC_DECODE(subsectors[i].sector, sectors);
+	}
+
+	for (i = 0; i < numsegs; i++) {
+		segs[i].v1 = LC_DECODE(segs[i].v1, vertexes);
+		segs[i].v2 = LC_DECODE(segs[i].v2, vertexes);
+		segs[i].sidedef = LC_DECODE(segs[i].sidedef, sides);
+		segs[i].linedef = LC_DECODE(segs[i].linedef, lines);
+		segs[i].frontsector = LC_DECODE(segs[i].frontsector, sectors);
+		segs[i].backsector = LC_DECODE(segs[i].backsector, sectors);
+	}
+
+	for (i = 0; i < COUNT(LC_LEAFS); i++) {
+		leafs[i].vertex = LC_DECODE(leafs[i].vertex, vertexes);
+		leafs[i].seg = LC_DECODE(leafs[i].seg, segs);
+	}
+
+#undef COUNT
+#undef SECTION
+
+	CON_DPrintf("P_LoadLevelCache: %i bytes\n", length);
+
+	return true;
+}
@@ -0,0 +1,32 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __P_LEVELCACHE__
+#define __P_LEVELCACHE__
+
+#include "doomtype.h"
+#include "md5.h"
+
+// Both expect W_CacheMapLump to have been called for the map.
+boolean P_LoadLevelCache(void);
+void P_SaveLevelCache(void);
+
+// Hash of everything the compiled geometry depends on; other
+// per-map caches are stored under the same key.
+void P_LevelCacheKey(md5_digest_t key);
+char* P_LevelCachePath(md5_digest_t key, const char* ext, boolean create);
+
+#endif
@@ -68,7 +68,7 @@ void P_SpawnFireFlicker(sector_t* sector) {
 
 	flick = Z_Malloc(sizeof(*flick), PU_LEVSPEC, 0);
 
-	P_AddThinker(&flick->thinker);
+	P_AddThinker(&flick->thinker, tc_flicker);
 
 	flick->thinker.function.acp1 = (actionf_p1)T_FireFlicker;
 	flick->sector = sector;
@@ -123,7 +123,7 @@ void P_SpawnLightFlash(sector_t* sector) {
 
 		flash = Z_Malloc(sizeof(*flash), PU_LEVSPEC, 0);
 
-		P_AddThinker(&flash->thinker);
+		P_AddThinker(&flash->thinker, tc_flash);
 
 		flash->thinker.function.acp1 = (actionf_p1)T_LightFlash;
 		flash->sector = sector;
@@ -182,7 +182,7 @@ void P_SpawnStrobeFlash(sector_t* sector, int speed) {
 		strobe_t* flash;
 
 		flash = Z_Malloc(sizeof(*flash), PU_LEVSPEC, 0);
-		P_AddThinker(&flash->thinker);
+		P_AddThinker(&flash->thinker, tc_strobe);
 		flash->thinker.function.acp1 = (actionf_p1)T_StrobeFlash;
 		flash->sector = sector;
 		flash->special = sector->special;
@@ -204,7 +204,7 @@ void P_SpawnStrobeAltFlash(sector_t* sector, int speed) {      // 0x80015C44
 		strobe_t* flash;
 
 		flash = Z_Malloc(sizeof(*flash), PU_LEVSPEC, 0);
-		P_AddThinker(&flash->thinker);
+		P_AddThinker(&flash->thinker, tc_strobe);
 		flash->thinker.function.acp1 = (actionf_p1)T_StrobeFlash;
 		flash->sector = sector;
 		flash->special = sector->special;
@@ -304,7 +304,7 @@ void P_SpawnGlowingLight(sector_t* sector, byte type) {
 
 		g = Z_Malloc(sizeof(*g), PU_LEVSPEC, 0);
 
-		P_AddThinker(&g->thinker);
+		P_AddThinker(&g->thinker, tc_glow);
 		g->count = 2;
 		g->direction = 1;
 		g->sector = sector;
@@ -444,7 +444,7 @@ void P_SpawnSequenceLight(sector_t* sector, boolean first) {
 	}
 
 	seq = Z_Malloc(sizeof(*seq), PU_LEVSPEC, 0);
-	P_AddThinker(&seq->thinker);
+	P_AddThinker(&seq->thinker, tc_sequence);
 	seq->thinker.function.acp1 = (actionf_p1)T_Sequence;
 	seq->sector = sector;
 	seq->special = sector->special;
@@ -485,12 +485,14 @@ void T_Combine(combine_t* combine) {
 
 void P_CombineLightSpecials(sector_t* sector) {
 	actionf_p1 func;
+	thinkerclass_t tclass;
 	thinker_t* thinker;
 	combine_t* combine;
 
 	switch (sector->special) {
 	case 1:
 		func = (actionf_p1)T_LightFlash;
+		tclass = tc_flash;
 		break;
 	case 2:
 	case 3:
@@ -501,27 +503,30 @@ void P_CombineLightSpecials(sector_t* sector) {
 	case 206:
 	case 208:
 		func = (actionf_p1)T_StrobeFlash;
+		tclass = tc_strobe;
 		break;
 	case 8:
 	case 9:
 	case 11:
 		func = (actionf_p1)T_Glow;
+		tclass = tc_glow;
 		break;
 	case 17:
 		func = (actionf_p1)T_FireFlicker;
+		tclass = tc_flicker;
 		break;
 	default:
 		return;
 	}
 
-	for (thinker = thinkercap.next; thinker != &thinkercap; thinker = thinker->next) {
+	for (thinker = thinkerclasscap[tclass].cnext; thinker != &thinkerclasscap[tclass]; thinker = thinker->cnext) {
 		if ((actionf_p1)func != (actionf_p1)thinker->function.acp1) {
 			continue;
 		}
 
 		combine = Z_Malloc(sizeof(*combine), PU_LEVSPEC, 0);
 
-		P_AddThinker(&combine->thinker);
+		P_AddThinker(&combine->thinker, tc_combine);
 
 		combine->sector = sector;
 		combine->special = sector->special;
@@ -571,7 +576,7 @@ void P_UpdateLightThinker(light_t* destlight, light_t* srclight) {
 	lightmorph_t* lt;
 
 	lt = Z_Malloc(sizeof(*lt), PU_LEVSPEC, 0);
-	P_AddThinker(&lt->thinker);
+	P_AddThinker(&lt->thinker, tc_morph);
 	lt->thinker.function.acp1 = (actionf_p1)T_LightMorph;
 
 	if (destlight) {
@@ -670,11 +675,6 @@ boolean P_ChangeLightByTag(int tag1, int tag2) {
 //
 //------------------------------------------------------------------------
 
-typedef struct {
-	thinker_t thinker;
-	float factor;
-} fadebright_t;
-
 CVAR_EXTERNAL(i_brightness);
 
 //
@@ -699,7 +699,7 @@ void P_FadeInBrightness(void) {
 	fadebright_t* fb;
 
 	fb = Z_Malloc(sizeof(*fb), PU_LEVSPEC, 0);
-	P_AddThinker(&fb->thinker);
+	P_AddThinker(&fb->thinker, tc_fadebright);
 	fb->thinker.function.acp1 = (actionf_p1)T_FadeInBrightness;
 	fb->factor = 0;
 }
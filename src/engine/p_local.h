@@ -72,18 +72,17 @@
 extern    thinker_t    thinkercap;
 extern    mobj_t        mobjhead;
 
+// both the head and tail of each per class list, linked by cprev/cnext
+extern    thinker_t    thinkerclasscap[NUMTHINKERCLASSES];
+
 void P_InitThinkers(void);
-void P_AddThinker(thinker_t* thinker);
+void P_InitThinkerClasses(void);
+void P_AddThinker(thinker_t* thinker, thinkerclass_t tclass);
 void P_RemoveThinker(thinker_t* thinker);
+void P_PrintThinkerCensus(void);
 void P_LinkMobj(mobj_t* mobj);
 void P_UnlinkMobj(mobj_t* mobj);
 
-extern angle_t frame_angle;
-extern angle_t frame_pitch;
-extern fixed_t frame_viewx;
-extern fixed_t frame_viewy;
-extern fixed_t frame_viewz;
-
 //
 // P_PSPR
 //
@@ -184,10 +183,17 @@ typedef struct {
 
 #define MAXINTERCEPTS    128
 
-extern intercept_t    intercepts[MAXINTERCEPTS];
-extern intercept_t* intercept_p;
+// per-trace state; intercepts are kept sorted nearest first
+typedef struct pathtrace_s {
+	divline_t    trace;
+	int          flags;
+	fixed_t      maxfrac;
+	int          numintercepts;
+	intercept_t  intercepts[MAXINTERCEPTS];
+	void* data;    // for use by the traverser
+} pathtrace_t;
 
-typedef boolean(*traverser_t)(intercept_t* in);
+typedef boolean(*traverser_t)(pathtrace_t* pt, intercept_t* in);
 
 fixed_t P_AproxDistance(fixed_t dx, fixed_t dy);
 int     P_PointOnLineSide(fixed_t x, fixed_t y, line_t* line);
@@ -204,17 +210,26 @@ extern fixed_t        lowfloor;
 
 void         P_LineOpening(line_t* linedef);
 boolean    P_BlockLinesIterator(int x, int y, boolean(*func)(line_t*));
+boolean    P_BoxLinesIterator(fixed_t* box, boolean(*func)(line_t*));
 boolean    P_BlockThingsIterator(int x, int y, boolean(*func)(mobj_t*));
 
+#define MAXNEARTHINGS	32
+
+int     P_FindNearestThings(fixed_t x, fixed_t y, fixed_t maxdist,
+	boolean(*func)(mobj_t*, void*), void* data, mobj_t** found, int maxfound);
+mobj_t* P_FindNearestThing(fixed_t x, fixed_t y, fixed_t maxdist,
+	boolean(*func)(mobj_t*, void*), void* data);
+
 #define PT_ADDLINES		1
 #define PT_ADDTHINGS	2
 #define PT_EARLYOUT		4
 
-extern divline_t    trace;
-
-boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int    flags, boolean(*trav)(intercept_t*));
+boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int flags, traverser_t trav);
+boolean P_TracePath(pathtrace_t* pt, fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, int flags, traverser_t trav);
+boolean P_TraverseIntercepts(pathtrace_t* pt, traverser_t func, fixed_t maxfrac);
 void    P_UnsetThingPosition(mobj_t* thing);
 void    P_SetThingPosition(mobj_t* thing);
+void    P_InitSecNodes(void);
 
 //
 // P_MAP
@@ -227,11 +242,7 @@ extern fixed_t      tmfloorz;
 extern fixed_t      tmceilingz;
 extern line_t* tmhitline;
 void P_TryMove2(void);
-boolean PIT_AddThingIntercepts(mobj_t* thing);
-boolean PIT_AddLineIntercepts(line_t* ld);
-boolean P_TraverseIntercepts(traverser_t func, fixed_t maxfrac);
 fixed_t P_InterceptLine(line_t* line, divline_t* trace);
-boolean P_TraverseIntercepts(traverser_t func, fixed_t maxfrac);
 
 boolean    P_CheckPosition(mobj_t* thing, fixed_t x, fixed_t y);
 boolean    P_TryMove(mobj_t* thing, fixed_t x, fixed_t y);
@@ -262,10 +273,13 @@ void    P_RadiusAttack(mobj_t* spot, mobj_t* source, int damage);
 // P_SETUP
 //
 extern byte* rejectmatrix;    // for fast sight rejection
-extern uint16_t* blockmaplump;    // offsets in blockmap are from here
-extern uint16_t* blockmap;
+extern int32_t* blockmaplump;    // line numbers, indexed by blockmap
+extern int32_t* blockmap;        // first entry of each line cell, plus one past the end
 extern int            bmapwidth;
 extern int            bmapheight;    // in mapblocks
+extern int            lmapwidth;
+extern int            lmapheight;    // in line cells
+extern int            lmapshift;     // line cell size, <= MAPBLOCKSHIFT
 extern fixed_t        bmaporgx;
 extern fixed_t        bmaporgy;    // origin of block map
 extern mobj_t** blocklinks;    // for thing chains
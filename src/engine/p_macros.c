@@ -22,6 +22,7 @@
 #include "p_macros.h"
 #include "doomstat.h"
 #include "p_local.h"
+#include "am_draw.h"
 
 thinker_t* macrothinker = NULL;
 macrodef_t* macro = NULL;
@@ -147,6 +148,7 @@ int P_StartMacro(mobj_t* thing, line_t* line) {
 	if (macro->data[0].id <= 0) {
 		if (macro->data[0].id == 0) {
 			line->special = 0;
+			AM_MarkLineDirty(line);
 		}
 
 		P_InitMacroVars();
@@ -22,6 +22,8 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdlib.h>
+
 #include "m_fixed.h"
 #include "m_random.h"
 #include "m_misc.h"
@@ -34,6 +36,7 @@
 #include "r_sky.h"
 #include "r_main.h"
 #include "con_console.h"
+#include "z_zone.h"
 
 // atsb: Reverse Engineered
 
@@ -302,12 +305,7 @@ boolean P_CheckPosition(mobj_t* thing, fixed_t x, fixed_t y)
             if (!P_BlockThingsIterator(bx, by, PIT_CheckThing)) 
                 return false;
 
-    for (bx = bbox[BOXLEFT]; bx <= bbox[BOXRIGHT]; bx++)
-        for (by = bbox[BOXBOTTOM]; by <= bbox[BOXTOP]; by++)
-            if (!P_BlockLinesIterator(bx, by, PIT_CheckLine)) 
-                return false;
-
-    return true;
+    return P_BoxLinesIterator(tmbbox, PIT_CheckLine);
 }
 
 //
@@ -521,7 +519,7 @@ mobj_t* slidemo;
 fixed_t   tmxmove;
 fixed_t   tmymove;
 
-boolean PTR_SlideTraverse(intercept_t* in)
+boolean PTR_SlideTraverse(pathtrace_t* pt, intercept_t* in)
 {
     line_t* li = in->d.line;
 
@@ -630,7 +628,7 @@ hitslideline:
 // LINE ATTACK / AIM
 //
 
-boolean PTR_AimTraverse(intercept_t* in)
+boolean PTR_AimTraverse(pathtrace_t* pt, intercept_t* in)
 {
     line_t* li;
     mobj_t* th;
@@ -685,7 +683,7 @@ boolean PTR_AimTraverse(intercept_t* in)
     return false;
 }
 
-boolean PTR_ShootTraverse(intercept_t* in)
+boolean PTR_ShootTraverse(pathtrace_t* pt, intercept_t* in)
 {
     fixed_t x = 0, y = 0, z = 0, frac, slope, dist, thingtopslope, thingbottomslope;
     line_t* li;
@@ -730,19 +728,19 @@ boolean PTR_ShootTraverse(intercept_t* in)
 
             if (den != 0) {
                 fixed_t hitdist;
-                fixed_t num = FixedDot(plane->a, plane->b, plane->c, trace.x, trace.y, shootz) + plane->d;
+                fixed_t num = FixedDot(plane->a, plane->b, plane->c, pt->trace.x, pt->trace.y, shootz) + plane->d;
                 hitdist = FixedDiv(-num, den);
 
                 frac = FixedDiv(hitdist, attackrange);
-                x = trace.x + FixedMul(FixedMul(aimpitch, trace.dx), frac);
-                y = trace.y + FixedMul(FixedMul(aimpitch, trace.dy), frac);
+                x = pt->trace.x + FixedMul(FixedMul(aimpitch, pt->trace.dx), frac);
+                y = pt->trace.y + FixedMul(FixedMul(aimpitch, pt->trace.dy), frac);
                 z = hitz;
             }
         }
         else {
             frac = in->frac - FixedDiv(4 * FRACUNIT, attackrange);
-            x = trace.x + FixedMul(trace.dx, frac);
-            y = trace.y + FixedMul(trace.dy, frac);
+            x = pt->trace.x + FixedMul(pt->trace.dx, frac);
+            y = pt->trace.y + FixedMul(pt->trace.dy, frac);
             z = shootz + FixedMul(aimslope, FixedMul(frac, attackrange));
         }
 
@@ -790,8 +788,8 @@ boolean PTR_ShootTraverse(intercept_t* in)
         return true;
 
     frac = in->frac - FixedDiv(10 * FRACUNIT, attackrange);
-    x = trace.x + FixedMul(trace.dx, frac);
-    y = trace.y + FixedMul(trace.dy, frac);
+    x = pt->trace.x + FixedMul(pt->trace.dx, frac);
+    y = pt->trace.y + FixedMul(pt->trace.dy, frac);
     z = shootz + FixedMul(aimslope, FixedMul(frac, attackrange));
 
     if (attackrange == LASERRANGE) {
@@ -923,7 +921,7 @@ static int P_CheckUseHeight(line_t* line, mobj_t* thing)
     return true;
 }
 
-boolean PTR_UseTraverse(intercept_t* in)
+boolean PTR_UseTraverse(pathtrace_t* pt, intercept_t* in)
 {
     if (!in->d.line->special) {
         P_LineOpening(in->d.line);
@@ -1086,9 +1084,38 @@ boolean PIT_ChangeSector(mobj_t* thing)
     return true;
 }
 
+//
+// Things to visit are gathered from the sector's touch list and put
+// back in the order a sweep over the sector's blockbox would meet them:
+// block column, block row, then position in the block chain. The array
+// is used as a stack, since crushing something can start another mover
+// from inside an action function.
+//
+
+typedef struct {
+    mobj_t* thing;
+    int64_t order;
+} changething_t;
+
+static changething_t* changethings;
+static int numchangethings;
+static int maxchangethings;
+
+static int P_CompareChangeThings(const void* a, const void* b)
+{
+    const changething_t* ca = (const changething_t*)a;
+    const changething_t* cb = (const changething_t*)b;
+
+    return (ca->order > cb->order) - (ca->order < cb->order);
+}
+
 boolean P_ChangeSector(sector_t* sector, int crunch)
 {
-    int x, y;
+    msecnode_t* node;
+    mobj_t* thing;
+    mobj_t* link;
+    int base, count, i;
+    int bx, by;
 
     nofit = false;
     crushchange = crunch;
@@ -1097,10 +1124,53 @@ boolean P_ChangeSector(sector_t* sector, int crunch)
         crushchange = 2;
     }
 
-    for (x = sector->blockbox[BOXLEFT]; x <= sector->blockbox[BOXRIGHT]; x++)
-        for (y = sector->blockbox[BOXBOTTOM]; y <= sector->blockbox[BOXTOP]; y++)
-            P_BlockThingsIterator(x, y, PIT_ChangeSector);
+    base = numchangethings;
+
+    for (node = sector->touching_thinglist; node; node = node->snext) {
+        thing = node->thing;
+
+        bx = (thing->x - bmaporgx) >> MAPBLOCKSHIFT;
+        by = (thing->y - bmaporgy) >> MAPBLOCKSHIFT;
+
+        if (bx < sector->blockbox[BOXLEFT] || bx > sector->blockbox[BOXRIGHT] ||
+            by < sector->blockbox[BOXBOTTOM] || by > sector->blockbox[BOXTOP]) {
+            continue;
+        }
+
+        if (numchangethings == maxchangethings) {
+            maxchangethings = maxchangethings ? maxchangethings * 2 : 64;
+            changethings = Z_Realloc(changethings,
+                maxchangethings * sizeof(*changethings), PU_STATIC, NULL);
+        }
+
+        i = 0;
+        for (link = thing->bprev; link; link = link->bprev) {
+            i++;
+        }
+
+        changethings[numchangethings].thing = thing;
+        changethings[numchangethings].order =
+            ((int64_t)(bx * bmapheight + by) << 32) | i;
+        numchangethings++;
+    }
+
+    count = numchangethings - base;
+    if (count > 1) {
+        qsort(&changethings[base], count, sizeof(*changethings), P_CompareChangeThings);
+    }
+
+    for (i = 0; i < count; i++) {
+        thing = changethings[base + i].thing;
+
+        // removed by an earlier thing's crush
+        if (!thing->touching_sectorlist) {
+            continue;
+        }
+
+        PIT_ChangeSector(thing);
+    }
 
+    numchangethings = base;
     return nofit;
 }
 
@@ -1109,7 +1179,7 @@ boolean P_ChangeSector(sector_t* sector, int crunch)
 //
 mobj_t* tmcamera;
 
-static boolean PTR_ChaseCamTraverse(intercept_t* in)
+static boolean PTR_ChaseCamTraverse(pathtrace_t* pt, intercept_t* in)
 {
     fixed_t x, y, frac;
 
@@ -1144,8 +1214,8 @@ static boolean PTR_ChaseCamTraverse(intercept_t* in)
         }
 
         frac = in->frac - FixedDiv(6 * FRACUNIT, MISSILERANGE);
-        x = trace.x + FixedMul(trace.dx, frac);
-        y = trace.y + FixedMul(trace.dy, frac);
+        x = pt->trace.x + FixedMul(pt->trace.dx, frac);
+        y = pt->trace.y + FixedMul(pt->trace.dy, frac);
 
         tmcamera->x = x;
         tmcamera->y = y;
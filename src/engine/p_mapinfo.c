@@ -51,64 +51,166 @@ but nothing UMAPINFO has difficulty in parsing anyway.
 So behold, the beautiful parser for remastered MAPINFO lumps
 */
 
+static void LOC_SetLanguage(void);
+
 // 0=English, 1=German, 2=Spanish, 3=French, 4=italian
-CVAR(p_language, 0);
+CVAR_CMD(p_language, 0) {
+    LOC_SetLanguage();
+}
 
-typedef struct { char* key; char* value; } loc_kv_t;
-static loc_kv_t* localisation_key_value = NULL;
-static int       localisation_count = 0;
+/* Localisation store. Keys and values live back to back in one string
+arena and are found through an open addressed hash on the lower cased
+key, so loading is linear and a lookup is a probe or two. A key's index
+is its string id; ids stay put when the language changes, only the
+values are thrown away and reloaded */
 
-static void LOC_Add(const char* k, const char* v) {
-    size_t key = dstrlen(k);
-    size_t value = dstrlen(v);
-    loc_kv_t key_value;
-    key_value.key = (char*)Z_Malloc(key + 1, PU_STATIC, 0);
-    key_value.value = (char*)Z_Malloc(value + 1, PU_STATIC, 0);
-    for (size_t i = 0; i < key; ++i) {
-        unsigned char c = (unsigned char)k[i];
-        if (c >= 'A' && c <= 'Z') 
-            c = (unsigned char)(c - 'A' + 'a');
-        key_value.key[i] = (char)c;
+typedef struct {
+    char*   arena;
+    int     arenasize;
+    int     arenacap;
+    int*    keys;       // arena offset of each key, by string id
+    int*    values;     // arena offset of each value, -1 if not translated
+    int     count;
+    int     cap;
+    int     numvalues;
+    int*    hash;       // string id + 1, 0 for an empty slot
+    int     hashsize;   // power of two, kept at least twice count
+} loc_table_t;
+
+static loc_table_t localisation;
+static boolean     localisation_ready = false;
+
+static int LOC_Lower(int c) {
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+static unsigned int LOC_Hash(const char* key) {
+    unsigned int h = 2166136261u;
+    while (*key) {
+        h ^= (unsigned char)LOC_Lower((unsigned char)*key++);
+        h *= 16777619u;
     }
-    key_value.key[key] = 0;
-    dmemcpy(key_value.value, v, value + 1);
+    return h;
+}
 
-    localisation_key_value = (loc_kv_t*)Z_Realloc(localisation_key_value, sizeof(loc_kv_t) * (localisation_count + 1), PU_STATIC, 0);
-    localisation_key_value[localisation_count++] = key_value;
+static void LOC_Free(loc_table_t* t) {
+    if (t->arena) Z_Free(t->arena);
+    if (t->keys) Z_Free(t->keys);
+    if (t->values) Z_Free(t->values);
+    if (t->hash) Z_Free(t->hash);
+    dmemset(t, 0, sizeof(*t));
 }
 
-static const char* LOC_Find(const char* key) {
-    if (!key || !*key)
-        return NULL;
+static int LOC_ArenaAlloc(loc_table_t* t, int size) {
+    int ofs = t->arenasize;
+    if (t->arenasize + size > t->arenacap) {
+        int cap = t->arenacap ? t->arenacap : 4096;
+        while (t->arenasize + size > cap)
+            cap *= 2;
+        t->arena = (char*)Z_Realloc(t->arena, cap, PU_STATIC, 0);
+        t->arenacap = cap;
+    }
+    t->arenasize += size;
+    return ofs;
+}
+
+static int LOC_ArenaString(loc_table_t* t, const char* s, boolean lower) {
+    int n = (int)dstrlen(s);
+    int ofs = LOC_ArenaAlloc(t, n + 1);
+    char* out = t->arena + ofs;
+    for (int i = 0; i < n; ++i)
+        out[i] = lower ? (char)LOC_Lower((unsigned char)s[i]) : s[i];
+    out[n] = 0;
+    return ofs;
+}
 
-    char tmp[256];
-    size_t n = dstrlen(key);
-    if (n >= sizeof(tmp)) 
-        n = sizeof(tmp) - 1;
-    for (size_t i = 0; i < n; ++i) {
-        unsigned char c = (unsigned char)key[i];
-        if (c >= 'A' && c <= 'Z') 
-            c = (unsigned char)(c - 'A' + 'a');
-        tmp[i] = (char)c;
+static int LOC_FindID(const loc_table_t* t, const char* key) {
+    if (!t->hashsize || !key || !*key)
+        return -1;
+
+    unsigned int mask = (unsigned int)t->hashsize - 1;
+    unsigned int slot = LOC_Hash(key) & mask;
+
+    while (t->hash[slot]) {
+        int id = t->hash[slot] - 1;
+        const char* a = t->arena + t->keys[id];
+        const char* b = key;
+        while (*a && *a == LOC_Lower((unsigned char)*b)) {
+            a++;
+            b++;
+        }
+        if (!*a && !*b)
+            return id;
+        slot = (slot + 1) & mask;
     }
-    tmp[n] = 0;
+    return -1;
+}
+
+static void LOC_Rehash(loc_table_t* t, int size) {
+    if (t->hash) Z_Free(t->hash);
+    t->hash = (int*)Z_Calloc(sizeof(int) * size, PU_STATIC, 0);
+    t->hashsize = size;
 
-    for (int i = 0; i < localisation_count; ++i) {
-        if (!dstricmp(localisation_key_value[i].key, tmp)) 
-            return localisation_key_value[i].value;
+    for (int id = 0; id < t->count; ++id) {
+        unsigned int slot = LOC_Hash(t->arena + t->keys[id]) & (unsigned int)(size - 1);
+        while (t->hash[slot])
+            slot = (slot + 1) & (unsigned int)(size - 1);
+        t->hash[slot] = id + 1;
     }
-    return NULL;
 }
 
-static const char* LOC_ExpandIfVar(const char* maybe) {
-    if (localisation_count == 0 || !maybe || maybe[0] != '$') 
-        return maybe;
-    const char* v = LOC_Find(maybe + 1);
-    if (!v) {
-        CON_Warnf("Localization: Missing key '%s'\n", maybe + 1);
-        return maybe;
+// returns the string id for key, adding it untranslated if it is new
+static int LOC_Intern(loc_table_t* t, const char* key) {
+    int id = LOC_FindID(t, key);
+    if (id >= 0)
+        return id;
+
+    if (t->count == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 256;
+        t->keys = (int*)Z_Realloc(t->keys, sizeof(int) * t->cap, PU_STATIC, 0);
+        t->values = (int*)Z_Realloc(t->values, sizeof(int) * t->cap, PU_STATIC, 0);
     }
-    return v;
+
+    id = t->count++;
+    t->keys[id] = LOC_ArenaString(t, key, true);
+    t->values[id] = -1;
+
+    if (t->count * 2 > t->hashsize) {
+        LOC_Rehash(t, t->hashsize ? t->hashsize * 2 : 512);
+    }
+    else {
+        unsigned int mask = (unsigned int)t->hashsize - 1;
+        unsigned int slot = LOC_Hash(key) & mask;
+        while (t->hash[slot])
+            slot = (slot + 1) & mask;
+        t->hash[slot] = id + 1;
+    }
+    return id;
+}
+
+// drops every value but keeps the keys, and with them the string ids
+static void LOC_ClearValues(loc_table_t* t) {
+    if (!t->count)
+        return;
+
+    char* old = t->arena;
+    t->arena = NULL;
+    t->arenasize = 0;
+    t->arenacap = 0;
+
+    for (int id = 0; id < t->count; ++id) {
+        t->keys[id] = LOC_ArenaString(t, old + t->keys[id], false);
+        t->values[id] = -1;
+    }
+    t->numvalues = 0;
+
+    Z_Free(old);
+}
+
+static const char* LOC_Value(const loc_table_t* t, int id) {
+    if (id < 0 || id >= t->count || t->values[id] < 0)
+        return NULL;
+    return t->arena + t->values[id];
 }
 
 static void LOC_SkipWS(const unsigned char** p, const unsigned char* end) {
@@ -143,12 +245,12 @@ static int LOC_ReadIdent(const unsigned char** p, const unsigned char* end, char
     return n > 0;
 }
 
-static char* LOC_ReadQuoted(const unsigned char** p, const unsigned char* end) {
+// appends the quoted string at *p to the arena, returning its offset
+static int LOC_ReadQuoted(loc_table_t* t, const unsigned char** p, const unsigned char* end) {
     if (*p >= end || **p != '"') 
-        return NULL;
+        return -1;
     (*p)++;
-    char* out = NULL;
-    size_t cap = 0, n = 0;
+    int ofs = t->arenasize;
     while (*p < end) {
         int c = *(*p)++;
         if (c == '"') 
@@ -172,21 +274,15 @@ static char* LOC_ReadQuoted(const unsigned char** p, const unsigned char* end) {
                 break;
             }
         }
-        if (n + 1 >= cap) {
-            cap = cap ? cap * 2 : 64;
-            out = (char*)Z_Realloc(out, cap, PU_STATIC, 0);
-        }
-        out[n++] = (char)c;
-    }
-    if (n + 1 >= cap) {
-        cap = cap ? cap * 2 : 64;
-        out = (char*)Z_Realloc(out, cap, PU_STATIC, 0);
+        int o = LOC_ArenaAlloc(t, 1);   // may move the arena
+        t->arena[o] = (char)c;
     }
-    out[n] = 0;
-    return out ? out : (char*)"";
+    int o = LOC_ArenaAlloc(t, 1);
+    t->arena[o] = 0;
+    return ofs;
 }
 
-static void LOC_LoadFromBuffer(const unsigned char* buf, int len) {
+static void LOC_LoadFromBuffer(loc_table_t* t, const unsigned char* buf, int len) {
     const unsigned char* p = buf;
     const unsigned char* end = buf + len;
     char ident[256];
@@ -204,9 +300,19 @@ static void LOC_LoadFromBuffer(const unsigned char* buf, int len) {
         }
         p++; // '='
         LOC_SkipWS(&p, end);
-        char* str = LOC_ReadQuoted(&p, end);
-        if (str) 
-            LOC_Add(ident, str);
+        if (p < end && *p == '"') {
+            int id = LOC_Intern(t, ident);
+            int ofs = LOC_ReadQuoted(t, &p, end);
+
+            // the first definition of a key wins
+            if (t->values[id] < 0) {
+                t->values[id] = ofs;
+                t->numvalues++;
+            }
+            else {
+                t->arenasize = ofs;
+            }
+        }
         while (p < end && *p != '\n') p++;
     }
 }
@@ -227,10 +333,10 @@ static boolean LOC_LoadLang(int lang) {
     unsigned char* data = NULL; int size = 0;
 
     if (W_KPFLoadInner(want_inner, &data, &size)) {
-        LOC_LoadFromBuffer(data, size);
+        LOC_LoadFromBuffer(&localisation, data, size);
         free(data);
         I_Printf("Localization: Loaded %d entries from %s\n",
-            localisation_count, want_inner);
+            localisation.numvalues, want_inner);
         return true;
     }
 
@@ -245,6 +351,8 @@ static void LOC_Load(void) {
     
     int lang = (int)p_language.value;
 
+    LOC_ClearValues(&localisation);
+
     if (LOC_LoadLang(lang)) return;
 
     if (lang != 0 && LOC_LoadLang(0)) {
@@ -256,6 +364,132 @@ static void LOC_Load(void) {
 
 }
 
+/* MAPINFO strings are kept as refs: the text as written plus the string
+id when it is a $key, so titles and cluster text can be resolved again
+after a language switch */
+
+typedef struct { int id; int source; } loc_ref_t;
+
+static loc_ref_t*  loc_refs = NULL;
+static int         num_loc_refs = 0;
+static int         max_loc_refs = 0;
+static loc_table_t loc_sources;    // only the arena is used
+
+static int LOC_AddRef(const char* s) {
+    if (num_loc_refs == max_loc_refs) {
+        max_loc_refs = max_loc_refs ? max_loc_refs * 2 : 64;
+        loc_refs = (loc_ref_t*)Z_Realloc(loc_refs, sizeof(loc_ref_t) * max_loc_refs, PU_STATIC, 0);
+    }
+
+    loc_ref_t* r = &loc_refs[num_loc_refs];
+    r->source = LOC_ArenaString(&loc_sources, s, false);
+    r->id = (s[0] == '$' && s[1]) ? LOC_Intern(&localisation, s + 1) : -1;
+
+    return num_loc_refs++;
+}
+
+static const char* LOC_ResolveRef(int ref) {
+    const loc_ref_t* r = &loc_refs[ref];
+    const char* source = loc_sources.arena + r->source;
+    const char* v = LOC_Value(&localisation, r->id);
+
+    if (v)
+        return v;
+    if (r->id >= 0 && localisation.numvalues)
+        CON_Warnf("Localization: Missing key '%s'\n", source + 1);
+    return source;
+}
+
+static void LOC_CopyString(char* out, size_t cap, const char* s) {
+    size_t n = dstrlen(s);
+    if (n >= cap) n = cap - 1;
+    dmemcpy(out, s, n);
+    out[n] = 0;
+}
+
+// joins count refs from first with newlines
+static void LOC_CopyRefs(char* out, size_t cap, int first, int count) {
+    size_t n = 0;
+    out[0] = 0;
+    for (int i = 0; i < count; ++i) {
+        if (i && n + 1 < cap) 
+            out[n++] = '\n';
+        LOC_CopyString(out + n, cap - n, LOC_ResolveRef(first + i));
+        n += dstrlen(out + n);
+    }
+}
+
+//
+// LOC_SetLanguage
+// Reloads the values for p_language and re-resolves every map title
+// and cluster text that came from a $key
+//
+
+static void LOC_SetLanguage(void) {
+    if (!localisation_ready)
+        return;
+
+    LOC_Load();
+
+    for (int i = 0; i < nummapdef; ++i) {
+        if (mapdefs[i].nameref >= 0)
+            LOC_CopyString(mapdefs[i].mapname, sizeof(mapdefs[i].mapname), LOC_ResolveRef(mapdefs[i].nameref));
+    }
+
+    for (int i = 0; i < numclusterdef; ++i) {
+        if (clusterdefs[i].numtextrefs)
+            LOC_CopyRefs(clusterdefs[i].text, sizeof(clusterdefs[i].text), clusterdefs[i].textref, clusterdefs[i].numtextrefs);
+    }
+}
+
+//
+// LOC_Benchmark
+// Loads a synthetic language file of numkeys entries into a scratch
+// table and looks every key up again
+//
+
+void LOC_Benchmark(int numkeys) {
+    loc_table_t t;
+    char key[32];
+    uint64_t start, loadtime, findtime;
+    int len = 0;
+    int found = 0;
+
+    if (numkeys <= 0)
+        numkeys = 50000;
+
+    // 64 bytes a line; keeps the buffer size and key format in range
+    if (numkeys > 1000000)
+        numkeys = 1000000;
+
+    char* buf = (char*)Z_Malloc((size_t)numkeys * 64, PU_STATIC, 0);
+    for (int i = 0; i < numkeys; ++i)
+        len += sprintf(buf + len, "key_%06d = \"Localised string number %d\"\n", i, i);
+
+    dmemset(&t, 0, sizeof(t));
+
+    start = I_GetTimeNS();
+    LOC_LoadFromBuffer(&t, (const unsigned char*)buf, len);
+    loadtime = I_GetTimeNS() - start;
+
+    start = I_GetTimeNS();
+    for (int i = 0; i < numkeys; ++i) {
+        sprintf(key, "KEY_%06d", i);
+        if (LOC_Value(&t, LOC_FindID(&t, key)))
+            found++;
+    }
+    findtime = I_GetTimeNS() - start;
+
+    CON_Printf(GREEN, "Localization benchmark, %d keys (%d kb file):\n", numkeys, len >> 10);
+    CON_Printf(AQUA, "load   %8.3f ms\n", (double)loadtime / 1000000.0);
+    CON_Printf(AQUA, "lookup %8.3f ms, %d found (%.1f ns each)\n",
+        (double)findtime / 1000000.0, found, (double)findtime / numkeys);
+    CON_Printf(WHITE, "arena %d kb, hash %d slots\n", t.arenasize >> 10, t.hashsize);
+
+    LOC_Free(&t);
+    Z_Free(buf);
+}
+
 //
 // P_InitMapInfo
 //
@@ -528,17 +762,17 @@ const char* P_MapInfoLexerParseStrAfterEq(mapinfo_lexer* mapinfo_lexer,
     CON_Warnf("%s:%d:%d: %s requires string\n", mapinfo_lexer->filename, mapinfo_string_after_value.line, mapinfo_string_after_value.column, key);
     return "";
 }
-static void P_MapInfoLexerParseStringList(mapinfo_lexer* mapinfo_lexer, char* outBuf, size_t outCap) {
-    outBuf[0] = 0;
+static void P_MapInfoLexerParseStringList(mapinfo_lexer* mapinfo_lexer, int* first, int* count) {
+    *first = num_loc_refs;
+    *count = 0;
     for (;;) {
         mapinfo_token string_v = P_MapInfoLexerNext(mapinfo_lexer);
         if (string_v.kind != MI_STRING) {
             CON_Warnf("%s:%d:%d: expected string in list\n", mapinfo_lexer->filename, string_v.line, string_v.column);
             break;
         }
-        const char* s = LOC_ExpandIfVar(string_v.mapinfo_string_value);
-        if (outBuf[0]) strncat(outBuf, "\n", outCap);
-        strncat(outBuf, s, outCap);
+        LOC_AddRef(string_v.mapinfo_string_value);
+        (*count)++;
 
         if (!P_MapInfoLexerAccept(mapinfo_lexer, MI_COMMA))
             break;
@@ -582,13 +816,14 @@ static void P_MapInfoLexerParseMapBlock(mapinfo_lexer* mapinfo_lexer,
     mapdef.mapid = 1;
     mapdef.exitdelay = 15;
     mapdef.music = -1;
+    mapdef.nameref = -1;
 
     if (title && *title) {
-        const char* t = LOC_ExpandIfVar(title);     // <--- expand $map_name_xx
-        dstrncpy(mapdef.mapname, t, dstrlen(t));
+        mapdef.nameref = LOC_AddRef(title);     // $map_name_xx stays a ref, resolved per language
+        LOC_CopyString(mapdef.mapname, sizeof(mapdef.mapname), LOC_ResolveRef(mapdef.nameref));
     }
     else if (lumpName && *lumpName) {
-        dstrncpy(mapdef.mapname, lumpName, dstrlen(lumpName));
+        LOC_CopyString(mapdef.mapname, sizeof(mapdef.mapname), lumpName);
     }
 
     for (;;) {
@@ -741,21 +976,17 @@ static void P_MapInfoLexerParseClusterBlock(mapinfo_lexer* mapinfo_lexer, int id
         }
 
         if (!dstricmp(mapinfo_cluster_value.mapinfo_string_value, "entertext")) {
-            char tmp[4096];
-            dmemset(tmp, 0, sizeof(tmp));
             P_MapInfoLexerExpect(mapinfo_lexer, MI_EQUALS, "'='");
-            P_MapInfoLexerParseStringList(mapinfo_lexer, tmp, sizeof(tmp));
+            P_MapInfoLexerParseStringList(mapinfo_lexer, &c.textref, &c.numtextrefs);
             c.enteronly = true;
-            dstrncpy(c.text, tmp, dstrlen(tmp));
+            LOC_CopyRefs(c.text, sizeof(c.text), c.textref, c.numtextrefs);
 
             continue;
         }
         if (!dstricmp(mapinfo_cluster_value.mapinfo_string_value, "exittext")) {
-            char tmp[4096];
-            dmemset(tmp, 0, sizeof(tmp));
             P_MapInfoLexerExpect(mapinfo_lexer, MI_EQUALS, "'='");
-            P_MapInfoLexerParseStringList(mapinfo_lexer, tmp, sizeof(tmp));
-            dstrncpy(c.text, tmp, dstrlen(tmp));
+            P_MapInfoLexerParseStringList(mapinfo_lexer, &c.textref, &c.numtextrefs);
+            LOC_CopyRefs(c.text, sizeof(c.text), c.textref, c.numtextrefs);
 
             continue;
         }
@@ -919,6 +1150,9 @@ void P_InitMapInfo(void) {
     dmemcpy(buf, raw, length);
     buf[length] = 0;
 
+    num_loc_refs = 0;
+    loc_sources.arenasize = 0;
+
     LOC_Load();
 
     mapinfo_lexer mapinfo_lexer;
@@ -929,4 +1163,6 @@ void P_InitMapInfo(void) {
     CON_DPrintf("%i map definitions\n", nummapdef);
     CON_DPrintf("%i cluster definitions\n", numclusterdef);
     CON_DPrintf("%i episode definitions\n", numepisodedef);
+
+    localisation_ready = true;
 }
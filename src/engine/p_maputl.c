@@ -24,6 +24,7 @@
 //-----------------------------------------------------------------------------
 
 #include <limits.h>
+#include <string.h>
 #include "m_misc.h"
 #include "m_fixed.h"
 #include "doomdef.h"
@@ -32,15 +33,10 @@
 #include "i_system.h"
 #include "i_swap.h"
 #include "r_main.h"
+#include "z_zone.h"
 
 // atsb: Reverse Engineered
 
-intercept_t intercepts[MAXINTERCEPTS];
-intercept_t* intercept_p;
-
-divline_t trace;
-int ptflags;
-
 //
 // P_AproxDistance
 //
@@ -205,6 +201,199 @@ void P_LineOpening(line_t* linedef)
     openrange = opentop - openbottom;
 }
 
+//
+// P_ScanLineCell
+//
+
+static void P_ScanLineCell(int x, int y, void(*func)(line_t*, void*), void* data)
+{
+    int32_t* list;
+    int32_t* end;
+    int cell = y * lmapwidth + x;
+
+    end = blockmaplump + blockmap[cell + 1];
+    for (list = blockmaplump + blockmap[cell]; list < end; list++)
+        func(&lines[*list], data);
+}
+
+//
+// P_ScanBlockLines
+// Like P_BlockLinesIterator, but without touching validcount so it is
+// safe to use from inside other iterators. A line that spans several
+// line cells is passed to func once per cell.
+//
+
+static void P_ScanBlockLines(int x, int y, void(*func)(line_t*, void*), void* data)
+{
+    int shift = MAPBLOCKSHIFT - lmapshift;
+    int cx, cy;
+
+    if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight) 
+        return;
+
+    for (cx = x << shift; cx < (x + 1) << shift; cx++)
+        for (cy = y << shift; cy < (y + 1) << shift; cy++)
+            P_ScanLineCell(cx, cy, func, data);
+}
+
+//
+// P_ScanBoxLines
+// P_ScanBlockLines over the line cells a box touches
+//
+
+static void P_ScanBoxLines(fixed_t* box, void(*func)(line_t*, void*), void* data)
+{
+    int xl, xh, yl, yh, x, y;
+
+    xl = MAX((box[BOXLEFT] - bmaporgx) >> lmapshift, 0);
+    xh = MIN((box[BOXRIGHT] - bmaporgx) >> lmapshift, lmapwidth - 1);
+    yl = MAX((box[BOXBOTTOM] - bmaporgy) >> lmapshift, 0);
+    yh = MIN((box[BOXTOP] - bmaporgy) >> lmapshift, lmapheight - 1);
+
+    for (x = xl; x <= xh; x++)
+        for (y = yl; y <= yh; y++)
+            P_ScanLineCell(x, y, func, data);
+}
+
+//
+// Sector touch lists
+// Every blockmap-linked thing keeps a list of the sectors its radius
+// overlaps, and every sector a matching list of things. The nodes sit
+// on both lists at once, so P_ChangeSector can go straight to the
+// things a moving floor or ceiling can affect.
+//
+
+static msecnode_t* headsecnode;    // freelist
+
+//
+// P_InitSecNodes
+// Level memory is gone, so is the freelist
+//
+
+void P_InitSecNodes(void)
+{
+    headsecnode = NULL;
+}
+
+static msecnode_t* P_GetSecNode(void)
+{
+    msecnode_t* node;
+
+    if (headsecnode) {
+        node = headsecnode;
+        headsecnode = headsecnode->tnext;
+    }
+    else {
+        node = Z_Malloc(sizeof(*node), PU_LEVEL, NULL);
+    }
+
+    return node;
+}
+
+//
+// P_AddSecNode
+// Links thing into sector unless it is already there
+//
+
+static void P_AddSecNode(sector_t* sector, mobj_t* thing)
+{
+    msecnode_t* node;
+
+    for (node = thing->touching_sectorlist; node; node = node->tnext) {
+        if (node->sector == sector) 
+            return;
+    }
+
+    node = P_GetSecNode();
+    node->sector = sector;
+    node->thing = thing;
+
+    node->tprev = NULL;
+    node->tnext = thing->touching_sectorlist;
+    if (node->tnext) 
+        node->tnext->tprev = node;
+    thing->touching_sectorlist = node;
+
+    node->sprev = NULL;
+    node->snext = sector->touching_thinglist;
+    if (node->snext) 
+        node->snext->sprev = node;
+    sector->touching_thinglist = node;
+}
+
+//
+// P_DelSecNodes
+// Unlinks thing from every sector it touches
+//
+
+static void P_DelSecNodes(mobj_t* thing)
+{
+    msecnode_t* node;
+    msecnode_t* next;
+
+    for (node = thing->touching_sectorlist; node; node = next) {
+        next = node->tnext;
+
+        if (node->snext) 
+            node->snext->sprev = node->sprev;
+        if (node->sprev) 
+            node->sprev->snext = node->snext;
+        else 
+            node->sector->touching_thinglist = node->snext;
+
+        node->tnext = headsecnode;
+        headsecnode = node;
+    }
+
+    thing->touching_sectorlist = NULL;
+}
+
+typedef struct {
+    mobj_t* thing;
+    fixed_t bbox[4];
+} secscan_t;
+
+//
+// PIT_GetSectors
+// Same overlap test as PIT_CheckLine, so the list holds exactly the
+// sectors that can change the thing's floorz and ceilingz
+//
+
+static void PIT_GetSectors(line_t* ld, void* data)
+{
+    secscan_t* scan = (secscan_t*)data;
+
+    if (scan->bbox[BOXRIGHT] <= ld->bbox[BOXLEFT] ||
+        scan->bbox[BOXLEFT] >= ld->bbox[BOXRIGHT] ||
+        scan->bbox[BOXTOP] <= ld->bbox[BOXBOTTOM] ||
+        scan->bbox[BOXBOTTOM] >= ld->bbox[BOXTOP]) {
+        return;
+    }
+
+    if (P_BoxOnLineSide(scan->bbox, ld) != -1) 
+        return;
+
+    P_AddSecNode(ld->frontsector, scan->thing);
+
+    if (ld->backsector) 
+        P_AddSecNode(ld->backsector, scan->thing);
+}
+
+static void P_CreateSecNodeList(mobj_t* thing)
+{
+    secscan_t scan;
+
+    scan.thing = thing;
+    scan.bbox[BOXTOP] = thing->y + thing->radius;
+    scan.bbox[BOXBOTTOM] = thing->y - thing->radius;
+    scan.bbox[BOXRIGHT] = thing->x + thing->radius;
+    scan.bbox[BOXLEFT] = thing->x - thing->radius;
+
+    P_ScanBoxLines(scan.bbox, PIT_GetSectors, &scan);
+
+    P_AddSecNode(thing->subsector->sector, thing);
+}
+
 //
 // Thing Positional Settings
 //
@@ -220,6 +409,9 @@ void P_UnsetThingPosition(mobj_t* thing)
         else              thing->subsector->sector->thinglist = thing->snext;
     }
 
+    if (thing->touching_sectorlist) 
+        P_DelSecNodes(thing);
+
     if (!(thing->flags & MF_NOBLOCKMAP)) {
         if (thing->bnext) 
             thing->bnext->bprev = thing->bprev;
@@ -270,30 +462,24 @@ void P_SetThingPosition(mobj_t* thing)
         else {
             thing->bnext = thing->bprev = NULL;
         }
+
+        P_CreateSecNodeList(thing);
     }
 }
 
 //
 // Blockmap stuff
 //
-boolean P_BlockLinesIterator(int x, int y, boolean(*func)(line_t*))
+static boolean P_LineCellIterator(int x, int y, boolean(*func)(line_t*))
 {
-    int offset;
-    short* list;
+    int32_t* list;
+    int32_t* end;
     line_t* ld;
+    int cell = y * lmapwidth + x;
 
-    if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight) 
-        return true;
-
-    offset = y * bmapwidth + x;
-    offset = (uint16_t)SHORT(*(blockmap + offset));
-
-    for (list = (short*)blockmaplump + offset; *list != -1; list++) {
-        ld = &lines[SHORT(*list)];
-
-        if ((ld - lines) >= numlines) {
-            I_Error("P_BlockLinesIterator: Linedef out of range");
-        }
+    end = blockmaplump + blockmap[cell + 1];
+    for (list = blockmaplump + blockmap[cell]; list < end; list++) {
+        ld = &lines[*list];
 
         if (ld->validcount == validcount) 
             continue;
@@ -305,6 +491,48 @@ boolean P_BlockLinesIterator(int x, int y, boolean(*func)(line_t*))
     return true;
 }
 
+//
+// P_BlockLinesIterator
+// x and y are in mapblocks; every line cell inside the block is visited
+//
+boolean P_BlockLinesIterator(int x, int y, boolean(*func)(line_t*))
+{
+    int shift = MAPBLOCKSHIFT - lmapshift;
+    int cx, cy;
+
+    if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight) 
+        return true;
+
+    for (cx = x << shift; cx < (x + 1) << shift; cx++)
+        for (cy = y << shift; cy < (y + 1) << shift; cy++)
+            if (!P_LineCellIterator(cx, cy, func)) 
+                return false;
+
+    return true;
+}
+
+//
+// P_BoxLinesIterator
+// Only the line cells the box touches, which is fewer lines than
+// whole mapblocks when the line cells are smaller
+//
+boolean P_BoxLinesIterator(fixed_t* box, boolean(*func)(line_t*))
+{
+    int xl, xh, yl, yh, x, y;
+
+    xl = MAX((box[BOXLEFT] - bmaporgx) >> lmapshift, 0);
+    xh = MIN((box[BOXRIGHT] - bmaporgx) >> lmapshift, lmapwidth - 1);
+    yl = MAX((box[BOXBOTTOM] - bmaporgy) >> lmapshift, 0);
+    yh = MIN((box[BOXTOP] - bmaporgy) >> lmapshift, lmapheight - 1);
+
+    for (x = xl; x <= xh; x++)
+        for (y = yl; y <= yh; y++)
+            if (!P_LineCellIterator(x, y, func)) 
+                return false;
+
+    return true;
+}
+
 boolean P_BlockThingsIterator(int x, int y, boolean(*func)(mobj_t*))
 {
     mobj_t* mobj;
@@ -319,51 +547,193 @@ boolean P_BlockThingsIterator(int x, int y, boolean(*func)(mobj_t*))
     return true;
 }
 
+//
+// P_FindNearestThings
+// Searches the blockmap in expanding rings of cells around (x, y)
+// and collects up to maxfound things accepted by func, sorted from
+// nearest to farthest by P_AproxDistance. The search stops as soon
+// as no cell in the next ring can hold anything closer than what
+// was already found, so the cost follows the local thing density
+// rather than the total number of mobjs in the level.
+// A maxdist of 0 means no distance limit.
+//
+
+int P_FindNearestThings(fixed_t x, fixed_t y, fixed_t maxdist,
+    boolean(*func)(mobj_t*, void*), void* data, mobj_t** found, int maxfound)
+{
+    fixed_t dists[MAXNEARTHINGS];
+    int numfound = 0;
+    int bx, by;
+    int r, maxr;
+    int cx, cy;
+    int i;
+    fixed_t dist;
+    mobj_t* mobj;
+
+    if (maxfound <= 0 || !blocklinks) 
+        return 0;
+
+    if (maxfound > MAXNEARTHINGS) 
+        maxfound = MAXNEARTHINGS;
+
+    bx = (x - bmaporgx) >> MAPBLOCKSHIFT;
+    by = (y - bmaporgy) >> MAPBLOCKSHIFT;
+
+    // enough rings to reach every cell from the origin cell
+    maxr = MAX(MAX(bx, bmapwidth - 1 - bx), MAX(by, bmapheight - 1 - by));
+
+    for (r = 0; r <= maxr; r++) {
+        // anything in ring r is at least (r - 1) whole cells away
+        // on one axis and P_AproxDistance never undershoots that
+        if (r > 0) {
+            int64_t mindist = (int64_t)(r - 1) << MAPBLOCKSHIFT;
+
+            if (maxdist > 0 && mindist > maxdist) 
+                break;
+            if (numfound == maxfound && mindist >= dists[numfound - 1]) 
+                break;
+        }
+
+        for (cy = by - r; cy <= by + r; cy++) {
+            if (cy < 0 || cy >= bmapheight) 
+                continue;
+
+            for (cx = bx - r; cx <= bx + r; cx++) {
+                // only the border of the ring, inner cells are done
+                if (cy != by - r && cy != by + r && cx != bx - r) {
+                    cx = bx + r;
+                }
+
+                if (cx < 0 || cx >= bmapwidth) 
+                    continue;
+
+                for (mobj = blocklinks[cy * bmapwidth + cx]; mobj; mobj = mobj->bnext) {
+                    if (!func(mobj, data)) 
+                        continue;
+
+                    dist = P_AproxDistance(mobj->x - x, mobj->y - y);
+
+                    if (maxdist > 0 && dist > maxdist) 
+                        continue;
+
+                    if (numfound == maxfound && !(dist < dists[numfound - 1])) 
+                        continue;
+
+                    // insertion sort; equal distances keep discovery order
+                    i = (numfound < maxfound) ? numfound++ : numfound - 1;
+                    for (; i > 0 && dist < dists[i - 1]; i--) {
+                        dists[i] = dists[i - 1];
+                        found[i] = found[i - 1];
+                    }
+                    dists[i] = dist;
+                    found[i] = mobj;
+                }
+            }
+        }
+    }
+
+    return numfound;
+}
+
+//
+// P_FindNearestThing
+//
+
+mobj_t* P_FindNearestThing(fixed_t x, fixed_t y, fixed_t maxdist,
+    boolean(*func)(mobj_t*, void*), void* data)
+{
+    mobj_t* mobj;
+
+    if (!P_FindNearestThings(x, y, maxdist, func, data, &mobj, 1)) 
+        return NULL;
+
+    return mobj;
+}
+
 //
 // Interp
 //
 
-boolean PIT_AddLineIntercepts(line_t* ld)
+//
+// P_AddIntercept
+// Intercepts are kept sorted by frac as they are collected. Blocks are
+// visited in order along the trace, so most inserts land at or near the
+// end of the buffer. Equal fracs keep their discovery order, matching
+// the old select-the-minimum scan. As before, a full buffer keeps the
+// first MAXINTERCEPTS found and drops the rest.
+//
+
+static void P_AddIntercept(pathtrace_t* pt, fixed_t frac, boolean isaline, void* d)
+{
+    intercept_t* in;
+    int i;
+
+    if (frac < 0) 
+        return;
+
+    i = pt->numintercepts;
+    while (i > 0 && pt->intercepts[i - 1].frac > frac) 
+        i--;
+
+    // a line that spans several blocks is found once per block, always
+    // with the same frac, so a duplicate can only sit in the run of
+    // equal fracs just before the insert point
+    if (isaline) {
+        int j;
+
+        for (j = i - 1; j >= 0 && pt->intercepts[j].frac == frac; j--) {
+            if (pt->intercepts[j].isaline && pt->intercepts[j].d.line == d) 
+                return;
+        }
+    }
+
+    if (pt->numintercepts >= MAXINTERCEPTS) 
+        return;
+
+    in = &pt->intercepts[i];
+    memmove(in + 1, in, (pt->numintercepts - i) * sizeof(*in));
+
+    in->frac = frac;
+    in->isaline = isaline;
+    if (isaline) 
+        in->d.line = (line_t*)d;
+    else 
+        in->d.thing = (mobj_t*)d;
+
+    pt->numintercepts++;
+}
+
+static void PIT_AddLineIntercept(line_t* ld, void* data)
 {
+    pathtrace_t* pt = (pathtrace_t*)data;
+    divline_t* trace = &pt->trace;
     int s1, s2;
-    fixed_t frac;
     divline_t dl;
 
-    if (trace.dx > FRACUNIT * 16 || trace.dy > FRACUNIT * 16 ||
-        trace.dx < -FRACUNIT * 16 || trace.dy < -FRACUNIT * 16) {
-        s1 = P_PointOnDivlineSide(ld->v1->x, ld->v1->y, &trace);
-        s2 = P_PointOnDivlineSide(ld->v2->x, ld->v2->y, &trace);
+    if (trace->dx > FRACUNIT * 16 || trace->dy > FRACUNIT * 16 ||
+        trace->dx < -FRACUNIT * 16 || trace->dy < -FRACUNIT * 16) {
+        s1 = P_PointOnDivlineSide(ld->v1->x, ld->v1->y, trace);
+        s2 = P_PointOnDivlineSide(ld->v2->x, ld->v2->y, trace);
     }
     else {
-        s1 = P_PointOnLineSide(trace.x, trace.y, ld);
-        s2 = P_PointOnLineSide(trace.x + trace.dx, trace.y + trace.dy, ld);
+        s1 = P_PointOnLineSide(trace->x, trace->y, ld);
+        s2 = P_PointOnLineSide(trace->x + trace->dx, trace->y + trace->dy, ld);
     }
 
     if (s1 == s2) 
-        return true;
+        return;
 
     P_MakeDivline(ld, &dl);
-    frac = P_InterceptVector(&trace, &dl);
-
-    if (frac < 0) 
-        return true;
-    if ((intercept_p - intercepts) >= MAXINTERCEPTS) 
-        return true;
-
-    intercept_p->frac = frac;
-    intercept_p->isaline = true;
-    intercept_p->d.line = ld;
-    intercept_p++;
-    return true;
+    P_AddIntercept(pt, P_InterceptVector(trace, &dl), true, ld);
 }
 
-boolean PIT_AddThingIntercepts(mobj_t* thing)
+static void P_AddThingIntercept(pathtrace_t* pt, mobj_t* thing)
 {
+    divline_t* trace = &pt->trace;
     fixed_t x1, y1, x2, y2;
     int s1, s2;
-    boolean tracepositive = (trace.dx ^ trace.dy) > 0;
+    boolean tracepositive = (trace->dx ^ trace->dy) > 0;
     divline_t dl;
-    fixed_t frac;
 
     if (tracepositive) {
         x1 = thing->x - thing->radius; y1 = thing->y + thing->radius;
@@ -374,45 +744,42 @@ boolean PIT_AddThingIntercepts(mobj_t* thing)
         x2 = thing->x + thing->radius; y2 = thing->y + thing->radius;
     }
 
-    s1 = P_PointOnDivlineSide(x1, y1, &trace);
-    s2 = P_PointOnDivlineSide(x2, y2, &trace);
+    s1 = P_PointOnDivlineSide(x1, y1, trace);
+    s2 = P_PointOnDivlineSide(x2, y2, trace);
     if (s1 == s2) 
-        return true;
+        return;
 
     dl.x = x1; dl.y = y1; dl.dx = x2 - x1; dl.dy = y2 - y1;
-    frac = P_InterceptVector(&trace, &dl);
-    if (frac < 0) 
-        return true;
-    if ((intercept_p - intercepts) >= MAXINTERCEPTS) 
-        return true;
-
-    intercept_p->frac = frac;
-    intercept_p->isaline = false;
-    intercept_p->d.thing = thing;
-    intercept_p++;
-    return true;
+    P_AddIntercept(pt, P_InterceptVector(trace, &dl), false, thing);
 }
 
-boolean P_TraverseIntercepts(traverser_t func, fixed_t maxfrac)
+static void P_TraceBlockThings(pathtrace_t* pt, int x, int y)
 {
-    int64_t count = intercept_p - intercepts;
-    intercept_t* scan, * in = 0;
-    fixed_t dist;
+    mobj_t* mobj;
 
-    while (count--) {
-        dist = INT_MAX;
-        for (scan = intercepts; scan < intercept_p; scan++) {
-            if (scan->frac < dist) { 
-                dist = scan->frac; in = scan;
-            }
-        }
+    if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight) 
+        return;
+
+    for (mobj = blocklinks[y * bmapwidth + x]; mobj; mobj = mobj->bnext) {
+        P_AddThingIntercept(pt, mobj);
+    }
+}
+
+//
+// P_TraverseIntercepts
+// Intercepts are already in order, so this is a single walk
+//
+
+boolean P_TraverseIntercepts(pathtrace_t* pt, traverser_t func, fixed_t maxfrac)
+{
+    int i;
 
-        if (dist > maxfrac) 
+    for (i = 0; i < pt->numintercepts; i++) {
+        if (pt->intercepts[i].frac > maxfrac) 
             return true;
 
-        if (!func(in)) 
+        if (!func(pt, &pt->intercepts[i])) 
             return false;
-        in->frac = INT_MAX;
     }
     return true;
 }
@@ -425,24 +792,30 @@ void T_TraceDrawer(tracedrawer_t* tdrawer)
 }
 
 //
-// P_PathTraverse
+// P_TracePath
+// Traces a line from x1,y1 to x2,y2, calling trav for every line and/or
+// thing crossed, nearest first. Intercept collection keeps its state in
+// the caller's pathtrace_t, so collecting is reentrant; P_LineOpening and
+// the PTR_* traversers still share globals (opentop, openbottom, aimslope,
+// linetarget, shootthing, bestslidefrac) and are not.
 //
-boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
-    int flags, boolean(*trav)(intercept_t*))
+boolean P_TracePath(pathtrace_t* pt, fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+    int flags, traverser_t trav)
 {
     fixed_t xt1, yt1, xt2, yt2, xstep, ystep, partial, xintercept, yintercept;
     int mapx, mapy, mapxstep, mapystep, count;
 
-    validcount++;
-    intercept_p = intercepts;
+    pt->numintercepts = 0;
+    pt->flags = flags;
+    pt->maxfrac = FRACUNIT;
 
     if (((x1 - bmaporgx) & (MAPBLOCKSIZE - 1)) == 0) x1 += FRACUNIT;
     if (((y1 - bmaporgy) & (MAPBLOCKSIZE - 1)) == 0) y1 += FRACUNIT;
 
-    trace.x = x1; 
-    trace.y = y1; 
-    trace.dx = x2 - x1; 
-    trace.dy = y2 - y1;
+    pt->trace.x = x1; 
+    pt->trace.y = y1; 
+    pt->trace.dx = x2 - x1; 
+    pt->trace.dy = y2 - y1;
 
     x1 -= bmaporgx; y1 -= bmaporgy; xt1 = x1 >> MAPBLOCKSHIFT; yt1 = y1 >> MAPBLOCKSHIFT;
     x2 -= bmaporgx; y2 -= bmaporgy; xt2 = x2 >> MAPBLOCKSHIFT; yt2 = y2 >> MAPBLOCKSHIFT;
@@ -481,10 +854,10 @@ boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
     mapx = xt1; mapy = yt1;
 
     for (count = 0; count < 64; count++) {
-        if ((flags & PT_ADDLINES) && !P_BlockLinesIterator(mapx, mapy, PIT_AddLineIntercepts))  
-            return false;
-        if ((flags & PT_ADDTHINGS) && !P_BlockThingsIterator(mapx, mapy, PIT_AddThingIntercepts)) 
-            return false;
+        if (flags & PT_ADDLINES) 
+            P_ScanBlockLines(mapx, mapy, PIT_AddLineIntercept, pt);
+        if (flags & PT_ADDTHINGS) 
+            P_TraceBlockThings(pt, mapx, mapy);
 
         if (mapx == xt2 && mapy == yt2) 
             break;
@@ -496,5 +869,17 @@ boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
             xintercept += xstep; mapy += mapystep;
         }
     }
-    return P_TraverseIntercepts(trav, FRACUNIT);
+    return P_TraverseIntercepts(pt, trav, pt->maxfrac);
+}
+
+//
+// P_PathTraverse
+//
+boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+    int flags, traverser_t trav)
+{
+    pathtrace_t pt;
+
+    pt.data = NULL;
+    return P_TracePath(&pt, x1, y1, x2, y2, flags, trav);
 }
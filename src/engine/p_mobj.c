@@ -600,8 +600,7 @@ mobj_t* P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type) {
 	mobj->health = info->spawnhealth;
 	mobj->alpha = info->alpha;
 	mobj->blockflag = 0;
-	mobj->frame_x = mobj->x;
-	mobj->frame_y = mobj->y;
+	mobj->snapindex = -1;
 	mobj->mobjfunc = NULL;
 	mobj->extradata = NULL;
 	mobj->target = NULL;
@@ -638,13 +637,13 @@ mobj_t* P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type) {
 	mobj->ceilingz = mobj->subsector->sector->ceilingheight;
 
 	if (z == ONFLOORZ) {
-		mobj->z = mobj->frame_z = mobj->floorz;
+		mobj->z = mobj->floorz;
 	}
 	else if (z == ONCEILINGZ) {
-		mobj->z = mobj->frame_z = (mobj->ceilingz - mobj->info->height);
+		mobj->z = (mobj->ceilingz - mobj->info->height);
 	}
 	else {
-		mobj->z = mobj->frame_z = z;
+		mobj->z = z;
 	}
 
 	P_LinkMobj(mobj);       // add to list
@@ -822,7 +821,7 @@ void P_FadeMobj(mobj_t* mobj, int amount, int alpha, int flags) {
 	mobjfade_t* mobjfade;
 
 	mobjfade = Z_Calloc(sizeof(*mobjfade), PU_LEVSPEC, 0);
-	P_AddThinker(&mobjfade->thinker);
+	P_AddThinker(&mobjfade->thinker, tc_fade);
 	mobjfade->thinker.function.acp1 = (actionf_p1)T_MobjFadeThinker;
 	P_SetTarget(&mobjfade->mobj, mobj);
 	mobjfade->amount = amount;
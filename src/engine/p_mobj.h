@@ -165,6 +165,9 @@ typedef struct mobj_s {
 
     struct subsector_s* subsector;
 
+    // sectors the radius overlaps, for P_ChangeSector
+    struct msecnode_s*  touching_sectorlist;
+
     // The closest interval over all contacted Sectors.
     fixed_t             floorz;
     fixed_t             ceilingz;
@@ -231,10 +234,8 @@ typedef struct mobj_s {
     // [d64] misc data for various actions
     void*               extradata;
 
-    // [kex] stuff that happens in between tics
-    fixed_t             frame_x;
-    fixed_t             frame_y;
-    fixed_t             frame_z;
+    // index into the last published render snapshot
+    int                 snapindex;
 
     // [kex] mobj reference id
     unsigned int        refcount;
@@ -155,7 +155,7 @@ EV_DoPlat
 		// Find lowest & highest floors around sector
 		rtn = 1;
 		plat = Z_Malloc(sizeof(*plat), PU_LEVSPEC, 0);
-		P_AddThinker(&plat->thinker);
+		P_AddThinker(&plat->thinker, tc_plat);
 
 		plat->type = type;
 		plat->sector = sec;
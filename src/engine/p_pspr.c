@@ -1057,7 +1057,7 @@ void A_FireLaser(player_t* player, pspdef_t* psp) {
 		P_LaserCrossBSP(numnodes - 1, laser[i]);
 
 		laserthinker[i] = Z_Malloc(sizeof(*laserthinker[i]), PU_LEVSPEC, 0);
-		P_AddThinker(&laserthinker[i]->thinker);
+		P_AddThinker(&laserthinker[i]->thinker, tc_laser);
 
 		laserthinker[i]->thinker.function.acp1 = (actionf_p1)T_LaserThinker;
 		laserthinker[i]->dest = P_SpawnMobj(x, y, z, MT_PROJ_LASER);
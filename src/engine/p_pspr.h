@@ -59,10 +59,6 @@ typedef struct {
 	fixed_t     sx;
 	fixed_t     sy;
 	int         alpha;  // [d64] for rendering
-
-	// [kex] stuff that happens in between tics
-	fixed_t     frame_x;
-	fixed_t     frame_y;
 	bool		processPending; // true: waiting for periodic processing on this tick
 
 } pspdef_t;
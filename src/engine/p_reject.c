@@ -0,0 +1,847 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Reject matrix builder for maps that ship an empty REJECT lump.
+//
+//      Every two sided line between two different sectors is a portal.
+//      Sight lines are straight, so a sector can only be seen through
+//      a chain of portals that one line passes through in order. The
+//      chains are followed from each sector, clipping every new portal
+//      to the region reachable through the first and the last one, in
+//      the same way as a PVS flood. Heights are ignored and every clip
+//      is widened a little, so a pair is only rejected when no line in
+//      the plane could join them; such pairs already fail P_CheckSight.
+//
+//      The build runs in a thread after the level is loaded and the
+//      result is kept next to the level cache.
+//
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL3/SDL_atomic.h>
+#include <SDL3/SDL_thread.h>
+
+#include "p_reject.h"
+#include "p_levelcache.h"
+#include "p_local.h"
+#include "doomstat.h"
+#include "doomdata.h"
+#include "w_wad.h"
+#include "z_zone.h"
+#include "m_misc.h"
+#include "i_system.h"
+#include "con_console.h"
+#include "con_cvar.h"
+
+CVAR_EXTERNAL(p_levelcache);
+CVAR_EXTERNAL(p_buildreject);
+
+extern int sightcounts[2];
+
+#define REJECTCACHE_MAGIC   "D64REJ"
+#define REJECTCACHE_VERSION 1
+#define REJECTCACHE_EXT     ".rej"
+
+// how far outside a portal a sight line may pass and still count as
+// going through it; covers the rounding in P_DivlineSide
+#define RJ_EPSILON          1.0
+
+// limits per source sector; past these the sector falls back to
+// being able to see everything it is connected to
+#define RJ_MAXSTEPS         (1 << 20)
+#define RJ_MAXDEPTH         1024
+
+#define RJ_TEST(set, i)     ((set)[(i) >> 5] & (1u << ((i) & 31)))
+#define RJ_SET(set, i)      ((set)[(i) >> 5] |= (1u << ((i) & 31)))
+
+typedef struct {
+	double      x1;
+	double      y1;
+	double      x2;
+	double      y2;
+} rjseg_t;
+
+typedef struct {
+	rjseg_t     seg;    // leads into the sector on its left
+	int         line;
+	int         from;
+	int         to;
+} rjportal_t;
+
+typedef struct {
+	int             numsectors;
+	int             numlines;
+	int             numportals;
+	int             words;          // per sector bit set
+
+	rjportal_t*     portals;        // sorted by from sector
+	int*            firstportal;    // numsectors + 1
+	int*            component;
+	uint32_t*       mightsee;       // per portal
+	uint32_t*       chain;          // per depth
+	uint32_t*       visible;        // per sector
+	byte*           inchain;        // per line
+	byte*           matrix;
+
+	int             steps;
+	boolean         overflow;
+	int             fallbacks;
+
+	SDL_AtomicInt   cancel;
+	SDL_AtomicInt   done;
+} rjwork_t;
+
+typedef enum {
+	RJ_NONE,
+	RJ_LUMP,
+	RJ_CACHED,
+	RJ_BUILDING,
+	RJ_BUILT
+} rjsource_t;
+
+typedef struct {
+	char        magic[8];
+	int32_t     version;
+	int32_t     numsectors;
+} rjheader_t;
+
+static rjwork_t*        rjwork;
+static SDL_Thread*      rjthread;
+static rjsource_t       rjsource = RJ_NONE;
+static md5_digest_t     rjkey;
+static uint64_t         rjstarttime;
+static uint64_t         rjbuildtime;
+static int              rjfallbacks;
+
+static const char* rjsourcenames[] = {
+	"none", "map lump", "cache", "building", "built"
+};
+
+//
+// RJ_Find
+//
+
+static int RJ_Find(int* parent, int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+
+	return i;
+}
+
+//
+// RJ_ClipSeg
+// Cuts seg down to the part on the given side of the line through
+// (ax, ay) and (bx, by), give or take RJ_EPSILON. Side is 1 for the
+// left and -1 for the right. Returns false if nothing is left.
+//
+
+static boolean RJ_ClipSeg(rjseg_t* seg, double ax, double ay, double bx, double by, int side) {
+	double dx = bx - ax;
+	double dy = by - ay;
+	double len = sqrt(dx * dx + dy * dy);
+	double d1;
+	double d2;
+	double f;
+	double x;
+	double y;
+
+	// no direction to clip against
+	if (len < 1e-6) {
+		return true;
+	}
+
+	d1 = side * (dx * (seg->y1 - ay) - dy * (seg->x1 - ax)) / len + RJ_EPSILON;
+	d2 = side * (dx * (seg->y2 - ay) - dy * (seg->x2 - ax)) / len + RJ_EPSILON;
+
+	if (d1 >= 0 && d2 >= 0) {
+		return true;
+	}
+
+	if (d1 < 0 && d2 < 0) {
+		return false;
+	}
+
+	f = d1 / (d1 - d2);
+	x = seg->x1 + (seg->x2 - seg->x1) * f;
+	y = seg->y1 + (seg->y2 - seg->y1) * f;
+
+	if (d1 < 0) {
+		seg->x1 = x;
+		seg->y1 = y;
+	}
+	else {
+		seg->x2 = x;
+		seg->y2 = y;
+	}
+
+	return true;
+}
+
+//
+// RJ_ClipToSeparators
+// Any line through src and pass stays between the lines joining
+// opposite ends of the two once it is past pass
+//
+
+static boolean RJ_ClipToSeparators(rjseg_t* seg, const rjseg_t* src, const rjseg_t* pass) {
+	double sx[2] = { src->x1, src->x2 };
+	double sy[2] = { src->y1, src->y2 };
+	double px[2] = { pass->x1, pass->x2 };
+	double py[2] = { pass->y1, pass->y2 };
+	double dx;
+	double dy;
+	double len;
+	double ds;
+	double dp;
+	int side;
+	int i;
+	int j;
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < 2; j++) {
+			dx = px[j] - sx[i];
+			dy = py[j] - sy[i];
+			len = sqrt(dx * dx + dy * dy);
+
+			if (len < 1e-6) {
+				continue;
+			}
+
+			// which sides the other two ends are on
+			ds = (dx * (sy[!i] - sy[i]) - dy * (sx[!i] - sx[i])) / len;
+			dp = (dx * (py[!j] - sy[i]) - dy * (px[!j] - sx[i])) / len;
+
+			if (ds > RJ_EPSILON && dp < -RJ_EPSILON) {
+				side = -1;
+			}
+			else if (ds < -RJ_EPSILON && dp > RJ_EPSILON) {
+				side = 1;
+			}
+			else {
+				// not a separating line
+				continue;
+			}
+
+			if (!RJ_ClipSeg(seg, sx[i], sy[i], px[j], py[j], side)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+//
+// RJ_InFront
+// Does any part of seg lie past the given portal
+//
+
+static boolean RJ_InFront(const rjseg_t* seg, const rjportal_t* p) {
+	rjseg_t clip = *seg;
+
+	return RJ_ClipSeg(&clip, p->seg.x1, p->seg.y1, p->seg.x2, p->seg.y2, 1);
+}
+
+//
+// RJ_MightSee
+// Rough set of sectors reachable through a portal: anything joined
+// to it by portals that are at least partly past it
+//
+
+static void RJ_MightSee(rjwork_t* w, int portal, int* queue) {
+	const rjportal_t* p = &w->portals[portal];
+	uint32_t* might = w->mightsee + (size_t)portal * w->words;
+	int head = 0;
+	int tail = 0;
+	int i;
+
+	RJ_SET(might, p->to);
+	queue[tail++] = p->to;
+
+	while (head < tail) {
+		int sec = queue[head++];
+
+		for (i = w->firstportal[sec]; i < w->firstportal[sec + 1]; i++) {
+			const rjportal_t* q = &w->portals[i];
+
+			if (q->line == p->line || RJ_TEST(might, q->to)) {
+				continue;
+			}
+
+			if (RJ_InFront(&q->seg, p)) {
+				RJ_SET(might, q->to);
+				queue[tail++] = q->to;
+			}
+		}
+	}
+}
+
+//
+// RJ_Flow
+// Follows the portals out of sector, seen through src and then
+// pass. The bits at chain[depth] are the sectors that every portal
+// so far might see.
+//
+
+static void RJ_Flow(rjwork_t* w, uint32_t* visible, const rjseg_t* src,
+	const rjseg_t* pass, int sector, int depth) {
+	uint32_t* might = w->chain + (size_t)depth * w->words;
+	uint32_t* next = might + w->words;
+	int i;
+	int k;
+
+	if (depth >= RJ_MAXDEPTH) {
+		w->overflow = true;
+		return;
+	}
+
+	for (i = w->firstportal[sector]; i < w->firstportal[sector + 1]; i++) {
+		const rjportal_t* q = &w->portals[i];
+		const uint32_t* qmight = w->mightsee + (size_t)i * w->words;
+		boolean more = false;
+		rjseg_t seg;
+
+		if (w->inchain[q->line] || !RJ_TEST(might, q->to)) {
+			continue;
+		}
+
+		if (++w->steps > RJ_MAXSTEPS) {
+			w->overflow = true;
+			return;
+		}
+
+		if (!(w->steps & 4095) && SDL_GetAtomicInt(&w->cancel)) {
+			w->overflow = true;
+			return;
+		}
+
+		// nothing new can be found through q
+		if (RJ_TEST(visible, q->to)) {
+			for (k = 0; k < w->words; k++) {
+				if (might[k] & qmight[k] & ~visible[k]) {
+					more = true;
+					break;
+				}
+			}
+
+			if (!more) {
+				continue;
+			}
+		}
+
+		seg = q->seg;
+
+		if (!RJ_ClipSeg(&seg, pass->x1, pass->y1, pass->x2, pass->y2, 1)) {
+			continue;
+		}
+
+		if (pass != src && !RJ_ClipToSeparators(&seg, src, pass)) {
+			continue;
+		}
+
+		RJ_SET(visible, q->to);
+
+		for (k = 0, more = false; k < w->words; k++) {
+			next[k] = might[k] & qmight[k];
+			more |= (next[k] & ~visible[k]) != 0;
+		}
+
+		if (!more) {
+			continue;
+		}
+
+		w->inchain[q->line] = true;
+		RJ_Flow(w, visible, src, &seg, q->to, depth + 1);
+		w->inchain[q->line] = false;
+
+		if (w->overflow) {
+			return;
+		}
+	}
+}
+
+//
+// RJ_SectorVisibility
+//
+
+static void RJ_SectorVisibility(rjwork_t* w, int sector) {
+	uint32_t* visible = w->visible + (size_t)sector * w->words;
+	int i;
+
+	RJ_SET(visible, sector);
+	w->steps = 0;
+	w->overflow = false;
+
+	for (i = w->firstportal[sector]; i < w->firstportal[sector + 1] && !w->overflow; i++) {
+		const rjportal_t* p = &w->portals[i];
+
+		RJ_SET(visible, p->to);
+		dmemcpy(w->chain, w->mightsee + (size_t)i * w->words, w->words * sizeof(uint32_t));
+
+		w->inchain[p->line] = true;
+		RJ_Flow(w, visible, &p->seg, &p->seg, p->to, 0);
+		w->inchain[p->line] = false;
+	}
+
+	if (w->overflow) {
+		// too many chains to follow; anything connected might be visible
+		dmemset(w->inchain, 0, w->numlines);
+
+		for (i = 0; i < w->numsectors; i++) {
+			if (w->component[i] == w->component[sector]) {
+				RJ_SET(visible, i);
+			}
+		}
+
+		w->fallbacks++;
+	}
+}
+
+//
+// RJ_Build
+//
+
+static void RJ_Build(rjwork_t* w) {
+	int* queue;
+	int i;
+	int j;
+
+	queue = malloc(w->numsectors * sizeof(int));
+
+	for (i = 0; i < w->numportals; i++) {
+		RJ_MightSee(w, i, queue);
+	}
+
+	free(queue);
+
+	for (i = 0; i < w->numsectors; i++) {
+		if (SDL_GetAtomicInt(&w->cancel)) {
+			return;
+		}
+
+		RJ_SectorVisibility(w, i);
+	}
+
+	// sight is symmetric; only reject when neither side found the other
+	for (i = 0; i < w->numsectors; i++) {
+		const uint32_t* vi = w->visible + (size_t)i * w->words;
+
+		for (j = 0; j < w->numsectors; j++) {
+			const uint32_t* vj = w->visible + (size_t)j * w->words;
+			size_t pnum = (size_t)i * w->numsectors + j;
+
+			if (!RJ_TEST(vi, j) && !RJ_TEST(vj, i)) {
+				w->matrix[pnum >> 3] |= 1 << (pnum & 7);
+			}
+		}
+	}
+}
+
+//
+// RJ_Thread
+//
+
+static int SDLCALL RJ_Thread(void* data) {
+	rjwork_t* w = (rjwork_t*)data;
+
+	RJ_Build(w);
+	SDL_SetAtomicInt(&w->done, 1);
+
+	return 0;
+}
+
+//
+// RJ_FreeWork
+//
+
+static void RJ_FreeWork(rjwork_t* w) {
+	free(w->portals);
+	free(w->firstportal);
+	free(w->component);
+	free(w->mightsee);
+	free(w->chain);
+	free(w->visible);
+	free(w->inchain);
+	free(w->matrix);
+	free(w);
+}
+
+//
+// RJ_SetupWork
+// Copies what the builder needs out of the level, so the thread
+// never touches level data
+//
+
+static rjwork_t* RJ_SetupWork(void) {
+	rjwork_t* w;
+	int* count;
+	int i;
+
+	w = calloc(1, sizeof(rjwork_t));
+	w->numsectors = numsectors;
+	w->numlines = numlines;
+	w->words = (numsectors + 31) >> 5;
+
+	w->firstportal = calloc(numsectors + 1, sizeof(int));
+	w->component = malloc(numsectors * sizeof(int));
+
+	for (i = 0; i < numsectors; i++) {
+		w->component[i] = i;
+	}
+
+	// count portals out of each sector and join the two sides
+	for (i = 0; i < numlines; i++) {
+		line_t* li = &lines[i];
+		int front;
+		int back;
+
+		if (!(li->flags & ML_TWOSIDED) || !li->frontsector || !li->backsector ||
+			li->frontsector == li->backsector) {
+			continue;
+		}
+
+		if (li->v1->x == li->v2->x && li->v1->y == li->v2->y) {
+			continue;
+		}
+
+		front = li->frontsector - sectors;
+		back = li->backsector - sectors;
+
+		w->firstportal[front + 1]++;
+		w->firstportal[back + 1]++;
+		w->numportals += 2;
+
+		w->component[RJ_Find(w->component, front)] = RJ_Find(w->component, back);
+	}
+
+	for (i = 0; i < numsectors; i++) {
+		w->firstportal[i + 1] += w->firstportal[i];
+	}
+
+	for (i = 0; i < numsectors; i++) {
+		w->component[i] = RJ_Find(w->component, i);
+	}
+
+	w->portals = malloc(MAX(w->numportals, 1) * sizeof(rjportal_t));
+	count = malloc(numsectors * sizeof(int));
+	dmemcpy(count, w->firstportal, numsectors * sizeof(int));
+
+	for (i = 0; i < numlines; i++) {
+		line_t* li = &lines[i];
+		double x1 = (double)li->v1->x / FRACUNIT;
+		double y1 = (double)li->v1->y / FRACUNIT;
+		double x2 = (double)li->v2->x / FRACUNIT;
+		double y2 = (double)li->v2->y / FRACUNIT;
+		rjportal_t* p;
+		int front;
+		int back;
+
+		if (!(li->flags & ML_TWOSIDED) || !li->frontsector || !li->backsector ||
+			li->frontsector == li->backsector) {
+			continue;
+		}
+
+		if (li->v1->x == li->v2->x && li->v1->y == li->v2->y) {
+			continue;
+		}
+
+		front = li->frontsector - sectors;
+		back = li->backsector - sectors;
+
+		// the front side is on the right of v1 -> v2
+		p = &w->portals[count[front]++];
+		p->seg.x1 = x1;
+		p->seg.y1 = y1;
+		p->seg.x2 = x2;
+		p->seg.y2 = y2;
+		p->line = i;
+		p->from = front;
+		p->to = back;
+
+		p = &w->portals[count[back]++];
+		p->seg.x1 = x2;
+		p->seg.y1 = y2;
+		p->seg.x2 = x1;
+		p->seg.y2 = y1;
+		p->line = i;
+		p->from = back;
+		p->to = front;
+	}
+
+	free(count);
+
+	w->mightsee = calloc((size_t)MAX(w->numportals, 1) * w->words, sizeof(uint32_t));
+	w->chain = calloc((size_t)(RJ_MAXDEPTH + 1) * w->words, sizeof(uint32_t));
+	w->visible = calloc((size_t)numsectors * w->words, sizeof(uint32_t));
+	w->inchain = calloc(MAX(numlines, 1), 1);
+	w->matrix = calloc(((size_t)numsectors * numsectors + 7) >> 3, 1);
+
+	SDL_SetAtomicInt(&w->cancel, 0);
+	SDL_SetAtomicInt(&w->done, 0);
+
+	return w;
+}
+
+//
+// RJ_RejectSize
+//
+
+static int RJ_RejectSize(void) {
+	return (int)(((size_t)numsectors * numsectors + 7) >> 3);
+}
+
+//
+// RJ_IsEmpty
+// Short or all zero lumps reject nothing
+//
+
+static boolean RJ_IsEmpty(void) {
+	int size = RJ_RejectSize();
+	int i;
+
+	if (!rejectmatrix || W_MapLumpLength(ML_REJECT) < size) {
+		return true;
+	}
+
+	for (i = 0; i < size; i++) {
+		if (rejectmatrix[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//
+// RJ_SetMatrix
+//
+
+static void RJ_SetMatrix(const byte* matrix) {
+	int size = RJ_RejectSize();
+
+	if (rejectmatrix) {
+		Z_Free(rejectmatrix);
+	}
+
+	rejectmatrix = (byte*)Z_Malloc(size, PU_LEVEL, 0);
+	dmemcpy(rejectmatrix, matrix, size);
+}
+
+//
+// RJ_LoadCache
+//
+
+static boolean RJ_LoadCache(void) {
+	rjheader_t* header;
+	byte* buffer;
+	char* path;
+	int length;
+
+	if (!p_levelcache.value) {
+		return false;
+	}
+
+	if (!(path = P_LevelCachePath(rjkey, REJECTCACHE_EXT, false))) {
+		return false;
+	}
+
+	length = M_FileExists(path) ? M_ReadFile(path, &buffer) : -1;
+	free(path);
+
+	if (length < 0) {
+		return false;
+	}
+
+	header = (rjheader_t*)buffer;
+
+	if (length != (int)sizeof(rjheader_t) + RJ_RejectSize() ||
+		memcmp(header->magic, REJECTCACHE_MAGIC, sizeof(REJECTCACHE_MAGIC)) ||
+		header->version != REJECTCACHE_VERSION || header->numsectors != numsectors) {
+		Z_Free(buffer);
+		return false;
+	}
+
+	RJ_SetMatrix(buffer + sizeof(rjheader_t));
+	Z_Free(buffer);
+
+	return true;
+}
+
+//
+// RJ_SaveCache
+//
+
+static void RJ_SaveCache(const byte* matrix) {
+	rjheader_t header;
+	byte* buffer;
+	char* path;
+	int size = RJ_RejectSize();
+
+	if (!p_levelcache.value) {
+		return;
+	}
+
+	dmemset(&header, 0, sizeof(header));
+	dmemcpy(header.magic, REJECTCACHE_MAGIC, sizeof(REJECTCACHE_MAGIC));
+	header.version = REJECTCACHE_VERSION;
+	header.numsectors = numsectors;
+
+	buffer = Z_Malloc(sizeof(header) + size, PU_STATIC, 0);
+	dmemcpy(buffer, &header, sizeof(header));
+	dmemcpy(buffer + sizeof(header), matrix, size);
+
+	if ((path = P_LevelCachePath(rjkey, REJECTCACHE_EXT, true))) {
+		if (!M_WriteFile(path, buffer, sizeof(header) + size)) {
+			CON_Warnf("RJ_SaveCache: couldn't write %s\n", path);
+		}
+
+		free(path);
+	}
+
+	Z_Free(buffer);
+}
+
+//
+// RJ_Finish
+//
+
+static void RJ_Finish(void) {
+	RJ_SetMatrix(rjwork->matrix);
+	RJ_SaveCache(rjwork->matrix);
+
+	rjbuildtime = I_GetTimeNS() - rjstarttime;
+	rjfallbacks = rjwork->fallbacks;
+	rjsource = RJ_BUILT;
+
+	CON_DPrintf("P_UpdateReject: built in %.1fms, %i fallbacks\n",
+		(double)rjbuildtime / 1000000.0, rjfallbacks);
+
+	RJ_FreeWork(rjwork);
+	rjwork = NULL;
+}
+
+//
+// P_StopReject
+//
+
+void P_StopReject(void) {
+	if (!rjwork) {
+		return;
+	}
+
+	SDL_SetAtomicInt(&rjwork->cancel, 1);
+
+	if (rjthread) {
+		SDL_WaitThread(rjthread, NULL);
+		rjthread = NULL;
+	}
+
+	RJ_FreeWork(rjwork);
+	rjwork = NULL;
+
+	if (rjsource == RJ_BUILDING) {
+		rjsource = RJ_NONE;
+	}
+}
+
+//
+// P_UpdateReject
+//
+
+void P_UpdateReject(void) {
+	if (!rjwork || !SDL_GetAtomicInt(&rjwork->done)) {
+		return;
+	}
+
+	if (rjthread) {
+		SDL_WaitThread(rjthread, NULL);
+		rjthread = NULL;
+	}
+
+	RJ_Finish();
+}
+
+//
+// P_InitReject
+// Keeps the map's own REJECT if it rejects anything, otherwise
+// loads a cached build or starts a new one
+//
+
+void P_InitReject(void) {
+	P_StopReject();
+
+	sightcounts[0] = sightcounts[1] = 0;
+	rjbuildtime = 0;
+	rjfallbacks = 0;
+
+	if (!RJ_IsEmpty()) {
+		rjsource = RJ_LUMP;
+		return;
+	}
+
+	rjsource = RJ_NONE;
+
+	// keep sight checks exactly as shipped when they have to stay in sync
+	if (!p_buildreject.value || netgame || demoplayback || demorecording ||
+		numsectors <= 0) {
+		return;
+	}
+
+	P_LevelCacheKey(rjkey);
+
+	if (RJ_LoadCache()) {
+		rjsource = RJ_CACHED;
+		return;
+	}
+
+	rjwork = RJ_SetupWork();
+	rjsource = RJ_BUILDING;
+	rjstarttime = I_GetTimeNS();
+
+	if (!(rjthread = SDL_CreateThread(RJ_Thread, "RejectBuilder", rjwork))) {
+		RJ_Build(rjwork);
+		RJ_Finish();
+	}
+}
+
+//
+// P_PrintSightStats
+//
+
+void P_PrintSightStats(void) {
+	int total = sightcounts[0] + sightcounts[1];
+
+	CON_Printf(GREEN, "Reject: %s\n", rjsourcenames[rjsource]);
+
+	if (rjsource == RJ_BUILT) {
+		CON_Printf(AQUA, "built in %.1fms, %i of %i sectors fell back to connectivity\n",
+			(double)rjbuildtime / 1000000.0, rjfallbacks, numsectors);
+	}
+
+	if (!total) {
+		CON_Printf(WHITE, "No sight checks this level\n");
+		return;
+	}
+
+	CON_Printf(WHITE, "%i sight checks, %i rejected (%.1f%%)\n",
+		total, sightcounts[0], 100.0 * sightcounts[0] / total);
+}
@@ -0,0 +1,33 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __P_REJECT__
+#define __P_REJECT__
+
+#include "doomtype.h"
+
+// Call after P_LoadReject while the map lumps are still cached.
+void P_InitReject(void);
+
+// Installs a finished background build; call once per tic.
+void P_UpdateReject(void);
+
+// Cancels any build in progress; call before the level is freed.
+void P_StopReject(void);
+
+void P_PrintSightStats(void);
+
+#endif
@@ -36,8 +36,20 @@
 
 #include "d_englsh.h"
 #include "m_misc.h"
+#include "am_draw.h"
+#include "am_map.h"
+#include "m_random.h"
+#include "s_sound.h"
+#include "p_setup.h"
+#include "p_reject.h"
+#include "p_tick.h"
+#include "con_console.h"
+#include "con_cvar.h"
 #include "doomdef.h" // added just so MSVC would shut up about warning C4761
 
+CVAR_EXTERNAL(p_rewind);
+CVAR_EXTERNAL(p_rewindinterval);
+
 void G_DoLoadLevel(void);
 
 //
@@ -47,9 +59,13 @@ void G_DoLoadLevel(void);
 #define SAVEGAME_EOF    0x464F45
 #define SAVEGAME_MOBJ   0x4A424F4D
 
-static FILE* save_stream;
 static byte* savebuffer;
 
+// archives are always built here first; the file path flushes
+// it with one fwrite and snapshots copy it out
+static byte* save_mem;
+static int   save_memsize = 0;
+
 static uint64_t save_offset = 0;
 
 //
@@ -79,8 +95,12 @@ static byte saveg_read8(void) {
 }
 
 static void saveg_write8(byte value) {
-    fwrite(&value, 1, 1, save_stream);
-    save_offset++;
+    if (save_offset >= (uint64_t)save_memsize) {
+        save_memsize = save_memsize ? save_memsize * 2 : SAVEGAMESIZE;
+        save_mem = Z_Realloc(save_mem, save_memsize, PU_STATIC, NULL);
+    }
+
+    save_mem[save_offset++] = value;
 }
 
 static short saveg_read16(void) {
@@ -323,9 +343,10 @@ static void saveg_write_mobj_t(mobj_t* mo) {
     saveg_write32(mo->player ? mo->player - players + 1 : 0);
     saveg_write_mapthing_t(&mo->spawnpoint);
     saveg_write_mobjindex(mo->tracer);
-    saveg_write32(mo->frame_x);
-    saveg_write32(mo->frame_y);
-    saveg_write32(mo->frame_z);
+    // former frame_x/y/z slots, kept so the format doesn't change
+    saveg_write32(mo->x);
+    saveg_write32(mo->y);
+    saveg_write32(mo->z);
     saveg_write32(mo->mobjfunc == P_RespawnSpecials ? 1 : 0);
 }
 
@@ -373,9 +394,10 @@ static void saveg_read_mobj_t(mobj_t* mo) {
 
     saveg_set_mobjtarget(&mo->tracer, saveg_read_mobjindex());
 
-    mo->frame_x = saveg_read32();
-    mo->frame_y = saveg_read32();
-    mo->frame_z = saveg_read32();
+    // former frame_x/y/z slots
+    saveg_read32();
+    saveg_read32();
+    saveg_read32();
     mo->mobjfunc = saveg_read32() ? P_RespawnSpecials : NULL;
 }
 
@@ -393,8 +415,9 @@ static void saveg_read_pspdef_t(pspdef_t* psp) {
     psp->sx = saveg_read32();
     psp->sy = saveg_read32();
     psp->alpha = saveg_read32();
-    psp->frame_x = saveg_read32();
-    psp->frame_y = saveg_read32();
+    // former frame_x/y slots
+    saveg_read32();
+    saveg_read32();
 }
 
 static void saveg_write_pspdef_t(pspdef_t* psp) {
@@ -403,8 +426,9 @@ static void saveg_write_pspdef_t(pspdef_t* psp) {
     saveg_write32(psp->sx);
     saveg_write32(psp->sy);
     saveg_write32(psp->alpha);
-    saveg_write32(psp->frame_x);
-    saveg_write32(psp->frame_y);
+    // former frame_x/y slots, kept so the format doesn't change
+    saveg_write32(psp->sx);
+    saveg_write32(psp->sy);
 }
 
 //
@@ -1069,7 +1093,7 @@ static char* saveg_gettime(void) {
     return asctime(lt);
 }
 
-static void saveg_write_header(char* description) {
+static void saveg_write_header(char* description, boolean snapshot) {
     int i;
     int size;
     char date[32];
@@ -1083,26 +1107,37 @@ static void saveg_write_header(char* description) {
         saveg_write8(0);
     }
 
-    sprintf(date, "%s", saveg_gettime());
-    size = dstrlen(date);
+    // snapshots leave out the date and thumbnail so two captures
+    // of the same world are byte-identical (and no glReadPixels)
+    if (snapshot) {
+        for (i = 0; i < 32; i++) {
+            saveg_write8(0);
+        }
 
-    for (i = 0; i < size; i++) {
-        saveg_write8(date[i]);
+        saveg_write32(0);
     }
+    else {
+        sprintf(date, "%s", saveg_gettime());
+        size = dstrlen(date);
 
-    for (; i < 32; i++) {
-        saveg_write8(0);
-    }
+        for (i = 0; i < size; i++) {
+            saveg_write8(date[i]);
+        }
 
-    size = M_CacheThumbNail(&tbn);
+        for (; i < 32; i++) {
+            saveg_write8(0);
+        }
 
-    saveg_write32(size);
+        size = M_CacheThumbNail(&tbn);
 
-    for (i = 0; i < size; i++) {
-        saveg_write8(tbn[i]);
-    }
+        saveg_write32(size);
+
+        for (i = 0; i < size; i++) {
+            saveg_write8(tbn[i]);
+        }
 
-    Z_Free(tbn);
+        Z_Free(tbn);
+    }
 
     for (i = 0; i < 16; i++) {
         saveg_write8(passwordData[i]);
@@ -1200,24 +1235,15 @@ static void saveg_write_marker(int marker) {
 }
 
 //
-// P_WriteSaveGame
+// saveg_write_game
+// Archives the whole game into save_mem; snapshots also
+// carry the random indices so a restore replays exactly
 //
 
-boolean P_WriteSaveGame(char* description, int slot) {
-
-    // setup game save file
-    char *filename = P_GetSaveGameName(slot);
-    save_stream = fopen(filename, "wb");
-    free(filename);
-
-    // success?
-    if (save_stream == NULL) {
-        return false;
-    }
-
+static void saveg_write_game(char* description, boolean snapshot) {
     save_offset = 0;
 
-    saveg_write_header(description);
+    saveg_write_header(description, snapshot);
 
     P_ArchiveMobjs();
     P_ArchivePlayers();
@@ -1225,20 +1251,20 @@ boolean P_WriteSaveGame(char* description, int slot) {
     P_ArchiveSpecials();
     P_ArchiveMacros();
 
-    saveg_write_marker(SAVEGAME_EOF);
-
-    // close out file
-    fclose(save_stream);
+    if (snapshot) {
+        saveg_write8(prndindex);
+        saveg_write8(rndindex);
+    }
 
-    return true;
+    saveg_write_marker(SAVEGAME_EOF);
 }
 
 //
-// P_ReadSaveGame
+// saveg_read_game
+// Rebuilds the level from savebuffer
 //
 
-boolean P_ReadSaveGame(char* name) {
-    M_ReadFile(name, &savebuffer);
+static void saveg_read_game(boolean snapshot) {
     save_offset = 0;
 
     saveg_read_header();
@@ -1253,11 +1279,56 @@ boolean P_ReadSaveGame(char* name) {
     P_UnArchiveSpecials();
     P_UnArchiveMacros();
 
+    if (snapshot) {
+        prndindex = saveg_read8();
+        rndindex = saveg_read8();
+    }
+
     if (!saveg_read_marker(SAVEGAME_EOF)) {
         I_Error("Bad savegame");
     }
+}
+
+//
+// P_WriteSaveGame
+//
+
+boolean P_WriteSaveGame(char* description, int slot) {
+    FILE* save_stream;
+    char* filename;
+    boolean ok;
+
+    saveg_write_game(description, false);
+
+    // setup game save file
+    filename = P_GetSaveGameName(slot);
+    save_stream = fopen(filename, "wb");
+    free(filename);
+
+    // success?
+    if (save_stream == NULL) {
+        return false;
+    }
+
+    ok = (fwrite(save_mem, 1, (size_t)save_offset, save_stream) == save_offset);
+
+    // close out file
+    fclose(save_stream);
+
+    return ok;
+}
+
+//
+// P_ReadSaveGame
+//
+
+boolean P_ReadSaveGame(char* name) {
+    M_ReadFile(name, &savebuffer);
+
+    saveg_read_game(false);
 
     Z_Free(savebuffer);
+    savebuffer = NULL;
 
     return true;
 }
@@ -1305,6 +1376,325 @@ boolean P_QuickReadSaveHeader(char* name, char* date,
     return 1;
 }
 
+//------------------------------------------------------------------------
+//
+// In-memory snapshots
+//
+// The same archive as a savegame, kept in a zone buffer. A ring
+// of them is captured every p_rewindinterval tics while p_rewind
+// is set, and any of them can be restored without touching disk.
+//
+//------------------------------------------------------------------------
+
+#define MAXSNAPSHOTS    64
+
+typedef struct {
+    byte*       data;
+    int         size;
+    int         map;
+    int         leveltime;
+    uint64_t    capturens;
+} savesnapshot_t;
+
+static savesnapshot_t   snapshotring[MAXSNAPSHOTS];
+static int              snapshotslots = 0;
+static int              snapshothead = 0;   // next slot to write
+static int              snapshotcount = 0;
+static boolean          snapshotbusy = false;
+
+//
+// saveg_capture
+//
+
+static void saveg_capture(savesnapshot_t* snap) {
+    uint64_t start = I_GetTimeNS();
+
+    snap->size = P_SaveSnapshot(&snap->data);
+    snap->map = gamemap;
+    snap->leveltime = leveltime;
+    snap->capturens = I_GetTimeNS() - start;
+}
+
+//
+// P_SaveSnapshot
+// Archives the game into *buffer (PU_STATIC, reallocated to fit)
+// and returns its size
+//
+
+int P_SaveSnapshot(byte** buffer) {
+    saveg_write_game("snapshot", true);
+
+    *buffer = Z_Realloc(*buffer, (int)save_offset, PU_STATIC, NULL);
+    dmemcpy(*buffer, save_mem, (size_t)save_offset);
+
+    return (int)save_offset;
+}
+
+//
+// P_LoadSnapshot
+// Tears the level down the way P_Stop does and loads
+// the snapshot back through the savegame path
+//
+
+void P_LoadSnapshot(byte* buffer) {
+    boolean playback = demoplayback;
+    boolean user = usergame;
+
+    S_StopPlasmaGunLoop();
+
+    if (automapactive) {
+        AM_Stop();
+    }
+
+    P_StopReject();
+    Z_FreeTags(PU_LEVEL, PU_PURGELEVEL - 1);
+    S_ResetSound();
+
+    // keeps P_SetupLevel from resetting the stats and leveltime
+    gameaction = ga_loadgame;
+
+    savebuffer = buffer;
+    saveg_read_game(true);
+    savebuffer = NULL;
+
+    // G_InitNew starts a fresh user game; a demo seek is still a demo
+    demoplayback = playback;
+    usergame = user;
+
+    S_StartMusic(P_GetMapInfo(gamemap)->music);
+}
+
+//
+// saveg_free_snapshot
+//
+
+static void saveg_free_snapshot(savesnapshot_t* snap) {
+    if (snap->data) {
+        Z_Free(snap->data);
+    }
+
+    dmemset(snap, 0, sizeof(*snap));
+}
+
+//
+// saveg_can_rewind
+//
+
+static boolean saveg_can_rewind(void) {
+    if (gamestate != GS_LEVEL) {
+        CON_Printf(WHITE, "Not in a level\n");
+        return false;
+    }
+
+    if (netgame || demoplayback || demorecording) {
+        CON_Printf(WHITE, "Not available in netgames or demos\n");
+        return false;
+    }
+
+    return true;
+}
+
+//
+// P_ClearRewind
+//
+
+void P_ClearRewind(void) {
+    int i;
+
+    for (i = 0; i < MAXSNAPSHOTS; i++) {
+        saveg_free_snapshot(&snapshotring[i]);
+    }
+
+    snapshothead = snapshotcount = 0;
+}
+
+//
+// P_RewindTicker
+// Called after each tic; captures into the ring on the interval
+//
+
+void P_RewindTicker(void) {
+    static int lastcapture = -1;
+    int slots;
+    int interval;
+
+    slots = (int)p_rewind.value;
+    slots = slots < 0 ? 0 : (slots > MAXSNAPSHOTS ? MAXSNAPSHOTS : slots);
+
+    if (slots != snapshotslots) {
+        P_ClearRewind();
+        snapshotslots = slots;
+    }
+
+    if (!snapshotslots || snapshotbusy || netgame || demoplayback) {
+        return;
+    }
+
+    interval = MAX((int)p_rewindinterval.value, 1);
+
+    // nothing ran this tic (paused or in a menu)
+    if (leveltime == lastcapture || leveltime % interval) {
+        return;
+    }
+
+    lastcapture = leveltime;
+
+    saveg_capture(&snapshotring[snapshothead]);
+    snapshothead = (snapshothead + 1) % snapshotslots;
+
+    if (snapshotcount < snapshotslots) {
+        snapshotcount++;
+    }
+}
+
+//
+// P_PrintRewind
+//
+
+void P_PrintRewind(void) {
+    savesnapshot_t* snap;
+    int i;
+    int total = 0;
+
+    if (!snapshotcount) {
+        CON_Printf(WHITE, "No snapshots (set p_rewind to the ring size)\n");
+        return;
+    }
+
+    CON_Printf(GREEN, "Snapshots (%i of %i, every %i tics):\n",
+        snapshotcount, snapshotslots, MAX((int)p_rewindinterval.value, 1));
+
+    for (i = 1; i <= snapshotcount; i++) {
+        snap = &snapshotring[(snapshothead - i + snapshotslots) % snapshotslots];
+        total += snap->size;
+
+        CON_Printf(WHITE, "%2i: map %02i %4i:%02i  %6i kb  %.3f ms\n",
+            i, snap->map, snap->leveltime / (TICRATE * 60),
+            (snap->leveltime / TICRATE) % 60, snap->size >> 10,
+            (double)snap->capturens / 1000000.0);
+    }
+
+    CON_Printf(AQUA, "%i kb held\n", total >> 10);
+}
+
+//
+// P_Rewind
+// Restores the snapshot 'back' captures ago (1 is the newest)
+// and drops everything newer than it
+//
+
+void P_Rewind(int back) {
+    savesnapshot_t* snap;
+    uint64_t start;
+    int i;
+
+    if (!saveg_can_rewind()) {
+        return;
+    }
+
+    if (back < 1 || back > snapshotcount) {
+        CON_Printf(WHITE, "No snapshot %i (%i held)\n", back, snapshotcount);
+        return;
+    }
+
+    for (i = 1; i < back; i++) {
+        snapshothead = (snapshothead - 1 + snapshotslots) % snapshotslots;
+        saveg_free_snapshot(&snapshotring[snapshothead]);
+    }
+
+    snapshotcount -= back - 1;
+    snap = &snapshotring[(snapshothead - 1 + snapshotslots) % snapshotslots];
+
+    start = I_GetTimeNS();
+    P_LoadSnapshot(snap->data);
+
+    CON_Printf(GREEN, "Rewound to map %02i tic %i (%i kb) in %.3f ms\n",
+        snap->map, snap->leveltime, snap->size >> 10,
+        (double)(I_GetTimeNS() - start) / 1000000.0);
+}
+
+//
+// P_RewindCheck
+// Snapshots, runs some tics, restores and runs them again;
+// both runs must leave a byte-identical archive
+//
+
+void P_RewindCheck(int tics) {
+    savesnapshot_t base;
+    savesnapshot_t first;
+    savesnapshot_t second;
+    uint64_t start;
+    uint64_t restorens;
+    int i;
+    int diff;
+
+    if (!saveg_can_rewind()) {
+        return;
+    }
+
+    if (tics <= 0) {
+        tics = 10 * TICRATE;
+    }
+
+    dmemset(&base, 0, sizeof(base));
+    dmemset(&first, 0, sizeof(first));
+    dmemset(&second, 0, sizeof(second));
+
+    snapshotbusy = true;
+
+    saveg_capture(&base);
+
+    for (i = 0; i < tics; i++) {
+        P_Ticker();
+    }
+
+    saveg_capture(&first);
+
+    if (first.leveltime == base.leveltime) {
+        CON_Printf(WHITE, "rewindcheck: no tics ran (game is paused)\n");
+    }
+
+    start = I_GetTimeNS();
+    P_LoadSnapshot(base.data);
+    restorens = I_GetTimeNS() - start;
+
+    for (i = 0; i < tics; i++) {
+        P_Ticker();
+    }
+
+    saveg_capture(&second);
+
+    snapshotbusy = false;
+
+    CON_Printf(WHITE, "capture %.3f ms (%i kb), restore %.3f ms\n",
+        (double)base.capturens / 1000000.0, base.size >> 10,
+        (double)restorens / 1000000.0);
+
+    diff = -1;
+    for (i = 0; i < MIN(first.size, second.size); i++) {
+        if (first.data[i] != second.data[i]) {
+            diff = i;
+            break;
+        }
+    }
+
+    if (diff == -1 && first.size != second.size) {
+        diff = MIN(first.size, second.size);
+    }
+
+    if (diff == -1) {
+        CON_Printf(GREEN, "rewindcheck: %i tics replayed identically\n", tics);
+    }
+    else {
+        CON_Warnf("rewindcheck: runs diverge at byte %i of %i after %i tics\n",
+            diff, first.size, tics);
+    }
+
+    saveg_free_snapshot(&base);
+    saveg_free_snapshot(&first);
+    saveg_free_snapshot(&second);
+}
+
 
 //
 // P_ArchivePlayers
@@ -1458,6 +1848,8 @@ void P_UnArchiveWorld(void) {
         }
     }
 
+    AM_InvalidateLines();
+
     // do lights
     for (i = 0, light = lights; i < numlights; i++, light++) {
         light->base_r = saveg_read8();
@@ -1535,29 +1927,7 @@ void P_UnArchiveMobjs(void) {
 }
 
 
-enum {
-    tc_ceiling,
-    tc_door,
-    tc_floor,
-    tc_plat,
-    tc_flash,
-    tc_strobe,
-    tc_glow,
-    tc_flicker,
-    tc_delay,
-    tc_aimcam,
-    tc_movecam,
-    tc_fade,
-    tc_sequence,
-    tc_quake,
-    tc_combine,
-    tc_laser,
-    tc_split,
-    tc_morph,
-    tc_exp,
-    tc_endthinkers
-};
-
+// indexed by thinker class
 struct {
     actionf_p1 function;
     int     type;
@@ -1734,14 +2104,15 @@ void P_ArchiveSpecials(void) {
     int         i;
 
     for (th = thinkercap.next; th != &thinkercap; th = th->next) {
-        if (th->function.acv == (actionf_v)NULL) {
-            for (i = 0; i < MAXCEILINGS; i++) {
-                if (activeceilings[i] == (ceiling_t*)th) {
-                    break;
-                }
-            }
+        // removed, or a class that is never archived
+        if (!th->cnext || th->tclass >= tc_endthinkers) {
+            continue;
+        }
 
-            if (i < MAXCEILINGS) {
+        // a NULL function is a ceiling in stasis; those are
+        // always in activeceilings
+        if (th->function.acv == (actionf_v)NULL) {
+            if (th->tclass == tc_ceiling) {
                 saveg_write8(tc_ceiling);
                 saveg_write_ceiling_t((ceiling_t*)th);
             }
@@ -1749,13 +2120,11 @@ void P_ArchiveSpecials(void) {
             continue;
         }
 
-        for (i = 0; saveg_specials[i].type != tc_endthinkers; i++) {
-            if (th->function.acp1 == (actionf_p1)saveg_specials[i].function) {
-                saveg_write8(saveg_specials[i].type);
-                saveg_specials[i].writefunc(th);
-                saveg_write32(th == macrothinker ? 1 : 0);
-                break;
-            }
+        i = th->tclass;
+        if (th->function.acp1 == (actionf_p1)saveg_specials[i].function) {
+            saveg_write8(saveg_specials[i].type);
+            saveg_specials[i].writefunc(th);
+            saveg_write32(th == macrothinker ? 1 : 0);
         }
     }
 
@@ -1785,6 +2154,7 @@ void P_UnArchiveSpecials(void) {
     }
 
     thinkercap.prev = thinkercap.next = &thinkercap;
+    P_InitThinkerClasses();
 
     while (1) {
         tclass = saveg_read8();
@@ -1797,48 +2167,43 @@ void P_UnArchiveSpecials(void) {
             I_Error("P_UnarchiveSpecials: Unknown tclass %i in savegame", tclass);
         }
 
-        for (i = 0; saveg_specials[i].type != tc_endthinkers; i++) {
-            if (tclass == saveg_specials[i].type) {
-                thinker = Z_Malloc(saveg_specials[i].structsize, PU_LEVEL, NULL);
-                saveg_specials[i].readfunc(thinker);
-
-                ((thinker_t*)thinker)->function.acp1 = (actionf_p1)saveg_specials[i].function;
-                P_AddThinker(thinker);
-
-                // handle special cases
-                switch (tclass) {
-                case tc_ceiling:
-                    specialthinker = saveg_read32();
-                    if (!specialthinker) {
-                        ((thinker_t*)thinker)->function.acp1 = NULL;
-                    }
-
-                    P_AddActiveCeiling(thinker);
-                    break;
-
-                case tc_plat:
-                    specialthinker = saveg_read32();
-                    if (!specialthinker) {
-                        ((thinker_t*)thinker)->function.acp1 = NULL;
-                    }
-
-                    P_AddActivePlat(thinker);
-                    break;
-
-                case tc_combine:
-                    P_CombineLightSpecials(((combine_t*)thinker)->sector);
-                    P_RemoveThinker(thinker);
-                    break;
-                }
-
-                if (((thinker_t*)thinker)->function.acp1 != NULL) {
-                    specialthinker = saveg_read32();
-                    if (specialthinker) {
-                        macrothinker = (thinker_t*)thinker;
-                    }
-                }
-
-                break;
+        i = tclass;
+        thinker = Z_Malloc(saveg_specials[i].structsize, PU_LEVEL, NULL);
+        saveg_specials[i].readfunc(thinker);
+
+        ((thinker_t*)thinker)->function.acp1 = (actionf_p1)saveg_specials[i].function;
+        P_AddThinker(thinker, tclass);
+
+        // handle special cases
+        switch (tclass) {
+        case tc_ceiling:
+            specialthinker = saveg_read32();
+            if (!specialthinker) {
+                ((thinker_t*)thinker)->function.acp1 = NULL;
+            }
+
+            P_AddActiveCeiling(thinker);
+            break;
+
+        case tc_plat:
+            specialthinker = saveg_read32();
+            if (!specialthinker) {
+                ((thinker_t*)thinker)->function.acp1 = NULL;
+            }
+
+            P_AddActivePlat(thinker);
+            break;
+
+        case tc_combine:
+            P_CombineLightSpecials(((combine_t*)thinker)->sector);
+            P_RemoveThinker(thinker);
+            break;
+        }
+
+        if (((thinker_t*)thinker)->function.acp1 != NULL) {
+            specialthinker = saveg_read32();
+            if (specialthinker) {
+                macrothinker = (thinker_t*)thinker;
             }
         }
     }
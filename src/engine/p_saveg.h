@@ -31,6 +31,15 @@ boolean P_WriteSaveGame(char* description, int slot);
 boolean P_ReadSaveGame(char* name);
 boolean P_QuickReadSaveHeader(char* name, char* date, int* thumbnail, int* skill, int* map);
 
+// In-memory save snapshots and the rewind ring
+int P_SaveSnapshot(byte** buffer);
+void P_LoadSnapshot(byte* buffer);
+void P_ClearRewind(void);
+void P_RewindTicker(void);
+void P_PrintRewind(void);
+void P_Rewind(int back);
+void P_RewindCheck(int tics);
+
 // Persistent storage/archiving.
 // These are the load / save game routines.
 void P_ArchivePlayers(void);
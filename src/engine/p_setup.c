@@ -36,6 +36,9 @@
 #include "doomstat.h"
 #include "t_bsp.h"
 #include "p_macros.h"
+#include "p_snapshot.h"
+#include "p_levelcache.h"
+#include "p_reject.h"
 #include "info.h"
 #include "m_misc.h"
 #include "tables.h"
@@ -98,6 +101,15 @@ CVAR(p_fdoubleclick, 0);
 CVAR(p_sdoubleclick, 0);
 CVAR(p_usecontext, 0);
 CVAR(p_damageindicator, 0);
+CVAR(p_loadtimes, 0);
+CVAR(p_blockmapcell, 128);
+CVAR(p_levelcache, 1);
+CVAR(p_buildreject, 1);
+CVAR(p_rewind, 0);
+CVAR(p_rewindinterval, 30);
+CVAR(p_statehash, 0);
+CVAR(p_hashinterval, 1);
+CVAR(p_demokeyframes, 300);
 
 //
 // [kex] sky definition stuff
@@ -116,9 +128,14 @@ static skydef_t* skydefs;
 // Blockmap size.
 int                 bmapwidth;
 int                 bmapheight;     // size in mapblocks
-uint16_t* blockmap;       // int for larger maps
-// offsets in blockmap are from here
-uint16_t* blockmaplump;
+// line cells; may be finer than the mapblocks used for things
+int                 lmapwidth;
+int                 lmapheight;
+int                 lmapshift;
+// cell n lists blockmaplump[blockmap[n]] .. blockmaplump[blockmap[n + 1] - 1]
+int32_t* blockmap;
+// line numbers, ascending within each cell
+int32_t* blockmaplump;
 // origin of block map
 fixed_t             bmaporgx;
 fixed_t             bmaporgy;
@@ -316,10 +333,6 @@ void P_LoadSectors(int lump) {
 
 		ss->tag = SHORT(ms->tag);
 		ss->thinglist = NULL;
-		ss->frame_z1[0] = ss->floorheight;
-		ss->frame_z1[1] = ss->floorheight;
-		ss->frame_z2[0] = ss->ceilingheight;
-		ss->frame_z2[1] = ss->ceilingheight;
 
 		for (j = 0; j < numskydef; j++) {
 			if (ss->ceilingpic == (W_GetNumForName(skydefs[j].flat) - t_start)) {
@@ -750,40 +763,284 @@ void P_LoadReject(int lump) {
 	dmemcpy(rejectmatrix, (byte*)W_GetMapLump(lump), size);
 }
 
+//
+// P_LineCellShift
+// Line cell size for the next blockmap build; fixed for netgames and
+// demos, since it changes the order PIT_CheckLine sees lines in
+//
+
+int P_LineCellShift(void) {
+	int cellsize = (int)p_blockmapcell.value;
+	int shift = FRACBITS;
+
+	if (netgame || demoplayback || demorecording ||
+		(cellsize != 32 && cellsize != 64)) {
+		cellsize = MAPBLOCKUNITS;
+	}
+
+	while ((1 << (shift - FRACBITS)) < cellsize) {
+		shift++;
+	}
+
+	return shift;
+}
+
 //
 // P_LoadBlockMap
+// Builds the line blockmap from the linedefs with 32 bit offsets,
+// so large maps can't overflow it
 //
 
 static void P_LoadBlockMap(void) {
-	int32_t	count;
-	int32_t	i;
-	int32_t length;
-	byte* src;
+	fixed_t box[4];
+	int32_t* fill;
+	int numcells;
+	int total;
+	int pass;
+	int i;
+	int x;
+	int y;
+	int count_size;
+
+	//
+	// the lump is only read for its origin, so mapblocks line up with
+	// the ones the map was built with; contents come from the lines
+	//
+	M_ClearBox(box);
+
+	// not M_AddToBox, which can miss the first vertex's maximum
+	for (i = 0; i < numvertexes; i++) {
+		box[BOXLEFT] = MIN(box[BOXLEFT], vertexes[i].x);
+		box[BOXRIGHT] = MAX(box[BOXRIGHT], vertexes[i].x);
+		box[BOXBOTTOM] = MIN(box[BOXBOTTOM], vertexes[i].y);
+		box[BOXTOP] = MAX(box[BOXTOP], vertexes[i].y);
+	}
+
+	if (W_MapLumpLength(ML_BLOCKMAP) >= 8) {
+		int16_t* header = (int16_t*)W_GetMapLump(ML_BLOCKMAP);
+
+		bmaporgx = SHORT(header[0]) << FRACBITS;
+		bmaporgy = SHORT(header[1]) << FRACBITS;
+	}
+	else {
+		bmaporgx = (box[BOXLEFT] >> FRACBITS) << FRACBITS;
+		bmaporgy = (box[BOXBOTTOM] >> FRACBITS) << FRACBITS;
+	}
+
+	bmaporgx = MIN(bmaporgx, box[BOXLEFT]);
+	bmaporgy = MIN(bmaporgy, box[BOXBOTTOM]);
+	bmapwidth = ((box[BOXRIGHT] - bmaporgx) >> MAPBLOCKSHIFT) + 1;
+	bmapheight = ((box[BOXTOP] - bmaporgy) >> MAPBLOCKSHIFT) + 1;
+
+	lmapshift = P_LineCellShift();
+
+	lmapwidth = bmapwidth << (MAPBLOCKSHIFT - lmapshift);
+	lmapheight = bmapheight << (MAPBLOCKSHIFT - lmapshift);
+	numcells = lmapwidth * lmapheight;
+
+	//
+	// count, then fill; lines are visited in order so every cell
+	// comes out sorted and without duplicates
+	//
+	count_size = sizeof(*blockmap) * (numcells + 1);
+	blockmap = Z_Malloc(count_size, PU_LEVEL, 0);
+	// per cell line counts on the first pass, write positions on the second
+	fill = Z_Malloc(count_size, PU_STATIC, 0);
+	memset(fill, 0, count_size);
+
+	blockmaplump = NULL;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < numlines; i++) {
+			line_t* ld = &lines[i];
+			int64_t x1 = (int64_t)ld->v1->x - bmaporgx;
+			int64_t y1 = (int64_t)ld->v1->y - bmaporgy;
+			int64_t dx = ld->dx;
+			int64_t dy = ld->dy;
+			int xl = (ld->bbox[BOXLEFT] - bmaporgx) >> lmapshift;
+			int xh = (ld->bbox[BOXRIGHT] - bmaporgx) >> lmapshift;
+			int yl = (ld->bbox[BOXBOTTOM] - bmaporgy) >> lmapshift;
+			int yh = (ld->bbox[BOXTOP] - bmaporgy) >> lmapshift;
+
+			for (y = yl; y <= yh; y++) {
+				for (x = xl; x <= xh; x++) {
+					// in fixed point, padded by a unit so lines grazing
+					// a corner stay in both cells; corners lie within a
+					// cell of the line's bbox, so the products fit
+					int64_t cx1 = ((int64_t)x << lmapshift) - FRACUNIT;
+					int64_t cy1 = ((int64_t)y << lmapshift) - FRACUNIT;
+					int64_t cx2 = cx1 + ((int64_t)1 << lmapshift) + 2 * FRACUNIT;
+					int64_t cy2 = cy1 + ((int64_t)1 << lmapshift) + 2 * FRACUNIT;
+					int64_t s1, s2, s3, s4;
+
+					// skip cells the line's bbox touches but the line misses
+					if (xl != xh && yl != yh) {
+						s1 = (cx1 - x1) * dy - (cy1 - y1) * dx;
+						s2 = (cx2 - x1) * dy - (cy1 - y1) * dx;
+						s3 = (cx1 - x1) * dy - (cy2 - y1) * dx;
+						s4 = (cx2 - x1) * dy - (cy2 - y1) * dx;
+
+						if ((s1 > 0 && s2 > 0 && s3 > 0 && s4 > 0) ||
+							(s1 < 0 && s2 < 0 && s3 < 0 && s4 < 0)) {
+							continue;
+						}
+					}
+
+					if (pass == 0) {
+						fill[y * lmapwidth + x]++;
+					}
+					else {
+						blockmaplump[fill[y * lmapwidth + x]++] = i;
+					}
+				}
+			}
+		}
 
-	length = W_MapLumpLength(ML_BLOCKMAP);
-	count = length / 2 >= 0x10000;
+		if (pass == 0) {
+			total = 0;
+			for (i = 0; i < numcells; i++) {
+				blockmap[i] = total;
+				total += fill[i];
+			}
 
-	blockmaplump = Z_Malloc(sizeof(*blockmaplump) * length, PU_LEVEL, 0);
-	blockmap = blockmaplump + 4;//skip blockmap header
+			blockmap[numcells] = total;
+			blockmaplump = Z_Malloc(sizeof(*blockmaplump) * MAX(total, 1), PU_LEVEL, 0);
+			memcpy(fill, blockmap, count_size);
+		}
+	}
 
-	src = W_GetMapLump(ML_BLOCKMAP);
-	memmove(blockmaplump, src, length);
+	Z_Free(fill);
+}
 
-	for (i = 4; i < count; i++)
-	{
-		int32_t t = (int32_t)SHORT(blockmaplump[i]);
-		blockmaplump[i] = (t == -1) ? -1l : (int32_t)t & 0xffff;
+//
+// P_LineCrossesBox
+// Clips the line to the box; true if any of it is left
+//
+
+static boolean P_LineCrossesBox(double x1, double y1, double dx, double dy,
+	double left, double bottom, double right, double top) {
+	double p[4];
+	double q[4];
+	double t0 = 0;
+	double t1 = 1;
+	int k;
+
+	p[0] = -dx; q[0] = x1 - left;
+	p[1] = dx;  q[1] = right - x1;
+	p[2] = -dy; q[2] = y1 - bottom;
+	p[3] = dy;  q[3] = top - y1;
+
+	for (k = 0; k < 4; k++) {
+		double r;
+
+		if (p[k] == 0) {
+			if (q[k] < 0) {
+				return false;
+			}
+
+			continue;
+		}
+
+		r = q[k] / p[k];
+
+		if (p[k] < 0) {
+			t0 = MAX(t0, r);
+		}
+		else {
+			t1 = MIN(t1, r);
+		}
+
+		if (t0 > t1) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//
+// P_CheckBlockMap
+// -checkblockmap: every cell a line passes through must list it, and
+// no cell outside a line's bbox may; done apart from P_LoadBlockMap's
+// side test, in floating point on the exact vertex positions
+//
+
+static void P_CheckBlockMap(void) {
+	double cellsize = (double)(1 << lmapshift) / FRACUNIT;
+	int missing = 0;
+	int stray = 0;
+	int i;
+	int j;
+	int x;
+	int y;
+
+	for (i = 0; i < numlines; i++) {
+		line_t* ld = &lines[i];
+		double x1 = ((double)ld->v1->x - bmaporgx) / FRACUNIT;
+		double y1 = ((double)ld->v1->y - bmaporgy) / FRACUNIT;
+		double dx = (double)ld->dx / FRACUNIT;
+		double dy = (double)ld->dy / FRACUNIT;
+		int xl = (ld->bbox[BOXLEFT] - bmaporgx) >> lmapshift;
+		int xh = (ld->bbox[BOXRIGHT] - bmaporgx) >> lmapshift;
+		int yl = (ld->bbox[BOXBOTTOM] - bmaporgy) >> lmapshift;
+		int yh = (ld->bbox[BOXTOP] - bmaporgy) >> lmapshift;
+
+		for (y = yl; y <= yh; y++) {
+			for (x = xl; x <= xh; x++) {
+				int n = y * lmapwidth + x;
+
+				if (!P_LineCrossesBox(x1, y1, dx, dy, x * cellsize, y * cellsize,
+					(x + 1) * cellsize, (y + 1) * cellsize)) {
+					continue;
+				}
+
+				for (j = blockmap[n]; j < blockmap[n + 1]; j++) {
+					if (blockmaplump[j] == i) {
+						break;
+					}
+				}
+
+				if (j == blockmap[n + 1] && missing++ < 8) {
+					CON_Warnf("P_CheckBlockMap: line %i missing from cell %i,%i\n", i, x, y);
+				}
+			}
+		}
+	}
+
+	for (i = 0; i < lmapwidth * lmapheight; i++) {
+		x = i % lmapwidth;
+		y = i / lmapwidth;
+
+		for (j = blockmap[i]; j < blockmap[i + 1]; j++) {
+			line_t* ld = &lines[blockmaplump[j]];
+
+			if (x < (ld->bbox[BOXLEFT] - bmaporgx) >> lmapshift ||
+				x > (ld->bbox[BOXRIGHT] - bmaporgx) >> lmapshift ||
+				y < (ld->bbox[BOXBOTTOM] - bmaporgy) >> lmapshift ||
+				y > (ld->bbox[BOXTOP] - bmaporgy) >> lmapshift) {
+				stray++;
+			}
+		}
+	}
+
+	if (missing || stray) {
+		I_Error("P_CheckBlockMap: %i missing and %i stray line cells", missing, stray);
 	}
 
-	bmaporgx = SHORT(blockmaplump[0]) << FRACBITS;
-	bmaporgy = SHORT(blockmaplump[1]) << FRACBITS;
-	bmapwidth = SHORT(blockmaplump[2]);
-	bmapheight = SHORT(blockmaplump[3]);
+	CON_Printf(GREEN, "P_CheckBlockMap: %i lines in %i cells of %i units OK\n",
+		numlines, lmapwidth * lmapheight, (int)cellsize);
+}
+
+//
+// P_InitBlockLinks
+// Clears out the mobj chains
+//
+
+static void P_InitBlockLinks(void) {
+	int size = sizeof(*blocklinks) * bmapwidth * bmapheight;
 
-	// clear out mobj chains
-	count = sizeof(*blocklinks) * bmapwidth * bmapheight;
-	blocklinks = Z_Malloc(count, PU_LEVEL, 0);
-	memset(blocklinks, 0, count);
+	blocklinks = Z_Malloc(size, PU_LEVEL, 0);
+	memset(blocklinks, 0, size);
 }
 
 //
@@ -794,6 +1051,7 @@ static void P_LoadBlockMap(void) {
 
 void P_GroupLines(void) {
 	line_t** linebuffer;
+	line_t*** fill;
 	int                 i;
 	int                 j;
 	int                 total;
@@ -801,7 +1059,8 @@ void P_GroupLines(void) {
 	sector_t* sector;
 	subsector_t* ss;
 	seg_t* seg;
-	fixed_t             bbox[4];
+	fixed_t* bbox;
+	fixed_t* bboxes;
 	int                 block;
 
 	// look up sector number for each subsector
@@ -833,24 +1092,44 @@ void P_GroupLines(void) {
 		}
 	}
 
-	// build line tables for each sector
+	// carve out each sector's slice of the line table; lines are
+	// scattered into the slices below in linedef order, giving the
+	// same per-sector ordering as a search over all lines would
 	linebuffer = Z_Malloc(total * sizeof(*linebuffer), PU_LEVEL, 0);
+	fill = Z_Malloc(numsectors * sizeof(*fill), PU_STATIC, 0);
+	bboxes = Z_Malloc(numsectors * 4 * sizeof(*bboxes), PU_STATIC, 0);
+
 	sector = sectors;
 	for (i = 0; i < numsectors; i++, sector++) {
-		M_ClearBox(bbox);
 		sector->lines = linebuffer;
-		li = lines;
-		for (j = 0; j < numlines; j++, li++) {
-			if (li->frontsector == sector || li->backsector == sector) {
-				*linebuffer++ = li;
-				M_AddToBox(bbox, li->v1->x, li->v1->y);
-				M_AddToBox(bbox, li->v2->x, li->v2->y);
-			}
+		fill[i] = linebuffer;
+		linebuffer += sector->linecount;
+		M_ClearBox(&bboxes[i * 4]);
+	}
+
+	li = lines;
+	for (i = 0; i < numlines; i++, li++) {
+		j = li->frontsector - sectors;
+		*fill[j]++ = li;
+		M_AddToBox(&bboxes[j * 4], li->v1->x, li->v1->y);
+		M_AddToBox(&bboxes[j * 4], li->v2->x, li->v2->y);
+
+		if (li->backsector && li->backsector != li->frontsector) {
+			j = li->backsector - sectors;
+			*fill[j]++ = li;
+			M_AddToBox(&bboxes[j * 4], li->v1->x, li->v1->y);
+			M_AddToBox(&bboxes[j * 4], li->v2->x, li->v2->y);
 		}
-		if (linebuffer - sector->lines != sector->linecount) {
+	}
+
+	sector = sectors;
+	for (i = 0; i < numsectors; i++, sector++) {
+		if (fill[i] - sector->lines != sector->linecount) {
 			I_Error("P_GroupLines: miscounted");
 		}
 
+		bbox = &bboxes[i * 4];
+
 		// set the degenmobj_t to the middle of the bounding box
 		sector->soundorg.x = (bbox[BOXRIGHT] + bbox[BOXLEFT]) / 2;
 		sector->soundorg.y = (bbox[BOXTOP] + bbox[BOXBOTTOM]) / 2;
@@ -872,6 +1151,9 @@ void P_GroupLines(void) {
 		block = block < 0 ? 0 : block;
 		sector->blockbox[BOXLEFT] = block;
 	}
+
+	Z_Free(fill);
+	Z_Free(bboxes);
 }
 
 //
@@ -936,6 +1218,63 @@ void P_SetupPlanes(void) {
 	}
 }
 
+//
+// Level load timing
+//
+
+#define MAXLOADSTAGES	24
+
+typedef struct {
+	const char* name;
+	uint64_t    time;
+} loadstage_t;
+
+static loadstage_t  loadstages[MAXLOADSTAGES];
+static int          numloadstages;
+static uint64_t     loadstagestart;
+
+static void P_BeginLoadStages(void) {
+	numloadstages = 0;
+	loadstagestart = I_GetTimeNS();
+}
+
+static void P_EndLoadStage(const char* name) {
+	uint64_t now = I_GetTimeNS();
+
+	if (numloadstages < MAXLOADSTAGES) {
+		loadstages[numloadstages].name = name;
+		loadstages[numloadstages].time = now - loadstagestart;
+		numloadstages++;
+	}
+
+	loadstagestart = now;
+}
+
+//
+// P_PrintLoadTimes
+// Dumps the per-stage breakdown of the last P_SetupLevel
+//
+
+void P_PrintLoadTimes(void) {
+	uint64_t total = 0;
+	int i;
+
+	if (!numloadstages) {
+		CON_Printf(WHITE, "No level has been loaded\n");
+		return;
+	}
+
+	CON_Printf(GREEN, "Level load times:\n");
+
+	for (i = 0; i < numloadstages; i++) {
+		CON_Printf(AQUA, "%-20s %8.3f ms\n", loadstages[i].name,
+			(double)loadstages[i].time / 1000000.0);
+		total += loadstages[i].time;
+	}
+
+	CON_Printf(WHITE, "%-20s %8.3f ms\n", "total", (double)total / 1000000.0);
+}
+
 //
 // P_SetupLevel
 //
@@ -963,6 +1302,8 @@ void P_SetupLevel(int map, int playermask, skill_t skill) {
 	M_ClearRandom();
 
 	P_InitThinkers();
+	P_InitSecNodes();
+	P_ResetSnapshots();
 
 	// [kex] 12/26/11 - don't reset leveltime when loading a savegame
 	if (gameaction != ga_loadgame) {
@@ -974,21 +1315,56 @@ void P_SetupLevel(int map, int playermask, skill_t skill) {
 
 	P_InitTextureHashTable();
 
+	P_BeginLoadStages();
+
 	W_CacheMapLump(map);
+	P_EndLoadStage("W_CacheMapLump");
 	P_LoadMacros(ML_MACROS);
-	P_LoadVertexes(ML_VERTEXES);
-	P_LoadSectors(ML_SECTORS);
-	P_LoadSideDefs(ML_SIDEDEFS);
-	P_LoadLineDefs(ML_LINEDEFS);
-	P_LoadSubsectors(ML_SSECTORS);
-	P_LoadBlockMap();
-	P_LoadNodes(ML_NODES);
-	P_LoadSegs();
-	P_LoadLeafs(ML_LEAFS);
+	P_EndLoadStage("P_LoadMacros");
+
+	// the linked geometry only depends on the map lumps, so it can
+	// come straight from the level cache
+	if (P_LoadLevelCache()) {
+		P_EndLoadStage("P_LoadLevelCache");
+	}
+	else {
+		P_LoadVertexes(ML_VERTEXES);
+		P_EndLoadStage("P_LoadVertexes");
+		P_LoadSectors(ML_SECTORS);
+		P_EndLoadStage("P_LoadSectors");
+		P_LoadSideDefs(ML_SIDEDEFS);
+		P_EndLoadStage("P_LoadSideDefs");
+		P_LoadLineDefs(ML_LINEDEFS);
+		P_EndLoadStage("P_LoadLineDefs");
+		P_LoadSubsectors(ML_SSECTORS);
+		P_EndLoadStage("P_LoadSubsectors");
+		P_LoadBlockMap();
+		P_EndLoadStage("P_LoadBlockMap");
+		P_LoadNodes(ML_NODES);
+		P_EndLoadStage("P_LoadNodes");
+		P_LoadSegs();
+		P_EndLoadStage("P_LoadSegs");
+		P_LoadLeafs(ML_LEAFS);
+		P_EndLoadStage("P_LoadLeafs");
+		P_GroupLines();
+		P_EndLoadStage("P_GroupLines");
+		P_SaveLevelCache();
+		P_EndLoadStage("P_SaveLevelCache");
+	}
+
+	if (M_CheckParm("-checkblockmap")) {
+		P_CheckBlockMap();
+	}
+
+	P_InitBlockLinks();
 	P_LoadReject(ML_REJECT);
+	P_EndLoadStage("P_LoadReject");
+	P_InitReject();
+	P_EndLoadStage("P_InitReject");
 	P_LoadLights(ML_LIGHTS);
-	P_GroupLines();
+	P_EndLoadStage("P_LoadLights");
 	P_LoadThings(ML_THINGS);
+	P_EndLoadStage("P_LoadThings");
 	W_FreeMapLump();
 
 	dmemset(taglist, 0, sizeof(int) * MAXQUEUELIST);
@@ -996,6 +1372,7 @@ void P_SetupLevel(int map, int playermask, skill_t skill) {
 
 	// set up world state
 	P_SpawnSpecials();
+	P_EndLoadStage("P_SpawnSpecials");
 	P_SetupSky();
 	P_SetupPlanes();
 
@@ -1019,7 +1396,14 @@ void P_SetupLevel(int map, int playermask, skill_t skill) {
 
 	// preload graphics
 	R_PrecacheLevel();
+	P_EndLoadStage("R_PrecacheLevel");
 	R_SetupLevel();
+	P_EndLoadStage("R_SetupLevel");
+
+	if (p_loadtimes.value) {
+		P_PrintLoadTimes();
+		R_PrintFlatStats();
+	}
 
 	Z_CheckHeap();
 
@@ -1201,4 +1585,13 @@ void P_RegisterCvars(void) {
 	CON_CvarRegister(&p_sdoubleclick);
 	CON_CvarRegister(&p_usecontext);
 	CON_CvarRegister(&p_damageindicator);
+	CON_CvarRegister(&p_loadtimes);
+	CON_CvarRegister(&p_blockmapcell);
+	CON_CvarRegister(&p_levelcache);
+	CON_CvarRegister(&p_buildreject);
+	CON_CvarRegister(&p_rewind);
+	CON_CvarRegister(&p_rewindinterval);
+	CON_CvarRegister(&p_statehash);
+	CON_CvarRegister(&p_hashinterval);
+	CON_CvarRegister(&p_demokeyframes);
 }
@@ -38,9 +38,12 @@ episodedef_t* P_GetEpisode(int episode);
 int P_GetNumEpisodes(void);
 void P_InitMapInfo(void);
 void P_ListMaps(void);
+void P_PrintLoadTimes(void);
+int P_LineCellShift(void);
 
 // 
 void LOC_RegisterCvars(void);
+void LOC_Benchmark(int numkeys);
 
 //
 // [kex] sky definitions
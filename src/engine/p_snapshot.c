@@ -0,0 +1,220 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Playsim snapshots for frame interpolation. The sim fills the
+//      back buffer at the end of a tic, carrying the previous values
+//      over from the front one, and flips. Single threaded: the
+//      renderer reads between tics, never while one is published.
+//
+//      This is groundwork only; there is no threaded playsim mode.
+//      One would still need G_Ticker and console commands to stop
+//      making GL and sound calls, the renderer to stop walking live
+//      sector thing lists and mobj snapindex, and the flip here to
+//      become a triple buffer or seqlock.
+//
+//-----------------------------------------------------------------------------
+
+#include <limits.h>
+
+#include "p_snapshot.h"
+#include "doomstat.h"
+#include "z_zone.h"
+#include "p_local.h"
+#include "r_main.h"
+
+static snapshot_t   snapshots[2];
+
+// last published snapshot, NULL if there is none
+static snapshot_t*  snaplatest;
+
+//
+// P_ResetSnapshots
+// Drops both buffers; called when a level is set up so nothing
+// interpolates from the previous map
+//
+
+void P_ResetSnapshots(void) {
+	snaplatest = NULL;
+
+	snapshots[0].numsectors = snapshots[1].numsectors = 0;
+	snapshots[0].nummobjs = snapshots[1].nummobjs = 0;
+}
+
+//
+// P_GetSnapshot
+// Latest published snapshot or NULL. Only valid until the next tic.
+//
+
+const snapshot_t* P_GetSnapshot(void) {
+	return snaplatest;
+}
+
+//
+// P_GetSnapshotMobj
+//
+
+const snapmobj_t* P_GetSnapshotMobj(const snapshot_t* snap, mobj_t* mobj) {
+	const snapmobj_t* sm;
+
+	if (!snap || mobj->snapindex < 0 || mobj->snapindex >= snap->nummobjs) {
+		return NULL;
+	}
+
+	sm = &snap->mobjs[mobj->snapindex];
+
+	// index is stale if the mobj was not part of this snapshot
+	return sm->mobj == mobj ? sm : NULL;
+}
+
+//
+// P_SnapshotView
+//
+
+static void P_SnapshotView(snapview_t* view) {
+	player_t* player = &players[displayplayer];
+	mobj_t* viewcamera = player->cameratarget;
+
+	if (!viewcamera) {
+		dmemset(view, 0, sizeof(*view));
+		return;
+	}
+
+	view->x = viewcamera->x;
+	view->y = viewcamera->y;
+	view->z = (viewcamera == player->mo ? player->viewz : viewcamera->z) + quakeviewy;
+	view->angle = (viewcamera->angle + quakeviewx) + viewangleoffset;
+	view->pitch = viewcamera->pitch + ANG90;
+
+	if (viewcamera == player->mo) {
+		view->pitch += player->recoilpitch;
+	}
+}
+
+//
+// P_PublishSnapshot
+// Called once at the end of every P_Ticker, including tics where
+// the game is paused, so the previous and current values collapse
+// and nothing drifts while stopped.
+//
+
+void P_PublishSnapshot(void) {
+	const snapshot_t* front;
+	snapshot_t* back;
+	player_t* player;
+	mobj_t* mobj;
+	int i;
+
+	front = P_GetSnapshot();
+	back = &snapshots[front == &snapshots[0] ? 1 : 0];
+	player = &players[displayplayer];
+
+	back->tic = leveltime;
+
+	//
+	// view
+	//
+	P_SnapshotView(&back->view[SNAP_CUR]);
+	back->view[SNAP_PREV] = front ? front->view[SNAP_CUR] : back->view[SNAP_CUR];
+
+	//
+	// player sprites
+	//
+	for (i = 0; i < NUMPSPRITES; i++) {
+		back->psprites[SNAP_CUR][i].sx = player->psprites[i].sx;
+		back->psprites[SNAP_CUR][i].sy = player->psprites[i].sy;
+		back->psprites[SNAP_PREV][i] = front ?
+			front->psprites[SNAP_CUR][i] : back->psprites[SNAP_CUR][i];
+	}
+
+	//
+	// sectors
+	//
+	back->minfloor = INT_MAX;
+	back->maxceiling = INT_MIN;
+
+	if (numsectors > back->maxsectors) {
+		back->maxsectors = numsectors;
+		back->sectors = Z_Realloc(back->sectors,
+			back->maxsectors * sizeof(snapsector_t), PU_STATIC, NULL);
+	}
+
+	for (i = 0; i < numsectors; i++) {
+		snapsector_t* ss = &back->sectors[i];
+
+		ss->floorheight[SNAP_CUR] = sectors[i].floorheight;
+		ss->ceilingheight[SNAP_CUR] = sectors[i].ceilingheight;
+
+		if (front && front->numsectors == numsectors) {
+			ss->floorheight[SNAP_PREV] = front->sectors[i].floorheight[SNAP_CUR];
+			ss->ceilingheight[SNAP_PREV] = front->sectors[i].ceilingheight[SNAP_CUR];
+		}
+		else {
+			ss->floorheight[SNAP_PREV] = ss->floorheight[SNAP_CUR];
+			ss->ceilingheight[SNAP_PREV] = ss->ceilingheight[SNAP_CUR];
+		}
+
+		back->minfloor = MIN(back->minfloor,
+			MIN(ss->floorheight[SNAP_PREV], ss->floorheight[SNAP_CUR]));
+		back->maxceiling = MAX(back->maxceiling,
+			MAX(ss->ceilingheight[SNAP_PREV], ss->ceilingheight[SNAP_CUR]));
+	}
+
+	back->numsectors = numsectors;
+
+	//
+	// mobjs
+	//
+	back->nummobjs = 0;
+
+	for (mobj = mobjhead.next; mobj != &mobjhead; mobj = mobj->next) {
+		const snapmobj_t* prev;
+		snapmobj_t* sm;
+
+		// never drawn from the sector lists
+		if (mobj->flags & MF_NOSECTOR) {
+			continue;
+		}
+
+		if (back->nummobjs == back->maxmobjs) {
+			back->maxmobjs = back->maxmobjs ? back->maxmobjs * 2 : 256;
+			back->mobjs = Z_Realloc(back->mobjs,
+				back->maxmobjs * sizeof(snapmobj_t), PU_STATIC, NULL);
+		}
+
+		sm = &back->mobjs[back->nummobjs];
+		sm->mobj = mobj;
+		sm->x[SNAP_CUR] = mobj->x;
+		sm->y[SNAP_CUR] = mobj->y;
+		sm->z[SNAP_CUR] = mobj->z;
+
+		// spawned this tic: nothing to come from
+		if ((prev = P_GetSnapshotMobj(front, mobj))) {
+			sm->x[SNAP_PREV] = prev->x[SNAP_CUR];
+			sm->y[SNAP_PREV] = prev->y[SNAP_CUR];
+			sm->z[SNAP_PREV] = prev->z[SNAP_CUR];
+		}
+		else {
+			sm->x[SNAP_PREV] = mobj->x;
+			sm->y[SNAP_PREV] = mobj->y;
+			sm->z[SNAP_PREV] = mobj->z;
+		}
+
+		mobj->snapindex = back->nummobjs++;
+	}
+
+	snaplatest = back;
+}
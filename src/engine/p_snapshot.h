@@ -0,0 +1,88 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __P_SNAPSHOT__
+#define __P_SNAPSHOT__
+
+#include "p_mobj.h"
+#include "p_pspr.h"
+
+//
+// Render snapshots
+//
+// The playsim publishes one of these at the end of every tic. Each
+// value is stored twice: as it was after the previous tic and as it
+// is now, so the renderer can interpolate from a single snapshot.
+// Snapshots are published and read on the main thread only.
+//
+
+typedef struct {
+	fixed_t     x;
+	fixed_t     y;
+	fixed_t     z;
+	angle_t     angle;
+	angle_t     pitch;
+} snapview_t;
+
+typedef struct {
+	fixed_t     sx;
+	fixed_t     sy;
+} snappsp_t;
+
+typedef struct {
+	fixed_t     floorheight[2];
+	fixed_t     ceilingheight[2];
+} snapsector_t;
+
+typedef struct {
+	mobj_t*     mobj;   // identity only, never dereferenced by readers
+	fixed_t     x[2];
+	fixed_t     y[2];
+	fixed_t     z[2];
+} snapmobj_t;
+
+typedef struct {
+	int             tic;
+
+	snapview_t      view[2];
+	snappsp_t       psprites[2][NUMPSPRITES];
+
+	int             numsectors;
+	snapsector_t*   sectors;
+
+	// lowest floor and highest ceiling over both values, so every
+	// frame interpolated from this snapshot lies inside them
+	fixed_t         minfloor;
+	fixed_t         maxceiling;
+
+	int             nummobjs;
+	snapmobj_t*     mobjs;
+
+	// allocated sizes
+	int             maxsectors;
+	int             maxmobjs;
+} snapshot_t;
+
+// index into the [2] arrays above
+#define SNAP_PREV   0
+#define SNAP_CUR    1
+
+void P_ResetSnapshots(void);
+void P_PublishSnapshot(void);
+const snapshot_t* P_GetSnapshot(void);
+const snapmobj_t* P_GetSnapshotMobj(const snapshot_t* snap, mobj_t* mobj);
+
+#endif
@@ -47,6 +47,7 @@
 #include "r_sky.h"
 #include "r_lights.h"
 #include "r_main.h"
+#include "am_draw.h"
 #include "sc_main.h"
 #include "p_setup.h"
 
@@ -589,6 +590,8 @@ static int P_ModifyLine(int tag1, int tag2, int type) {
 			default:
 				break;
 			}
+
+			AM_MarkLineDirty(line1);
 		}
 	}
 
@@ -644,6 +647,7 @@ static int P_ModifySector(line_t* line, int tag, int type) {
 			break;
 		case mods_flags:
 			sec1->flags = sec2->flags;
+			AM_InvalidateLines();
 			break;
 		default:
 			break;
@@ -753,7 +757,7 @@ void P_SpawnDelayTimer(line_t* line, void (*func)(void)) {
 	delay_t* timer;
 
 	timer = Z_Malloc(sizeof(*timer), PU_LEVSPEC, 0);
-	P_AddThinker(&timer->thinker);
+	P_AddThinker(&timer->thinker, tc_delay);
 	timer->thinker.function.acp1 = (actionf_p1)T_CountdownTimer;
 	timer->tics = line->tag;
 	timer->finishfunc = func;
@@ -785,7 +789,7 @@ static void P_SpawnQuake(int tics) {
 	quake_t* quake;
 
 	quake = Z_Malloc(sizeof(*quake), PU_LEVSPEC, 0);
-	P_AddThinker(&quake->thinker);
+	P_AddThinker(&quake->thinker, tc_quake);
 	quake->thinker.function.acp1 = (actionf_p1)T_Quake;
     quake->tics = tics;
 
@@ -906,7 +910,7 @@ int P_SetAimCamera(player_t* player, line_t* line, boolean aim) {
 		mo->angle = R_PointToAngle2(mo->x, mo->y, player->mo->x, player->mo->y);
 
 		camera = Z_Malloc(sizeof(*camera), PU_LEVSPEC, 0);
-		P_AddThinker(&camera->thinker);
+		P_AddThinker(&camera->thinker, tc_aimcam);
 		camera->thinker.function.acp1 = (actionf_p1)T_LookAtCamera;
 		camera->viewmobj = mo;
 
@@ -1006,7 +1010,7 @@ void P_SetMovingCamera(player_t* player, line_t* line) {
 	}
 
 	camera = Z_Malloc(sizeof(*camera), PU_LEVSPEC, 0);
-	P_AddThinker(&camera->thinker);
+	P_AddThinker(&camera->thinker, tc_movecam);
 	camera->thinker.function.acp1 = (actionf_p1)T_MovingCamera;
 
 	if (!(player->cheats & CF_LOCKCAM)) {
@@ -1707,6 +1711,7 @@ boolean P_InitSpecialLine(mobj_t* thing, line_t* line, int side) {
 
 	if (!use) {
 		line->special = 0;
+		AM_MarkLineDirty(line);
 	}
 
 	return true;
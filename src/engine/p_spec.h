@@ -144,6 +144,11 @@ typedef struct {
 	int inc;
 } lightmorph_t;
 
+typedef struct {
+	thinker_t thinker;
+	float factor;
+} fadebright_t;
+
 #define GLOWSPEED			2
 #define	STROBEBRIGHT		3
 #define	STROBEBRIGHT2		1
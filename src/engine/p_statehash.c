@@ -0,0 +1,602 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Per-tic hash of the deterministic playsim state, used to catch
+//      desyncs. Every part of the world is hashed on its own so the
+//      first mismatch can say which part went wrong: the playsim random
+//      index, players, mobjs, sector heights and the parameters of the
+//      active thinkers. Pointers are never hashed, only what they lead
+//      to, so the value is the same on every machine and build.
+//
+//      Netgames fold it into ticcmd_t.consistency. Demos keep the full
+//      breakdown in a sidecar file next to the lump.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "p_statehash.h"
+#include "p_local.h"
+#include "p_spec.h"
+#include "doomstat.h"
+#include "m_random.h"
+#include "m_misc.h"
+#include "z_zone.h"
+#include "i_system.h"
+#include "con_console.h"
+#include "con_cvar.h"
+
+CVAR_EXTERNAL(p_statehash);
+CVAR_EXTERNAL(p_hashinterval);
+
+#define HASHFILE_MAGIC      "D64HSH"
+#define HASHFILE_VERSION    1
+#define HASHFILE_EXT        ".hsh"
+#define HASHFILE_NAMESIZE   256
+
+#define HASH_BASIS          0x811C9DC5
+#define HASH_MIX(h, v)      ((h) = ((h) ^ (unsigned int)(v)) * 0x01000193)
+
+#define HASHHISTORY         8
+
+typedef struct {
+	int             tic;
+	unsigned int    part[NUMHASHPARTS];
+} statehash_t;
+
+typedef struct {
+	char    magic[6];
+	byte    version;
+	byte    numparts;
+	int     interval;
+} hashfileheader_t;
+
+static const char* hashpartnames[NUMHASHPARTS] = {
+	"random",
+	"players",
+	"mobjs",
+	"sectors",
+	"thinkers"
+};
+
+static statehash_t  hashhistory[HASHHISTORY];
+static int          hashcount = 0;
+static int          hashtic = 0;
+static unsigned int hashlast = 0;
+
+static uint64_t     hashtime = 0;
+static uint64_t     hashmaxtime = 0;
+static int          hashtimed = 0;
+
+// demo sidecar
+static FILE*        hashfile = NULL;
+static byte*        hashcheck = NULL;
+static statehash_t* hashcheck_p;
+static statehash_t* hashcheck_end;
+static int          hashcheckinterval;
+static int          hashmatched;
+static boolean      hashdiverged;
+
+//
+// P_HashRandom
+//
+
+static unsigned int P_HashRandom(void) {
+	unsigned int h = HASH_BASIS;
+
+	HASH_MIX(h, prndindex);
+	HASH_MIX(h, leveltime);
+
+	return h;
+}
+
+//
+// P_HashPlayers
+//
+
+static unsigned int P_HashPlayers(void) {
+	unsigned int h = HASH_BASIS;
+	player_t* p;
+	int i;
+	int j;
+
+	for (i = 0; i < MAXPLAYERS; i++) {
+		if (!playeringame[i]) {
+			continue;
+		}
+
+		p = &players[i];
+
+		HASH_MIX(h, p->playerstate);
+		HASH_MIX(h, p->health);
+		HASH_MIX(h, p->armorpoints);
+		HASH_MIX(h, p->readyweapon);
+		HASH_MIX(h, p->pendingweapon);
+		HASH_MIX(h, p->viewz);
+
+		for (j = 0; j < NUMAMMO; j++) {
+			HASH_MIX(h, p->ammo[j]);
+		}
+
+		for (j = 0; j < NUMPOWERS; j++) {
+			HASH_MIX(h, p->powers[j]);
+		}
+	}
+
+	return h;
+}
+
+//
+// P_HashMobjs
+//
+
+static unsigned int P_HashMobjs(void) {
+	unsigned int h = HASH_BASIS;
+	mobj_t* mo;
+
+	for (mo = mobjhead.next; mo != &mobjhead; mo = mo->next) {
+		// gone at the end of this tic; the archive skips them too
+		if (mo->mobjfunc == P_SafeRemoveMobj) {
+			continue;
+		}
+
+		HASH_MIX(h, mo->type);
+		HASH_MIX(h, mo->x);
+		HASH_MIX(h, mo->y);
+		HASH_MIX(h, mo->z);
+		HASH_MIX(h, mo->momx);
+		HASH_MIX(h, mo->momy);
+		HASH_MIX(h, mo->momz);
+		HASH_MIX(h, mo->angle);
+		HASH_MIX(h, mo->health);
+		HASH_MIX(h, mo->state - states);
+		HASH_MIX(h, mo->tics);
+		HASH_MIX(h, mo->flags);
+		HASH_MIX(h, mo->movedir);
+		HASH_MIX(h, mo->movecount);
+		HASH_MIX(h, mo->reactiontime);
+		HASH_MIX(h, mo->threshold);
+	}
+
+	return h;
+}
+
+//
+// P_HashSectors
+//
+
+static unsigned int P_HashSectors(void) {
+	unsigned int h = HASH_BASIS;
+	sector_t* sec;
+	int i;
+
+	for (i = 0, sec = sectors; i < numsectors; i++, sec++) {
+		HASH_MIX(h, sec->floorheight);
+		HASH_MIX(h, sec->ceilingheight);
+		HASH_MIX(h, sec->lightlevel);
+		HASH_MIX(h, sec->special);
+		HASH_MIX(h, sec->flags);
+	}
+
+	return h;
+}
+
+//
+// P_HashThinkers
+// The fields each class moves or counts down with
+//
+
+static unsigned int P_HashThinkers(void) {
+	unsigned int h = HASH_BASIS;
+	thinker_t* th;
+
+	for (th = thinkercap.next; th != &thinkercap; th = th->next) {
+		// removed this tic
+		if (!th->cnext) {
+			continue;
+		}
+
+		HASH_MIX(h, th->tclass);
+		HASH_MIX(h, th->function.acv == (actionf_v)NULL);
+
+		switch (th->tclass) {
+		case tc_ceiling: {
+			ceiling_t* c = (ceiling_t*)th;
+
+			HASH_MIX(h, c->sector - sectors);
+			HASH_MIX(h, c->type);
+			HASH_MIX(h, c->bottomheight);
+			HASH_MIX(h, c->topheight);
+			HASH_MIX(h, c->speed);
+			HASH_MIX(h, c->direction);
+			HASH_MIX(h, c->olddirection);
+			break;
+		}
+
+		case tc_door: {
+			vldoor_t* d = (vldoor_t*)th;
+
+			HASH_MIX(h, d->sector - sectors);
+			HASH_MIX(h, d->type);
+			HASH_MIX(h, d->topheight);
+			HASH_MIX(h, d->speed);
+			HASH_MIX(h, d->direction);
+			HASH_MIX(h, d->topcountdown);
+			break;
+		}
+
+		case tc_floor: {
+			floormove_t* f = (floormove_t*)th;
+
+			HASH_MIX(h, f->sector - sectors);
+			HASH_MIX(h, f->type);
+			HASH_MIX(h, f->direction);
+			HASH_MIX(h, f->floordestheight);
+			HASH_MIX(h, f->speed);
+			break;
+		}
+
+		case tc_plat: {
+			plat_t* p = (plat_t*)th;
+
+			HASH_MIX(h, p->sector - sectors);
+			HASH_MIX(h, p->speed);
+			HASH_MIX(h, p->low);
+			HASH_MIX(h, p->high);
+			HASH_MIX(h, p->count);
+			HASH_MIX(h, p->status);
+			break;
+		}
+
+		case tc_split: {
+			splitmove_t* s = (splitmove_t*)th;
+
+			HASH_MIX(h, s->sector - sectors);
+			HASH_MIX(h, s->ceildest);
+			HASH_MIX(h, s->flrdest);
+			HASH_MIX(h, s->ceildir);
+			HASH_MIX(h, s->flrdir);
+			break;
+		}
+
+		case tc_flash:
+			HASH_MIX(h, ((lightflash_t*)th)->count);
+			break;
+
+		case tc_flicker:
+			HASH_MIX(h, ((fireflicker_t*)th)->count);
+			break;
+
+		case tc_strobe:
+			HASH_MIX(h, ((strobe_t*)th)->count);
+			break;
+
+		case tc_glow:
+			HASH_MIX(h, ((glow_t*)th)->count);
+			HASH_MIX(h, ((glow_t*)th)->direction);
+			break;
+
+		case tc_sequence:
+			HASH_MIX(h, ((sequenceGlow_t*)th)->count);
+			HASH_MIX(h, ((sequenceGlow_t*)th)->index);
+			break;
+
+		case tc_morph:
+			HASH_MIX(h, ((lightmorph_t*)th)->inc);
+			break;
+
+		case tc_delay:
+			HASH_MIX(h, ((delay_t*)th)->tics);
+			break;
+
+		case tc_quake:
+			HASH_MIX(h, ((quake_t*)th)->tics);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	return h;
+}
+
+//
+// P_CombineHash
+//
+
+static unsigned int P_CombineHash(const statehash_t* sh) {
+	unsigned int h = HASH_BASIS;
+	int i;
+
+	for (i = 0; i < NUMHASHPARTS; i++) {
+		HASH_MIX(h, sh->part[i]);
+	}
+
+	return h;
+}
+
+//
+// P_CheckDemoHash
+// Compares against the sidecar; only the first divergence is reported
+//
+
+static void P_CheckDemoHash(const statehash_t* sh) {
+	int i;
+
+	while (hashcheck_p < hashcheck_end && hashcheck_p->tic < sh->tic) {
+		hashcheck_p++;
+	}
+
+	if (hashcheck_p >= hashcheck_end || hashcheck_p->tic != sh->tic) {
+		return;
+	}
+
+	if (!memcmp(hashcheck_p->part, sh->part, sizeof(sh->part))) {
+		hashmatched++;
+		return;
+	}
+
+	hashdiverged = true;
+
+	CON_Warnf("statehash: demo diverges at tic %i (map %02i, leveltime %i)\n",
+		sh->tic, gamemap, leveltime);
+
+	for (i = 0; i < NUMHASHPARTS; i++) {
+		CON_Printf(hashcheck_p->part[i] != sh->part[i] ? YELLOW : WHITE,
+			"  %-8s recorded %08x, now %08x\n", hashpartnames[i],
+			hashcheck_p->part[i], sh->part[i]);
+	}
+
+	if (M_CheckParm("-hashcheck")) {
+		I_Error("statehash: demo diverges at tic %i", sh->tic);
+	}
+}
+
+//
+// P_StateHashTicker
+//
+
+void P_StateHashTicker(void) {
+	statehash_t* sh;
+	uint64_t start;
+	int interval;
+
+	hashtic++;
+
+	if (!netgame && !hashfile && !hashcheck && !p_statehash.value) {
+		return;
+	}
+
+	// both ends of a netgame must hash the same tics
+	if (netgame) {
+		interval = 1;
+	}
+	else if (hashcheck) {
+		interval = hashcheckinterval;
+	}
+	else {
+		interval = MAX((int)p_hashinterval.value, 1);
+	}
+
+	if (hashtic % interval) {
+		return;
+	}
+
+	start = I_GetTimeNS();
+
+	sh = &hashhistory[hashcount++ % HASHHISTORY];
+	sh->tic = hashtic;
+	sh->part[HASH_RANDOM] = P_HashRandom();
+	sh->part[HASH_PLAYERS] = P_HashPlayers();
+	sh->part[HASH_MOBJS] = P_HashMobjs();
+	sh->part[HASH_SECTORS] = P_HashSectors();
+	sh->part[HASH_THINKERS] = P_HashThinkers();
+	hashlast = P_CombineHash(sh);
+
+	start = I_GetTimeNS() - start;
+	hashtime += start;
+	hashmaxtime = MAX(hashmaxtime, start);
+	hashtimed++;
+
+	if (hashfile) {
+		if (fwrite(sh, sizeof(*sh), 1, hashfile) != 1) {
+			CON_Warnf("statehash: error writing demo hashes\n");
+			fclose(hashfile);
+			hashfile = NULL;
+		}
+	}
+	else if (hashcheck && !hashdiverged) {
+		P_CheckDemoHash(sh);
+	}
+}
+
+//
+// P_StateHashConsistency
+//
+
+byte P_StateHashConsistency(void) {
+	return (byte)(hashlast ^ (hashlast >> 8) ^ (hashlast >> 16) ^ (hashlast >> 24));
+}
+
+//
+// P_StateHashTic
+//
+
+int P_StateHashTic(void) {
+	return hashtic;
+}
+
+//
+// P_SetStateHashTic
+// For demo seeking; the sidecar is walked again from the start
+//
+
+void P_SetStateHashTic(int tic) {
+	// the sidecar must stay in tic order
+	if (hashfile && tic < hashtic) {
+		CON_Warnf("statehash: seeked back, stopped writing demo hashes\n");
+		fclose(hashfile);
+		hashfile = NULL;
+	}
+
+	hashtic = tic;
+
+	if (hashcheck) {
+		hashcheck_p = (statehash_t*)(hashcheck + sizeof(hashfileheader_t));
+	}
+}
+
+//
+// P_PrintStateHash
+//
+
+void P_PrintStateHash(void) {
+	statehash_t* sh;
+	int i;
+	int j;
+	int n;
+
+	n = MIN(hashcount, HASHHISTORY);
+
+	if (!n) {
+		CON_Printf(WHITE, "No tics hashed (set p_statehash 1)\n");
+		return;
+	}
+
+	CON_Printf(GREEN, "State hash: %i tics, avg %.1fus, max %.1fus\n",
+		hashtimed, (double)hashtime / hashtimed / 1000.0,
+		(double)hashmaxtime / 1000.0);
+
+	for (i = n; i > 0; i--) {
+		sh = &hashhistory[(hashcount - i) % HASHHISTORY];
+
+		CON_Printf(AQUA, "tic %i: %08x\n", sh->tic, P_CombineHash(sh));
+
+		for (j = 0; j < NUMHASHPARTS; j++) {
+			CON_Printf(WHITE, "  %-8s %08x\n", hashpartnames[j], sh->part[j]);
+		}
+	}
+
+	if (hashcheck) {
+		CON_Printf(WHITE, "demo: %i tics matched%s\n", hashmatched,
+			hashdiverged ? ", diverged" : "");
+	}
+}
+
+//
+// P_HashFileName
+//
+
+static void P_HashFileName(const char* demoname, char* out) {
+	char* ext;
+
+	snprintf(out, HASHFILE_NAMESIZE - sizeof(HASHFILE_EXT), "%s", demoname);
+
+	ext = dstrrchr(out, '.');
+	if (ext && !strchr(ext, '/') && !strchr(ext, '\\')) {
+		*ext = 0;
+	}
+
+	dstrcat(out, HASHFILE_EXT);
+}
+
+//
+// P_StateHashOpenDemo
+//
+
+void P_StateHashOpenDemo(const char* demoname, boolean write) {
+	hashfileheader_t header;
+	char filename[HASHFILE_NAMESIZE];
+	int size;
+
+	P_StateHashCloseDemo();
+
+	hashtic = 0;
+	hashcount = 0;
+	hashmatched = 0;
+	hashdiverged = false;
+
+	P_HashFileName(demoname, filename);
+
+	if (write) {
+		if (!(hashfile = fopen(filename, "wb"))) {
+			CON_Warnf("statehash: couldn't create %s\n", filename);
+			return;
+		}
+
+		dmemcpy(header.magic, HASHFILE_MAGIC, sizeof(header.magic));
+		header.version = HASHFILE_VERSION;
+		header.numparts = NUMHASHPARTS;
+		header.interval = MAX((int)p_hashinterval.value, 1);
+
+		fwrite(&header, sizeof(header), 1, hashfile);
+		CON_Printf(WHITE, "statehash: writing %s\n", filename);
+		return;
+	}
+
+	if (!M_FileExists(filename)) {
+		return;
+	}
+
+	size = M_ReadFile(filename, &hashcheck);
+
+	if (size < (int)sizeof(header)) {
+		P_StateHashCloseDemo();
+		return;
+	}
+
+	dmemcpy(&header, hashcheck, sizeof(header));
+
+	if (memcmp(header.magic, HASHFILE_MAGIC, sizeof(header.magic))
+		|| header.version != HASHFILE_VERSION
+		|| header.numparts != NUMHASHPARTS
+		|| header.interval < 1) {
+		CON_Warnf("statehash: %s is not a hash file for this version\n", filename);
+		P_StateHashCloseDemo();
+		return;
+	}
+
+	hashcheckinterval = header.interval;
+	hashcheck_p = (statehash_t*)(hashcheck + sizeof(header));
+	hashcheck_end = hashcheck_p + (size - sizeof(header)) / sizeof(statehash_t);
+
+	CON_Printf(WHITE, "statehash: checking against %s (%i tics)\n",
+		filename, (int)(hashcheck_end - hashcheck_p));
+}
+
+//
+// P_StateHashCloseDemo
+//
+
+void P_StateHashCloseDemo(void) {
+	if (hashfile) {
+		fclose(hashfile);
+		hashfile = NULL;
+	}
+
+	if (hashcheck) {
+		if (!hashdiverged) {
+			CON_Printf(GREEN, "statehash: %i demo tics matched\n", hashmatched);
+		}
+
+		Z_Free(hashcheck);
+		hashcheck = NULL;
+	}
+}
@@ -0,0 +1,49 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __P_STATEHASH__
+#define __P_STATEHASH__
+
+#include "doomtype.h"
+
+typedef enum {
+	HASH_RANDOM,
+	HASH_PLAYERS,
+	HASH_MOBJS,
+	HASH_SECTORS,
+	HASH_THINKERS,
+	NUMHASHPARTS
+} hashpart_t;
+
+// Call after every tic that advanced leveltime.
+void P_StateHashTicker(void);
+
+// Hash of the last hashed tic folded down for ticcmd_t.consistency
+byte P_StateHashConsistency(void);
+
+// Count of tics run since the demo started; demo seeking sets it back
+int P_StateHashTic(void);
+void P_SetStateHashTic(int tic);
+
+// Dumps the per-part breakdown of the most recent hashes
+void P_PrintStateHash(void);
+
+// Demo sidecar (<demo>.hsh): written while recording, or while
+// playing back with -hashwrite; otherwise checked during playback
+void P_StateHashOpenDemo(const char* demoname, boolean write);
+void P_StateHashCloseDemo(void);
+
+#endif
@@ -36,8 +36,11 @@
 #include "p_setup.h"
 #include "g_demo.h"
 #include "con_cvar.h"
+#include "p_snapshot.h"
+#include "p_reject.h"
+#include "p_saveg.h"
+#include "p_statehash.h"
 
-CVAR_EXTERNAL(i_interpolateframes);
 CVAR_EXTERNAL(p_damageindicator);
 CVAR_EXTERNAL(r_wipe);
 CVAR_EXTERNAL(v_fadein);
@@ -64,6 +67,22 @@ mobj_t      mobjhead;        // Both the head and tail of the mobj list.
 mobj_t* currentmobj;
 thinker_t* currentthinker;
 
+// Each class also keeps its own list, so finding or counting
+// thinkers of one kind doesn't walk every thinker in the level
+thinker_t   thinkerclasscap[NUMTHINKERCLASSES];
+
+//
+// P_InitThinkerClasses
+//
+
+void P_InitThinkerClasses(void) {
+	int i;
+
+	for (i = 0; i < NUMTHINKERCLASSES; i++) {
+		thinkerclasscap[i].cprev = thinkerclasscap[i].cnext = &thinkerclasscap[i];
+	}
+}
+
 //
 // P_InitThinkers
 //
@@ -71,6 +90,7 @@ thinker_t* currentthinker;
 void P_InitThinkers(void) {
 	thinkercap.prev = thinkercap.next = &thinkercap;
 	mobjhead.next = mobjhead.prev = &mobjhead;
+	P_InitThinkerClasses();
 }
 
 //
@@ -78,11 +98,19 @@ void P_InitThinkers(void) {
 // Adds a new thinker at the end of the list.
 //
 
-void P_AddThinker(thinker_t* thinker) {
+void P_AddThinker(thinker_t* thinker, thinkerclass_t tclass) {
+	thinker_t* cap = &thinkerclasscap[tclass];
+
 	thinkercap.prev->next = thinker;
 	thinker->next = &thinkercap;
 	thinker->prev = thinkercap.prev;
 	thinkercap.prev = thinker;
+
+	thinker->tclass = tclass;
+	cap->cprev->cnext = thinker;
+	thinker->cnext = cap;
+	thinker->cprev = cap->cprev;
+	cap->cprev = thinker;
 }
 
 //
@@ -103,10 +131,96 @@ static void P_UnlinkThinker(thinker_t* thinker) {
 //
 
 void P_RemoveThinker(thinker_t* thinker) {
+	if (thinker->cnext) {
+		thinker->cprev->cnext = thinker->cnext;
+		thinker->cnext->cprev = thinker->cprev;
+		thinker->cprev = thinker->cnext = NULL;
+	}
+
 	thinker->function.acp1 = (actionf_p1)P_UnlinkThinker;
 	P_MacroDetachThinker(thinker);
 }
 
+//
+// P_PrintThinkerCensus
+// Live thinkers and their fixed size per class, for capacity planning
+//
+
+static const struct {
+	const char* name;
+	int         size;
+} thinkerclassinfo[NUMTHINKERCLASSES] = {
+	{ "ceiling",    sizeof(ceiling_t) },
+	{ "door",       sizeof(vldoor_t) },
+	{ "floor",      sizeof(floormove_t) },
+	{ "plat",       sizeof(plat_t) },
+	{ "flash",      sizeof(lightflash_t) },
+	{ "strobe",     sizeof(strobe_t) },
+	{ "glow",       sizeof(glow_t) },
+	{ "flicker",    sizeof(fireflicker_t) },
+	{ "delay",      sizeof(delay_t) },
+	{ "aimcam",     sizeof(aimcamera_t) },
+	{ "movecam",    sizeof(movecamera_t) },
+	{ "mobjfade",   sizeof(mobjfade_t) },
+	{ "sequence",   sizeof(sequenceGlow_t) },
+	{ "quake",      sizeof(quake_t) },
+	{ "combine",    sizeof(combine_t) },
+	{ "laser",      sizeof(laserthinker_t) },
+	{ "split",      sizeof(splitmove_t) },
+	{ "morph",      sizeof(lightmorph_t) },
+	{ "mobjexp",    sizeof(mobjexp_t) },
+	{ NULL,         0 },
+	{ "fadebright", sizeof(fadebright_t) }
+};
+
+void P_PrintThinkerCensus(void) {
+	thinker_t* th;
+	mobj_t* mo;
+	int count;
+	int total = 0;
+	int bytes = 0;
+	int removed = 0;
+	int i;
+
+	CON_Printf(GREEN, "Thinkers:\n");
+
+	for (i = 0; i < NUMTHINKERCLASSES; i++) {
+		if (!thinkerclassinfo[i].name) {
+			continue;
+		}
+
+		count = 0;
+		for (th = thinkerclasscap[i].cnext; th != &thinkerclasscap[i]; th = th->cnext) {
+			count++;
+		}
+
+		if (!count) {
+			continue;
+		}
+
+		CON_Printf(AQUA, "%-10s %6i %8i bytes\n", thinkerclassinfo[i].name,
+			count, count * thinkerclassinfo[i].size);
+
+		total += count;
+		bytes += count * thinkerclassinfo[i].size;
+	}
+
+	for (th = thinkercap.next; th != &thinkercap; th = th->next) {
+		if (!th->cnext) {
+			removed++;
+		}
+	}
+
+	count = 0;
+	for (mo = mobjhead.next; mo != &mobjhead; mo = mo->next) {
+		count++;
+	}
+
+	CON_Printf(WHITE, "%-10s %6i %8i bytes (%i awaiting removal)\n", "total",
+		total, bytes, removed);
+	CON_Printf(WHITE, "%-10s %6i %8i bytes\n", "mobjs", count, count * (int)sizeof(mobj_t));
+}
+
 //
 // P_LinkMobj
 //
@@ -185,82 +299,6 @@ void P_RunThinkers(void) {
 	}
 }
 
-//
-// P_UpdateFrameStates
-//
-
-angle_t frame_angle = 0;
-angle_t frame_pitch = 0;
-fixed_t frame_viewx = 0;
-fixed_t frame_viewy = 0;
-fixed_t frame_viewz = 0;
-
-static void P_UpdateFrameStates(void) {
-	player_t* player = &players[displayplayer];
-	pspdef_t* psp;
-	mobj_t* viewcamera;
-	angle_t     pitch;
-	mobj_t* mobj;
-	int         i;
-
-	viewcamera = player->cameratarget;
-	pitch = viewcamera->pitch + ANG90;
-
-	if (viewcamera == player->mo) {
-		pitch += player->recoilpitch;
-	}
-
-	//
-	// update player position/view for interpolation
-	//
-	frame_viewx = player->cameratarget->x;
-	frame_viewy = player->cameratarget->y;
-	frame_viewz = (viewcamera == player->mo ? player->viewz : viewcamera->z) + quakeviewy;
-	frame_angle = (player->cameratarget->angle + quakeviewx) + viewangleoffset;
-	frame_pitch = pitch;
-
-	//
-	// update player sprites for interpolation
-	//
-	psp = &player->psprites[ps_weapon];
-
-	player->psprites[ps_weapon].frame_x = psp->sx;
-	player->psprites[ps_weapon].frame_y = psp->sy;
-	player->psprites[ps_flash].frame_x = psp->sx;
-	player->psprites[ps_flash].frame_y = psp->sy;
-
-	//
-	// update sector frames for interpolation
-	//
-	for (i = 0; i < numsectors; i++) {
-		sector_t* sector = &sectors[i];
-
-		sector->frame_z1[0] = sector->frame_z1[1];
-		sector->frame_z2[0] = sector->frame_z2[1];
-		sector->frame_z1[1] = sector->floorheight;
-		sector->frame_z2[1] = sector->ceilingheight;
-	}
-
-	//
-	// update mobj frames for interpolation
-	//
-	for (mobj = mobjhead.next; mobj != &mobjhead; mobj = mobj->next) {
-		if (!mobj) {
-			CON_Warnf("P_UpdateFrameStates: Null mobj in linked list!\n");
-			continue;
-		}
-
-		// Special case only
-		if (mobj->flags & MF_NOSECTOR) {
-			continue;
-		}
-
-		mobj->frame_x = mobj->x;
-		mobj->frame_y = mobj->y;
-		mobj->frame_z = mobj->z;
-	}
-}
-
 //
 // P_Start
 //
@@ -334,6 +372,10 @@ void P_Stop(void) {
 		AM_Stop();
 	}
 
+	// the reject builder reads nothing from the level, but it would
+	// finish into the next one
+	P_StopReject();
+
 	// free level tags
 	Z_FreeTags(PU_LEVEL, PU_PURGELEVEL - 1);
 
@@ -402,16 +444,12 @@ void P_Drawer(void) {
 }
 
 //
-// P_Ticker
+// P_RunTic
 //
 
-int P_Ticker(void) {
+static int P_RunTic(void) {
 	int i;
 
-	if (i_interpolateframes.value) {
-		P_UpdateFrameStates();
-	}
-
 	if (paused) {
 		return 0;
 	}
@@ -449,3 +487,25 @@ int P_Ticker(void) {
 
 	return gameaction;
 }
+
+//
+// P_Ticker
+//
+
+int P_Ticker(void) {
+	int action;
+	int oldtime = leveltime;
+
+	P_UpdateReject();
+	action = P_RunTic();
+
+	if (leveltime != oldtime) {
+		P_StateHashTicker();
+	}
+
+	// published even when nothing ran so interpolation settles
+	P_PublishSnapshot();
+	P_RewindTicker();
+
+	return action;
+}
@@ -31,6 +31,7 @@
 #include "z_zone.h"
 #include "r_sky.h"
 #include "r_drawlist.h"
+#include "am_draw.h"
 #include "gl_texture.h"
 
 sector_t* frontsector;
@@ -45,12 +46,12 @@ CVAR_EXTERNAL(i_interpolateframes);
 CVAR_EXTERNAL(r_texturecombiner);
 
 //
-// R_AddClipLine
-// Clips the given segment
-// and adds any visible pieces to the line list.
+// R_ClipSeg
+// Checks the segment against the clipper and adds it as an
+// occluder if it blocks the view. Returns false if it is hidden.
 //
 
-void R_AddClipLine(seg_t* line) {
+boolean R_ClipSeg(seg_t* line) {
 	angle_t angle1;
 	angle_t angle2;
 
@@ -69,11 +70,11 @@ void R_AddClipLine(seg_t* line) {
 
 	// Back side, i.e. backface culling    - read: endAngle >= startAngle!
 	if (angle2 - angle1 < ANG180 || !line->linedef) {
-		return;
+		return false;
 	}
 
 	if (!R_Clipper_SafeCheckRange(angle2, angle1)) {
-		return;
+		return false;
 	}
 
 	if (!(line->linedef->flags & (ML_DRAWMASKED | ML_DONTOCCLUDE))) {
@@ -94,7 +95,24 @@ void R_AddClipLine(seg_t* line) {
 		}
 	}
 
-	line->linedef->flags |= ML_MAPPED;
+	return true;
+}
+
+//
+// R_AddClipLine
+// Clips the given segment
+// and adds any visible pieces to the line list.
+//
+
+void R_AddClipLine(seg_t* line) {
+	if (!R_ClipSeg(line)) {
+		return;
+	}
+
+	if (!(line->linedef->flags & ML_MAPPED)) {
+		line->linedef->flags |= ML_MAPPED;
+		AM_MarkLineDirty(line->linedef);
+	}
 
 	R_AddLine(line);
 }
@@ -114,10 +132,11 @@ int checkcoord[12][4] = {
 };
 
 //
-// R_CheckBBox
+// R_CheckBBoxAngles
+// Checks the angles the box covers against the clipper
 //
 
-boolean R_CheckBBox(fixed_t* bspcoord) {
+boolean R_CheckBBoxAngles(fixed_t* bspcoord) {
 	angle_t     angle1;
 	angle_t     angle2;
 	int         boxpos;
@@ -139,6 +158,16 @@ boolean R_CheckBBox(fixed_t* bspcoord) {
 	return R_Clipper_SafeCheckRange(angle2 + viewangle, angle1 + viewangle);
 }
 
+//
+// R_CheckBBox
+// The frustum test rejects boxes above, below or too far to the
+// side of the view before any angles are worked out
+//
+
+boolean R_CheckBBox(fixed_t* bspcoord) {
+	return R_FrustrumTestBox(bspcoord) && R_CheckBBoxAngles(bspcoord);
+}
+
 //
 // AddSwitchQuad
 // Draw the switch box on a linedef
@@ -278,11 +307,10 @@ boolean R_GenerateSwitchPlane(seg_t* line, vtx_t* v) {
 
 SDL_INLINE static void GetSideTopBottom(sector_t* sector, rfloat* top, rfloat* bottom) {
 	if (i_interpolateframes.value) {
-		fixed_t frame_c = sector->frame_z2[1];
-		fixed_t frame_f = sector->frame_z1[1];
+		rsector_t* rs = &rsectors[sector - sectors];
 
-		*bottom = F2D3D(frame_f);
-		*top = F2D3D(frame_c);
+		*bottom = F2D3D(rs->floorheight);
+		*top = F2D3D(rs->ceilingheight);
 	}
 	else {
 		*top = F2D3D(sector->ceilingheight);
@@ -0,0 +1,618 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2003 Tim Stump
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Clipper benchmark. Records the clipper calls made while
+//      rendering and replays them through the span clipper and
+//      the linked list clipper it replaced, timing both and
+//      checking that every visibility result is the same.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "r_clipbench.h"
+#include "r_clipper.h"
+#include "doomdef.h"
+#include "z_zone.h"
+#include "m_misc.h"
+#include "i_system.h"
+#include "i_system_io.h"
+#include "con_console.h"
+
+#define CLIPBENCH_MAGIC     "D64CLIP"
+#define CLIPBENCH_FILE      "clipbench.dat"
+#define CLIPBENCH_FRAMES    64
+#define CLIPBENCH_PASSES    16
+
+typedef struct {
+	uint32_t    op;         // clipop_t, bit 8 is the visibility result
+	uint32_t    start;
+	uint32_t    end;
+} clipevent_t;
+
+typedef struct {
+	char        magic[8];
+	int32_t     numevents;
+	int32_t     numframes;
+} clipbenchheader_t;
+
+boolean cliprecording = false;
+
+static clipevent_t* clipevents = NULL;
+static int numclipevents = 0;
+static int maxclipevents = 0;
+static int clipframes = 0;
+static int clipframetarget = 0;
+
+//
+// Reference clipper
+//
+// The linked list clipper as it was before the span array, kept
+// only to compare against. Apart from living in a struct instead
+// of globals it is unchanged, quirks included.
+//
+
+typedef struct clipnode_s {
+	struct clipnode_s* prev, * next;
+	angle_t start, end;
+} clipnode_t;
+
+typedef struct {
+	clipnode_t* cliphead;
+	clipnode_t* freelist;
+} listclipper_t;
+
+static clipnode_t* R_ListClipper_GetNew(listclipper_t* lc) {
+	if (lc->freelist) {
+		clipnode_t* p = lc->freelist;
+		lc->freelist = p->next;
+		return p;
+	}
+
+	return malloc(sizeof(clipnode_t));
+}
+
+static clipnode_t* R_ListClipper_NewRange(listclipper_t* lc, angle_t start, angle_t end) {
+	clipnode_t* c = R_ListClipper_GetNew(lc);
+	c->start = start;
+	c->end = end;
+	c->next = c->prev = NULL;
+	return c;
+}
+
+static boolean R_ListClipper_IsRangeVisible(listclipper_t* lc, angle_t startAngle, angle_t endAngle) {
+	clipnode_t* ci;
+	ci = lc->cliphead;
+
+	if (endAngle == 0 && ci && ci->start == 0) {
+		return false;
+	}
+
+	while (ci != NULL && ci->start < endAngle) {
+		if (startAngle >= ci->start && endAngle <= ci->end) {
+			return false;
+		}
+
+		ci = ci->next;
+	}
+
+	return true;
+}
+
+static boolean R_ListClipper_SafeCheckRange(listclipper_t* lc, angle_t startAngle, angle_t endAngle) {
+	if (startAngle > endAngle)
+		return (R_ListClipper_IsRangeVisible(lc, startAngle, ANGLE_MAX) ||
+			R_ListClipper_IsRangeVisible(lc, 0, endAngle));
+
+	return R_ListClipper_IsRangeVisible(lc, startAngle, endAngle);
+}
+
+static void R_ListClipper_Free(listclipper_t* lc, clipnode_t* node) {
+	node->next = lc->freelist;
+	lc->freelist = node;
+}
+
+static void R_ListClipper_RemoveRange(listclipper_t* lc, clipnode_t* range) {
+	if (range == lc->cliphead) {
+		lc->cliphead = lc->cliphead->next;
+	}
+	else {
+		if (range->prev) {
+			range->prev->next = range->next;
+		}
+
+		if (range->next) {
+			range->next->prev = range->prev;
+		}
+	}
+
+	R_ListClipper_Free(lc, range);
+}
+
+static void R_ListClipper_AddClipRange(listclipper_t* lc, angle_t start, angle_t end) {
+	clipnode_t* node, * temp, * prevNode;
+	if (lc->cliphead) {
+		//check to see if range contains any old ranges
+		node = lc->cliphead;
+		while (node != NULL && node->start < end) {
+			if (node->start >= start && node->end <= end) {
+				temp = node;
+				node = node->next;
+				R_ListClipper_RemoveRange(lc, temp);
+			}
+			else {
+				if (node->start <= start && node->end >= end) {
+					return;
+				}
+				else {
+					node = node->next;
+				}
+			}
+		}
+		//check to see if range overlaps a range (or possibly 2)
+		node = lc->cliphead;
+		while (node != NULL) {
+			if (node->start >= start && node->start <= end) {
+				node->start = start;
+				return;
+			}
+			if (node->end >= start && node->end <= end) {
+				// check for possible merger
+				if (node->next && node->next->start <= end) {
+					node->end = node->next->end;
+					R_ListClipper_RemoveRange(lc, node->next);
+				}
+				else {
+					node->end = end;
+				}
+
+				return;
+			}
+
+			node = node->next;
+		}
+
+		//just add range
+		node = lc->cliphead;
+		prevNode = NULL;
+
+		temp = R_ListClipper_NewRange(lc, start, end);
+
+		while (node != NULL && node->start < end) {
+			prevNode = node;
+			node = node->next;
+		}
+
+		temp->next = node;
+
+		if (node == NULL) {
+			temp->prev = prevNode;
+
+			if (prevNode) {
+				prevNode->next = temp;
+			}
+
+			if (!lc->cliphead) {
+				lc->cliphead = temp;
+			}
+		}
+		else {
+			if (node == lc->cliphead) {
+				lc->cliphead->prev = temp;
+				lc->cliphead = temp;
+			}
+			else {
+				temp->prev = prevNode;
+				prevNode->next = temp;
+				node->prev = temp;
+			}
+		}
+	}
+	else {
+		temp = R_ListClipper_NewRange(lc, start, end);
+		lc->cliphead = temp;
+		return;
+	}
+}
+
+static void R_ListClipper_SafeAddClipRange(listclipper_t* lc, angle_t startangle, angle_t endangle) {
+	if (startangle > endangle) {
+		R_ListClipper_AddClipRange(lc, startangle, ANGLE_MAX);
+		R_ListClipper_AddClipRange(lc, 0, endangle);
+	}
+	else {
+		R_ListClipper_AddClipRange(lc, startangle, endangle);
+	}
+}
+
+static void R_ListClipper_Clear(listclipper_t* lc) {
+	clipnode_t* node = lc->cliphead;
+	clipnode_t* temp;
+
+	while (node != NULL) {
+		temp = node;
+		node = node->next;
+		R_ListClipper_Free(lc, temp);
+	}
+
+	lc->cliphead = NULL;
+}
+
+static void R_ListClipper_Shutdown(listclipper_t* lc) {
+	clipnode_t* node;
+
+	R_ListClipper_Clear(lc);
+
+	while ((node = lc->freelist)) {
+		lc->freelist = node->next;
+		free(node);
+	}
+}
+
+//
+// R_SpanClipper_SafeCheckRange
+//
+
+static boolean R_SpanClipper_SafeCheckRange(clipper_t* clipper, angle_t start, angle_t end) {
+	if (start > end) {
+		return (R_ClipperIsRangeVisible(clipper, start, ANGLE_MAX) ||
+			R_ClipperIsRangeVisible(clipper, 0, end));
+	}
+
+	return R_ClipperIsRangeVisible(clipper, start, end);
+}
+
+//
+// R_SpanClipper_SafeAddClipRange
+//
+
+static void R_SpanClipper_SafeAddClipRange(clipper_t* clipper, angle_t start, angle_t end) {
+	if (start > end) {
+		R_ClipperAddRange(clipper, start, ANGLE_MAX);
+		R_ClipperAddRange(clipper, 0, end);
+	}
+	else {
+		R_ClipperAddRange(clipper, start, end);
+	}
+}
+
+//
+// R_ClipBenchSameRanges
+// Both clippers should be holding exactly the same ranges
+//
+
+static boolean R_ClipBenchSameRanges(const listclipper_t* lc, const clipper_t* clipper) {
+	const clipnode_t* node = lc->cliphead;
+	int i;
+
+	for (i = 0; i < clipper->numspans; i++, node = node->next) {
+		if (!node || node->start != clipper->spans[i].start ||
+			node->end != clipper->spans[i].end) {
+			return false;
+		}
+	}
+
+	return node == NULL;
+}
+
+//
+// R_ClipBenchVerify
+// Replays the events through both clippers side by side and
+// returns the number of checks where either one disagrees with
+// the recorded result
+//
+
+static int R_ClipBenchVerify(int* rangemismatches) {
+	listclipper_t lc;
+	clipper_t clipper;
+	int mismatches = 0;
+	int frame = 0;
+	int i;
+
+	dmemset(&lc, 0, sizeof(lc));
+	dmemset(&clipper, 0, sizeof(clipper));
+	*rangemismatches = 0;
+
+	for (i = 0; i < numclipevents; i++) {
+		const clipevent_t* ev = &clipevents[i];
+		boolean recorded = (ev->op >> 8) & 1;
+		boolean listvis;
+		boolean spanvis;
+
+		switch (ev->op & 0xff) {
+		case CLIPOP_CLEAR:
+			if (!R_ClipBenchSameRanges(&lc, &clipper)) {
+				if (!(*rangemismatches)++) {
+					CON_Printf(RED, "Ranges differ before frame %i\n", frame);
+				}
+			}
+
+			R_ListClipper_Clear(&lc);
+			R_ClipperClear(&clipper);
+			frame++;
+			break;
+
+		case CLIPOP_ADD:
+			R_ListClipper_SafeAddClipRange(&lc, ev->start, ev->end);
+			R_SpanClipper_SafeAddClipRange(&clipper, ev->start, ev->end);
+			break;
+
+		case CLIPOP_CHECK:
+			listvis = R_ListClipper_SafeCheckRange(&lc, ev->start, ev->end);
+			spanvis = R_SpanClipper_SafeCheckRange(&clipper, ev->start, ev->end);
+
+			if (listvis != recorded || spanvis != recorded) {
+				if (!mismatches++) {
+					CON_Printf(RED, "Check %i (frame %i, %08x-%08x): recorded %i list %i spans %i\n",
+						i, frame, ev->start, ev->end, recorded, listvis, spanvis);
+				}
+			}
+			break;
+		}
+	}
+
+	R_ListClipper_Shutdown(&lc);
+	free(clipper.spans);
+
+	return mismatches;
+}
+
+//
+// R_ClipBenchTimeList
+//
+
+static uint64_t R_ClipBenchTimeList(void) {
+	listclipper_t lc;
+	uint64_t start;
+	int visible = 0;
+	int pass;
+	int i;
+
+	dmemset(&lc, 0, sizeof(lc));
+	start = I_GetTimeNS();
+
+	for (pass = 0; pass < CLIPBENCH_PASSES; pass++) {
+		for (i = 0; i < numclipevents; i++) {
+			const clipevent_t* ev = &clipevents[i];
+
+			switch (ev->op & 0xff) {
+			case CLIPOP_CLEAR:
+				R_ListClipper_Clear(&lc);
+				break;
+			case CLIPOP_ADD:
+				R_ListClipper_SafeAddClipRange(&lc, ev->start, ev->end);
+				break;
+			case CLIPOP_CHECK:
+				visible += R_ListClipper_SafeCheckRange(&lc, ev->start, ev->end);
+				break;
+			}
+		}
+	}
+
+	start = I_GetTimeNS() - start;
+	R_ListClipper_Shutdown(&lc);
+
+	// keeps the checks from being optimized out
+	return start + (visible < 0);
+}
+
+//
+// R_ClipBenchTimeSpans
+//
+
+static uint64_t R_ClipBenchTimeSpans(void) {
+	clipper_t clipper;
+	uint64_t start;
+	int visible = 0;
+	int pass;
+	int i;
+
+	dmemset(&clipper, 0, sizeof(clipper));
+	start = I_GetTimeNS();
+
+	for (pass = 0; pass < CLIPBENCH_PASSES; pass++) {
+		for (i = 0; i < numclipevents; i++) {
+			const clipevent_t* ev = &clipevents[i];
+
+			switch (ev->op & 0xff) {
+			case CLIPOP_CLEAR:
+				R_ClipperClear(&clipper);
+				break;
+			case CLIPOP_ADD:
+				R_SpanClipper_SafeAddClipRange(&clipper, ev->start, ev->end);
+				break;
+			case CLIPOP_CHECK:
+				visible += R_SpanClipper_SafeCheckRange(&clipper, ev->start, ev->end);
+				break;
+			}
+		}
+	}
+
+	start = I_GetTimeNS() - start;
+	free(clipper.spans);
+
+	return start + (visible < 0);
+}
+
+//
+// R_ClipBenchReplay
+//
+
+static void R_ClipBenchReplay(void) {
+	uint64_t listtime;
+	uint64_t spantime;
+	int mismatches;
+	int rangemismatches;
+	int adds = 0;
+	int checks = 0;
+	int i;
+
+	for (i = 0; i < numclipevents; i++) {
+		adds += (clipevents[i].op & 0xff) == CLIPOP_ADD;
+		checks += (clipevents[i].op & 0xff) == CLIPOP_CHECK;
+	}
+
+	mismatches = R_ClipBenchVerify(&rangemismatches);
+	listtime = R_ClipBenchTimeList();
+	spantime = R_ClipBenchTimeSpans();
+
+	CON_Printf(GREEN, "clipbench: %i frames, %i adds, %i checks, %i passes\n",
+		clipframes, adds, checks, CLIPBENCH_PASSES);
+	CON_Printf(AQUA, "list clipper: %.3fms per frame\n",
+		(double)listtime / 1000000.0 / MAX(clipframes * CLIPBENCH_PASSES, 1));
+	CON_Printf(AQUA, "span clipper: %.3fms per frame (%.2fx)\n",
+		(double)spantime / 1000000.0 / MAX(clipframes * CLIPBENCH_PASSES, 1),
+		spantime ? (double)listtime / spantime : 0.0);
+
+	if (mismatches || rangemismatches) {
+		CON_Printf(RED, "%i check results and %i frames of ranges differ\n",
+			mismatches, rangemismatches);
+	}
+	else {
+		CON_Printf(WHITE, "All check results and ranges match\n");
+	}
+}
+
+//
+// R_ClipBenchSave
+//
+
+static void R_ClipBenchSave(void) {
+	clipbenchheader_t header;
+	byte* buffer;
+	char* path;
+	int length;
+
+	dmemset(&header, 0, sizeof(header));
+	dmemcpy(header.magic, CLIPBENCH_MAGIC, sizeof(CLIPBENCH_MAGIC));
+	header.numevents = numclipevents;
+	header.numframes = clipframes;
+
+	length = sizeof(header) + numclipevents * sizeof(clipevent_t);
+	buffer = Z_Malloc(length, PU_STATIC, 0);
+	dmemcpy(buffer, &header, sizeof(header));
+	dmemcpy(buffer + sizeof(header), clipevents, numclipevents * sizeof(clipevent_t));
+
+	path = I_GetUserFile(CLIPBENCH_FILE);
+	if (!M_WriteFile(path, buffer, length)) {
+		CON_Warnf("R_ClipBenchSave: couldn't write %s\n", path);
+	}
+
+	free(path);
+	Z_Free(buffer);
+}
+
+//
+// R_ClipBenchLoad
+//
+
+static boolean R_ClipBenchLoad(void) {
+	clipbenchheader_t* header;
+	byte* buffer;
+	char* path;
+	int length;
+
+	path = I_GetUserFile(CLIPBENCH_FILE);
+	length = M_FileExists(path) ? M_ReadFile(path, &buffer) : -1;
+	free(path);
+
+	if (length < 0) {
+		return false;
+	}
+
+	header = (clipbenchheader_t*)buffer;
+
+	if (length < (int)sizeof(*header) ||
+		memcmp(header->magic, CLIPBENCH_MAGIC, sizeof(CLIPBENCH_MAGIC)) ||
+		header->numevents < 0 ||
+		length != (int)(sizeof(*header) + header->numevents * sizeof(clipevent_t))) {
+		Z_Free(buffer);
+		return false;
+	}
+
+	numclipevents = maxclipevents = header->numevents;
+	clipframes = header->numframes;
+	clipevents = realloc(clipevents, MAX(numclipevents, 1) * sizeof(clipevent_t));
+	dmemcpy(clipevents, buffer + sizeof(*header), numclipevents * sizeof(clipevent_t));
+
+	Z_Free(buffer);
+	return true;
+}
+
+//
+// R_ClipBenchRecord
+//
+
+void R_ClipBenchRecord(clipop_t op, angle_t start, angle_t end, boolean visible) {
+	clipevent_t* ev;
+
+	// every frame starts with a clear
+	if (op == CLIPOP_CLEAR) {
+		if (clipframes == clipframetarget) {
+			cliprecording = false;
+			R_ClipBenchSave();
+			R_ClipBenchReplay();
+			return;
+		}
+
+		clipframes++;
+	}
+	else if (!clipframes) {
+		// wait for the first frame to start
+		return;
+	}
+
+	if (numclipevents == maxclipevents) {
+		maxclipevents = maxclipevents ? maxclipevents * 2 : 4096;
+		clipevents = realloc(clipevents, maxclipevents * sizeof(clipevent_t));
+	}
+
+	ev = &clipevents[numclipevents++];
+	ev->op = op | (visible ? 0x100 : 0);
+	ev->start = start;
+	ev->end = end;
+}
+
+//
+// R_ClipBenchCommand
+//
+
+void R_ClipBenchCommand(const char* arg) {
+	if (arg && !dstricmp(arg, "replay")) {
+		if (!R_ClipBenchLoad()) {
+			CON_Printf(WHITE, "No recording in %s\n", CLIPBENCH_FILE);
+			return;
+		}
+
+		R_ClipBenchReplay();
+		return;
+	}
+
+	clipframetarget = arg ? datoi(arg) : CLIPBENCH_FRAMES;
+	if (clipframetarget <= 0) {
+		clipframetarget = CLIPBENCH_FRAMES;
+	}
+
+	numclipevents = 0;
+	clipframes = 0;
+	cliprecording = true;
+
+	CON_Printf(WHITE, "Recording %i frames of clipper calls\n", clipframetarget);
+}
@@ -0,0 +1,37 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __R_CLIPBENCH__
+#define __R_CLIPBENCH__
+
+#include "doomtype.h"
+#include "tables.h"
+
+typedef enum {
+	CLIPOP_CLEAR,
+	CLIPOP_ADD,
+	CLIPOP_CHECK
+} clipop_t;
+
+extern boolean cliprecording;
+
+void R_ClipBenchRecord(clipop_t op, angle_t start, angle_t end, boolean visible);
+
+// "clipbench [frames]" records that many frames of clipper calls and
+// replays them; "clipbench replay" replays the last saved recording
+void R_ClipBenchCommand(const char* arg);
+
+#endif
@@ -20,206 +20,233 @@
 //-----------------------------------------------------------------------------
 
 #include <stdlib.h>
+#include <string.h>
 #include <SDL3/SDL_opengl.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define FRUSTUM_NEON
+#endif
+
 #include "r_clipper.h"
+#include "r_clipbench.h"
 #include "doomtype.h"
 #include "tables.h"
 #include "r_main.h"
+#include "m_fixed.h"
+#include "m_misc.h"
 #include "dgl.h"
 
-static GLdouble viewMatrix[16];
-static GLdouble projMatrix[16];
 float frustum[6][4];
 
-typedef struct clipnode_s {
-	struct clipnode_s* prev, * next;
-	angle_t start, end;
-} clipnode_t;
+//
+// The six planes again, laid out one component per array and padded
+// to eight with planes every point is in front of, so the SIMD
+// kernels test all of them in two registers
+//
+
+#define FRUSTUM_PLANES  8
+
+typedef struct {
+	float x[FRUSTUM_PLANES];
+	float y[FRUSTUM_PLANES];
+	float z[FRUSTUM_PLANES];
+	float w[FRUSTUM_PLANES];
+} frustumplanes_t;
+
+static frustumplanes_t frustumplanes;
+
+// vertical extent used for node boxes, which only have x and y
+static float frustumfloor;
+static float frustumceiling;
 
 //
-// GhostlyDeath <10/3/11>
+// The clipper keeps the occluded angles as a sorted array of
+// disjoint spans. Touching or overlapping spans are merged when
+// added, so a range is hidden only when a single span covers it
+// and both lookups are a binary search.
 //
-clipnode_t* freelist = NULL;
-clipnode_t* clipnodes = NULL;
-clipnode_t* cliphead = NULL;
 
-static clipnode_t* R_Clipnode_NewRange(angle_t start, angle_t end);
-static boolean R_Clipper_IsRangeVisible(angle_t startAngle, angle_t endAngle);
-static void R_Clipper_AddClipRange(angle_t start, angle_t end);
-static void R_Clipper_RemoveRange(clipnode_t* range);
-static void R_Clipnode_Free(clipnode_t* node);
+static clipper_t viewclipper;
 
-static clipnode_t* R_Clipnode_GetNew(void) {
-	if (freelist) {
-		clipnode_t* p = freelist;
-		freelist = p->next;
-		return p;
-	}
+//
+// R_ClipperFindStart
+// Index of the first span starting after angle
+//
 
-	return malloc(sizeof(clipnode_t));
-}
+static int R_ClipperFindStart(const clipper_t* clipper, angle_t angle) {
+	int lo = 0;
+	int hi = clipper->numspans;
+
+	while (lo < hi) {
+		int mid = (lo + hi) >> 1;
+
+		if (clipper->spans[mid].start <= angle) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
 
-static clipnode_t* R_Clipnode_NewRange(angle_t start, angle_t end) {
-	clipnode_t* c = R_Clipnode_GetNew();
-	c->start = start;
-	c->end = end;
-	c->next = c->prev = NULL;
-	return c;
+	return lo;
 }
 
 //
-// R_Clipper_SafeCheckRange
+// R_ClipperFindEnd
+// Index of the first span ending at or after angle
 //
 
-boolean R_Clipper_SafeCheckRange(angle_t startAngle, angle_t endAngle) {
-	if (startAngle > endAngle)
-		return (R_Clipper_IsRangeVisible(startAngle, ANGLE_MAX) ||
-			R_Clipper_IsRangeVisible(0, endAngle));
+static int R_ClipperFindEnd(const clipper_t* clipper, angle_t angle) {
+	int lo = 0;
+	int hi = clipper->numspans;
+
+	while (lo < hi) {
+		int mid = (lo + hi) >> 1;
 
-	return R_Clipper_IsRangeVisible(startAngle, endAngle);
+		if (clipper->spans[mid].end < angle) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+
+	return lo;
 }
 
-static boolean R_Clipper_IsRangeVisible(angle_t startAngle, angle_t endAngle) {
-	clipnode_t* ci;
-	ci = cliphead;
+//
+// R_ClipperIsRangeVisible
+//
+
+boolean R_ClipperIsRangeVisible(const clipper_t* clipper, angle_t start, angle_t end) {
+	const clipspan_t* span;
+	int i;
 
-	if (endAngle == 0 && ci && ci->start == 0) {
+	if (clipper->full) {
 		return false;
 	}
 
-	while (ci != NULL && ci->start < endAngle) {
-		if (startAngle >= ci->start && endAngle <= ci->end) {
-			return false;
-		}
+	// only the last span starting at or before start can cover it
+	i = R_ClipperFindStart(clipper, start) - 1;
+	if (i < 0) {
+		return true;
+	}
 
-		ci = ci->next;
+	span = &clipper->spans[i];
+
+	if (span->end < end) {
+		return true;
 	}
 
-	return true;
+	// a span starting exactly where the range ends is not counted,
+	// except for the zero length range at angle 0
+	return !(span->start < end || (end == 0 && span->start == 0));
 }
 
-static void R_Clipnode_Free(clipnode_t* node) {
-	node->next = freelist;
-	freelist = node;
-}
+//
+// R_ClipperAddRange
+//
 
-static void R_Clipper_RemoveRange(clipnode_t* range) {
-	if (range == cliphead) {
-		cliphead = cliphead->next;
+void R_ClipperAddRange(clipper_t* clipper, angle_t start, angle_t end) {
+	clipspan_t* span;
+	int first;
+	int last;
+	int count;
+
+	if (clipper->full) {
+		return;
+	}
+
+	// spans from first up to last touch the new one
+	first = R_ClipperFindEnd(clipper, start);
+	last = R_ClipperFindStart(clipper, end) - 1;
+	count = last - first + 1;
+
+	if (count <= 0) {
+		if (clipper->numspans == clipper->maxspans) {
+			clipper->maxspans = clipper->maxspans ? clipper->maxspans * 2 : 64;
+			clipper->spans = realloc(clipper->spans, clipper->maxspans * sizeof(clipspan_t));
+		}
+
+		span = &clipper->spans[first];
+		memmove(span + 1, span, (clipper->numspans - first) * sizeof(clipspan_t));
+		clipper->numspans++;
+
+		span->start = start;
+		span->end = end;
 	}
 	else {
-		if (range->prev) {
-			range->prev->next = range->next;
+		span = &clipper->spans[first];
+
+		if (span->start > start) {
+			span->start = start;
 		}
 
-		if (range->next) {
-			range->next->prev = range->prev;
+		span->end = MAX(end, clipper->spans[last].end);
+
+		if (count > 1) {
+			memmove(span + 1, span + count,
+				(clipper->numspans - last - 1) * sizeof(clipspan_t));
+			clipper->numspans -= count - 1;
 		}
 	}
 
-	R_Clipnode_Free(range);
+	clipper->full = (clipper->numspans == 1 &&
+		clipper->spans[0].start == 0 && clipper->spans[0].end == ANGLE_MAX);
 }
 
 //
-// R_Clipper_SafeAddClipRange
+// R_ClipperClear
 //
 
-void R_Clipper_SafeAddClipRange(angle_t startangle, angle_t endangle) {
-	if (startangle > endangle) {
-		// The range has to added in two parts.
-		R_Clipper_AddClipRange(startangle, ANGLE_MAX);
-		R_Clipper_AddClipRange(0, endangle);
-	}
-	else {
-		// Add the range as usual.
-		R_Clipper_AddClipRange(startangle, endangle);
-	}
+void R_ClipperClear(clipper_t* clipper) {
+	clipper->numspans = 0;
+	clipper->full = false;
 }
 
-static void R_Clipper_AddClipRange(angle_t start, angle_t end) {
-	clipnode_t* node, * temp, * prevNode;
-	if (cliphead) {
-		//check to see if range contains any old ranges
-		node = cliphead;
-		while (node != NULL && node->start < end) {
-			if (node->start >= start && node->end <= end) {
-				temp = node;
-				node = node->next;
-				R_Clipper_RemoveRange(temp);
-			}
-			else {
-				if (node->start <= start && node->end >= end) {
-					return;
-				}
-				else {
-					node = node->next;
-				}
-			}
-		}
-		//check to see if range overlaps a range (or possibly 2)
-		node = cliphead;
-		while (node != NULL) {
-			if (node->start >= start && node->start <= end) {
-				node->start = start;
-				return;
-			}
-			if (node->end >= start && node->end <= end) {
-				// check for possible merger
-				if (node->next && node->next->start <= end) {
-					node->end = node->next->end;
-					R_Clipper_RemoveRange(node->next);
-				}
-				else {
-					node->end = end;
-				}
-
-				return;
-			}
-
-			node = node->next;
-		}
+//
+// R_Clipper_SafeCheckRange
+//
 
-		//just add range
-		node = cliphead;
-		prevNode = NULL;
+boolean R_Clipper_SafeCheckRange(angle_t startAngle, angle_t endAngle) {
+	boolean visible;
 
-		temp = R_Clipnode_NewRange(start, end);
+	if (startAngle > endAngle) {
+		visible = (R_ClipperIsRangeVisible(&viewclipper, startAngle, ANGLE_MAX) ||
+			R_ClipperIsRangeVisible(&viewclipper, 0, endAngle));
+	}
+	else {
+		visible = R_ClipperIsRangeVisible(&viewclipper, startAngle, endAngle);
+	}
 
-		while (node != NULL && node->start < end) {
-			prevNode = node;
-			node = node->next;
-		}
+	if (cliprecording) {
+		R_ClipBenchRecord(CLIPOP_CHECK, startAngle, endAngle, visible);
+	}
 
-		temp->next = node;
+	return visible;
+}
 
-		if (node == NULL) {
-			temp->prev = prevNode;
+//
+// R_Clipper_SafeAddClipRange
+//
 
-			if (prevNode) {
-				prevNode->next = temp;
-			}
+void R_Clipper_SafeAddClipRange(angle_t startangle, angle_t endangle) {
+	if (cliprecording) {
+		R_ClipBenchRecord(CLIPOP_ADD, startangle, endangle, false);
+	}
 
-			if (!cliphead) {
-				cliphead = temp;
-			}
-		}
-		else {
-			if (node == cliphead) {
-				cliphead->prev = temp;
-				cliphead = temp;
-			}
-			else {
-				temp->prev = prevNode;
-				prevNode->next = temp;
-				node->prev = temp;
-			}
-		}
+	if (startangle > endangle) {
+		// The range has to added in two parts.
+		R_ClipperAddRange(&viewclipper, startangle, ANGLE_MAX);
+		R_ClipperAddRange(&viewclipper, 0, endangle);
 	}
 	else {
-		temp = R_Clipnode_NewRange(start, end);
-		cliphead = temp;
-		return;
+		// Add the range as usual.
+		R_ClipperAddRange(&viewclipper, startangle, endangle);
 	}
 }
 
@@ -228,16 +255,11 @@ static void R_Clipper_AddClipRange(angle_t start, angle_t end) {
 //
 
 void R_Clipper_Clear(void) {
-	clipnode_t* node = cliphead;
-	clipnode_t* temp;
-
-	while (node != NULL) {
-		temp = node;
-		node = node->next;
-		R_Clipnode_Free(temp);
+	if (cliprecording) {
+		R_ClipBenchRecord(CLIPOP_CLEAR, 0, 0, false);
 	}
 
-	cliphead = NULL;
+	R_ClipperClear(&viewclipper);
 }
 
 //
@@ -268,6 +290,8 @@ angle_t R_FrustumAngle(void) {
 
 //
 // R_FrustrumSetup
+// Extracts the planes from the renderer's own matrices rather than
+// reading them back from the driver
 //
 
 #define CALCMATRIX(a, b, c, d, e, f, g, h)\
@@ -276,11 +300,9 @@ viewMatrix[c] * projMatrix[d] + \
 viewMatrix[e] * projMatrix[f] + \
 viewMatrix[g] * projMatrix[h])
 
-void R_FrustrumSetup(void) {
+void R_FrustrumSetup(const rfloat* projMatrix, const rfloat* viewMatrix) {
 	float clip[16];
-
-	dglGetDoublev(GL_PROJECTION_MATRIX, projMatrix);
-	dglGetDoublev(GL_MODELVIEW_MATRIX, viewMatrix);
+	int p;
 
 	clip[0] = CALCMATRIX(0, 0, 1, 4, 2, 8, 3, 12);
 	clip[1] = CALCMATRIX(0, 1, 1, 5, 2, 9, 3, 13);
@@ -337,14 +359,35 @@ void R_FrustrumSetup(void) {
 	frustum[5][1] = clip[7] + clip[6];
 	frustum[5][2] = clip[11] + clip[10];
 	frustum[5][3] = clip[15] + clip[14];
+
+	for (p = 0; p < FRUSTUM_PLANES; p++) {
+		boolean used = p < 6;
+
+		frustumplanes.x[p] = used ? frustum[p][0] : 0.0f;
+		frustumplanes.y[p] = used ? frustum[p][1] : 0.0f;
+		frustumplanes.z[p] = used ? frustum[p][2] : 0.0f;
+		frustumplanes.w[p] = used ? frustum[p][3] : 1.0f;
+	}
 }
 
 //
-// R_FrustrumTestVertex
-// Returns false if polygon is not within the view frustrum
+// R_FrustrumSetHeights
+// Lowest floor and highest ceiling node boxes are tested with
 //
 
-boolean R_FrustrumTestVertex(vtx_t* vertex, int count) {
+void R_FrustrumSetHeights(fixed_t floorheight, fixed_t ceilingheight) {
+	frustumfloor = F2D3D(floorheight);
+	frustumceiling = F2D3D(ceilingheight);
+}
+
+//
+// R_FrustrumTestVertexScalar
+// Returns false if polygon is not within the view frustrum.
+// The plain version of R_FrustrumTestVertex, kept to check the
+// SIMD kernels against.
+//
+
+boolean R_FrustrumTestVertexScalar(vtx_t* vertex, int count) {
 	int p;
 	int i;
 
@@ -367,3 +410,162 @@ boolean R_FrustrumTestVertex(vtx_t* vertex, int count) {
 
 	return true;
 }
+
+//
+// R_FrustrumTestVertex
+// Same test as R_FrustrumTestVertexScalar, one vertex against all
+// planes at a time. Bit p of front is set once a vertex is in front
+// of plane p; the polygon is outside if any plane never gets one.
+//
+
+boolean R_FrustrumTestVertex(vtx_t* vertex, int count) {
+#if defined(FRUSTUM_SSE2)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 px0 = _mm_loadu_ps(&frustumplanes.x[0]);
+	const __m128 py0 = _mm_loadu_ps(&frustumplanes.y[0]);
+	const __m128 pz0 = _mm_loadu_ps(&frustumplanes.z[0]);
+	const __m128 pw0 = _mm_loadu_ps(&frustumplanes.w[0]);
+	const __m128 px1 = _mm_loadu_ps(&frustumplanes.x[4]);
+	const __m128 py1 = _mm_loadu_ps(&frustumplanes.y[4]);
+	const __m128 pz1 = _mm_loadu_ps(&frustumplanes.z[4]);
+	const __m128 pw1 = _mm_loadu_ps(&frustumplanes.w[4]);
+	int front = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		__m128 x = _mm_set1_ps(vertex[i].x);
+		__m128 y = _mm_set1_ps(vertex[i].y);
+		__m128 z = _mm_set1_ps(vertex[i].z);
+		__m128 d0;
+		__m128 d1;
+
+		d0 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px0, x),
+			_mm_mul_ps(py0, y)), _mm_mul_ps(pz0, z)), pw0);
+		d1 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px1, x),
+			_mm_mul_ps(py1, y)), _mm_mul_ps(pz1, z)), pw1);
+
+		front |= _mm_movemask_ps(_mm_cmpgt_ps(d0, zero)) |
+			(_mm_movemask_ps(_mm_cmpgt_ps(d1, zero)) << 4);
+
+		if (front == 0xff) {
+			return true;
+		}
+	}
+
+	return false;
+#elif defined(FRUSTUM_NEON)
+	static const uint32_t bits[4] = { 1, 2, 4, 8 };
+	const uint32x4_t bit = vld1q_u32(bits);
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	const float32x4_t px0 = vld1q_f32(&frustumplanes.x[0]);
+	const float32x4_t py0 = vld1q_f32(&frustumplanes.y[0]);
+	const float32x4_t pz0 = vld1q_f32(&frustumplanes.z[0]);
+	const float32x4_t pw0 = vld1q_f32(&frustumplanes.w[0]);
+	const float32x4_t px1 = vld1q_f32(&frustumplanes.x[4]);
+	const float32x4_t py1 = vld1q_f32(&frustumplanes.y[4]);
+	const float32x4_t pz1 = vld1q_f32(&frustumplanes.z[4]);
+	const float32x4_t pw1 = vld1q_f32(&frustumplanes.w[4]);
+	uint32x4_t front0 = vdupq_n_u32(0);
+	uint32x4_t front1 = vdupq_n_u32(0);
+	int i;
+
+	for (i = 0; i < count; i++) {
+		float32x4_t x = vdupq_n_f32(vertex[i].x);
+		float32x4_t y = vdupq_n_f32(vertex[i].y);
+		float32x4_t z = vdupq_n_f32(vertex[i].z);
+		float32x4_t d0;
+		float32x4_t d1;
+
+		// separate multiplies and adds, to round like the scalar test
+		d0 = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(px0, x),
+			vmulq_f32(py0, y)), vmulq_f32(pz0, z)), pw0);
+		d1 = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(px1, x),
+			vmulq_f32(py1, y)), vmulq_f32(pz1, z)), pw1);
+
+		front0 = vorrq_u32(front0, vcgtq_f32(d0, zero));
+		front1 = vorrq_u32(front1, vcgtq_f32(d1, zero));
+	}
+
+	return (vaddvq_u32(vandq_u32(front0, bit)) |
+		(vaddvq_u32(vandq_u32(front1, bit)) << 4)) == 0xff;
+#else
+	return R_FrustrumTestVertexScalar(vertex, count);
+#endif
+}
+
+//
+// R_FrustrumTestBox
+// Tests a node's bounding box, stretched from the lowest floor to
+// the highest ceiling, against every plane at once. The corner
+// furthest in front of each plane decides; if it is not in front,
+// nothing in the box is.
+//
+
+boolean R_FrustrumTestBox(fixed_t* bbox) {
+	float xmin = F2D3D(bbox[BOXLEFT]) - FRUSTUM_BOXMARGIN;
+	float xmax = F2D3D(bbox[BOXRIGHT]) + FRUSTUM_BOXMARGIN;
+	float ymin = F2D3D(bbox[BOXBOTTOM]) - FRUSTUM_BOXMARGIN;
+	float ymax = F2D3D(bbox[BOXTOP]) + FRUSTUM_BOXMARGIN;
+	float zmin = frustumfloor;
+	float zmax = frustumceiling + FRUSTUM_BOXCEILING;
+#if defined(FRUSTUM_SSE2)
+	const __m128 zero = _mm_setzero_ps();
+	__m128 d0;
+	__m128 d1;
+
+#define BOX_EXTENT(p, lo, hi) _mm_max_ps(_mm_mul_ps(p, _mm_set1_ps(lo)), _mm_mul_ps(p, _mm_set1_ps(hi)))
+
+	d0 = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+		BOX_EXTENT(_mm_loadu_ps(&frustumplanes.x[0]), xmin, xmax),
+		BOX_EXTENT(_mm_loadu_ps(&frustumplanes.y[0]), ymin, ymax)),
+		BOX_EXTENT(_mm_loadu_ps(&frustumplanes.z[0]), zmin, zmax)),
+		_mm_loadu_ps(&frustumplanes.w[0]));
+	d1 = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+		BOX_EXTENT(_mm_loadu_ps(&frustumplanes.x[4]), xmin, xmax),
+		BOX_EXTENT(_mm_loadu_ps(&frustumplanes.y[4]), ymin, ymax)),
+		BOX_EXTENT(_mm_loadu_ps(&frustumplanes.z[4]), zmin, zmax)),
+		_mm_loadu_ps(&frustumplanes.w[4]));
+
+#undef BOX_EXTENT
+
+	return (_mm_movemask_ps(_mm_cmpgt_ps(d0, zero)) &
+		_mm_movemask_ps(_mm_cmpgt_ps(d1, zero))) == 0xf;
+#elif defined(FRUSTUM_NEON)
+	float32x4_t d0;
+	float32x4_t d1;
+
+#define BOX_EXTENT(p, lo, hi) vmaxq_f32(vmulq_n_f32(p, lo), vmulq_n_f32(p, hi))
+
+	d0 = vaddq_f32(vaddq_f32(vaddq_f32(
+		BOX_EXTENT(vld1q_f32(&frustumplanes.x[0]), xmin, xmax),
+		BOX_EXTENT(vld1q_f32(&frustumplanes.y[0]), ymin, ymax)),
+		BOX_EXTENT(vld1q_f32(&frustumplanes.z[0]), zmin, zmax)),
+		vld1q_f32(&frustumplanes.w[0]));
+	d1 = vaddq_f32(vaddq_f32(vaddq_f32(
+		BOX_EXTENT(vld1q_f32(&frustumplanes.x[4]), xmin, xmax),
+		BOX_EXTENT(vld1q_f32(&frustumplanes.y[4]), ymin, ymax)),
+		BOX_EXTENT(vld1q_f32(&frustumplanes.z[4]), zmin, zmax)),
+		vld1q_f32(&frustumplanes.w[4]));
+
+#undef BOX_EXTENT
+
+	return vminvq_u32(vandq_u32(vcgtq_f32(d0, vdupq_n_f32(0.0f)),
+		vcgtq_f32(d1, vdupq_n_f32(0.0f)))) != 0;
+#else
+	int p;
+
+	for (p = 0; p < 6; p++) {
+		float d = frustumplanes.w[p];
+
+		d += MAX(frustumplanes.x[p] * xmin, frustumplanes.x[p] * xmax);
+		d += MAX(frustumplanes.y[p] * ymin, frustumplanes.y[p] * ymax);
+		d += MAX(frustumplanes.z[p] * zmin, frustumplanes.z[p] * zmax);
+
+		if (d <= 0) {
+			return false;
+		}
+	}
+
+	return true;
+#endif
+}
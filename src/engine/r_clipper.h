@@ -21,6 +21,21 @@
 #include "tables.h"
 #include "gl_main.h"
 
+typedef struct {
+	angle_t     start;
+	angle_t     end;
+} clipspan_t;
+
+typedef struct {
+	clipspan_t* spans;      // sorted, disjoint and not touching
+	int         numspans;
+	int         maxspans;
+	boolean     full;       // one span covering every angle
+} clipper_t;
+
+boolean     R_ClipperIsRangeVisible(const clipper_t* clipper, angle_t start, angle_t end);
+void        R_ClipperAddRange(clipper_t* clipper, angle_t start, angle_t end);
+void        R_ClipperClear(clipper_t* clipper);
 
 boolean    R_Clipper_SafeCheckRange(angle_t startAngle, angle_t endAngle);
 void        R_Clipper_SafeAddClipRange(angle_t startangle, angle_t endangle);
@@ -28,8 +43,15 @@ void        R_Clipper_Clear(void);
 
 extern float frustum[6][4];
 
+// room left around node boxes for sprites hanging over their edges
+#define FRUSTUM_BOXMARGIN   128.0f
+#define FRUSTUM_BOXCEILING  256.0f
+
 angle_t     R_FrustumAngle(void);
-void        R_FrustrumSetup(void);
+void        R_FrustrumSetup(const rfloat* projMatrix, const rfloat* viewMatrix);
+void        R_FrustrumSetHeights(fixed_t floorheight, fixed_t ceilingheight);
 boolean    R_FrustrumTestVertex(vtx_t* vertex, int count);
+boolean    R_FrustrumTestVertexScalar(vtx_t* vertex, int count);
+boolean    R_FrustrumTestBox(fixed_t* bbox);
 
 #endif
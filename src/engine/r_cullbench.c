@@ -0,0 +1,495 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Culling check. Records a camera path and walks the BSP along
+//      it twice without drawing: once culling nodes by angle only,
+//      as the renderer used to, and once with the frustum box test
+//      in front of it. Reports how much each visits and whether the
+//      frustum test ever loses a leaf that would reach the screen.
+//
+//-----------------------------------------------------------------------------
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "r_cullbench.h"
+#include "r_clipper.h"
+#include "r_clipbench.h"
+#include "r_main.h"
+#include "doomdef.h"
+#include "doomstat.h"
+#include "z_zone.h"
+#include "m_fixed.h"
+#include "m_misc.h"
+#include "i_system.h"
+#include "i_system_io.h"
+#include "con_console.h"
+
+#define CULLBENCH_MAGIC     "D64CULL"
+#define CULLBENCH_FILE      "cullpath.dat"
+#define CULLBENCH_FRAMES    256
+#define CULLBENCH_PASSES    8
+
+typedef struct {
+	int32_t     x;
+	int32_t     y;
+	int32_t     z;
+	uint32_t    angle;
+	uint32_t    pitch;
+} cullframe_t;
+
+typedef struct {
+	char        magic[8];
+	int32_t     numframes;
+	int32_t     numnodes;
+	int32_t     numsubsectors;
+} cullbenchheader_t;
+
+typedef struct {
+	int         nodes;
+	int         leafs;
+	int         drawn;
+} cullstats_t;
+
+boolean cullrecording = false;
+
+static cullframe_t* cullframes = NULL;
+static int numcullframes = 0;
+static int maxcullframes = 0;
+static int cullframetarget = 0;
+
+static vtx_t* cullverts = NULL;
+static byte* culldrawn = NULL;
+static boolean cullverify = false;
+static int cullmismatches = 0;
+static fixed_t cullfloor;
+static fixed_t cullceiling;
+
+//
+// R_CullBenchTest
+// In the frustum pass every SIMD result is checked against the
+// scalar test while verifying
+//
+
+static boolean R_CullBenchTest(vtx_t* v, int count, boolean frustum) {
+	boolean visible;
+
+	if (!frustum) {
+		return R_FrustrumTestVertexScalar(v, count);
+	}
+
+	visible = R_FrustrumTestVertex(v, count);
+
+	if (cullverify && visible != R_FrustrumTestVertexScalar(v, count)) {
+		cullmismatches++;
+	}
+
+	return visible;
+}
+
+//
+// R_CullBenchLeaf
+// A leaf counts as drawn if a flat or a wall that survives the
+// clipper would make it past the frustum test
+//
+
+static void R_CullBenchLeaf(int num, boolean frustum, cullstats_t* stats) {
+	subsector_t* sub = &subsectors[num];
+	sector_t* sec = sub->sector;
+	boolean visible = false;
+	vtx_t quad[4];
+	int i;
+
+	stats->leafs++;
+
+	if (sub->numleafs < 3) {
+		return;
+	}
+
+	for (i = 0; i < sub->numleafs; i++) {
+		leaf_t* leaf = &leafs[sub->leaf + i];
+		seg_t* seg = leaf->seg;
+
+		cullverts[i].x = F2D3D(leaf->vertex->x);
+		cullverts[i].y = F2D3D(leaf->vertex->y);
+		cullverts[i].z = F2D3D(sec->floorheight);
+
+		if (seg == NULL || !R_ClipSeg(seg) || visible) {
+			continue;
+		}
+
+		quad[0].x = quad[1].x = F2D3D(seg->v1->x);
+		quad[0].y = quad[1].y = F2D3D(seg->v1->y);
+		quad[2].x = quad[3].x = F2D3D(seg->v2->x);
+		quad[2].y = quad[3].y = F2D3D(seg->v2->y);
+		quad[0].z = quad[3].z = F2D3D(seg->frontsector->ceilingheight);
+		quad[1].z = quad[2].z = F2D3D(seg->frontsector->floorheight);
+
+		visible = R_CullBenchTest(quad, 4, frustum);
+	}
+
+	if (!visible) {
+		visible = R_CullBenchTest(cullverts, sub->numleafs, frustum);
+	}
+
+	if (!visible) {
+		for (i = 0; i < sub->numleafs; i++) {
+			cullverts[i].z = F2D3D(sec->ceilingheight);
+		}
+
+		visible = R_CullBenchTest(cullverts, sub->numleafs, frustum);
+	}
+
+	if (visible) {
+		stats->drawn++;
+
+		if (culldrawn) {
+			culldrawn[num] |= frustum ? 2 : 1;
+		}
+	}
+}
+
+//
+// R_CullBenchNode
+// R_RenderBSPNode without the drawing, with the node test picked
+// by the pass
+//
+
+static void R_CullBenchNode(int bspnum, boolean frustum, cullstats_t* stats) {
+	node_t* bsp;
+	int     side;
+
+	while (!(bspnum & NF_SUBSECTOR)) {
+		bsp = &nodes[bspnum];
+		stats->nodes++;
+
+		side = R_PointOnSide(viewx, viewy, bsp);
+
+		if (frustum ? R_CheckBBox(bsp->bbox[side]) : R_CheckBBoxAngles(bsp->bbox[side])) {
+			R_CullBenchNode(bsp->children[side], frustum, stats);
+		}
+
+		if (!(frustum ? R_CheckBBox(bsp->bbox[side ^ 1]) : R_CheckBBoxAngles(bsp->bbox[side ^ 1]))) {
+			return;
+		}
+
+		bspnum = bsp->children[side ^ 1];
+	}
+
+	if (bspnum == -1) {
+		bspnum = 0;
+	}
+
+	R_CullBenchLeaf(bspnum & ~NF_SUBSECTOR, frustum, stats);
+}
+
+//
+// R_CullBenchSetView
+// Moves the camera to a recorded frame and sets up clipping the
+// way R_RenderPlayerView does
+//
+
+static void R_CullBenchSetView(const cullframe_t* frame) {
+	angle_t angle;
+
+	viewx = frame->x;
+	viewy = frame->y;
+	viewz = frame->z;
+	viewangle = frame->angle;
+	viewpitch = frame->pitch;
+
+	fviewx = F2D3D(viewx);
+	fviewy = F2D3D(viewy);
+	fviewz = F2D3D(viewz);
+
+	validcount++;
+
+	angle = R_FrustumAngle();
+	R_Clipper_Clear();
+	R_Clipper_SafeAddClipRange(viewangle + angle, viewangle - angle);
+
+	R_BuildViewMatrices();
+	R_FrustrumSetHeights(cullfloor, cullceiling);
+	R_FrustrumSetup(projmatrix, viewmatrix);
+}
+
+//
+// R_CullBenchRun
+//
+
+static uint64_t R_CullBenchRun(boolean frustum, int passes, cullstats_t* stats) {
+	uint64_t start;
+	int pass;
+	int i;
+
+	dmemset(stats, 0, sizeof(*stats));
+	start = I_GetTimeNS();
+
+	for (pass = 0; pass < passes; pass++) {
+		for (i = 0; i < numcullframes; i++) {
+			R_CullBenchSetView(&cullframes[i]);
+			R_CullBenchNode(numnodes - 1, frustum, stats);
+		}
+	}
+
+	return I_GetTimeNS() - start;
+}
+
+//
+// R_CullBenchVerify
+// Walks every frame both ways and returns the number of leafs the
+// angle test drew that the frustum test lost
+//
+
+static int R_CullBenchVerify(void) {
+	cullstats_t stats;
+	int missed = 0;
+	int i;
+	int j;
+
+	culldrawn = Z_Malloc(numsubsectors, PU_STATIC, 0);
+	cullverify = true;
+	cullmismatches = 0;
+
+	for (i = 0; i < numcullframes; i++) {
+		dmemset(culldrawn, 0, numsubsectors);
+
+		R_CullBenchSetView(&cullframes[i]);
+		R_CullBenchNode(numnodes - 1, false, &stats);
+		R_CullBenchSetView(&cullframes[i]);
+		R_CullBenchNode(numnodes - 1, true, &stats);
+
+		for (j = 0; j < numsubsectors; j++) {
+			if (culldrawn[j] == 1) {
+				if (!missed++) {
+					CON_Printf(RED, "Frame %i: leaf %i lost by the frustum test\n", i, j);
+				}
+			}
+		}
+	}
+
+	cullverify = false;
+	Z_Free(culldrawn);
+	culldrawn = NULL;
+
+	return missed;
+}
+
+//
+// R_CullBenchReplay
+//
+
+static void R_CullBenchReplay(void) {
+	fixed_t savex = viewx;
+	fixed_t savey = viewy;
+	fixed_t savez = viewz;
+	angle_t saveangle = viewangle;
+	angle_t savepitch = viewpitch;
+	boolean saverecording = cliprecording;
+	cullstats_t anglestats;
+	cullstats_t frustumstats;
+	uint64_t angletime;
+	uint64_t frustumtime;
+	double frames;
+	int maxverts = 0;
+	int missed;
+	int i;
+
+	cullfloor = INT_MAX;
+	cullceiling = INT_MIN;
+
+	for (i = 0; i < numsectors; i++) {
+		cullfloor = MIN(cullfloor, sectors[i].floorheight);
+		cullceiling = MAX(cullceiling, sectors[i].ceilingheight);
+	}
+
+	for (i = 0; i < numsubsectors; i++) {
+		maxverts = MAX(maxverts, subsectors[i].numleafs);
+	}
+
+	// keep a clipbench recording from picking up these frames
+	cliprecording = false;
+	cullverts = Z_Malloc(MAX(maxverts, 1) * sizeof(vtx_t), PU_STATIC, 0);
+
+	missed = R_CullBenchVerify();
+	angletime = R_CullBenchRun(false, CULLBENCH_PASSES, &anglestats);
+	frustumtime = R_CullBenchRun(true, CULLBENCH_PASSES, &frustumstats);
+
+	Z_Free(cullverts);
+	cullverts = NULL;
+	cliprecording = saverecording;
+
+	viewx = savex;
+	viewy = savey;
+	viewz = savez;
+	viewangle = saveangle;
+	viewpitch = savepitch;
+	fviewx = F2D3D(viewx);
+	fviewy = F2D3D(viewy);
+	fviewz = F2D3D(viewz);
+	validcount++;
+
+	frames = (double)MAX(numcullframes * CULLBENCH_PASSES, 1);
+
+	CON_Printf(GREEN, "cullcheck: %i frames, %i passes\n", numcullframes, CULLBENCH_PASSES);
+	CON_Printf(AQUA, "angles:  %.1f nodes %.1f leafs %.1f drawn, %.3fms per frame\n",
+		anglestats.nodes / frames, anglestats.leafs / frames, anglestats.drawn / frames,
+		(double)angletime / 1000000.0 / frames);
+	CON_Printf(AQUA, "frustum: %.1f nodes %.1f leafs %.1f drawn, %.3fms per frame (%.2fx)\n",
+		frustumstats.nodes / frames, frustumstats.leafs / frames, frustumstats.drawn / frames,
+		(double)frustumtime / 1000000.0 / frames,
+		frustumtime ? (double)angletime / frustumtime : 0.0);
+
+	if (missed || cullmismatches) {
+		CON_Printf(RED, "%i leafs lost, %i SIMD results differ from scalar\n",
+			missed, cullmismatches);
+	}
+	else {
+		CON_Printf(WHITE, "No drawn leafs lost and all SIMD results match\n");
+	}
+}
+
+//
+// R_CullBenchSave
+//
+
+static void R_CullBenchSave(void) {
+	cullbenchheader_t header;
+	byte* buffer;
+	char* path;
+	int length;
+
+	dmemset(&header, 0, sizeof(header));
+	dmemcpy(header.magic, CULLBENCH_MAGIC, sizeof(CULLBENCH_MAGIC));
+	header.numframes = numcullframes;
+	header.numnodes = numnodes;
+	header.numsubsectors = numsubsectors;
+
+	length = sizeof(header) + numcullframes * sizeof(cullframe_t);
+	buffer = Z_Malloc(length, PU_STATIC, 0);
+	dmemcpy(buffer, &header, sizeof(header));
+	dmemcpy(buffer + sizeof(header), cullframes, numcullframes * sizeof(cullframe_t));
+
+	path = I_GetUserFile(CULLBENCH_FILE);
+	if (!M_WriteFile(path, buffer, length)) {
+		CON_Warnf("R_CullBenchSave: couldn't write %s\n", path);
+	}
+
+	free(path);
+	Z_Free(buffer);
+}
+
+//
+// R_CullBenchLoad
+//
+
+static boolean R_CullBenchLoad(void) {
+	cullbenchheader_t* header;
+	byte* buffer;
+	char* path;
+	int length;
+
+	path = I_GetUserFile(CULLBENCH_FILE);
+	length = M_FileExists(path) ? M_ReadFile(path, &buffer) : -1;
+	free(path);
+
+	if (length < 0) {
+		CON_Printf(WHITE, "No camera path in %s\n", CULLBENCH_FILE);
+		return false;
+	}
+
+	header = (cullbenchheader_t*)buffer;
+
+	if (length < (int)sizeof(*header) ||
+		memcmp(header->magic, CULLBENCH_MAGIC, sizeof(CULLBENCH_MAGIC)) ||
+		header->numframes < 0 ||
+		length != (int)(sizeof(*header) + header->numframes * sizeof(cullframe_t))) {
+		CON_Printf(WHITE, "%s is not a camera path\n", CULLBENCH_FILE);
+		Z_Free(buffer);
+		return false;
+	}
+
+	if (header->numnodes != numnodes || header->numsubsectors != numsubsectors) {
+		CON_Printf(WHITE, "%s was recorded on another map\n", CULLBENCH_FILE);
+		Z_Free(buffer);
+		return false;
+	}
+
+	numcullframes = maxcullframes = header->numframes;
+	cullframes = realloc(cullframes, MAX(numcullframes, 1) * sizeof(cullframe_t));
+	dmemcpy(cullframes, buffer + sizeof(*header), numcullframes * sizeof(cullframe_t));
+
+	Z_Free(buffer);
+	return true;
+}
+
+//
+// R_CullBenchRecord
+//
+
+void R_CullBenchRecord(void) {
+	cullframe_t* frame;
+
+	if (numcullframes == maxcullframes) {
+		maxcullframes = maxcullframes ? maxcullframes * 2 : 256;
+		cullframes = realloc(cullframes, maxcullframes * sizeof(cullframe_t));
+	}
+
+	frame = &cullframes[numcullframes++];
+	frame->x = viewx;
+	frame->y = viewy;
+	frame->z = viewz;
+	frame->angle = viewangle;
+	frame->pitch = viewpitch;
+
+	if (numcullframes == cullframetarget) {
+		cullrecording = false;
+		R_CullBenchSave();
+		R_CullBenchReplay();
+	}
+}
+
+//
+// R_CullBenchCommand
+//
+
+void R_CullBenchCommand(const char* arg) {
+	if (gamestate != GS_LEVEL) {
+		CON_Printf(WHITE, "cullcheck needs a level loaded\n");
+		return;
+	}
+
+	if (arg && !dstricmp(arg, "replay")) {
+		if (R_CullBenchLoad()) {
+			R_CullBenchReplay();
+		}
+
+		return;
+	}
+
+	cullframetarget = arg ? datoi(arg) : CULLBENCH_FRAMES;
+	if (cullframetarget <= 0) {
+		cullframetarget = CULLBENCH_FRAMES;
+	}
+
+	numcullframes = 0;
+	cullrecording = true;
+
+	CON_Printf(WHITE, "Recording %i frames of camera path\n", cullframetarget);
+}
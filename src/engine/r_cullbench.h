@@ -0,0 +1,31 @@
+// Emacs style mode select   -*- C -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright(C) 2007-2012 Samuel Villarreal
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __R_CULLBENCH__
+#define __R_CULLBENCH__
+
+#include "doomtype.h"
+
+extern boolean cullrecording;
+
+// Call once the view for the frame has been set up.
+void R_CullBenchRecord(void);
+
+// "cullcheck [frames]" records that many frames of camera path and
+// replays it; "cullcheck replay" replays the last saved path
+void R_CullBenchCommand(const char* arg);
+
+#endif
@@ -22,25 +22,53 @@
 #include "r_lights.h"
 #include "doomstat.h"
 #include "i_swap.h"
+#include "i_shaders.h"
 #include "p_local.h"
 #include "con_cvar.h"
+#include "z_zone.h"
+#include "dgl.h"
 
-rcolor    bspColor[5];
+lightvtx_t* bspLight = NULL;
 
 CVAR_CMD(i_brightness, 100) {
 	R_RefreshBrightness();
 }
 CVAR(i_overbright, 0);
+CVAR(r_shaderlights, 1);
 
 CVAR_EXTERNAL(r_texturecombiner);
 
+//
+// Light table
+//
+// The active colour of every light, one RGBA texel each, in a
+// texture the world shader looks lights up in. Only entries that
+// changed since the last tic are sent to the driver.
+//
+
+static byte* lighttable = NULL;
+static int lighttablerows = 0;
+static int lighttabletic = -1;
+static boolean lighttabledirty = true;
+static dtexture lighttexture = 0;
+
 //
 // R_LightToVertex
+// Fills bspLight instead while walls are drawn with shader lights
 //
 
 void R_LightToVertex(vtx_t* v, int idx, word c) {
 	int i = 0;
 
+	if (bspLight) {
+		for (i = 0; i < c; i++) {
+			R_SetLightVertex(&bspLight[i], idx, idx, 1.0f);
+			*(rcolor*)&v[i].r = D_RGBA(0xff, 0xff, 0xff, 0xff);
+		}
+
+		return;
+	}
+
 	for (i = 0; i < c; i++) {
 		v[i].a = 0xff;
 		if (i_overbright.value) {
@@ -232,6 +260,8 @@ void R_SetLightFactor(float lightfactor) {
 		light->active_g = light->base_g;
 		light->active_b = light->base_b;
 	}
+
+	lighttabledirty = true;
 }
 
 //
@@ -259,48 +289,70 @@ rcolor R_GetSectorLight(byte alpha, word ptr) {
 }
 
 //
-// R_SplitLineColor
+// R_SetLightVertex
 //
 
-rcolor R_SplitLineColor(seg_t* line, byte side) {
+void R_SetLightVertex(lightvtx_t* l, int upper, int lower, float blend) {
+	l->upper = (rfloat)upper;
+	l->lower = (rfloat)lower;
+	l->blend = blend;
+}
+
+//
+// R_LightVertexColor
+// CPU version of the lookup and blend the world shader does, used
+// when shader lights are off or unavailable
+//
+
+rcolor R_LightVertexColor(const lightvtx_t* l) {
+	light_t* upper;
+	light_t* lower;
+	float f;
+
+	if (i_overbright.value) {
+		return D_RGBA(0xff, 0xff, 0xff, 0xff);
+	}
+
+	upper = &lights[(int)l->upper];
+	lower = &lights[(int)l->lower];
+
+	if (upper == lower) {
+		return D_RGBA(upper->active_r, upper->active_g, upper->active_b, 0xff);
+	}
+
+	f = 1.0f - l->blend;
+
+	return D_RGBA(
+		(byte)MAX(MIN(upper->active_r * l->blend + lower->active_r * f, 0xff), 0),
+		(byte)MAX(MIN(upper->active_g * l->blend + lower->active_g * f, 0xff), 0),
+		(byte)MAX(MIN(upper->active_b * l->blend + lower->active_b * f, 0xff), 0),
+		0xff);
+}
+
+//
+// R_SplitLineBlend
+// How much of the upper wall colour reaches the split point of a
+// blended top or bottom texture
+//
+
+static float R_SplitLineBlend(seg_t* line, byte side) {
 	int height = 0;
-	int sideheight1 = 0;
-	int sideheight2 = 0;
-	float r1, g1, b1;
-	float r2, g2, b2;
-	rcolor d3dc1 = 0;
-	rcolor d3dc2 = 0;
+	int sideheight = 0;
 
 	height = (line->frontsector->ceilingheight - line->frontsector->floorheight) / FRACUNIT;
-	d3dc1 = LONG(bspColor[LIGHT_UPRWALL]);
-	d3dc2 = LONG(bspColor[LIGHT_LWRWALL]);
-
-	b1 = (float)((d3dc1 >> 16) & 0xff);
-	g1 = (float)((d3dc1 >> 8) & 0xff);
-	r1 = (float)(d3dc1 & 0xff);
 
-	b2 = (float)((d3dc2 >> 16) & 0xff);
-	g2 = (float)((d3dc2 >> 8) & 0xff);
-	r2 = (float)(d3dc2 & 0xff);
+	if (height == 0) {
+		return 1.0f;
+	}
 
 	if (side == 1) {      /*TOP*/
-		sideheight1 = (line->backsector->ceilingheight - line->frontsector->floorheight) / FRACUNIT;
-		sideheight2 = (line->frontsector->ceilingheight - line->backsector->ceilingheight) / FRACUNIT;
+		sideheight = (line->backsector->ceilingheight - line->frontsector->floorheight) / FRACUNIT;
 	}
 	else if (side == 2) {  /*BOTTOM*/
-		sideheight1 = (line->backsector->floorheight - line->frontsector->floorheight) / FRACUNIT;
-		sideheight2 = (line->frontsector->ceilingheight - line->backsector->floorheight) / FRACUNIT;
+		sideheight = (line->backsector->floorheight - line->frontsector->floorheight) / FRACUNIT;
 	}
 
-	r1 = ((r1 / height) * sideheight1);
-	g1 = ((g1 / height) * sideheight1);
-	b1 = ((b1 / height) * sideheight1);
-
-	r2 = ((r2 / height) * sideheight2);
-	g2 = ((g2 / height) * sideheight2);
-	b2 = ((b2 / height) * sideheight2);
-
-	return D_RGBA((byte)MIN((r1 + r2), 0xff), (byte)MIN((g1 + g2), 0xff), (byte)MIN((b1 + b2), 0xff), 0xff);
+	return (float)sideheight / (float)height;
 }
 
 //
@@ -309,69 +361,182 @@ rcolor R_SplitLineColor(seg_t* line, byte side) {
 
 void R_SetSegLineColor(seg_t* line, vtx_t* v, byte side) {
 	int i;
-	rcolor c[4];
-	byte lwr = LIGHT_LWRWALL;
-	byte upr = LIGHT_UPRWALL;
+	lightvtx_t light[4];
+	lightvtx_t* l = bspLight ? bspLight : light;
+	const short* colors = line->frontsector->colors;
+	int lwr = colors[LIGHT_LWRWALL];
+	int upr = colors[LIGHT_UPRWALL];
 
 	if (line->linedef->flags & ML_BLENDING) {
 		if (line->backsector && side != 0) {
 			if (!(line->linedef->flags & ML_BLENDFULLTOP) && side == 1) {
-				c[2] = R_SplitLineColor(line, 1);
-				c[3] = c[2];
+				R_SetLightVertex(&l[2], colors[LIGHT_UPRWALL], colors[LIGHT_LWRWALL],
+					R_SplitLineBlend(line, 1));
+				l[3] = l[2];
 			}
 			else {
 				if (side == 1 && line->linedef->flags & ML_INVERSEBLEND) {
-					lwr = LIGHT_UPRWALL;
+					lwr = colors[LIGHT_UPRWALL];
 				}
 
-				c[2] = bspColor[lwr];
-				c[3] = bspColor[lwr];
+				R_SetLightVertex(&l[2], lwr, lwr, 1.0f);
+				l[3] = l[2];
 			}
 			if (!(line->linedef->flags & ML_BLENDFULLBOTTOM) && side == 2) {
-				c[0] = R_SplitLineColor(line, 2);
-				c[1] = c[0];
+				R_SetLightVertex(&l[0], colors[LIGHT_UPRWALL], colors[LIGHT_LWRWALL],
+					R_SplitLineBlend(line, 2));
+				l[1] = l[0];
 			}
 			else {
 				if (side == 1 && line->linedef->flags & ML_INVERSEBLEND) {
-					upr = LIGHT_LWRWALL;
+					upr = colors[LIGHT_LWRWALL];
 				}
 
-				c[0] = bspColor[upr];
-				c[1] = bspColor[upr];
+				R_SetLightVertex(&l[0], upr, upr, 1.0f);
+				l[1] = l[0];
 			}
 			if (side == 3) { // midtexture
 				if (line->backsector->ceilingheight < line->frontsector->ceilingheight) {
-					c[0] = R_SplitLineColor(line, 1);
-					c[1] = c[0];
+					R_SetLightVertex(&l[0], colors[LIGHT_UPRWALL], colors[LIGHT_LWRWALL],
+						R_SplitLineBlend(line, 1));
+					l[1] = l[0];
 				}
 				else {
-					c[0] = bspColor[LIGHT_UPRWALL];
-					c[1] = bspColor[LIGHT_UPRWALL];
+					R_SetLightVertex(&l[0], colors[LIGHT_UPRWALL], colors[LIGHT_UPRWALL], 1.0f);
+					l[1] = l[0];
 				}
 				if (line->backsector->floorheight > line->frontsector->floorheight) {
-					c[2] = R_SplitLineColor(line, 2);
-					c[3] = c[2];
+					R_SetLightVertex(&l[2], colors[LIGHT_UPRWALL], colors[LIGHT_LWRWALL],
+						R_SplitLineBlend(line, 2));
+					l[3] = l[2];
 				}
 				else {
-					c[2] = bspColor[LIGHT_LWRWALL];
-					c[3] = bspColor[LIGHT_LWRWALL];
+					R_SetLightVertex(&l[2], colors[LIGHT_LWRWALL], colors[LIGHT_LWRWALL], 1.0f);
+					l[3] = l[2];
 				}
 			}
 		}
 		else {
-			c[0] = bspColor[LIGHT_UPRWALL];
-			c[1] = bspColor[LIGHT_UPRWALL];
-			c[2] = bspColor[LIGHT_LWRWALL];
-			c[3] = bspColor[LIGHT_LWRWALL];
+			R_SetLightVertex(&l[0], upr, upr, 1.0f);
+			R_SetLightVertex(&l[2], lwr, lwr, 1.0f);
+			l[1] = l[0];
+			l[3] = l[2];
 		}
 	}
 	else {
 		for (i = 0; i < 4; i++) {
-			c[i] = bspColor[LIGHT_THING];
+			R_SetLightVertex(&l[i], colors[LIGHT_THING], colors[LIGHT_THING], 1.0f);
 		}
 	}
 
 	for (i = 0; i < 4; i++) {
-		*(rcolor*)&v[i].r = c[i];
+		*(rcolor*)&v[i].r = bspLight ? D_RGBA(0xff, 0xff, 0xff, 0xff) : R_LightVertexColor(&l[i]);
+	}
+}
+
+//
+// R_LightTableEntry
+//
+
+static void R_LightTableEntry(int light, byte* rgba) {
+	if (i_overbright.value) {
+		rgba[0] = rgba[1] = rgba[2] = 0xff;
+	}
+	else {
+		rgba[0] = lights[light].active_r;
+		rgba[1] = lights[light].active_g;
+		rgba[2] = lights[light].active_b;
+	}
+
+	rgba[3] = 0xff;
+}
+
+//
+// R_UpdateLightTable
+// Called every frame; does the work at most once a tic. Returns
+// false if the shader can't light the world, so the renderer
+// should colour vertices itself.
+//
+
+boolean R_UpdateLightTable(void) {
+	static int overbright = -1;
+	int rows;
+	int row;
+	int i;
+
+	if (r_shaderlights.value <= 0 || !numlights || !has_GL_ARB_multitexture ||
+		!I_ShaderLightTableReady()) {
+		return false;
 	}
+
+	if ((int)i_overbright.value != overbright) {
+		overbright = (int)i_overbright.value;
+		lighttabledirty = true;
+	}
+
+	rows = (numlights + LIGHTTABLE_WIDTH - 1) / LIGHTTABLE_WIDTH;
+
+	dglActiveTextureARB(GL_TEXTURE0_ARB + LIGHTTABLE_UNIT);
+
+	if (rows != lighttablerows || !lighttexture || !dglIsTexture(lighttexture)) {
+		lighttablerows = rows;
+		lighttable = Z_Realloc(lighttable, rows * LIGHTTABLE_WIDTH * 4, PU_STATIC, NULL);
+		dmemset(lighttable, 0, rows * LIGHTTABLE_WIDTH * 4);
+
+		for (i = 0; i < numlights; i++) {
+			R_LightTableEntry(i, &lighttable[i * 4]);
+		}
+
+		if (!lighttexture || !dglIsTexture(lighttexture)) {
+			dglGenTextures(1, &lighttexture);
+		}
+
+		dglBindTexture(GL_TEXTURE_2D, lighttexture);
+		dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		dglTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, LIGHTTABLE_WIDTH, rows, 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, lighttable);
+
+		lighttabletic = gametic;
+		lighttabledirty = false;
+	}
+	else {
+		dglBindTexture(GL_TEXTURE_2D, lighttexture);
+	}
+
+	if (lighttabletic != gametic || lighttabledirty) {
+		for (row = 0; row < rows; row++) {
+			int first = LIGHTTABLE_WIDTH;
+			int last = -1;
+			int end = MIN(numlights - row * LIGHTTABLE_WIDTH, LIGHTTABLE_WIDTH);
+
+			for (i = 0; i < end; i++) {
+				byte* entry = &lighttable[(row * LIGHTTABLE_WIDTH + i) * 4];
+				byte rgba[4];
+
+				R_LightTableEntry(row * LIGHTTABLE_WIDTH + i, rgba);
+
+				if (*(rcolor*)rgba != *(rcolor*)entry) {
+					*(rcolor*)entry = *(rcolor*)rgba;
+					first = MIN(first, i);
+					last = i;
+				}
+			}
+
+			if (last >= first) {
+				dglTexSubImage2D(GL_TEXTURE_2D, 0, first, row, last - first + 1, 1,
+					GL_RGBA, GL_UNSIGNED_BYTE, &lighttable[(row * LIGHTTABLE_WIDTH + first) * 4]);
+			}
+		}
+
+		lighttabletic = gametic;
+		lighttabledirty = false;
+	}
+
+	dglActiveTextureARB(GL_TEXTURE0_ARB);
+
+	I_ShaderSetLightTable(LIGHTTABLE_UNIT, LIGHTTABLE_WIDTH, rows);
+	return true;
 }
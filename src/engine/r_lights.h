@@ -20,6 +20,7 @@
 
 #include "gl_main.h"
 #include "t_bsp.h"
+#include "con_cvar.h"
 
 enum {
 	LIGHT_FLOOR,
@@ -29,12 +30,33 @@ enum {
 	LIGHT_LWRWALL
 };
 
-extern rcolor    bspColor[5];
+#define LIGHTTABLE_WIDTH    256
+#define LIGHTTABLE_UNIT     4
+
+//
+// Per vertex light for the world shader: the colour is
+// upper * blend + lower * (1 - blend), both looked up in the
+// light table
+//
+typedef struct {
+	rfloat    upper;
+	rfloat    lower;
+	rfloat    blend;
+} lightvtx_t;
+
+// where wall vertex lights go while walls are drawn with shader
+// lights; NULL when vertex colours are worked out on the CPU
+extern lightvtx_t* bspLight;
+
+CVAR_EXTERNAL(r_shaderlights);
 
 rcolor R_GetSectorLight(byte alpha, word ptr);
 void R_SetLightFactor(float lightfactor);
 void R_RefreshBrightness(void);
 void R_LightToVertex(vtx_t* v, int idx, word c);
+void R_SetLightVertex(lightvtx_t* l, int upper, int lower, float blend);
+rcolor R_LightVertexColor(const lightvtx_t* l);
 void R_SetSegLineColor(seg_t* line, vtx_t* v, byte side);
+boolean R_UpdateLightTable(void);
 
 #endif
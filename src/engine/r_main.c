@@ -20,8 +20,10 @@
 //-----------------------------------------------------------------------------
 
 #include <math.h>
+#include <limits.h>
 
 #include "r_main.h"
+#include "r_cullbench.h"
 #include "doomdef.h"
 #include "doomstat.h"
 #include "r_lights.h"
@@ -39,6 +41,7 @@
 #include "z_zone.h"
 #include "con_console.h"
 #include "r_drawlist.h"
+#include "am_draw.h"
 #include "gl_draw.h"
 #include "w_wad.h"
 #include "dgl.h"
@@ -75,6 +78,13 @@ unsigned int    glBindCalls = 0;
 
 boolean        bRenderSky = false;
 
+// playsim snapshot the current frame interpolates from; NULL when
+// interpolation is off or no tic has been published yet
+const snapshot_t* rsnapshot = NULL;
+
+rsector_t*      rsectors = NULL;
+static int      maxrsectors = 0;
+
 CVAR(r_fov, 74.0);
 CVAR(r_fillmode, 1);
 CVAR(r_fog, 1);
@@ -117,6 +127,7 @@ CVAR_CMD(r_anisotropic, 1) {
 CVAR_EXTERNAL(r_texturecombiner);
 CVAR_EXTERNAL(i_interpolateframes);
 CVAR_EXTERNAL(p_usecontext);
+CVAR_EXTERNAL(r_framesinflight);
 
 //
 // R_PointToAngle
@@ -328,6 +339,8 @@ void R_SetViewOffset(int offset) {
 
 void R_SetupLevel(void) {
 	R_AllocSubsectorBuffer();
+	R_BuildFlatMeshes();
+	AM_SetupLevelLines();
 	R_RefreshBrightness();
 
 	DL_Init();
@@ -480,20 +493,34 @@ void R_SetupFrame(player_t* player) {
 	//
 	// setup view rotation/position
 	//
-	viewcamera = player->cameratarget;
-	angle = (viewcamera->angle + quakeviewx) + viewangleoffset;
-	pitch = viewcamera->pitch + ANG90;
-	cam_z = (viewcamera == player->mo ? player->viewz : viewcamera->z) + quakeviewy;
+	rsnapshot = i_interpolateframes.value ? P_GetSnapshot() : NULL;
+
+	if (rsnapshot) {
+		const snapview_t* prev = &rsnapshot->view[SNAP_PREV];
+		const snapview_t* cur = &rsnapshot->view[SNAP_CUR];
 
-	if (viewcamera == player->mo) {
-		pitch += player->recoilpitch;
+		viewangle = R_Interpolate(cur->angle, prev->angle, true);
+		viewpitch = R_Interpolate(cur->pitch, prev->pitch, true);
+		viewx = R_Interpolate(cur->x, prev->x, true);
+		viewy = R_Interpolate(cur->y, prev->y, true);
+		viewz = R_Interpolate(cur->z, prev->z, true);
 	}
+	else {
+		viewcamera = player->cameratarget;
+		angle = (viewcamera->angle + quakeviewx) + viewangleoffset;
+		pitch = viewcamera->pitch + ANG90;
+		cam_z = (viewcamera == player->mo ? player->viewz : viewcamera->z) + quakeviewy;
 
-	viewangle = R_Interpolate(angle, frame_angle, (int)i_interpolateframes.value);
-	viewpitch = R_Interpolate(pitch, frame_pitch, (int)i_interpolateframes.value);
-	viewx = R_Interpolate(viewcamera->x, frame_viewx, (int)i_interpolateframes.value);
-	viewy = R_Interpolate(viewcamera->y, frame_viewy, (int)i_interpolateframes.value);
-	viewz = R_Interpolate(cam_z, frame_viewz, (int)i_interpolateframes.value);
+		if (viewcamera == player->mo) {
+			pitch += player->recoilpitch;
+		}
+
+		viewangle = angle;
+		viewpitch = pitch;
+		viewx = viewcamera->x;
+		viewy = viewcamera->y;
+		viewz = cam_z;
+	}
 
 	fviewx = F2D3D(viewx);
 	fviewy = F2D3D(viewy);
@@ -513,9 +540,37 @@ void R_SetupFrame(player_t* player) {
 //
 
 static void R_SetViewClipping(angle_t angle) {
+	static fixed_t floorheight;
+	static fixed_t ceilingheight;
+	static int boundstic = -1;
+	const snapshot_t* snap = P_GetSnapshot();
+	int i;
+
 	R_Clipper_Clear();
 	R_Clipper_SafeAddClipRange(viewangle + angle, viewangle - angle);
-	R_FrustrumSetup();
+
+	// node boxes are culled against the whole height of the level;
+	// the snapshot keeps that per tic, covering interpolated frames
+	if (snap && snap->numsectors == numsectors) {
+		floorheight = snap->minfloor;
+		ceilingheight = snap->maxceiling;
+		boundstic = -1;
+	}
+	else if (boundstic != gametic) {
+		// no tic run on this level yet; sectors can't move until one is
+		floorheight = INT_MAX;
+		ceilingheight = INT_MIN;
+
+		for (i = 0; i < numsectors; i++) {
+			floorheight = MIN(floorheight, sectors[i].floorheight);
+			ceilingheight = MAX(ceilingheight, sectors[i].ceilingheight);
+		}
+
+		boundstic = gametic;
+	}
+
+	R_FrustrumSetHeights(floorheight, ceilingheight);
+	R_FrustrumSetup(projmatrix, viewmatrix);
 }
 
 //
@@ -528,16 +583,33 @@ fixed_t R_Interpolate(fixed_t ticframe, fixed_t updateframe, boolean enable) {
 
 //
 // R_InterpolateSectors
+// Fills rsectors from the snapshot, or from the live sectors
+// when the snapshot does not cover this level yet
 //
 
 static void R_InterpolateSectors(void) {
 	int i;
 
-	for (i = 0; i < numsectors; i++) {
-		sector_t* s = &sectors[i];
+	if (numsectors > maxrsectors) {
+		maxrsectors = numsectors;
+		rsectors = Z_Realloc(rsectors, maxrsectors * sizeof(rsector_t), PU_STATIC, NULL);
+	}
+
+	if (rsnapshot && rsnapshot->numsectors == numsectors) {
+		for (i = 0; i < numsectors; i++) {
+			const snapsector_t* ss = &rsnapshot->sectors[i];
 
-		s->frame_z1[1] = R_Interpolate(s->floorheight, s->frame_z1[0], 1);
-		s->frame_z2[1] = R_Interpolate(s->ceilingheight, s->frame_z2[0], 1);
+			rsectors[i].floorheight = R_Interpolate(ss->floorheight[SNAP_CUR],
+				ss->floorheight[SNAP_PREV], true);
+			rsectors[i].ceilingheight = R_Interpolate(ss->ceilingheight[SNAP_CUR],
+				ss->ceilingheight[SNAP_PREV], true);
+		}
+	}
+	else {
+		for (i = 0; i < numsectors; i++) {
+			rsectors[i].floorheight = sectors[i].floorheight;
+			rsectors[i].ceilingheight = sectors[i].ceilingheight;
+		}
 	}
 }
 
@@ -720,6 +792,10 @@ void R_RenderPlayerView(player_t* player) {
 	//
 	R_SetupFrame(player);
 
+	if (cullrecording) {
+		R_CullBenchRecord();
+	}
+
 	//
 	// draw sky
 	//
@@ -739,11 +815,6 @@ void R_RenderPlayerView(player_t* player) {
 	//
 	NetUpdate();
 
-	//
-	// setup clipping
-	//
-	R_SetViewClipping(R_FrustumAngle());
-
 	//
 	// interpolate moving sectors before draw
 	//
@@ -751,6 +822,11 @@ void R_RenderPlayerView(player_t* player) {
 		R_InterpolateSectors();
 	}
 
+	//
+	// setup clipping
+	//
+	R_SetViewClipping(R_FrustumAngle());
+
 	//
 	// traverse BSP for rendering
 	//
@@ -820,5 +896,7 @@ void R_RegisterCvars(void) {
 	CON_CvarRegister(&r_weaponswitch);
 	CON_CvarRegister(&r_colorscale);
 	CON_CvarRegister(&r_texturecombiner);
+	CON_CvarRegister(&r_framesinflight);
+	CON_CvarRegister(&r_shaderlights);
 	CON_CvarRegister(&hud_disablesecretmessages);
 }
@@ -22,6 +22,13 @@
 #include "d_player.h"
 #include "gl_main.h"
 #include "con_cvar.h"
+#include "p_snapshot.h"
+
+// sector heights as drawn this frame
+typedef struct {
+	fixed_t     floorheight;
+	fixed_t     ceilingheight;
+} rsector_t;
 
 extern fixed_t      viewx;
 extern fixed_t      viewy;
@@ -51,6 +58,12 @@ extern unsigned int glBindCalls;
 
 extern boolean     bRenderSky;
 
+extern const snapshot_t* rsnapshot;
+extern rsector_t*   rsectors;
+
+extern rfloat       viewmatrix[16];
+extern rfloat       projmatrix[16];
+
 CVAR_EXTERNAL(r_fov);
 CVAR_EXTERNAL(r_fillmode);
 
@@ -67,9 +80,15 @@ void R_SetupLevel(void);
 void R_SetViewAngleOffset(angle_t angle);
 void R_SetViewOffset(int offset);
 void R_RegisterCvars(void);
+void R_BuildViewMatrices(void);
 void R_SetViewMatrix(void);
+void R_BuildFlatMeshes(void);
+void R_PrintFlatStats(void);
 void R_RenderWorld(void);
 void R_RenderBSPNode(int bspnum);
+boolean R_CheckBBox(fixed_t* bspcoord);
+boolean R_CheckBBoxAngles(fixed_t* bspcoord);
+boolean R_ClipSeg(seg_t* line);
 void R_AllocSubsectorBuffer(void);
 
 #endif
@@ -29,9 +29,12 @@
 #include "r_things.h"
 #include "i_swap.h"
 #include "i_system.h"
+#include "i_shaders.h"
 #include "dgl.h"
 #include "con_cvar.h"
 #include "m_fixed.h"
+#include "z_zone.h"
+#include "con_console.h"
 
 CVAR_EXTERNAL(r_texturecombiner);
 CVAR_EXTERNAL(i_interpolateframes);
@@ -41,6 +44,15 @@ CVAR_EXTERNAL(st_flashoverlay);
 
 int game_world_shader_scope = 0;
 
+// the current view's matrices, kept on the CPU for frustum culling
+rfloat viewmatrix[16];
+rfloat projmatrix[16];
+
+// light table references for drawVertex, used when the shader
+// lights the world
+static lightvtx_t drawLight[MAXDLDRAWCOUNT];
+static boolean shaderlights = false;
+
 extern void I_SectorCombiner_SetFog(int en, float r, float g, float b, float fac);
 extern void I_SectorCombiner_SetFogParams(int mode, float start, float end, float density);
 
@@ -50,15 +62,14 @@ extern void I_SectorCombiner_SetFogParams(int mode, float start, float end, floa
 
 static boolean ProcessWalls(vtxlist_t* vl, int* drawcount) {
 	seg_t* seg = (seg_t*)vl->data;
-	sector_t* sec = seg->frontsector;
 
-	bspColor[LIGHT_FLOOR] = R_GetSectorLight(0xff, sec->colors[LIGHT_FLOOR]);
-	bspColor[LIGHT_CEILING] = R_GetSectorLight(0xff, sec->colors[LIGHT_CEILING]);
-	bspColor[LIGHT_THING] = R_GetSectorLight(0xff, sec->colors[LIGHT_THING]);
-	bspColor[LIGHT_UPRWALL] = R_GetSectorLight(0xff, sec->colors[LIGHT_UPRWALL]);
-	bspColor[LIGHT_LWRWALL] = R_GetSectorLight(0xff, sec->colors[LIGHT_LWRWALL]);
+	boolean ok;
 
-	if (!vl->callback(seg, &drawVertex[*drawcount])) {
+	bspLight = shaderlights ? &drawLight[*drawcount] : NULL;
+	ok = vl->callback(seg, &drawVertex[*drawcount]);
+	bspLight = NULL;
+
+	if (!ok) {
 		return false;
 	}
 
@@ -70,21 +81,118 @@ static boolean ProcessWalls(vtxlist_t* vl, int* drawcount) {
 	return true;
 }
 
+//
+// Flat meshes
+//
+// A leaf's vertices and their texture coordinates never move once
+// the level is loaded, so they are worked out once, in leaf order,
+// and ProcessFlats only adds the height, scroll offset and light.
+//
+
+typedef struct {
+	rfloat    x;
+	rfloat    y;
+	rfloat    tu;
+	rfloat    tv;
+} flatvtx_t;
+
+static flatvtx_t* flatverts = NULL;
+
+static struct {
+	int         subsectors;
+	int         vertices;
+	int         bytes;
+	uint64_t    buildtime;
+} flatstats;
+
+//
+// R_BuildFlatMeshes
+//
+
+void R_BuildFlatMeshes(void) {
+	uint64_t start = I_GetTimeNS();
+	int i;
+	int j;
+
+	flatverts = Z_Malloc(MAX(numleafs, 1) * sizeof(flatvtx_t), PU_LEVEL, &flatverts);
+	flatstats.subsectors = 0;
+	flatstats.vertices = 0;
+
+	for (i = 0; i < numsubsectors; i++) {
+		subsector_t* ss = &subsectors[i];
+		leaf_t* leaf = &leafs[ss->leaf];
+		fixed_t tx;
+		fixed_t ty;
+
+		if (ss->numleafs < 3) {
+			continue;
+		}
+
+		// need to keep texture coords small to avoid
+		// floor 'wobble' due to rounding errors on some cards
+		// make relative to first vertex, not (0,0)
+		// which is arbitary anyway
+
+		tx = (leaf->vertex->x >> 6) & ~(FRACUNIT - 1);
+		ty = (leaf->vertex->y >> 6) & ~(FRACUNIT - 1);
+
+		for (j = 0; j < ss->numleafs; j++, leaf++) {
+			flatvtx_t* fv = &flatverts[ss->leaf + j];
+
+			fv->x = F2D3D(leaf->vertex->x);
+			fv->y = F2D3D(leaf->vertex->y);
+			fv->tu = F2D3D((leaf->vertex->x >> 6) - tx);
+			fv->tv = -F2D3D((leaf->vertex->y >> 6) - ty);
+		}
+
+		flatstats.subsectors++;
+		flatstats.vertices += ss->numleafs;
+	}
+
+	flatstats.bytes = numleafs * sizeof(flatvtx_t);
+	flatstats.buildtime = I_GetTimeNS() - start;
+
+	CON_DPrintf("R_BuildFlatMeshes: %i leafs, %i vertices, %i kb, %.3f ms\n",
+		flatstats.subsectors, flatstats.vertices, flatstats.bytes >> 10,
+		(double)flatstats.buildtime / 1000000.0);
+}
+
+//
+// R_PrintFlatStats
+//
+
+void R_PrintFlatStats(void) {
+	if (!flatverts) {
+		CON_Printf(WHITE, "No level has been loaded\n");
+		return;
+	}
+
+	CON_Printf(GREEN, "Flat meshes:\n");
+	CON_Printf(AQUA, "leafs:       %i\n", flatstats.subsectors);
+	CON_Printf(AQUA, "vertices:    %i\n", flatstats.vertices);
+	CON_Printf(AQUA, "memory:      %i kb\n", flatstats.bytes >> 10);
+	CON_Printf(AQUA, "build time:  %.3f ms\n", (double)flatstats.buildtime / 1000000.0);
+}
+
 //
 // ProcessFlats
 //
 
 static boolean ProcessFlats(vtxlist_t* vl, int* drawcount) {
 	int j;
-	fixed_t tx;
-	fixed_t ty;
-	leaf_t* leaf;
 	subsector_t* ss;
 	sector_t* sector;
+	flatvtx_t* fv;
+	rfloat z;
+	rfloat du;
+	rfloat dv;
+	rcolor color;
+	byte alpha;
+	int idx;
+	int step;
 	int count;
 
 	ss = (subsector_t*)vl->data;
-	leaf = &leafs[ss->leaf];
 	sector = ss->sector;
 	count = *drawcount;
 
@@ -92,79 +200,76 @@ static boolean ProcessFlats(vtxlist_t* vl, int* drawcount) {
 		dglTriangle(count, count + 1 + j, count + 2 + j);
 	}
 
-	// need to keep texture coords small to avoid
-	// floor 'wobble' due to rounding errors on some cards
-	// make relative to first vertex, not (0,0)
-	// which is arbitary anyway
-
-	tx = (leaf->vertex->x >> 6) & ~(FRACUNIT - 1);
-	ty = (leaf->vertex->y >> 6) & ~(FRACUNIT - 1);
-
-	for (j = 0; j < ss->numleafs; j++) {
-		int idx;
-		vtx_t* v = &drawVertex[count];
+	// ceilings are wound the other way round
+	if (vl->flags & DLF_CEILING) {
+		fv = &flatverts[ss->leaf + ss->numleafs - 1];
+		step = -1;
+		idx = sector->colors[LIGHT_CEILING];
 
-		if (vl->flags & DLF_CEILING) {
-			leaf = &leafs[(ss->leaf + (ss->numleafs - 1)) - j];
+		if (i_interpolateframes.value) {
+			z = F2D3D(rsectors[sector - sectors].ceilingheight);
 		}
 		else {
-			leaf = &leafs[ss->leaf + j];
+			z = F2D3D(sector->ceilingheight);
 		}
+	}
+	else {
+		fv = &flatverts[ss->leaf];
+		step = 1;
+		idx = sector->colors[LIGHT_FLOOR];
 
-		v->x = F2D3D(leaf->vertex->x);
-		v->y = F2D3D(leaf->vertex->y);
-
-		if (vl->flags & DLF_CEILING) {
-			if (i_interpolateframes.value) {
-				v->z = F2D3D(sector->frame_z2[1]);
-			}
-			else {
-				v->z = F2D3D(sector->ceilingheight);
-			}
+		if (i_interpolateframes.value) {
+			z = F2D3D(rsectors[sector - sectors].floorheight);
 		}
 		else {
-			if (i_interpolateframes.value) {
-				v->z = F2D3D(sector->frame_z1[1]);
-			}
-			else {
-				v->z = F2D3D(sector->floorheight);
-			}
+			z = F2D3D(sector->floorheight);
 		}
+	}
 
-		v->tu = F2D3D((leaf->vertex->x >> 6) - tx);
-		v->tv = -F2D3D((leaf->vertex->y >> 6) - ty);
+	du = dv = 0;
+	alpha = 0xff;
 
-		// set the mapping offsets for scrolling floors/ceilings
-		if ((!(vl->flags & DLF_CEILING) && sector->flags & MS_SCROLLFLOOR) ||
-			(vl->flags & DLF_CEILING && sector->flags & MS_SCROLLCEILING)) {
-			v->tu += F2D3D(sector->xoffset >> 6);
-			v->tv += F2D3D(sector->yoffset >> 6);
-		}
+	// set the mapping offsets for scrolling floors/ceilings
+	if ((!(vl->flags & DLF_CEILING) && sector->flags & MS_SCROLLFLOOR) ||
+		(vl->flags & DLF_CEILING && sector->flags & MS_SCROLLCEILING)) {
+		du += F2D3D(sector->xoffset >> 6);
+		dv += F2D3D(sector->yoffset >> 6);
+	}
 
-		v->a = 0xff;
+	//
+	// water layer 1
+	//
+	if (vl->flags & DLF_WATER1) {
+		dv -= F2D3D(scrollfrac >> 6);
+		alpha = 0xA0;
+	}
 
-		if (vl->flags & DLF_CEILING) {
-			idx = sector->colors[LIGHT_CEILING];
-		}
-		else {
-			idx = sector->colors[LIGHT_FLOOR];
-		}
+	//
+	// water layer 2
+	//
+	if (vl->flags & DLF_WATER2) {
+		du += F2D3D(scrollfrac >> 6);
+	}
+
+	if (shaderlights) {
+		color = D_RGBA(0xff, 0xff, 0xff, alpha);
+	}
+	else {
+		color = R_GetSectorLight(alpha, idx);
+	}
 
-		R_LightToVertex(v, idx, 1);
+	for (j = 0; j < ss->numleafs; j++, fv += step) {
+		vtx_t* v = &drawVertex[count];
 
-		//
-		// water layer 1
-		//
-		if (vl->flags & DLF_WATER1) {
-			v->tv -= F2D3D(scrollfrac >> 6);
-			v->a = 0xA0;
-		}
+		v->x = fv->x;
+		v->y = fv->y;
+		v->z = z;
+		v->tu = fv->tu + du;
+		v->tv = fv->tv + dv;
+		*(rcolor*)&v->r = color;
 
-		//
-		// water layer 2
-		//
-		if (vl->flags & DLF_WATER2) {
-			v->tu += F2D3D(scrollfrac >> 6);
+		if (shaderlights) {
+			R_SetLightVertex(&drawLight[count], idx, idx, 1.0f);
 		}
 
 		count++;
@@ -257,19 +362,32 @@ static void SetupFog(void) {
 	I_SectorCombiner_SetFog(1, color[0], color[1], color[2], (float)fogfactor / 1000.0f);
 }
 
+//
+// R_BuildViewMatrices
+// Same transforms R_SetViewMatrix used to hand to GL one call at a
+// time, built without touching the driver
+//
+
+void R_BuildViewMatrices(void) {
+	dglMakeViewFrustum(video_width, video_height, r_fov.value, 0.1f, projmatrix);
+
+	dglMatrixIdentity(viewmatrix);
+	dglMatrixRotate(viewmatrix, -TRUEANGLES(viewpitch), 1.0f, 0.0f, 0.0f);
+	dglMatrixRotate(viewmatrix, -TRUEANGLES(viewangle) + 90.0f, 0.0f, 0.0f, 1.0f);
+	dglMatrixTranslate(viewmatrix, -fviewx, -fviewy, -fviewz);
+}
+
 //
 // R_SetViewMatrix
 //
 
 void R_SetViewMatrix(void) {
+	R_BuildViewMatrices();
+
 	dglMatrixMode(GL_PROJECTION);
-	dglLoadIdentity();
-	dglViewFrustum(video_width, video_height, r_fov.value, 0.1f);
+	dglLoadMatrixf(projmatrix);
 	dglMatrixMode(GL_MODELVIEW);
-	dglLoadIdentity();
-	dglRotatef(-TRUEANGLES(viewpitch), 1.0f, 0.0f, 0.0f);
-	dglRotatef(-TRUEANGLES(viewangle) + 90.0f, 0.0f, 0.0f, 1.0f);
-	dglTranslatef(-fviewx, -fviewy, -fviewz);
+	dglLoadMatrixf(viewmatrix);
 }
 
 //
@@ -305,6 +423,11 @@ void R_RenderWorld(void) {
 		GL_SetTextureUnit(0, true);
 	}
 
+	// sector colours come from the light table when the shader can
+	// do the lookup; otherwise they are written into drawVertex
+	shaderlights = R_UpdateLightTable();
+	I_ShaderSetLightArray(shaderlights ? &drawLight[0].upper : NULL, sizeof(lightvtx_t));
+
 	dglEnable(GL_ALPHA_TEST);
 	dglAlphaFunc(GL_GREATER, 0.5f);
 	GL_SetState(GLSTATE_BLEND, 0);
@@ -319,6 +442,8 @@ void R_RenderWorld(void) {
 	DL_ProcessDrawList(DLT_FLAT, ProcessFlats);
 	DL_ProcessDrawList(DLT_WALL, ProcessWalls);
 
+	I_ShaderSetLightArray(NULL, 0);
+
 	if (r_rendersprites.value) {
 		R_SetupSprites();
 		dglBlendFunc(GL_SRC_ALPHA, GL_ONE);
@@ -227,6 +227,157 @@ static void R_TitleSkyTicker(void) {
 // R_DrawSkyDome
 //
 
+#define NUM_SKY_DOME_FACES  32
+#define NUM_SKY_DOMES       4
+
+//
+// Sky domes only depend on their dimensions, so the vertices are
+// built once and kept; only the colors are rewritten when a sky
+// asks for different ones
+//
+
+typedef struct {
+    int     tiles;
+    int     height;
+    int     radius;
+    rcolor  c1;
+    rcolor  c2;
+    vtx_t   vtx[NUM_SKY_DOME_FACES * 4];
+} skydome_t;
+
+static skydome_t skydomes[NUM_SKY_DOMES];
+static int numskydomes = 0;
+static int nextskydome = 0;
+static word skydomeindices[NUM_SKY_DOME_FACES * 6];
+
+//
+// R_SetSkyDomeColor
+//
+
+static void R_SetSkyDomeColor(skydome_t* dome, rcolor c1, rcolor c2) {
+    vtx_t* vtx = dome->vtx;
+    int i;
+
+    for (i = 0; i < NUM_SKY_DOME_FACES; i++, vtx += 4) {
+        dglSetVertexColor(&vtx[0], c2, 1);
+        dglSetVertexColor(&vtx[1], c1, 2);
+        dglSetVertexColor(&vtx[3], c2, 1);
+    }
+
+    dome->c1 = c1;
+    dome->c2 = c2;
+}
+
+//
+// R_BuildSkyDome
+//
+
+static void R_BuildSkyDome(skydome_t* dome, int tiles, int height, int radius) {
+    fixed_t x, y, z;
+    fixed_t lx, ly;
+    fixed_t rx, ry;
+    int i;
+    angle_t an;
+    float tu1, tu2;
+    vtx_t* vtx;
+
+#define SKYDOME_VERTEX() vtx->x = F2D3D(x); vtx->y = F2D3D(y); vtx->z = F2D3D(z)
+#define SKYDOME_UV(u, v) vtx->tu = u; vtx->tv = v
+#define SKYDOME_LEFT(v, h)                      \
+    x = lx;                                     \
+    y = ly;                                     \
+    z = INT2F(h);                               \
+    SKYDOME_UV(-tu1, v);                        \
+    SKYDOME_VERTEX();                           \
+    vtx++
+
+#define SKYDOME_RIGHT(v, h)                     \
+    x = rx;                                     \
+    y = ry;                                     \
+    z = INT2F(h);                               \
+    SKYDOME_UV(-(tu2 * (i + 1)), v);            \
+    SKYDOME_VERTEX();                           \
+    vtx++
+
+    dome->tiles = tiles;
+    dome->height = height;
+    dome->radius = radius;
+
+    vtx = dome->vtx;
+    tu1 = 0;
+    tu2 = (float)tiles / (float)NUM_SKY_DOME_FACES;
+    an = (ANGLE_MAX / NUM_SKY_DOME_FACES);
+
+    for (i = 0; i < NUM_SKY_DOME_FACES; i++) {
+        angle_t a0 = an * i;
+        angle_t a1 = an * (i + 1);
+
+        lx = FixedMul(INT2F(radius), dcos(a0));
+        ly = FixedMul(INT2F(radius), dsin(a0));
+        rx = FixedMul(INT2F(radius), dcos(a1));
+        ry = FixedMul(INT2F(radius), dsin(a1));
+
+        SKYDOME_LEFT(1.0f, -height);
+        SKYDOME_LEFT(0.0f, height);
+        SKYDOME_RIGHT(0.0f, height);
+        SKYDOME_RIGHT(1.0f, -height);
+
+        tu1 += tu2;
+    }
+
+    // the winding is the same for every face
+    for (i = 0; i < NUM_SKY_DOME_FACES; i++) {
+        word* idx = &skydomeindices[i * 6];
+        word base = (word)(i * 4);
+
+        idx[0] = base + 0;
+        idx[1] = base + 1;
+        idx[2] = base + 2;
+        idx[3] = base + 3;
+        idx[4] = base + 0;
+        idx[5] = base + 2;
+    }
+
+#undef SKYDOME_RIGHT
+#undef SKYDOME_LEFT
+#undef SKYDOME_UV
+#undef SKYDOME_VERTEX
+}
+
+//
+// R_GetSkyDome
+//
+
+static skydome_t* R_GetSkyDome(int tiles, int height, int radius, rcolor c1, rcolor c2) {
+    skydome_t* dome;
+    int i;
+
+    for (i = 0; i < numskydomes; i++) {
+        dome = &skydomes[i];
+
+        if (dome->tiles == tiles && dome->height == height && dome->radius == radius) {
+            if (dome->c1 != c1 || dome->c2 != c2) {
+                R_SetSkyDomeColor(dome, c1, c2);
+            }
+
+            return dome;
+        }
+    }
+
+    if (numskydomes < NUM_SKY_DOMES) {
+        dome = &skydomes[numskydomes++];
+    }
+    else {
+        dome = &skydomes[nextskydome];
+        nextskydome = (nextskydome + 1) % NUM_SKY_DOMES;
+    }
+
+    R_BuildSkyDome(dome, tiles, height, radius);
+    R_SetSkyDomeColor(dome, c1, c2);
+
+    return dome;
+}
+
 // atsb: largely rewritten
 
 /* how this works now is that we draw a ring around the 'border' of the void
@@ -239,19 +390,7 @@ skies are also 'only' GL_LINEAR.  GL_NEAREST skies do NOT look good
 static void R_DrawSkyDome(int tiles, float rows, int height,
     int radius, float offset, float topoffs,
     rcolor c1, rcolor c2) {
-    fixed_t x, y, z;
-    fixed_t lx, ly;
-    fixed_t rx, ry;
-    int i;
-    angle_t an;
-    float tu1, tu2;
-    int r;
-    vtx_t* vtx;
-    int count;
-
-    lx = ly = count = 0;
-
-#define NUM_SKY_DOME_FACES  32
+    skydome_t* dome;
 
     GL_SetOrthoScale(1.0f);
 
@@ -307,71 +446,19 @@ static void R_DrawSkyDome(int tiles, float rows, int height,
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, (int)r_skyFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
 #endif
 
-    // void radius of the sky
-    r = radius;
-
-    //
-    // set pointer for the main vertex list
-    //
-    dglSetVertex(drawVertex);
-    vtx = drawVertex;
-
-#define SKYDOME_VERTEX() vtx->x = F2D3D(x); vtx->y = F2D3D(y); vtx->z = F2D3D(z)
-#define SKYDOME_UV(u, v) vtx->tu = u; vtx->tv = v
-#define SKYDOME_LEFT(v, h)                      \
-    x = lx;                                     \
-    y = ly;                                     \
-    z = INT2F(h);                               \
-    SKYDOME_UV(-tu1, v);                        \
-    SKYDOME_VERTEX();                           \
-    vtx++
-
-#define SKYDOME_RIGHT(v, h)                     \
-    x = rx;                                     \
-    y = ry;                                     \
-    z = INT2F(h);                               \
-    SKYDOME_UV(-(tu2 * (i + 1)), v);            \
-    SKYDOME_VERTEX();                           \
-    vtx++
-
-    tu1 = 0;
-    tu2 = (float)tiles / (float)NUM_SKY_DOME_FACES;
-    an = (ANGLE_MAX / NUM_SKY_DOME_FACES);
+    dome = R_GetSkyDome(tiles, height, radius, c1, c2);
 
     //
-    // setup vertex data
+    // draw sky dome
     //
-    for (i = 0; i < NUM_SKY_DOME_FACES; i++) {
-        angle_t a0 = an * i;
-        angle_t a1 = an * (i + 1);
-
-        lx = FixedMul(INT2F(r), dcos(a0));
-        ly = FixedMul(INT2F(r), dsin(a0));
-        rx = FixedMul(INT2F(r), dcos(a1));
-        ry = FixedMul(INT2F(r), dsin(a1));
+    dglSetVertex(dome->vtx);
+    dglDrawElements(GL_TRIANGLES, NUM_SKY_DOME_FACES * 6, GL_UNSIGNED_SHORT, skydomeindices);
+    statdrawcalls++;
 
-        dglSetVertexColor(&vtx[0], c2, 1);
-        dglSetVertexColor(&vtx[1], c1, 1);
-        dglSetVertexColor(&vtx[2], c1, 1);
-        dglSetVertexColor(&vtx[3], c2, 1);
-
-        SKYDOME_LEFT(1.0f, -height);
-        SKYDOME_LEFT(0.0f, height);
-        SKYDOME_RIGHT(0.0f, height);
-        SKYDOME_RIGHT(1.0f, -height);
-
-        dglTriangle(0 + count, 1 + count, 2 + count);
-        dglTriangle(3 + count, 0 + count, 2 + count);
-        count += 4;
-
-        tu1 += tu2;
+    if (devparm) {
+        statindice += NUM_SKY_DOME_FACES * 6;
     }
 
-    //
-    // draw sky dome
-    //
-    dglDrawGeometry(count, drawVertex);
-
     // atsb: the below restore the renderer filter and also pops the depth test back
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, old2DMin);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, old2DMag);
@@ -392,12 +479,6 @@ static void R_DrawSkyDome(int tiles, float rows, int height,
 
     dglCullFace(GL_FRONT);
     GL_SetState(GLSTATE_BLEND, 0);
-
-#undef SKYDOME_RIGHT
-#undef SKYDOME_LEFT
-#undef SKYDOME_UV
-#undef SKYDOME_VERTEX
-#undef NUM_SKY_DOME_FACES
 }
 
 //
@@ -417,7 +498,7 @@ static void R_DrawSimpleSky(int lump, int offset) {
 
     I_ShaderUnBind();
 
-    gfxLmp = GL_BindGfxTexture(lumpinfo[lump].name, true);
+    gfxLmp = GL_BindGfxHandle(GL_GetGfxIdForLump(lump), true);
 
     dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (int)r_skyFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
     dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (int)r_skyFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
@@ -493,7 +574,7 @@ static void R_DrawClouds(void) {
     I_ShaderUnBind();
     GL_SetTextureUnit(0, true);
     R_NeutralizeShaders();
-    GL_BindGfxTexture(lumpinfo[skypicnum].name, true);
+    GL_BindGfxHandle(GL_GetGfxIdForLump(skypicnum), true);
     dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (int)r_skyFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
     dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (int)r_skyFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
 
@@ -690,7 +771,11 @@ static void R_Fire(byte* buffer) {
 // R_InitFire
 //
 
-static rcolor firetexture[FIRESKY_WIDTH * FIRESKY_HEIGHT];
+// the fire palette is a plain gray ramp, so the texture is uploaded
+// as luminance and only when R_Fire has run since the last upload
+static byte firetexture[FIRESKY_WIDTH * FIRESKY_HEIGHT];
+static int firegeneration = 0;
+static int fireuploaded = -1;
 
 void R_InitFire(void) {
     int i;
@@ -711,6 +796,8 @@ void R_InitFire(void) {
     for (i = 0; i < 4096; i++) {
         fireBuffer[i] >>= 4;
     }
+
+    firegeneration++;
 }
 
 //
@@ -720,6 +807,7 @@ void R_InitFire(void) {
 static void R_FireTicker(void) {
     if (leveltime & 1) {
         R_Fire(fireBuffer);
+        firegeneration++;
     }
 }
 
@@ -736,20 +824,6 @@ static void R_DrawFire(void) {
     dtexture t = gfxptr[fireLumpGfxId];
     int i;
 
-    //
-    // copy fire pixel data to texture data array
-    //
-    dmemset(firetexture, 0, sizeof(int) * FIRESKY_WIDTH * FIRESKY_HEIGHT);
-    for (i = 0; i < FIRESKY_WIDTH * FIRESKY_HEIGHT; i++) {
-        byte rgb[3];
-
-        rgb[0] = firePal16[fireBuffer[i]].r;
-        rgb[1] = firePal16[fireBuffer[i]].g;
-        rgb[2] = firePal16[fireBuffer[i]].b;
-
-        firetexture[i] = D_RGBA(rgb[2], rgb[1], rgb[0], 0xff);
-    }
-
     if (!t) {
         dglGenTextures(1, &gfxptr[fireLumpGfxId]);
     }
@@ -769,38 +843,49 @@ static void R_DrawFire(void) {
         glBindCalls++;
     }
 
+    //
+    // copy fire pixel data to texture data array
+    //
+    if (!t || fireuploaded != firegeneration) {
+        for (i = 0; i < FIRESKY_WIDTH * FIRESKY_HEIGHT; i++) {
+            firetexture[i] = firePal16[fireBuffer[i]].r;
+        }
 
-    if (!t) {
-        //
-        // copy data if it didn't exist before
-        //
-        dglTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RGBA8,
-            FIRESKY_WIDTH,
-            FIRESKY_HEIGHT,
-            0,
-            GL_RGBA,
-            GL_UNSIGNED_BYTE,
-            firetexture
-        );
-    }
-    else {
-        //
-        // update texture data
-        //
-        dglTexSubImage2D(
-            GL_TEXTURE_2D,
-            0,
-            0,
-            0,
-            FIRESKY_WIDTH,
-            FIRESKY_HEIGHT,
-            GL_RGBA,
-            GL_UNSIGNED_BYTE,
-            firetexture
-        );
+
+        if (!t) {
+            //
+            // copy data if it didn't exist before
+            //
+            dglTexImage2D(
+                GL_TEXTURE_2D,
+                0,
+                GL_LUMINANCE8,
+                FIRESKY_WIDTH,
+                FIRESKY_HEIGHT,
+                0,
+                GL_LUMINANCE,
+                GL_UNSIGNED_BYTE,
+                firetexture
+            );
+        }
+        else {
+            //
+            // update texture data
+            //
+            dglTexSubImage2D(
+                GL_TEXTURE_2D,
+                0,
+                0,
+                0,
+                FIRESKY_WIDTH,
+                FIRESKY_HEIGHT,
+                GL_LUMINANCE,
+                GL_UNSIGNED_BYTE,
+                firetexture
+            );
+        }
+
+        fireuploaded = firegeneration;
     }
 
     if (r_skybox.value <= 0) {
@@ -853,7 +938,7 @@ void R_DrawSky(void) {
             else {
                 GL_SetTextureUnit(0, true);
                 R_NeutralizeShaders();
-                GL_BindGfxTexture(lumpinfo[skypicnum].name, true);
+                GL_BindGfxHandle(GL_GetGfxIdForLump(skypicnum), true);
                 dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (int)r_skyFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
                 dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (int)r_skyFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
 
@@ -889,7 +974,7 @@ void R_DrawSky(void) {
 
                 GL_SetTextureUnit(0, true);
                 R_NeutralizeShaders();
-                l = GL_BindGfxTexture(lumpinfo[skybackdropnum].name, true);
+                l = GL_BindGfxHandle(GL_GetGfxIdForLump(skybackdropnum), true);
                 dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (int)r_skyFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
                 dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (int)r_skyFilter.value == 0 ? GL_LINEAR : GL_NEAREST);
 
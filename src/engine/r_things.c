@@ -61,7 +61,6 @@ static visspritelist_t* vissprite = NULL;
 
 CVAR_EXTERNAL(r_texturecombiner);
 CVAR_EXTERNAL(st_flashoverlay);
-CVAR_EXTERNAL(i_interpolateframes);
 CVAR_EXTERNAL(v_accessibility);
 CVAR_EXTERNAL(r_rendersprites);
 CVAR_EXTERNAL(r_weaponFilter);
@@ -547,18 +546,43 @@ static void AddSpriteDrawlist(drawlist_t* dl, visspritelist_t* vis, int texid) {
 		| (((unsigned int)(list->flags & 0xFFFF)) << 16));
 }
 
+//
+// R_GetSpritePosition
+// Interpolated from the render snapshot; things the snapshot
+// doesn't know about yet are drawn where they are
+//
+
+static void R_GetSpritePosition(mobj_t* mobj, fixed_t* x, fixed_t* y, fixed_t* z) {
+	const snapmobj_t* sm = P_GetSnapshotMobj(rsnapshot, mobj);
+
+	if (sm) {
+		*x = R_Interpolate(sm->x[SNAP_CUR], sm->x[SNAP_PREV], true);
+		*y = R_Interpolate(sm->y[SNAP_CUR], sm->y[SNAP_PREV], true);
+		*z = R_Interpolate(sm->z[SNAP_CUR], sm->z[SNAP_PREV], true);
+	}
+	else {
+		*x = mobj->x;
+		*y = mobj->y;
+		*z = mobj->z;
+	}
+}
+
 //
 // R_SetupSprites
 //
 
 void R_SetupSprites(void) {
-	boolean interpolate = (int)i_interpolateframes.value;
 	visspritelist_t* vis;
+	fixed_t x;
+	fixed_t y;
+	fixed_t z;
 
 	I_ShaderBind();
 	I_SectorCombiner_Commit();
 
 	for (vis = vissprite - 1; vis >= visspritelist; vis--) {
+		R_GetSpritePosition(vis->spr, &x, &y, &z);
+
 		// Avoid from having the torch poles and fire from z-fighting
 		if (vis->spr->type >= MT_PROP_POLEBASELONG &&
 			vis->spr->type <= MT_PROP_FIREYELLOW) {
@@ -572,12 +596,12 @@ void R_SetupSprites(void) {
 			// move a bit further towards view
 			vis->x = F2D3D(vis->spr->x - FixedMul(FLOATTOFIXED(1.5), dcos(ang)));
 			vis->y = F2D3D(vis->spr->y - FixedMul(FLOATTOFIXED(1.5), dsin(ang)));
-			vis->z = F2D3D(R_Interpolate(vis->spr->z, vis->spr->frame_z, interpolate));
+			vis->z = F2D3D(z);
 		}
 		else {  // normal vis sprite process
-			vis->x = F2D3D(R_Interpolate(vis->spr->x, vis->spr->frame_x, interpolate));
-			vis->y = F2D3D(R_Interpolate(vis->spr->y, vis->spr->frame_y, interpolate));
-			vis->z = F2D3D(R_Interpolate(vis->spr->z, vis->spr->frame_z, interpolate));
+			vis->x = F2D3D(x);
+			vis->y = F2D3D(y);
+			vis->z = F2D3D(z);
 		}
 
 		vis->dist = (int)((vis->x - fviewx) * viewcos[0] +
@@ -666,11 +690,21 @@ void R_DrawPSprite(pspdef_t* psp, sector_t* sector, player_t* player) {
 	GL_SetState(GLSTATE_BLEND, 1);
 
 	// setup vertex data
-	x = (F2D3D(R_Interpolate(psp->sx, psp->frame_x, (int)i_interpolateframes.value))
-		- spriteoffset[spritenum]);
+	if (rsnapshot) {
+		int i = (int)(psp - player->psprites);
+
+		x = F2D3D(R_Interpolate(rsnapshot->psprites[SNAP_CUR][i].sx,
+			rsnapshot->psprites[SNAP_PREV][i].sx, true));
+		y = F2D3D(R_Interpolate(rsnapshot->psprites[SNAP_CUR][i].sy,
+			rsnapshot->psprites[SNAP_PREV][i].sy, true));
+	}
+	else {
+		x = F2D3D(psp->sx);
+		y = F2D3D(psp->sy);
+	}
 
-	y = (F2D3D(R_Interpolate(psp->sy, psp->frame_y, (int)i_interpolateframes.value))
-		- spritetopoffset[spritenum]);
+	x -= spriteoffset[spritenum];
+	y -= spritetopoffset[spritenum];
 
 	if (player->onground) {
 		x += (quakeviewx >> 24);
@@ -21,131 +21,161 @@
 
 #include "r_wipe.h"
 #include "doomdef.h"
-#include "i_system.h"
 #include "gl_texture.h"
 #include "doomstat.h"
 #include "dgl.h"
 #include "m_menu.h"
 
+//
+// The wipe no longer runs its own swap loop. Starting a wipe captures
+// the screen and returns; D_MiniLoop advances it once per tic through
+// WIPE_Ticker and composites it over each frame with WIPE_Drawer.
+// A melt runs WIPEMELTTICS steps and then fades like a plain fade, so
+// the length of either effect is a fixed number of tics
+//
+
+#define WIPEMELTTICS    80
+
 static dtexture wipeMeltTexture = 0;
-static int wipeFadeAlpha = 0;
+static boolean wipeActive = false;
+static int wipeTic = 0;
+static int wipeMeltTics = 0;
+static int wipeMeltStep = 0;
+static int wipeFadeTics = 0;
+static int wipeDuration = 0;
 
 //
-// WIPE_DisplayScreen
+// WIPE_Finish
 //
 
-static void WIPE_RefreshDelay(void) {
-	int starttime = I_GetTime();
-	int tics = 0;
+static void WIPE_Finish(void) {
+	if (!wipeActive) {
+		return;
+	}
+
+	GL_UnloadTexture(&wipeMeltTexture);
 
-	do {
-		tics = I_GetTime() - starttime;
-		//
-		// don't bash the CPU
-		//
-		I_Sleep(1);
-	} while (!tics);
+	wipeActive = false;
+	allowmenu = true;
 }
 
 //
-// WIPE_FadeScreen
+// WIPE_Start
 //
 
-void WIPE_FadeScreen(int fadetics) {
-	int padw, padh;
-	vtx_t v[4];
-	float left, right, top, bottom;
-
-	I_ShaderUnBind();
+static void WIPE_Start(int melttics, int fadetics) {
+	// a new transition replaces one still in progress
+	WIPE_Finish();
 
 	allowmenu = false;
 
-	wipeFadeAlpha = 0xff;
 	wipeMeltTexture = GL_ScreenToTexture();
+	wipeActive = true;
+	wipeTic = 0;
+	wipeMeltTics = melttics;
+	wipeMeltStep = 0;
+	wipeFadeTics = fadetics;
+	wipeDuration = melttics + ((0xff + fadetics - 1) / fadetics);
+}
 
-	padw = GL_PadTextureDims(video_width);
-	padh = GL_PadTextureDims(video_height);
-
-	GL_SetState(GLSTATE_BLEND, 1);
-	dglEnable(GL_TEXTURE_2D);
-
-	//
-	// setup vertex coordinates for plane
-	//
-	left = (float)(ViewWindowX * ViewWidth / video_width);
-	right = left + (SCREENWIDTH * ViewWidth / video_width);
-	top = (float)(ViewWindowY * ViewHeight / video_height);
-	bottom = top + (SCREENHEIGHT * ViewHeight / video_height);
+//
+// WIPE_FadeScreen
+//
 
-	v[0].x = v[2].x = left;
-	v[1].x = v[3].x = right;
-	v[0].y = v[1].y = top;
-	v[2].y = v[3].y = bottom;
+void WIPE_FadeScreen(int fadetics) {
+	WIPE_Start(0, fadetics);
+}
 
-	v[0].z = v[1].z = v[2].z = v[3].z = 0.0f;
+//
+// WIPE_MeltScreen
+//
 
-	v[0].tu = v[2].tu = 0.0f;
-	v[1].tu = v[3].tu = (float)video_width / (float)padw;
-	v[0].tv = v[1].tv = (float)video_height / (float)padh;
-	v[2].tv = v[3].tv = 0.0f;
+void WIPE_MeltScreen(void) {
+	M_ClearMenus();
+	WIPE_Start(WIPEMELTTICS, 6);
+}
 
-	dglBindTexture(GL_TEXTURE_2D, wipeMeltTexture);
+//
+// WIPE_InProgress
+//
 
-	//
-	// begin fade out
-	//
-	while (wipeFadeAlpha > 0) {
-		rcolor color;
+boolean WIPE_InProgress(void) {
+	return wipeActive;
+}
 
-		//
-		// clear frame
-		//
-		GL_ClearView(0xFF000000);
+//
+// WIPE_Ticker
+//
 
-		if (wipeFadeAlpha < 0) {
-			wipeFadeAlpha = 0;
-		}
+void WIPE_Ticker(void) {
+	if (!wipeActive) {
+		return;
+	}
 
-		//
-		// display screen overlay
-		//
-		color = D_RGBA(wipeFadeAlpha, wipeFadeAlpha, wipeFadeAlpha, 0xff);
+	if (++wipeTic >= wipeDuration) {
+		WIPE_Finish();
+	}
+}
 
-		dglSetVertexColor(v, color, 4);
-		GL_Draw2DQuad(v, 1);
+//
+// WIPE_MeltStep
+// Draws the captured screen over itself shifted down by half a pixel
+// per step and copies the result back. Without clearing in between we
+// get the melt from the HOM effect
+//
 
-		GL_SwapBuffers();
+static void WIPE_MeltStep(vtx_t* v, int padw, int padh) {
+	vtx_t v2[4];
+	int j;
 
-		WIPE_RefreshDelay();
+	dmemcpy(v2, v, sizeof(vtx_t) * 4);
 
-		wipeFadeAlpha -= fadetics;
+	for (j = 0; j < 4; j++) {
+		v2[j].y += (float)wipeMeltStep * 0.5f;
 	}
 
-	GL_SetState(GLSTATE_BLEND, 0);
-	GL_UnloadTexture(&wipeMeltTexture);
+	GL_ClearView(0xFF000000);
 
-	allowmenu = true;
+	dglSetVertexColor(v, D_RGBA(1, 0, 0, 0xff), 4);
+	GL_Draw2DQuad(v, 1);
 
-	I_ShaderBind();
+	dglSetVertexColor(v2, D_RGBA(0, 0, 0, 0x10), 4);
+	GL_Draw2DQuad(v2, 1);
+
+	//
+	// update screen buffer
+	//
+	dglCopyTexSubImage2D(
+		GL_TEXTURE_2D,
+		0,
+		0,
+		0,
+		0,
+		0,
+		padw,
+		padh
+	);
+
+	wipeMeltStep++;
 }
 
 //
-// WIPE_MeltScreen
+// WIPE_Drawer
+// Covers whatever was drawn this frame with the captured screen as of
+// the current wipe tic
 //
 
-void WIPE_MeltScreen(void) {
+void WIPE_Drawer(void) {
 	int padw, padh;
 	vtx_t v[4];
-	vtx_t v2[4];
 	float left, right, top, bottom;
-	int i = 0;
-
-	I_ShaderUnBind();
+	int alpha;
 
-	M_ClearMenus();
-	allowmenu = false;
+	if (!wipeActive) {
+		return;
+	}
 
-	wipeMeltTexture = GL_ScreenToTexture();
+	I_ShaderUnBind();
 
 	padw = GL_PadTextureDims(video_width);
 	padh = GL_PadTextureDims(video_height);
@@ -173,61 +203,44 @@ void WIPE_MeltScreen(void) {
 	v[0].tv = v[1].tv = (float)video_height / (float)padh;
 	v[2].tv = v[3].tv = 0.0f;
 
-	dmemcpy(v2, v, sizeof(vtx_t) * 4);
-
 	dglBindTexture(GL_TEXTURE_2D, wipeMeltTexture);
-	GL_SetTextureMode(GL_ADD);
-
-	for (i = 0; i < 160; i += 2) {
-		int j;
-
-		GL_ClearView(0xFF000000);
 
-		dglSetVertexColor(v2, D_RGBA(1, 0, 0, 0xff), 4);
-		GL_Draw2DQuad(v2, 1);
-
-		dglSetVertexColor(v, D_RGBA(0, 0, 0, 0x10), 4);
-		GL_Draw2DQuad(v, 1);
+	//
+	// catch the melt up to the current tic. frames drawn between
+	// tics just redisplay the last step
+	//
+	if (wipeMeltStep < MIN(wipeTic, wipeMeltTics)) {
+		GL_SetTextureMode(GL_ADD);
 
-		//
-		// move screen down. without clearing the frame, we should
-		// get a nice melt effect using the HOM effect
-		//
-		for (j = 0; j < 4; j++) {
-			v[j].y += 0.5f;
+		while (wipeMeltStep < MIN(wipeTic, wipeMeltTics)) {
+			WIPE_MeltStep(v, padw, padh);
 		}
 
-		//
-		// update screen buffer
-		//
-		dglCopyTexSubImage2D(
-			GL_TEXTURE_2D,
-			0,
-			0,
-			0,
-			0,
-			0,
-			padw,
-			padh
-		);
-
-		GL_SwapBuffers();
-
-		WIPE_RefreshDelay();
+		GL_SetTextureMode(GL_MODULATE);
+		GL_SetDefaultCombiner();
 	}
 
 	//
-	// reset combiners and blending
+	// display screen overlay
 	//
-	GL_SetTextureMode(GL_MODULATE);
-	GL_SetDefaultCombiner();
+	alpha = 0xff;
+
+	if (wipeTic > wipeMeltTics) {
+		alpha -= (wipeTic - wipeMeltTics) * wipeFadeTics;
+		if (alpha < 0) {
+			alpha = 0;
+		}
+	}
+
+	GL_ClearView(0xFF000000);
+
+	dglSetVertexColor(v, D_RGBA(alpha, alpha, alpha, 0xff), 4);
+	GL_Draw2DQuad(v, 1);
+
 	GL_SetState(GLSTATE_BLEND, 0);
-	GL_UnloadTexture(&wipeMeltTexture);
 
-	//
-	// fade screen out
-	//
-	WIPE_FadeScreen(6);
+	// the wipe texture was bound behind the texture cache's back
+	GL_ResetTextures();
 
 	I_ShaderBind();
 }
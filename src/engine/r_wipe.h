@@ -18,7 +18,13 @@
 #ifndef D3DF_WIPE_H
 #define D3DF_WIPE_H
 
+#include "doomtype.h"
+
 void WIPE_FadeScreen(int fadetics);
 void WIPE_MeltScreen(void);
 
+boolean WIPE_InProgress(void);
+void WIPE_Ticker(void);
+void WIPE_Drawer(void);
+
 #endif
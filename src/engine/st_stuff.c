@@ -584,6 +584,9 @@ static const float st_key3Vertex[4][2] = {
 	{ ST_KEYX + 20, ST_KEYY + 10 }
 };
 
+static int statushandle = GFX_UNRESOLVED;
+static int crosshairhandle = GFX_UNRESOLVED;
+
 static void ST_DrawStatus(void) {
 	int     lump;
 	float   width;
@@ -592,7 +595,7 @@ static void ST_DrawStatus(void) {
 	const rcolor color = D_RGBA(0x68, 0x68, 0x68, 0x90);
 
 	GL_SetState(GLSTATE_BLEND, 1);
-	lump = GL_BindGfxTexture("STATUS", true);
+	lump = GL_BindGfxHandle(GL_CacheGfxHandle(&statushandle, "STATUS"), true);
 
 	width = (float)gfxwidth[lump];
 	height = (float)gfxheight[lump];
@@ -696,7 +699,7 @@ void ST_DrawCrosshair(int x, int y, int slot, byte scalefactor, rcolor color) {
 
 	index = slot - 1;
 
-	GL_BindGfxTexture("CRSHAIRS", true);
+	GL_BindGfxHandle(GL_CacheGfxHandle(&crosshairhandle, "CRSHAIRS"), true);
 	GL_SetState(GLSTATE_BLEND, 1);
 
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -719,7 +722,7 @@ void ST_DrawCrosshair(int x, int y, int slot, byte scalefactor, rcolor color) {
 static void ST_DrawJMessage(int pic) {
 	int lump = st_jmessages[pic];
 
-	int gfxid = GL_BindGfxTexture(lumpinfo[lump].name, true);
+	int gfxid = GL_BindGfxHandle(GL_GetGfxIdForLump(lump), true);
 	GL_SetState(GLSTATE_BLEND, 1);
 
 	dglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -104,21 +104,33 @@ typedef    struct {
 	// list of mobjs in sector
 	mobj_t* thinglist;
 
+	// list of mobjs whose radius overlaps this sector
+	struct msecnode_s* touching_thinglist;
+
 	// thinker_t for reversable actions
 	void* specialdata;
 
 	int             linecount;
 	struct line_s** lines;    // [linecount] size
 
-	// [kex] stuff that happens in between tics
-	fixed_t         frame_z1[2];
-	fixed_t         frame_z2[2];
-
 	// [kex] plane/normal info for ceiling and floor
 	plane_t         ceilingplane;
 	plane_t         floorplane;
 } sector_t;
 
+//
+// Links a thing to every sector its radius overlaps;
+// each node is on one thing list and one sector list
+//
+typedef struct msecnode_s {
+	sector_t* sector;    // a sector containing this object
+	mobj_t* thing;    // this object
+	struct msecnode_s* tprev;    // prev node in the thing's sector list
+	struct msecnode_s* tnext;    // next node in the thing's sector list
+	struct msecnode_s* sprev;    // prev node in the sector's thing list
+	struct msecnode_s* snext;    // next node in the sector's thing list
+} msecnode_t;
+
 //
 // The SideDef.
 //